@@ -0,0 +1,214 @@
+// Simulates AsyncComputeScheduler's decisions on a synthetic deferred frame and on random frame graphs, comparing the
+// scheduled frame time with running everything on the graphics queue and with the best of every assignment of
+// compute passes to queues. Returns non-zero if a schedule is slower than serial, moves a non-compute pass, or
+// disagrees with its own model.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "AsyncComputeScheduler.h"
+#include "Benchmark.h"
+
+namespace
+{
+using PassId = RenderGraph::PassId;
+using PassType = RenderGraph::PassType;
+using ResourceId = RenderGraph::ResourceId;
+
+struct PassSpec {
+    const char *name;
+    PassType type;
+    float cost; // microseconds
+    std::vector<uint32_t> inputs; // earlier passes whose output it reads
+};
+
+// Every synthetic transient is a 1080p RGBA16Float target; the scheduler only looks at the dependencies.
+RenderGraph::TextureDesc transientTarget()
+{
+    constexpr uint64_t HeapAlignment = 64 << 10;
+    RenderGraph::TextureDesc desc;
+    desc.width = 1920;
+    desc.height = 1080;
+    desc.pixelFormat = 115; // MTL::PixelFormatRGBA16Float
+    desc.size = (uint64_t(desc.width) * desc.height * 8 + HeapAlignment - 1) / HeapAlignment * HeapAlignment;
+    desc.alignment = HeapAlignment;
+    return desc;
+}
+
+// Each pass writes one texture of its own; the last pass writes the imported drawable.
+void buildGraph(RenderGraph &graph, const std::vector<PassSpec> &passes)
+{
+    graph.reset();
+    std::vector<ResourceId> outputs;
+    const ResourceId drawable = graph.importResource("drawable");
+    for (size_t i = 0; i < passes.size(); ++i)
+    {
+        const PassSpec &spec = passes[i];
+        const PassId pass = graph.addPass(spec.name, spec.type, []() {});
+        for (uint32_t input : spec.inputs)
+            graph.read(pass, outputs[input]);
+        const ResourceId output = i + 1 == passes.size() ? drawable : graph.createTexture(spec.name, transientTarget());
+        outputs.push_back(graph.write(pass, output));
+    }
+    graph.compile();
+}
+
+// The shortest modelled frame over every assignment of the surviving compute passes.
+float exhaustiveBest(AsyncComputeScheduler &scheduler, const RenderGraph &graph, const float *pCosts)
+{
+    std::vector<PassId> compute;
+    for (PassId pass : graph.order())
+    {
+        if (graph.pass(pass).type == PassType::Compute)
+            compute.push_back(pass);
+    }
+    std::vector<uint32_t> queues(graph.passCount(), AsyncComputeScheduler::GraphicsQueue);
+    float best = scheduler.simulate(graph, pCosts, queues.data());
+    for (uint32_t mask = 1; mask < (1u << compute.size()); ++mask)
+    {
+        for (size_t i = 0; i < compute.size(); ++i)
+            queues[compute[i]] = (mask >> i) & 1;
+        best = std::min(best, scheduler.simulate(graph, pCosts, queues.data()));
+    }
+    return best;
+}
+
+int failures = 0;
+
+void check(bool condition, const char *what)
+{
+    if (!condition)
+    {
+        ++failures;
+        std::printf("  failed: %s\n", what);
+    }
+}
+
+// Schedules the graph and checks the result against the scheduler's own model.
+void scheduleAndCheck(AsyncComputeScheduler &scheduler, const RenderGraph &graph, const std::vector<float> &costs)
+{
+    scheduler.schedule(graph, costs.data());
+    check(scheduler.scheduledTime() <= scheduler.serialTime(), "scheduled frame slower than serial");
+
+    std::vector<uint32_t> queues(graph.passCount());
+    for (PassId pass = 0; pass < graph.passCount(); ++pass)
+    {
+        queues[pass] = scheduler.queue(pass);
+        check(queues[pass] == AsyncComputeScheduler::GraphicsQueue || graph.pass(pass).type == PassType::Compute,
+              "non-compute pass moved to the compute queue");
+    }
+    check(scheduler.simulate(graph, costs.data(), queues.data()) == scheduler.scheduledTime(),
+          "scheduled time does not match the model");
+}
+
+std::vector<PassSpec> deferredFrame()
+{
+    const PassType Render = PassType::Render, Compute = PassType::Compute;
+    return {
+        {"particles", Compute, 400.0f, {}},
+        {"culling", Compute, 300.0f, {}},
+        {"shadows", Render, 1500.0f, {1}},
+        {"gbuffer", Render, 2000.0f, {1}},
+        {"ssao", Compute, 700.0f, {3}},
+        {"lighting", Render, 1200.0f, {2, 3, 4}},
+        {"particleDraw", Render, 500.0f, {0, 5}},
+        {"bloom", Compute, 600.0f, {6}},
+        {"luminance", Compute, 200.0f, {6}},
+        {"tonemap", Render, 600.0f, {6, 7, 8}},
+    };
+}
+
+std::vector<PassSpec> randomFrame(std::mt19937 &random)
+{
+    static const char *const Names[] = {"p0", "p1", "p2", "p3", "p4", "p5", "p6", "p7",
+                                        "p8", "p9", "p10", "p11", "p12", "p13", "p14", "p15"};
+    std::uniform_real_distribution<float> cost(50.0f, 2000.0f);
+    const uint32_t count = 6 + random() % 10;
+    std::vector<PassSpec> passes;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        PassSpec spec = {Names[i], random() % 5 < 2 ? PassType::Compute : PassType::Render, cost(random), {}};
+        for (uint32_t input = 0; input < i; ++input)
+        {
+            if (random() % 4 == 0)
+                spec.inputs.push_back(input);
+        }
+        passes.push_back(spec);
+    }
+    // Everything reaches the output, so nothing is culled.
+    for (uint32_t i = 0; i + 1 < count; ++i)
+        passes.back().inputs.push_back(i);
+    passes.back().type = PassType::Render;
+    return passes;
+}
+} // namespace
+
+int main()
+{
+    Benchmark::printHeader("AsyncComputeScheduler simulation (frame times in modelled us)");
+
+    RenderGraph graph;
+    const std::vector<PassSpec> deferred = deferredFrame();
+    buildGraph(graph, deferred);
+    std::vector<float> costs;
+    for (const PassSpec &spec : deferred)
+        costs.push_back(spec.cost);
+
+    std::printf("  deferred frame, 10 passes, 15 us event latency\n");
+    for (float efficiency : {0.5f, 0.75f, 0.9f})
+    {
+        AsyncComputeScheduler scheduler({15.0f, efficiency});
+        scheduleAndCheck(scheduler, graph, costs);
+        const float best = exhaustiveBest(scheduler, graph, costs.data());
+        std::printf("    overlap %.2f: serial %.0f, scheduled %.0f (%.1f%% faster), exhaustive best %.0f; async:",
+                    efficiency, scheduler.serialTime(), scheduler.scheduledTime(),
+                    100.0f * (1.0f - scheduler.scheduledTime() / scheduler.serialTime()), best);
+        for (PassId pass : graph.order())
+        {
+            if (scheduler.queue(pass) == AsyncComputeScheduler::ComputeQueue)
+                std::printf(" %s", graph.pass(pass).name.c_str());
+        }
+        std::printf("\n");
+        if (efficiency == 0.5f)
+            check(scheduler.scheduledTime() == scheduler.serialTime(), "a move paid off without any overlap gain");
+    }
+
+    AsyncComputeScheduler scheduler({15.0f, 0.75f});
+    std::mt19937 random(3);
+    constexpr int GraphCount = 500;
+    double gainSum = 0.0, gapSum = 0.0, worstGap = 0.0;
+    for (int i = 0; i < GraphCount; ++i)
+    {
+        const std::vector<PassSpec> passes = randomFrame(random);
+        buildGraph(graph, passes);
+        costs.clear();
+        for (const PassSpec &spec : passes)
+            costs.push_back(spec.cost);
+
+        scheduleAndCheck(scheduler, graph, costs);
+        const float best = exhaustiveBest(scheduler, graph, costs.data());
+        gainSum += 1.0 - scheduler.scheduledTime() / scheduler.serialTime();
+        const double gap = scheduler.scheduledTime() / best - 1.0;
+        gapSum += gap;
+        worstGap = std::max(worstGap, gap);
+    }
+    std::printf("  %d random graphs of 6-15 passes, overlap 0.75: mean gain %.1f%%, gap to exhaustive best mean "
+                "%.2f%%, worst %.1f%%\n",
+                GraphCount, 100.0 * gainSum / GraphCount, 100.0 * gapSum / GraphCount, 100.0 * worstGap);
+
+    buildGraph(graph, deferred);
+    costs.clear();
+    for (const PassSpec &spec : deferred)
+        costs.push_back(spec.cost);
+    Benchmark::printResult("schedule(), deferred frame", Benchmark::nanosecondsPerOperation(1, [&]() {
+                               scheduler.schedule(graph, costs.data());
+                               Benchmark::doNotOptimize(scheduler.scheduledTime());
+                           }));
+
+    if (failures)
+        std::printf("%d checks failed\n", failures);
+    return failures ? 1 : 0;
+}
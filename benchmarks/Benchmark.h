@@ -0,0 +1,58 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+
+// Timing helpers for the micro-benchmarks. Each benchmark is a plain executable that prints its own table; they are
+// built with GraphicsCore on every platform but are not part of the test suite, as their numbers depend on the
+// machine. Build with CMAKE_BUILD_TYPE=Release for representative results.
+namespace Benchmark
+{
+// Keeps the compiler from discarding a result that is otherwise unused.
+template <typename T> inline void doNotOptimize(const T &value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void *pSink;
+    pSink = &value;
+#endif
+}
+
+// Runs body, which performs operationCount operations per call, for at least minSeconds per repetition and returns
+// the fastest of a few repetitions in nanoseconds per operation.
+template <typename Body> double nanosecondsPerOperation(size_t operationCount, Body &&body, double minSeconds = 0.05)
+{
+    using Clock = std::chrono::steady_clock;
+    double best = 1e30;
+    for (int repetition = 0; repetition < 5; ++repetition)
+    {
+        size_t calls = 0;
+        const Clock::time_point start = Clock::now();
+        double elapsed = 0.0;
+        do
+        {
+            body();
+            ++calls;
+            elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+        } while (elapsed < minSeconds);
+        best = std::min(best, elapsed * 1e9 / double(calls * operationCount));
+    }
+    return best;
+}
+
+inline void printHeader(const char *title)
+{
+    std::printf("%s\n", title);
+#ifndef NDEBUG
+    std::printf("  (assertions enabled; build with CMAKE_BUILD_TYPE=Release for representative numbers)\n");
+#endif
+}
+
+inline void printResult(const char *name, double nanoseconds)
+{
+    std::printf("  %-44s %10.2f ns\n", name, nanoseconds);
+}
+} // namespace Benchmark
@@ -0,0 +1,85 @@
+// CascadedShadows with four 1024-texel cascades over 100 units of view depth: update for a moving camera, and
+// cullCasters over 1M bounding spheres scattered across a 1 km square around it, serially and on the JobSystem.
+// Prints how many casters each cascade keeps. Returns non-zero if the two culling paths disagree.
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "Benchmark.h"
+#include "CascadedShadows.h"
+#include "JobSystem.h"
+
+using namespace SimdMath;
+
+namespace
+{
+constexpr size_t CasterCount = 1000000;
+} // namespace
+
+int main()
+{
+    std::mt19937 random(41);
+    std::uniform_real_distribution<float> across(-500.0f, 500.0f), height(0.0f, 30.0f), size(0.5f, 8.0f);
+    std::vector<float> x(CasterCount), y(CasterCount), z(CasterCount), radius(CasterCount);
+    for (size_t i = 0; i < CasterCount; ++i)
+    {
+        x[i] = across(random);
+        y[i] = height(random);
+        z[i] = across(random);
+        radius[i] = size(random);
+    }
+    const FrustumCulling::SphereSoA casters = {x.data(), y.data(), z.data(), radius.data()};
+
+    CascadedShadows shadows(CascadedShadows::Settings{});
+    const float light[3] = {0.4f, -0.8f, -0.3f};
+    float4x4 view = float4x4::lookAt({0.0f, 10.0f, 0.0f}, {30.0f, 5.0f, -60.0f}, {0.0f, 1.0f, 0.0f});
+    const CascadedShadows::Camera camera = {view.data(), 1.0f, 16.0f / 9.0f, 0.1f};
+
+    JobSystem jobs;
+    char title[128];
+    std::snprintf(title, sizeof(title), "CascadedShadows, %u cascades, %zu casters, %u threads", shadows.cascadeCount(),
+                  CasterCount, unsigned(jobs.threadCount()));
+    Benchmark::printHeader(title);
+    float step = 0.0f;
+    const double updateTime = Benchmark::nanosecondsPerOperation(1, [&]() {
+        step += 0.01f;
+        view = float4x4::lookAt({step, 10.0f, -step}, {30.0f + step, 5.0f, -60.0f}, {0.0f, 1.0f, 0.0f});
+        shadows.update(camera, light);
+    });
+    Benchmark::printResult("update, per frame", updateTime);
+
+    view = float4x4::lookAt({0.0f, 10.0f, 0.0f}, {30.0f, 5.0f, -60.0f}, {0.0f, 1.0f, 0.0f});
+    shadows.update(camera, light);
+    std::vector<uint32_t> serial[CascadedShadows::MaxCascades], parallel[CascadedShadows::MaxCascades];
+    uint32_t *ppSerial[CascadedShadows::MaxCascades], *ppParallel[CascadedShadows::MaxCascades];
+    for (uint32_t c = 0; c < CascadedShadows::MaxCascades; ++c)
+    {
+        serial[c].resize(CasterCount);
+        parallel[c].resize(CasterCount);
+        ppSerial[c] = serial[c].data();
+        ppParallel[c] = parallel[c].data();
+    }
+    size_t serialCounts[CascadedShadows::MaxCascades] = {}, parallelCounts[CascadedShadows::MaxCascades] = {};
+
+    const double serialTime = Benchmark::nanosecondsPerOperation(
+        CasterCount, [&]() { shadows.cullCasters(casters, CasterCount, ppSerial, serialCounts); });
+    const double parallelTime = Benchmark::nanosecondsPerOperation(
+        CasterCount, [&]() { shadows.cullCasters(casters, CasterCount, ppParallel, parallelCounts, &jobs); });
+    std::printf("  %-44s %10.3f ms\n", "cullCasters, serial", serialTime * CasterCount * 1e-6);
+    std::printf("  %-44s %10.3f ms\n", "cullCasters, JobSystem", parallelTime * CasterCount * 1e-6);
+    Benchmark::printResult("cullCasters, serial, per caster", serialTime);
+
+    bool match = true;
+    for (uint32_t c = 0; c < shadows.cascadeCount(); ++c)
+    {
+        std::printf("  cascade %u: %zu casters, %.3f units per texel\n", c, serialCounts[c],
+                    shadows.cascade(c).texelSize);
+        match = match && serialCounts[c] == parallelCounts[c] &&
+                std::equal(serial[c].begin(), serial[c].begin() + serialCounts[c], parallel[c].begin());
+    }
+    if (!match)
+        std::printf("  MISMATCH\n");
+    return match ? 0 : 1;
+}
@@ -0,0 +1,70 @@
+// DescriptorTable with the largest capacity a handle can name: filling it from empty, then a steady state of 500k live
+// descriptors where each frame frees 5000 random ones and allocates as many, with three frames in flight. Prints the
+// cost of an allocate, and of an allocate and free pair including the frame's beginFrame. Returns non-zero if the
+// steady state fails an allocation or leaves a live handle invalid.
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "Benchmark.h"
+#include "DescriptorTable.h"
+
+namespace
+{
+constexpr uint32_t Capacity = DescriptorTable::MaxCapacity;
+constexpr uint32_t LiveCount = 500000;
+constexpr uint32_t ChurnPerFrame = 5000;
+} // namespace
+
+int main()
+{
+    const DescriptorTable::Settings settings = {Capacity, 3};
+    char title[128];
+    std::snprintf(title, sizeof(title), "DescriptorTable, %u slots, %u live, %u freed and allocated per frame",
+                  Capacity, LiveCount, ChurnPerFrame);
+    Benchmark::printHeader(title);
+
+    const double fillTime = Benchmark::nanosecondsPerOperation(Capacity, [&]() {
+        DescriptorTable table(settings);
+        table.beginFrame(1);
+        for (uint32_t i = 0; i < Capacity; ++i)
+            Benchmark::doNotOptimize(table.allocate());
+    });
+    Benchmark::printResult("allocate, constructing and filling a table", fillTime);
+
+    DescriptorTable table(settings);
+    std::vector<DescriptorTable::Handle> live(LiveCount);
+    uint64_t frame = 1;
+    table.beginFrame(frame);
+    for (DescriptorTable::Handle &handle : live)
+        handle = table.allocate();
+
+    // Victims are drawn ahead of time, so the loop times only the table.
+    std::mt19937 random(45);
+    std::vector<uint32_t> victims(size_t(ChurnPerFrame) * 64);
+    for (uint32_t &victim : victims)
+        victim = random() % LiveCount;
+    size_t next = 0;
+    bool ok = true;
+    const double churnTime = Benchmark::nanosecondsPerOperation(ChurnPerFrame, [&]() {
+        table.beginFrame(++frame);
+        for (uint32_t i = 0; i < ChurnPerFrame; ++i, next = next + 1 == victims.size() ? 0 : next + 1)
+        {
+            DescriptorTable::Handle &handle = live[victims[next]];
+            table.free(handle);
+            handle = table.allocate();
+            ok = ok && handle != DescriptorTable::InvalidHandle;
+        }
+    });
+    Benchmark::printResult("allocate + free, steady state", churnTime);
+
+    for (DescriptorTable::Handle handle : live)
+        ok = ok && table.valid(handle);
+    const DescriptorTable::Stats stats = table.stats();
+    std::printf("  %u allocated, %u retired, high water %u\n", stats.allocated, stats.retired, stats.highWater);
+
+    if (!ok)
+        std::printf("  ALLOCATION FAILED or INVALID HANDLE\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,164 @@
+// DynamicAABBTree with 100k boxes moving every frame: building the tree, a frame of move() at walking and at fast
+// speeds, a frame of setBounds + refit, and overlap, frustum and ray queries against the result.
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "Benchmark.h"
+#include "DynamicAABBTree.h"
+#include "SimdMath.h"
+
+using namespace SimdMath;
+
+namespace
+{
+constexpr size_t ObjectCount = 100000;
+constexpr float WorldSize = 1000.0f;
+
+struct Object {
+    DynamicAABBTree::ProxyId proxy;
+    float center[3];
+    float velocity[3];
+    float halfSize;
+};
+
+AABB bounds(const Object &object)
+{
+    const float *c = object.center;
+    return {c[0] - object.halfSize, c[1] - object.halfSize, c[2] - object.halfSize,
+            c[0] + object.halfSize, c[1] + object.halfSize, c[2] + object.halfSize};
+}
+
+void advance(Object &object)
+{
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        object.center[axis] += object.velocity[axis];
+        if (object.center[axis] < 0.0f || object.center[axis] > WorldSize)
+            object.velocity[axis] = -object.velocity[axis];
+    }
+}
+
+std::vector<Object> scatter(float speed)
+{
+    std::mt19937 random(9);
+    std::uniform_real_distribution<float> position(0.0f, WorldSize), direction(-1.0f, 1.0f), size(0.5f, 2.0f);
+    std::vector<Object> objects(ObjectCount);
+    for (Object &object : objects)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            object.center[axis] = position(random);
+            object.velocity[axis] = direction(random) * speed;
+        }
+        object.halfSize = size(random);
+    }
+    return objects;
+}
+} // namespace
+
+int main()
+{
+    Benchmark::printHeader("DynamicAABBTree, 100k boxes in a 1 km cube, ns per operation");
+
+    std::vector<Object> objects = scatter(0.05f);
+    Benchmark::printResult("insert, per box", Benchmark::nanosecondsPerOperation(ObjectCount, [&]() {
+                               DynamicAABBTree tree;
+                               for (uint32_t i = 0; i < ObjectCount; ++i)
+                                   objects[i].proxy = tree.insert(bounds(objects[i]), i);
+                               Benchmark::doNotOptimize(tree.height());
+                           }));
+
+    // Speeds in world units per frame, against the default 0.1 margin: 0.05 is a walk at 60 Hz, 0.5 a car.
+    for (float speed : {0.05f, 0.5f})
+    {
+        objects = scatter(speed);
+        DynamicAABBTree tree;
+        for (uint32_t i = 0; i < ObjectCount; ++i)
+            objects[i].proxy = tree.insert(bounds(objects[i]), i);
+
+        size_t moves = 0, reinserts = 0;
+        const double move = Benchmark::nanosecondsPerOperation(ObjectCount, [&]() {
+            for (Object &object : objects)
+            {
+                advance(object);
+                reinserts += tree.move(object.proxy, bounds(object), object.velocity);
+            }
+            moves += ObjectCount;
+        });
+        char name[64];
+        std::snprintf(name, sizeof(name), "move, speed %.2f (%.1f%% reinserted)", speed,
+                      100.0 * double(reinserts) / double(moves));
+        Benchmark::printResult(name, move);
+        std::printf("    %.2f ms per frame of 100k moves, height %d, area ratio %.1f\n", move * 1e-6 * ObjectCount,
+                    tree.height(), tree.areaRatio());
+
+        const double refit = Benchmark::nanosecondsPerOperation(ObjectCount, [&]() {
+            for (Object &object : objects)
+            {
+                advance(object);
+                tree.setBounds(object.proxy, bounds(object));
+            }
+            tree.refit();
+        });
+        std::snprintf(name, sizeof(name), "setBounds + refit, speed %.2f", speed);
+        Benchmark::printResult(name, refit);
+        std::printf("    %.2f ms per frame of 100k moves, area ratio %.1f\n", refit * 1e-6 * ObjectCount,
+                    tree.areaRatio());
+    }
+
+    // Queries against the slow scene, rebuilt so refit has not loosened it.
+    objects = scatter(0.05f);
+    DynamicAABBTree tree;
+    for (uint32_t i = 0; i < ObjectCount; ++i)
+        objects[i].proxy = tree.insert(bounds(objects[i]), i);
+
+    std::mt19937 random(4);
+    std::uniform_real_distribution<float> position(0.0f, WorldSize), unit(-1.0f, 1.0f);
+    std::vector<uint32_t> results;
+    constexpr size_t QueryCount = 1000;
+    std::vector<AABB> queries(QueryCount);
+    for (AABB &query : queries)
+    {
+        const float x = position(random), y = position(random), z = position(random);
+        query = {x - 10.0f, y - 10.0f, z - 10.0f, x + 10.0f, y + 10.0f, z + 10.0f};
+    }
+    size_t hits = 0;
+    const double overlap = Benchmark::nanosecondsPerOperation(QueryCount, [&]() {
+        for (const AABB &query : queries)
+        {
+            results.clear();
+            tree.queryOverlap(query, results);
+            hits += results.size();
+        }
+    });
+    Benchmark::printResult("queryOverlap, 20 m box", overlap);
+
+    const float4x4 viewProjection = float4x4::perspective(1.0f, 16.0f / 9.0f, 0.5f, 400.0f) *
+                                    float4x4::lookAt({500.0f, 500.0f, -50.0f}, {500.0f, 500.0f, 500.0f},
+                                                     {0.0f, 1.0f, 0.0f});
+    const Frustum frustum = Frustum::fromViewProjection(viewProjection.data());
+    const double frustumQuery = Benchmark::nanosecondsPerOperation(1, [&]() {
+        results.clear();
+        tree.queryFrustum(frustum, results);
+    });
+    char name[64];
+    std::snprintf(name, sizeof(name), "queryFrustum, %zu visible", results.size());
+    Benchmark::printResult(name, frustumQuery);
+
+    std::vector<float> rays(QueryCount * 6);
+    for (size_t i = 0; i < QueryCount; ++i)
+    {
+        float *pRay = &rays[i * 6];
+        pRay[0] = position(random), pRay[1] = position(random), pRay[2] = 0.0f;
+        pRay[3] = unit(random) * 0.2f, pRay[4] = unit(random) * 0.2f, pRay[5] = 1.0f;
+    }
+    const double pick = Benchmark::nanosecondsPerOperation(QueryCount, [&]() {
+        for (size_t i = 0; i < QueryCount; ++i)
+            hits += tree.pick(&rays[i * 6], &rays[i * 6 + 3], WorldSize) != DynamicAABBTree::InvalidProxy;
+    });
+    Benchmark::printResult("pick, ray through the cube", pick);
+    Benchmark::doNotOptimize(hits);
+    return 0;
+}
@@ -0,0 +1,170 @@
+// EntityWorld against the naive layout it replaces, a std::vector<Object *> of individually allocated objects:
+// one movement update over 1M entities, creating and destroying 100k entities, and adding and removing a component
+// on 100k of them. The naive objects are updated both in allocation order and shuffled, as they end up after a
+// while of churn. Returns non-zero if the two layouts disagree on the updated positions.
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "Benchmark.h"
+#include "EntityWorld.h"
+#include "JobSystem.h"
+
+namespace
+{
+constexpr size_t EntityCount = 1000000;
+constexpr size_t ChurnCount = 100000;
+constexpr float TimeStep = 1.0f / 60.0f;
+
+struct Position {
+    float x, y, z;
+};
+
+struct Velocity {
+    float x, y, z;
+};
+
+struct Health {
+    float value;
+};
+
+struct Burning {
+    float damagePerSecond;
+};
+
+// The naive entity: every component in one heap object, optional ones behind their own allocation.
+struct Object {
+    Position position;
+    Velocity velocity;
+    Health health;
+    std::unique_ptr<Burning> pBurning;
+    size_t slot; // index in the owning vector, for swap-and-pop removal
+};
+
+void move(Position &p, const Velocity &v)
+{
+    p.x += v.x * TimeStep;
+    p.y += v.y * TimeStep;
+    p.z += v.z * TimeStep;
+}
+} // namespace
+
+int main()
+{
+    std::mt19937 random(23);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    EntityWorld world;
+    std::vector<Object *> objects;
+    std::vector<Entity> entities;
+    objects.reserve(EntityCount);
+    for (size_t i = 0; i < EntityCount; ++i)
+    {
+        const Position p = {unit(random) * 100.0f, unit(random) * 100.0f, unit(random) * 100.0f};
+        const Velocity v = {unit(random), unit(random), unit(random)};
+        entities.push_back(world.create(p, v, Health{100.0f}));
+        objects.push_back(new Object{p, v, {100.0f}, nullptr, i});
+    }
+    std::vector<Object *> shuffled = objects;
+    std::shuffle(shuffled.begin(), shuffled.end(), random);
+    JobSystem jobs;
+
+    Benchmark::printHeader("EntityWorld vs std::vector<Object *>, ns per entity");
+    const double worldForEach = Benchmark::nanosecondsPerOperation(EntityCount, [&]() {
+        world.forEach<Position, const Velocity>([](Entity, Position &p, const Velocity &v) { move(p, v); });
+    });
+    const double worldChunks = Benchmark::nanosecondsPerOperation(EntityCount, [&]() {
+        world.forEachChunk<Position, const Velocity>(
+            [](size_t count, const Entity *, Position *pPositions, const Velocity *pVelocities) {
+                for (size_t i = 0; i < count; ++i)
+                    move(pPositions[i], pVelocities[i]);
+            });
+    });
+    const double worldParallel = Benchmark::nanosecondsPerOperation(EntityCount, [&]() {
+        world.parallelForEach<Position, const Velocity>(jobs,
+                                                        [](Entity, Position &p, const Velocity &v) { move(p, v); });
+    });
+    const double naiveOrdered = Benchmark::nanosecondsPerOperation(EntityCount, [&]() {
+        for (Object *pObject : objects)
+            move(pObject->position, pObject->velocity);
+    });
+    const double naiveShuffled = Benchmark::nanosecondsPerOperation(EntityCount, [&]() {
+        for (Object *pObject : shuffled)
+            move(pObject->position, pObject->velocity);
+    });
+    Benchmark::printResult("update, EntityWorld::forEach", worldForEach);
+    Benchmark::printResult("update, EntityWorld::forEachChunk", worldChunks);
+    Benchmark::printResult("update, EntityWorld::parallelForEach", worldParallel);
+    Benchmark::printResult("update, vector<Object *> in allocation order", naiveOrdered);
+    Benchmark::printResult("update, vector<Object *> shuffled", naiveShuffled);
+
+    // Both layouts ran a different number of updates; bring them to the same state and compare.
+    for (size_t i = 0; i < EntityCount; ++i)
+    {
+        *world.get<Position>(entities[i]) = objects[i]->position;
+        move(*world.get<Position>(entities[i]), *world.get<Velocity>(entities[i]));
+        move(objects[i]->position, objects[i]->velocity);
+    }
+    bool match = true;
+    for (size_t i = 0; i < EntityCount; i += 101)
+    {
+        const Position &a = *world.get<Position>(entities[i]), &b = objects[i]->position;
+        match &= a.x == b.x && a.y == b.y && a.z == b.z;
+    }
+
+    // Churn: create and destroy ChurnCount entities in random order.
+    std::vector<Entity> spawned(ChurnCount);
+    std::vector<size_t> order(ChurnCount);
+    for (size_t i = 0; i < ChurnCount; ++i)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), random);
+    const double worldChurn = Benchmark::nanosecondsPerOperation(ChurnCount, [&]() {
+        for (size_t i = 0; i < ChurnCount; ++i)
+            spawned[i] = world.create(Position{}, Velocity{}, Health{100.0f});
+        for (size_t i : order)
+            world.destroy(spawned[i]);
+    });
+    std::vector<Object *> spawnedObjects(ChurnCount);
+    const double naiveChurn = Benchmark::nanosecondsPerOperation(ChurnCount, [&]() {
+        for (size_t i = 0; i < ChurnCount; ++i)
+        {
+            spawnedObjects[i] = new Object{{}, {}, {100.0f}, nullptr, objects.size()};
+            objects.push_back(spawnedObjects[i]);
+        }
+        for (size_t i : order)
+        {
+            Object *pObject = spawnedObjects[i];
+            objects[pObject->slot] = objects.back();
+            objects[pObject->slot]->slot = pObject->slot;
+            objects.pop_back();
+            delete pObject;
+        }
+    });
+    Benchmark::printResult("create + destroy, EntityWorld", worldChurn);
+    Benchmark::printResult("create + destroy, vector<Object *>", naiveChurn);
+
+    // A status effect: add and remove an optional component on ChurnCount existing entities.
+    const double worldAddRemove = Benchmark::nanosecondsPerOperation(ChurnCount, [&]() {
+        for (size_t i = 0; i < ChurnCount; ++i)
+            world.add(entities[i * 7], Burning{5.0f});
+        for (size_t i = 0; i < ChurnCount; ++i)
+            world.remove<Burning>(entities[i * 7]);
+    });
+    const double naiveAddRemove = Benchmark::nanosecondsPerOperation(ChurnCount, [&]() {
+        for (size_t i = 0; i < ChurnCount; ++i)
+            shuffled[i * 7]->pBurning = std::make_unique<Burning>(Burning{5.0f});
+        for (size_t i = 0; i < ChurnCount; ++i)
+            shuffled[i * 7]->pBurning.reset();
+    });
+    Benchmark::printResult("add + remove component, EntityWorld", worldAddRemove);
+    Benchmark::printResult("add + remove component, vector<Object *>", naiveAddRemove);
+
+    for (Object *pObject : objects)
+        delete pObject;
+    if (!match)
+        std::printf("  MISMATCH\n");
+    return match ? 0 : 1;
+}
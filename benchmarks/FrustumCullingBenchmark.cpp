@@ -0,0 +1,119 @@
+// FrustumCulling over 1M spheres and 1M boxes scattered through a 400-unit field, seen from inside it and from its
+// edge, on one thread and across the JobSystem. The Float8 back end is whatever the build flags select; configure
+// with CMAKE_CXX_FLAGS=-mavx (or -march=native) to measure AVX. Returns non-zero if a visible list differs from the
+// scalar Frustum::intersects tests.
+
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "Benchmark.h"
+#include "FrustumCulling.h"
+#include "JobSystem.h"
+#include "SimdMath.h"
+
+using namespace SimdMath;
+
+namespace
+{
+constexpr size_t ObjectCount = 1000000;
+
+const char *backEnd()
+{
+#if defined(__AVX__)
+    return "AVX";
+#elif defined(__SSE__)
+    return "SSE";
+#elif defined(__ARM_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
+} // namespace
+
+int main()
+{
+    std::vector<float> x(ObjectCount), y(ObjectCount), z(ObjectCount), radius(ObjectCount);
+    std::vector<float> minX(ObjectCount), minY(ObjectCount), minZ(ObjectCount);
+    std::vector<float> maxX(ObjectCount), maxY(ObjectCount), maxZ(ObjectCount);
+    std::mt19937 random(9);
+    std::uniform_real_distribution<float> field(-200.0f, 200.0f), size(0.1f, 2.0f);
+    for (size_t i = 0; i < ObjectCount; ++i)
+    {
+        x[i] = field(random);
+        y[i] = field(random) * 0.1f;
+        z[i] = field(random);
+        radius[i] = size(random);
+        minX[i] = x[i] - radius[i];
+        minY[i] = y[i] - radius[i] * 0.5f;
+        minZ[i] = z[i] - radius[i];
+        maxX[i] = x[i] + radius[i];
+        maxY[i] = y[i] + radius[i] * 0.5f;
+        maxZ[i] = z[i] + radius[i];
+    }
+    const FrustumCulling::SphereSoA spheres = {x.data(), y.data(), z.data(), radius.data()};
+    const FrustumCulling::AABBSoA boxes = {minX.data(), minY.data(), minZ.data(),
+                                           maxX.data(), maxY.data(), maxZ.data()};
+
+    struct View {
+        const char *name;
+        float3 eye, target;
+    };
+    const View views[] = {{"inside the field", {0.0f, 2.0f, 0.0f}, {50.0f, 0.0f, -80.0f}},
+                          {"from the edge", {0.0f, 20.0f, 210.0f}, {0.0f, 0.0f, 0.0f}}};
+
+    std::vector<uint32_t> visible(ObjectCount);
+    JobSystem jobs;
+    bool match = true;
+    char title[128];
+    std::snprintf(title, sizeof(title), "FrustumCulling, 1M objects, %s, %u worker threads, ms per cull", backEnd(),
+                  std::thread::hardware_concurrency());
+    Benchmark::printHeader(title);
+    for (const View &view : views)
+    {
+        const float4x4 viewProjection = float4x4::perspective(1.0f, 16.0f / 9.0f, 0.1f, 500.0f) *
+                                        float4x4::lookAt(view.eye, view.target, {0.0f, 1.0f, 0.0f});
+        const Frustum frustum = Frustum::fromViewProjection(viewProjection.data());
+
+        const size_t sphereCount = FrustumCulling::cullSpheres(frustum, spheres, ObjectCount, visible.data(), &jobs);
+        size_t o = 0;
+        for (uint32_t i = 0; i < ObjectCount; ++i)
+        {
+            if (frustum.intersects(Sphere{x[i], y[i], z[i], radius[i]}))
+                match &= o < sphereCount && visible[o++] == i;
+        }
+        match &= o == sphereCount;
+        const size_t boxCount = FrustumCulling::cullAABBs(frustum, boxes, ObjectCount, visible.data(), &jobs);
+        o = 0;
+        for (uint32_t i = 0; i < ObjectCount; ++i)
+        {
+            if (frustum.intersects(AABB{minX[i], minY[i], minZ[i], maxX[i], maxY[i], maxZ[i]}))
+                match &= o < boxCount && visible[o++] == i;
+        }
+        match &= o == boxCount;
+
+        const double sphereSerial = Benchmark::nanosecondsPerOperation(ObjectCount, [&]() {
+            Benchmark::doNotOptimize(FrustumCulling::cullSpheres(frustum, spheres, ObjectCount, visible.data()));
+        });
+        const double sphereParallel = Benchmark::nanosecondsPerOperation(ObjectCount, [&]() {
+            Benchmark::doNotOptimize(FrustumCulling::cullSpheres(frustum, spheres, ObjectCount, visible.data(), &jobs));
+        });
+        const double boxSerial = Benchmark::nanosecondsPerOperation(ObjectCount, [&]() {
+            Benchmark::doNotOptimize(FrustumCulling::cullAABBs(frustum, boxes, ObjectCount, visible.data()));
+        });
+        const double boxParallel = Benchmark::nanosecondsPerOperation(ObjectCount, [&]() {
+            Benchmark::doNotOptimize(FrustumCulling::cullAABBs(frustum, boxes, ObjectCount, visible.data(), &jobs));
+        });
+        std::printf(" %s: %zu spheres, %zu boxes visible\n", view.name, sphereCount, boxCount);
+        std::printf("  %-44s %10.3f ms\n", "cullSpheres, one thread", sphereSerial * ObjectCount * 1e-6);
+        std::printf("  %-44s %10.3f ms\n", "cullSpheres, JobSystem", sphereParallel * ObjectCount * 1e-6);
+        std::printf("  %-44s %10.3f ms\n", "cullAABBs, one thread", boxSerial * ObjectCount * 1e-6);
+        std::printf("  %-44s %10.3f ms\n", "cullAABBs, JobSystem", boxParallel * ObjectCount * 1e-6);
+    }
+
+    if (!match)
+        std::printf("  MISMATCH\n");
+    return match ? 0 : 1;
+}
@@ -0,0 +1,199 @@
+// GeometryCodec on a corpus of generated meshes: compression ratio and decode throughput of the vertex streams and
+// index buffers, next to memcpy of the decoded bytes. For the vertex streams it also reports the order-0 entropy of
+// each byte plane's deltas, the size an ideal entropy coder over the same deltas would reach, to show what an entropy
+// stage after the delta coding could still gain. Returns non-zero if a mesh does not round-trip.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Benchmark.h"
+#include "GeometryCodec.h"
+
+namespace
+{
+struct Mesh {
+    const char *name;
+    std::vector<float> positions;  // float4 per vertex, as the renderer's position stream
+    std::vector<float> attributes; // normal and texture coordinates, 8 floats per vertex
+    std::vector<uint32_t> indices;
+};
+
+constexpr size_t PositionStride = 4 * sizeof(float);
+constexpr size_t AttributeStride = 8 * sizeof(float);
+
+// A grid of columns x rows vertices mapped through surface, triangulated row by row.
+template <typename Surface> Mesh grid(const char *name, uint32_t columns, uint32_t rows, Surface &&surface)
+{
+    Mesh mesh{name, {}, {}, {}};
+    for (uint32_t y = 0; y < rows; ++y)
+    {
+        for (uint32_t x = 0; x < columns; ++x)
+        {
+            const float u = float(x) / float(columns - 1), v = float(y) / float(rows - 1);
+            float position[3], normal[3];
+            surface(u, v, position, normal);
+            mesh.positions.insert(mesh.positions.end(), {position[0], position[1], position[2], 1.0f});
+            mesh.attributes.insert(mesh.attributes.end(), {normal[0], normal[1], normal[2], 0.0f, u, v, 0.0f, 0.0f});
+        }
+    }
+    for (uint32_t y = 0; y + 1 < rows; ++y)
+    {
+        for (uint32_t x = 0; x + 1 < columns; ++x)
+        {
+            const uint32_t i = y * columns + x;
+            mesh.indices.insert(mesh.indices.end(), {i, i + columns, i + 1, i + 1, i + columns, i + columns + 1});
+        }
+    }
+    return mesh;
+}
+
+std::vector<Mesh> corpus()
+{
+    constexpr float Pi = 3.14159265f;
+    std::vector<Mesh> meshes;
+    meshes.push_back(grid("sphere 256x128", 256, 128, [](float u, float v, float *p, float *n) {
+        const float theta = u * 2.0f * Pi, phi = v * Pi;
+        n[0] = std::sin(phi) * std::cos(theta);
+        n[1] = std::cos(phi);
+        n[2] = std::sin(phi) * std::sin(theta);
+        for (int i = 0; i < 3; ++i)
+            p[i] = n[i] * 2.5f;
+    }));
+    meshes.push_back(grid("torus 384x96", 384, 96, [](float u, float v, float *p, float *n) {
+        const float theta = u * 2.0f * Pi, phi = v * 2.0f * Pi;
+        n[0] = std::cos(phi) * std::cos(theta);
+        n[1] = std::sin(phi);
+        n[2] = std::cos(phi) * std::sin(theta);
+        p[0] = (3.0f + std::cos(phi)) * std::cos(theta);
+        p[1] = std::sin(phi);
+        p[2] = (3.0f + std::cos(phi)) * std::sin(theta);
+    }));
+    meshes.push_back(grid("terrain 257x257", 257, 257, [](float u, float v, float *p, float *n) {
+        const float height = 0.3f * std::sin(u * 17.0f) * std::cos(v * 13.0f) + 0.05f * std::sin(u * 97.0f + v * 61.0f);
+        p[0] = u * 256.0f;
+        p[1] = height * 20.0f;
+        p[2] = v * 256.0f;
+        n[0] = -0.3f * 17.0f * std::cos(u * 17.0f) * std::cos(v * 13.0f);
+        n[1] = 1.0f;
+        n[2] = 0.3f * 13.0f * std::sin(u * 17.0f) * std::sin(v * 13.0f);
+        const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        for (int i = 0; i < 3; ++i)
+            n[i] /= length;
+    }));
+
+    // The sphere with its triangles shuffled, as a mesh no one optimized for locality would be.
+    Mesh shuffled = meshes[0];
+    shuffled.name = "sphere, triangles shuffled";
+    std::vector<uint32_t> order(shuffled.indices.size() / 3);
+    for (uint32_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937(3));
+    for (size_t t = 0; t < order.size(); ++t)
+        std::memcpy(&shuffled.indices[t * 3], &meshes[0].indices[order[t] * 3], 3 * sizeof(uint32_t));
+    meshes.push_back(std::move(shuffled));
+    return meshes;
+}
+
+// Bytes an ideal order-0 coder needs for the zigzagged deltas of every byte plane, each plane with its own model.
+double planeEntropyBytes(const void *pVertices, size_t vertexCount, size_t vertexSize)
+{
+    const uint8_t *pBytes = static_cast<const uint8_t *>(pVertices);
+    double bits = 0.0;
+    for (size_t k = 0; k < vertexSize; ++k)
+    {
+        size_t histogram[256] = {};
+        uint8_t previous = 0;
+        for (size_t i = 0; i < vertexCount; ++i)
+        {
+            const uint8_t delta = uint8_t(pBytes[i * vertexSize + k] - previous);
+            previous = pBytes[i * vertexSize + k];
+            ++histogram[uint8_t((delta << 1) ^ uint8_t(int8_t(delta) >> 7))];
+        }
+        for (size_t count : histogram)
+        {
+            if (count)
+                bits -= double(count) * std::log2(double(count) / double(vertexCount));
+        }
+    }
+    return bits / 8.0;
+}
+
+double gigabytesPerSecond(size_t bytes, double nanoseconds) { return double(bytes) / nanoseconds; }
+} // namespace
+
+int main()
+{
+    Benchmark::printHeader("GeometryCodec decode, GB/s of decoded data");
+    std::printf("  %-28s %-9s %9s %9s %7s %9s %8s %8s\n", "mesh", "stream", "raw KB", "coded KB", "ratio", "ideal KB",
+                "decode", "memcpy");
+
+    bool match = true;
+    GeometryCodec::Stats vertexTotals, indexTotals;
+    double idealTotal = 0.0;
+    for (const Mesh &mesh : corpus())
+    {
+        const size_t vertexCount = mesh.positions.size() / 4;
+        struct Stream {
+            const char *name;
+            const void *pData;
+            size_t stride;
+        };
+        const Stream streams[] = {{"position", mesh.positions.data(), PositionStride},
+                                  {"attribute", mesh.attributes.data(), AttributeStride}};
+        for (const Stream &stream : streams)
+        {
+            GeometryCodec::Stats stats;
+            const std::vector<uint8_t> encoded =
+                GeometryCodec::encodeVertexBuffer(stream.pData, vertexCount, stream.stride, &stats);
+            vertexTotals.rawSize += stats.rawSize;
+            vertexTotals.encodedSize += stats.encodedSize;
+            const double ideal = planeEntropyBytes(stream.pData, vertexCount, stream.stride);
+            idealTotal += ideal;
+
+            std::vector<uint8_t> decoded(stats.rawSize), copied(stats.rawSize);
+            match &= GeometryCodec::decodeVertexBuffer(decoded.data(), vertexCount, stream.stride, encoded.data(),
+                                                       encoded.size());
+            match &= std::memcmp(decoded.data(), stream.pData, stats.rawSize) == 0;
+            const double decode = Benchmark::nanosecondsPerOperation(1, [&]() {
+                GeometryCodec::decodeVertexBuffer(decoded.data(), vertexCount, stream.stride, encoded.data(),
+                                                  encoded.size());
+                Benchmark::doNotOptimize(decoded[0]);
+            });
+            const double copy = Benchmark::nanosecondsPerOperation(1, [&]() {
+                std::memcpy(copied.data(), stream.pData, stats.rawSize);
+                Benchmark::doNotOptimize(copied[0]);
+            });
+            std::printf("  %-28s %-9s %9.1f %9.1f %6.2fx %9.1f %6.2f %8.2f\n", mesh.name, stream.name,
+                        stats.rawSize / 1024.0, stats.encodedSize / 1024.0, stats.ratio(), ideal / 1024.0,
+                        gigabytesPerSecond(stats.rawSize, decode), gigabytesPerSecond(stats.rawSize, copy));
+        }
+
+        GeometryCodec::Stats stats;
+        const std::vector<uint8_t> encoded =
+            GeometryCodec::encodeIndexBuffer(mesh.indices.data(), mesh.indices.size(), &stats);
+        indexTotals.rawSize += stats.rawSize;
+        indexTotals.encodedSize += stats.encodedSize;
+        std::vector<uint32_t> decoded(mesh.indices.size());
+        match &= GeometryCodec::decodeIndexBuffer(decoded.data(), decoded.size(), sizeof(uint32_t), encoded.data(),
+                                                  encoded.size());
+        match &= decoded == mesh.indices;
+        const double decode = Benchmark::nanosecondsPerOperation(1, [&]() {
+            GeometryCodec::decodeIndexBuffer(decoded.data(), decoded.size(), sizeof(uint32_t), encoded.data(),
+                                             encoded.size());
+            Benchmark::doNotOptimize(decoded[0]);
+        });
+        std::printf("  %-28s %-9s %9.1f %9.1f %6.2fx %9s %6.2f\n", mesh.name, "index", stats.rawSize / 1024.0,
+                    stats.encodedSize / 1024.0, stats.ratio(), "", gigabytesPerSecond(stats.rawSize, decode));
+    }
+
+    std::printf("  vertex streams %.2fx; an order-0 entropy coder over the same deltas would reach at best %.2fx\n",
+                vertexTotals.ratio(), double(vertexTotals.rawSize) / idealTotal);
+    std::printf("  index buffers %.2fx\n", indexTotals.ratio());
+    if (!match)
+        std::printf("  MISMATCH\n");
+    return match ? 0 : 1;
+}
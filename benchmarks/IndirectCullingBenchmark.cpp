@@ -0,0 +1,87 @@
+// IndirectCulling::cullAndCompact, the CPU reference of the GPU culling kernel, over 1M objects scattered through a
+// 400-unit field, seen from inside it and from its edge. A tenth of the objects have no instances left. Prints the
+// time per cull and per object, and the throughput of the 48-byte objects read. Returns non-zero if the draws differ
+// from FrustumCulling::cullSpheres over the objects that have instances.
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "Benchmark.h"
+#include "FrustumCulling.h"
+#include "IndirectCulling.h"
+#include "SimdMath.h"
+
+using namespace SimdMath;
+
+namespace
+{
+constexpr size_t ObjectCount = 1000000;
+} // namespace
+
+int main()
+{
+    std::mt19937 random(28);
+    std::uniform_real_distribution<float> field(-200.0f, 200.0f), size(0.1f, 2.0f);
+    std::vector<CullObject> objects(ObjectCount);
+    std::vector<float> x, y, z, radius;
+    std::vector<uint32_t> withInstances;
+    for (uint32_t i = 0; i < ObjectCount; ++i)
+    {
+        CullObject &object = objects[i];
+        object = {};
+        object.bounds = {field(random), field(random) * 0.1f, field(random), size(random)};
+        object.indexType = i % 3 == 0 ? 0 : 1;
+        object.indexCount = 3 * (1 + random() % 2000);
+        object.indexOffset = (random() % 1000000) * 4;
+        object.baseInstance = i;
+        object.instanceCount = random() % 10 == 0 ? 0 : 1;
+        if (object.instanceCount > 0)
+        {
+            x.push_back(object.bounds.x);
+            y.push_back(object.bounds.y);
+            z.push_back(object.bounds.z);
+            radius.push_back(object.bounds.radius);
+            withInstances.push_back(i);
+        }
+    }
+    const FrustumCulling::SphereSoA spheres = {x.data(), y.data(), z.data(), radius.data()};
+
+    struct View {
+        const char *name;
+        float3 eye, target;
+    };
+    const View views[] = {{"inside the field", {0.0f, 2.0f, 0.0f}, {50.0f, 0.0f, -80.0f}},
+                          {"from the edge", {0.0f, 20.0f, 210.0f}, {0.0f, 0.0f, 0.0f}}};
+
+    std::vector<DrawIndexedArguments> draws(ObjectCount);
+    std::vector<uint32_t> visible(ObjectCount);
+    bool match = true;
+    Benchmark::printHeader("IndirectCulling::cullAndCompact, 1M objects, one thread");
+    for (const View &view : views)
+    {
+        const float4x4 viewProjection = float4x4::perspective(1.0f, 16.0f / 9.0f, 0.1f, 500.0f) *
+                                        float4x4::lookAt(view.eye, view.target, {0.0f, 1.0f, 0.0f});
+        const Frustum frustum = Frustum::fromViewProjection(viewProjection.data());
+
+        // Each object's baseInstance is its index, so the draws name the objects they came from.
+        const size_t drawCount = IndirectCulling::cullAndCompact(frustum, objects.data(), ObjectCount, draws.data());
+        const size_t visibleCount = FrustumCulling::cullSpheres(frustum, spheres, x.size(), visible.data());
+        match = match && drawCount == visibleCount;
+        for (size_t i = 0; match && i < drawCount; ++i)
+            match = draws[i].baseInstance == withInstances[visible[i]];
+
+        const double time = Benchmark::nanosecondsPerOperation(ObjectCount, [&]() {
+            Benchmark::doNotOptimize(
+                IndirectCulling::cullAndCompact(frustum, objects.data(), ObjectCount, draws.data()));
+        });
+        std::printf(" %s: %zu draws\n", view.name, drawCount);
+        std::printf("  %-44s %10.3f ms\n", "cullAndCompact", time * ObjectCount * 1e-6);
+        Benchmark::printResult("per object", time);
+        std::printf("  %-44s %10.2f GB/s\n", "objects read", double(sizeof(CullObject)) / time);
+    }
+
+    if (!match)
+        std::printf("  MISMATCH\n");
+    return match ? 0 : 1;
+}
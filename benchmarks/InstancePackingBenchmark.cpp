@@ -0,0 +1,127 @@
+// The CPU side of a frame of 1M instances of a small mesh: frustum culling the scene's instance bounds and packing
+// the survivors from InstanceSoA into InstanceData, as Renderer::updateInstances does, plus packing every instance,
+// on one thread and over the JobSystem. The GPU side is not measured here. Returns non-zero if a packed transform
+// differs from float4x4::transform or the JobSystem packs differ from the single-threaded ones.
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "Benchmark.h"
+#include "FrustumCulling.h"
+#include "InstancePacking.h"
+#include "JobSystem.h"
+#include "SimdMath.h"
+
+using namespace SimdMath;
+
+namespace
+{
+constexpr size_t InstanceCount = 1000000;
+
+bool matches(const InstanceSoA &instances, size_t i, const InstanceData &packed)
+{
+    const float4x4 m = float4x4::transform({instances.positionX[i], instances.positionY[i], instances.positionZ[i]},
+                                           {instances.rotationX[i], instances.rotationY[i], instances.rotationZ[i],
+                                            instances.rotationW[i]},
+                                           {instances.scaleX[i], instances.scaleY[i], instances.scaleZ[i]});
+    const float *pM = m.data();
+    for (int r = 0; r < 3; ++r)
+    {
+        for (int c = 0; c < 4; ++c)
+        {
+            if (std::fabs(packed.rows[r][c] - pM[c * 4 + r]) > 1e-5f * (1.0f + std::fabs(pM[c * 4 + r])))
+                return false;
+        }
+    }
+    return packed.materialIndex == instances.materialIndex[i] && packed.color == instances.color[i];
+}
+} // namespace
+
+int main()
+{
+    // A field of small meshes 400 units across, seen from its edge.
+    InstanceSoA instances;
+    instances.resize(InstanceCount);
+    std::vector<float> radius(InstanceCount, 0.3f);
+    std::mt19937 random(5);
+    std::uniform_real_distribution<float> field(-200.0f, 200.0f), unit(-1.0f, 1.0f), scales(0.5f, 1.5f);
+    for (size_t i = 0; i < InstanceCount; ++i)
+    {
+        const float4 q = {unit(random), unit(random), unit(random), unit(random)};
+        const float length = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+        const float position[3] = {field(random), field(random) * 0.1f, field(random)};
+        const float rotation[4] = {q.x / length, q.y / length, q.z / length, q.w / length};
+        const float scale[3] = {scales(random), scales(random), scales(random)};
+        instances.set(i, position, rotation, scale, uint32_t(i % 64), uint32_t(random()));
+    }
+
+    const float4x4 viewProjection = float4x4::perspective(1.0f, 16.0f / 9.0f, 0.1f, 500.0f) *
+                                    float4x4::lookAt({0.0f, 20.0f, 210.0f}, {0.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f});
+    const Frustum frustum = Frustum::fromViewProjection(viewProjection.data());
+    const FrustumCulling::SphereSoA bounds = {instances.positionX.data(), instances.positionY.data(),
+                                              instances.positionZ.data(), radius.data()};
+
+    std::vector<uint32_t> visible(InstanceCount);
+    std::vector<InstanceData> packed(InstanceCount);
+    JobSystem jobs;
+    const size_t visibleCount = FrustumCulling::cullSpheres(frustum, bounds, InstanceCount, visible.data(), &jobs);
+
+    bool match = true;
+    InstancePacking::pack(instances, 0, InstanceCount, packed.data());
+    for (size_t i = 0; i < InstanceCount; i += 97)
+        match &= matches(instances, i, packed[i]);
+    std::vector<InstanceData> packedParallel(InstanceCount);
+    InstancePacking::pack(instances, 0, InstanceCount, packedParallel.data(), &jobs);
+    match &= memcmp(packed.data(), packedParallel.data(), InstanceCount * sizeof(InstanceData)) == 0;
+    InstancePacking::packIndexed(instances, visible.data(), visibleCount, packed.data());
+    for (size_t o = 0; o < visibleCount; o += 97)
+        match &= matches(instances, visible[o], packed[o]);
+    InstancePacking::packIndexed(instances, visible.data(), visibleCount, packedParallel.data(), &jobs);
+    match &= memcmp(packed.data(), packedParallel.data(), visibleCount * sizeof(InstanceData)) == 0;
+
+    char title[128];
+    std::snprintf(title, sizeof(title), "1M instances per frame, %zu visible, %u worker threads, ns per instance",
+                  visibleCount, std::thread::hardware_concurrency());
+    Benchmark::printHeader(title);
+    const double cullSerial = Benchmark::nanosecondsPerOperation(InstanceCount, [&]() {
+        Benchmark::doNotOptimize(FrustumCulling::cullSpheres(frustum, bounds, InstanceCount, visible.data()));
+    });
+    const double cullParallel = Benchmark::nanosecondsPerOperation(InstanceCount, [&]() {
+        Benchmark::doNotOptimize(FrustumCulling::cullSpheres(frustum, bounds, InstanceCount, visible.data(), &jobs));
+    });
+    const double packAll = Benchmark::nanosecondsPerOperation(InstanceCount, [&]() {
+        InstancePacking::pack(instances, 0, InstanceCount, packed.data());
+        Benchmark::doNotOptimize(packed[0]);
+    });
+    const double packAllParallel = Benchmark::nanosecondsPerOperation(InstanceCount, [&]() {
+        InstancePacking::pack(instances, 0, InstanceCount, packed.data(), &jobs);
+        Benchmark::doNotOptimize(packed[0]);
+    });
+    const double packVisible = Benchmark::nanosecondsPerOperation(visibleCount, [&]() {
+        InstancePacking::packIndexed(instances, visible.data(), visibleCount, packed.data());
+        Benchmark::doNotOptimize(packed[0]);
+    });
+    const double packVisibleParallel = Benchmark::nanosecondsPerOperation(visibleCount, [&]() {
+        InstancePacking::packIndexed(instances, visible.data(), visibleCount, packed.data(), &jobs);
+        Benchmark::doNotOptimize(packed[0]);
+    });
+    Benchmark::printResult("cullSpheres, one thread", cullSerial);
+    Benchmark::printResult("cullSpheres, JobSystem", cullParallel);
+    Benchmark::printResult("pack, all instances, one thread", packAll);
+    Benchmark::printResult("pack, all instances, JobSystem", packAllParallel);
+    Benchmark::printResult("packIndexed, visible instances, one thread", packVisible);
+    Benchmark::printResult("packIndexed, visible instances, JobSystem", packVisibleParallel);
+
+    const double frame = (cullParallel * double(InstanceCount) + packVisibleParallel * double(visibleCount)) * 1e-6;
+    std::printf("  cull + pack of the visible instances: %.2f ms per frame, %.1f MB of InstanceData\n", frame,
+                double(visibleCount * sizeof(InstanceData)) / 1e6);
+    std::printf("  pack of all 1M: %.2f ms, %.2f GB/s written\n", packAll * double(InstanceCount) * 1e-6,
+                double(sizeof(InstanceData)) / packAll);
+    if (!match)
+        std::printf("  MISMATCH\n");
+    return match ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+// LightClusters with 10k point lights in front of a 1920x1080 camera with the Renderer's projection and the default
+// 16x9x24 grid: build and write into an upload-sized buffer, serially and on the JobSystem. The lights fill the view
+// frustum out to the far plane with radii of 0.5 to 4 units. Returns non-zero if the parallel buffer differs from the
+// serial one.
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "Benchmark.h"
+#include "ClusteredLighting.h"
+#include "JobSystem.h"
+#include "SimdMath.h"
+
+namespace
+{
+constexpr size_t LightCount = 10000;
+constexpr float Width = 1920.0f, Height = 1080.0f, FovY = 1.0f, Near = 0.1f, Far = 100.0f;
+} // namespace
+
+int main()
+{
+    // Uniform in the frustum's volume: depth grows with the cube root, lateral positions within the tile bounds.
+    std::mt19937 random(37);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f), side(-1.1f, 1.1f);
+    const float tanHalfY = std::tan(0.5f * FovY), tanHalfX = tanHalfY * Width / Height;
+    std::vector<LightComponent> lights(LightCount);
+    for (LightComponent &light : lights)
+    {
+        const float depth = Far * std::cbrt(unit(random));
+        light = {{side(random) * tanHalfX * depth, side(random) * tanHalfY * depth, -depth},
+                 0.5f + unit(random) * 3.5f,
+                 {1.0f, 1.0f, 1.0f},
+                 1.0f};
+    }
+    const SimdMath::float4x4 view = SimdMath::float4x4::identity();
+
+    LightClusters clusters(LightClusters::Settings{});
+    clusters.setProjection(FovY, Width, Height, Near, Far);
+    JobSystem jobs;
+    std::vector<uint8_t> serial, parallel;
+
+    clusters.build(view.data(), lights.data(), LightCount);
+    serial.resize(clusters.layout().size);
+    clusters.write(serial.data());
+
+    char title[160];
+    std::snprintf(title, sizeof(title), "LightClusters, %zu lights, %.0fx%.0f, %zu clusters, %u threads", LightCount,
+                  Width, Height, clusters.clusterCount(), unsigned(jobs.threadCount()));
+    Benchmark::printHeader(title);
+    auto run = [&](const char *name, JobSystem *pJobs, std::vector<uint8_t> &buffer) {
+        const double build = Benchmark::nanosecondsPerOperation(
+            1, [&]() { clusters.build(view.data(), lights.data(), LightCount, pJobs); }, 0.2);
+        buffer.resize(clusters.layout().size);
+        const double write =
+            Benchmark::nanosecondsPerOperation(1, [&]() { clusters.write(buffer.data(), pJobs); }, 0.2);
+        char line[64];
+        std::snprintf(line, sizeof(line), "build, %s", name);
+        std::printf("  %-44s %10.3f ms\n", line, build * 1e-6);
+        std::snprintf(line, sizeof(line), "write, %s", name);
+        std::printf("  %-44s %10.3f ms\n", line, write * 1e-6);
+        std::snprintf(line, sizeof(line), "build + write, %s", name);
+        std::printf("  %-44s %10.3f ms\n", line, (build + write) * 1e-6);
+    };
+    run("serial", nullptr, serial);
+    run("JobSystem", &jobs, parallel);
+    std::printf("  %zu light indices, %.1f per light, %.1f per cluster\n", clusters.indexCount(),
+                double(clusters.indexCount()) / double(LightCount),
+                double(clusters.indexCount()) / double(clusters.clusterCount()));
+
+    const bool match = serial == parallel;
+    if (!match)
+        std::printf("  MISMATCH\n");
+    return match ? 0 : 1;
+}
@@ -0,0 +1,93 @@
+// LodSelector::select over 1M objects of 64 meshes with five LODs each, scattered up to 2 km from a 1080p camera: with
+// only the error threshold, and with a triangle budget halfway between all-coarsest and the unbudgeted selection,
+// serially and on the JobSystem. Returns non-zero if a selection exceeds the budget or reports a triangle count its
+// LODs do not add up to.
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "Benchmark.h"
+#include "JobSystem.h"
+#include "LodSelector.h"
+
+namespace
+{
+constexpr size_t ObjectCount = 1000000;
+constexpr uint32_t MeshCount = 64;
+constexpr uint32_t LodsPerMesh = 5;
+} // namespace
+
+int main()
+{
+    std::mt19937 random(31);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    LodSelector::Settings settings;
+    LodSelector selector(settings);
+    std::vector<LodSelector::Lod> meshLods[MeshCount];
+    for (std::vector<LodSelector::Lod> &lods : meshLods)
+    {
+        float error = 0.002f + unit(random) * 0.01f;
+        uint32_t triangles = 5000 + uint32_t(random() % 20000);
+        for (uint32_t lod = 0; lod < LodsPerMesh; ++lod, error *= 2.5f, triangles /= 3)
+            lods.push_back({error, triangles});
+        selector.addMesh(lods.data(), LodsPerMesh);
+    }
+
+    std::vector<float> x(ObjectCount), y(ObjectCount), z(ObjectCount), radius(ObjectCount);
+    std::vector<uint32_t> meshes(ObjectCount);
+    for (size_t i = 0; i < ObjectCount; ++i)
+    {
+        x[i] = (unit(random) - 0.5f) * 4000.0f;
+        y[i] = unit(random) * 50.0f;
+        z[i] = (unit(random) - 0.5f) * 4000.0f;
+        radius[i] = 0.5f + unit(random) * 4.0f;
+        meshes[i] = uint32_t(random() % MeshCount);
+    }
+    const FrustumCulling::SphereSoA bounds = {x.data(), y.data(), z.data(), radius.data()};
+    const LodSelector::View view = {{0.0f, 2.0f, 0.0f}, LodSelector::projectionScale(1080.0f, 1.0f)};
+    std::vector<uint8_t> lods(ObjectCount, 0);
+    JobSystem jobs;
+
+    auto sumTriangles = [&]() {
+        uint64_t triangles = 0;
+        for (size_t i = 0; i < ObjectCount; ++i)
+            triangles += meshLods[meshes[i]][lods[i]].triangleCount;
+        return triangles;
+    };
+    const uint64_t unbudgeted = selector.select(view, bounds, meshes.data(), ObjectCount, lods.data());
+    bool ok = unbudgeted == sumTriangles();
+    uint64_t coarsest = 0;
+    for (size_t i = 0; i < ObjectCount; ++i)
+        coarsest += meshLods[meshes[i]][LodsPerMesh - 1].triangleCount;
+    const uint64_t budget = coarsest + (unbudgeted - coarsest) / 2;
+
+    char title[128];
+    std::snprintf(title, sizeof(title), "LodSelector::select, %zu objects, %u threads", ObjectCount,
+                  unsigned(jobs.threadCount()));
+    Benchmark::printHeader(title);
+    auto run = [&](const char *name, JobSystem *pJobs) {
+        uint64_t triangles = 0;
+        const double time = Benchmark::nanosecondsPerOperation(
+            1, [&]() { triangles = selector.select(view, bounds, meshes.data(), ObjectCount, lods.data(), pJobs); },
+            0.2);
+        std::printf("  %-44s %10.3f ms\n", name, time * 1e-6);
+        ok = ok && triangles == sumTriangles();
+        return triangles;
+    };
+    run("threshold only", nullptr);
+    run("threshold only, JobSystem", &jobs);
+
+    selector.settings().triangleBudget = budget;
+    const uint64_t budgeted = run("with a triangle budget", nullptr);
+    run("with a triangle budget, JobSystem", &jobs);
+    std::printf("  %.1fM triangles at the coarsest LODs, %.1fM unbudgeted, %.1fM within a budget of %.1fM\n",
+                double(coarsest) * 1e-6, double(unbudgeted) * 1e-6, double(budgeted) * 1e-6, double(budget) * 1e-6);
+    std::printf("  threshold raised from %.2f to %.2f pixels\n", settings.errorThreshold, selector.threshold());
+
+    ok = ok && budgeted <= budget;
+    if (!ok)
+        std::printf("  MISMATCH or budget exceeded\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+// OcclusionCuller at 480x270, a quarter of 1080p per axis, behind a street-level view of a city: 1024 buildings of
+// 12 triangles each are rasterized every frame, then the boxes among 100k scattered between them that survive
+// frustum culling are tested with isVisible. Prints the share of the screen the occluders cover and the share of
+// boxes rejected. Returns non-zero if the coverage is too low for the timings to mean anything or if cullAABBs
+// disagrees with isVisible.
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "Benchmark.h"
+#include "FrustumCulling.h"
+#include "OcclusionCulling.h"
+#include "SimdMath.h"
+
+using namespace SimdMath;
+
+namespace
+{
+constexpr uint32_t Width = 480, Height = 270;
+constexpr size_t BoxCount = 100000;
+
+// An axis-aligned building as 12 triangles over 8 shared corners.
+void addBuilding(float x, float z, float halfWidth, float height, std::vector<float> &positions,
+                 std::vector<uint32_t> &indices)
+{
+    const uint32_t base = uint32_t(positions.size() / 3);
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        positions.push_back(corner & 1 ? x + halfWidth : x - halfWidth);
+        positions.push_back(corner & 2 ? height : 0.0f);
+        positions.push_back(corner & 4 ? z + halfWidth : z - halfWidth);
+    }
+    static const uint32_t Faces[36] = {0, 1, 3, 0, 3, 2, 4, 6, 7, 4, 7, 5, 0, 2, 6, 0, 6, 4,
+                                       1, 5, 7, 1, 7, 3, 0, 4, 5, 0, 5, 1, 2, 3, 7, 2, 7, 6};
+    for (uint32_t index : Faces)
+        indices.push_back(base + index);
+}
+} // namespace
+
+int main()
+{
+    // A 32x32 grid of blocks 20 units apart, with the camera in the street between two rows, looking along it.
+    std::vector<float> positions;
+    std::vector<uint32_t> indices;
+    std::mt19937 random(17);
+    std::uniform_real_distribution<float> heights(8.0f, 40.0f), widths(6.0f, 9.0f);
+    for (int row = 0; row < 32; ++row)
+    {
+        for (int column = 0; column < 32; ++column)
+            addBuilding(float(column - 16) * 20.0f, -float(row) * 20.0f, widths(random), heights(random), positions,
+                        indices);
+    }
+    const float4x4 clipFromWorld = float4x4::perspective(1.0f, 16.0f / 9.0f, 0.5f, 1000.0f) *
+                                   float4x4::lookAt({-10.0f, 2.0f, 20.0f}, {25.0f, 4.0f, -200.0f},
+                                                    {0.0f, 1.0f, 0.0f});
+
+    // Boxes of up to 4 units between and above the buildings, a mix of in front of, behind and beside them.
+    std::vector<float> minX(BoxCount), minY(BoxCount), minZ(BoxCount), maxX(BoxCount), maxY(BoxCount),
+        maxZ(BoxCount);
+    std::uniform_real_distribution<float> across(-330.0f, 330.0f), along(-640.0f, 10.0f), up(0.0f, 30.0f),
+        size(0.25f, 2.0f);
+    std::vector<uint32_t> candidates(BoxCount), visible(BoxCount);
+    for (size_t i = 0; i < BoxCount; ++i)
+    {
+        const float x = across(random), y = up(random), z = along(random), e = size(random);
+        minX[i] = x - e;
+        minY[i] = y - e;
+        minZ[i] = z - e;
+        maxX[i] = x + e;
+        maxY[i] = y + e;
+        maxZ[i] = z + e;
+    }
+    const FrustumCulling::AABBSoA boxes = {minX.data(), minY.data(), minZ.data(),
+                                           maxX.data(), maxY.data(), maxZ.data()};
+    const Frustum frustum = Frustum::fromViewProjection(clipFromWorld.data());
+    const size_t candidateCount = FrustumCulling::cullAABBs(frustum, boxes, BoxCount, candidates.data());
+
+    OcclusionCuller culler(Width, Height);
+    auto render = [&]() {
+        culler.clear();
+        culler.renderOccluder(positions.data(), 3 * sizeof(float), indices.data(), indices.size(),
+                              clipFromWorld.data());
+    };
+    render();
+
+    // Coverage: a box inside one pixel at the far plane is occluded exactly where some occluder was drawn. With an
+    // identity matrix its corners are clip positions with w = 1.
+    const float identity[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+    size_t covered = 0;
+    for (uint32_t y = 0; y < Height; ++y)
+    {
+        for (uint32_t x = 0; x < Width; ++x)
+        {
+            const float cx = (float(x) + 0.5f) / float(Width) * 2.0f - 1.0f;
+            const float cy = 1.0f - (float(y) + 0.5f) / float(Height) * 2.0f;
+            const AABB probe = {cx - 0.1f / Width, cy - 0.1f / Height, 0.9999f,
+                                cx + 0.1f / Width, cy + 0.1f / Height, 0.9999f};
+            covered += !culler.isVisible(probe, identity);
+        }
+    }
+    const double coverage = double(covered) / double(Width * Height);
+
+    auto isVisible = [&](uint32_t i) {
+        return culler.isVisible({minX[i], minY[i], minZ[i], maxX[i], maxY[i], maxZ[i]}, clipFromWorld.data());
+    };
+    size_t visibleCount = 0;
+    for (size_t c = 0; c < candidateCount; ++c)
+        visibleCount += isVisible(candidates[c]);
+    const bool match = culler.cullAABBs(boxes, candidates.data(), candidateCount, clipFromWorld.data(),
+                                        visible.data()) == visibleCount;
+
+    char title[160];
+    std::snprintf(title, sizeof(title), "OcclusionCuller %ux%u, %zu occluder triangles, %.0f%% of the screen covered",
+                  Width, Height, indices.size() / 3, coverage * 100.0);
+    Benchmark::printHeader(title);
+    const double renderTime = Benchmark::nanosecondsPerOperation(1, render);
+    const double isVisibleTime = Benchmark::nanosecondsPerOperation(candidateCount, [&]() {
+        size_t count = 0;
+        for (size_t c = 0; c < candidateCount; ++c)
+            count += isVisible(candidates[c]);
+        Benchmark::doNotOptimize(count);
+    });
+    const double cullTime = Benchmark::nanosecondsPerOperation(candidateCount, [&]() {
+        Benchmark::doNotOptimize(
+            culler.cullAABBs(boxes, candidates.data(), candidateCount, clipFromWorld.data(), visible.data()));
+    });
+    std::printf("  %-44s %10.3f ms\n", "clear + renderOccluder, per frame", renderTime * 1e-6);
+    Benchmark::printResult("isVisible, per box", isVisibleTime);
+    Benchmark::printResult("cullAABBs, per box", cullTime);
+    std::printf("  %zu of %zu boxes in the frustum, %zu of them visible (%.1f%% rejected), culled in %.3f ms\n",
+                candidateCount, BoxCount, visibleCount,
+                100.0 * double(candidateCount - visibleCount) / double(candidateCount),
+                cullTime * double(candidateCount) * 1e-6);
+
+    const bool ok = match && coverage > 0.5;
+    if (!ok)
+        std::printf("  MISMATCH or coverage below 50%%\n");
+    return ok ? 0 : 1;
+}
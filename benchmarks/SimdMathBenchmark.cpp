@@ -0,0 +1,139 @@
+// Matrix multiply, point transform, normalization and half conversion throughput of SimdMath, next to plain scalar
+// loops computing the same results. Returns non-zero if the two disagree.
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "Benchmark.h"
+#include "SimdMath.h"
+
+using namespace SimdMath;
+
+namespace
+{
+constexpr size_t Count = 4096;
+
+float4x4 multiplyScalar(const float4x4 &a, const float4x4 &b)
+{
+    float4x4 result;
+    const float *pA = a.data();
+    const float *pB = b.data();
+    float *pResult = &result.columns[0].x;
+    for (int c = 0; c < 4; ++c)
+    {
+        for (int r = 0; r < 4; ++r)
+        {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; ++k)
+                sum += pA[k * 4 + r] * pB[c * 4 + k];
+            pResult[c * 4 + r] = sum;
+        }
+    }
+    return result;
+}
+
+float3 transformPointScalar(const float4x4 &m, const float3 &p)
+{
+    const float *pM = m.data();
+    return {pM[0] * p.x + pM[4] * p.y + pM[8] * p.z + pM[12], pM[1] * p.x + pM[5] * p.y + pM[9] * p.z + pM[13],
+            pM[2] * p.x + pM[6] * p.y + pM[10] * p.z + pM[14]};
+}
+
+float3 normalizeScalar(const float3 &v)
+{
+    const float inverseLength = 1.0f / std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+    return {v.x * inverseLength, v.y * inverseLength, v.z * inverseLength};
+}
+
+bool close(float a, float b)
+{
+    return std::fabs(a - b) <= 1e-4f * std::max(1.0f, std::fabs(b));
+}
+
+bool close(const float3 &a, const float3 &b)
+{
+    return close(a.x, b.x) && close(a.y, b.y) && close(a.z, b.z);
+}
+} // namespace
+
+int main()
+{
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    auto randomVector = [&]() { return float3{unit(random), unit(random), unit(random)}; };
+
+    std::vector<float4x4> a(Count), b(Count), products(Count);
+    std::vector<float3> points(Count), transformed(Count);
+    std::vector<float> floats(Count * 4);
+    std::vector<half> halves(floats.size());
+    for (size_t i = 0; i < Count; ++i)
+    {
+        a[i] = float4x4::transform(randomVector(), normalize(quatf{unit(random), unit(random), unit(random), 1.0f}),
+                                   {2.0f, 2.0f, 2.0f});
+        b[i] = float4x4::perspective(1.0f + 0.1f * unit(random), 1.5f, 0.1f, 100.0f);
+        points[i] = randomVector();
+    }
+    for (float &f : floats)
+        f = 100.0f * unit(random);
+
+    int failures = 0;
+    for (size_t i = 0; i < Count; ++i)
+    {
+        const float4x4 simd = a[i] * b[i];
+        const float4x4 scalar = multiplyScalar(a[i], b[i]);
+        for (int j = 0; j < 16; ++j)
+            failures += !close(simd.data()[j], scalar.data()[j]);
+        failures += !close(transformPoint(a[i], points[i]), transformPointScalar(a[i], points[i]));
+        failures += !close(normalize(points[i]), normalizeScalar(points[i]));
+    }
+
+    Benchmark::printHeader("SimdMath, per operation");
+    using Benchmark::doNotOptimize;
+    using Benchmark::nanosecondsPerOperation;
+    using Benchmark::printResult;
+
+    printResult("float4x4 * float4x4", nanosecondsPerOperation(Count, [&]() {
+                    for (size_t i = 0; i < Count; ++i)
+                        products[i] = a[i] * b[i];
+                    doNotOptimize(products[Count - 1]);
+                }));
+    printResult("float4x4 * float4x4, scalar loops", nanosecondsPerOperation(Count, [&]() {
+                    for (size_t i = 0; i < Count; ++i)
+                        products[i] = multiplyScalar(a[i], b[i]);
+                    doNotOptimize(products[Count - 1]);
+                }));
+    printResult("transformPoint", nanosecondsPerOperation(Count, [&]() {
+                    for (size_t i = 0; i < Count; ++i)
+                        transformed[i] = transformPoint(a[i], points[i]);
+                    doNotOptimize(transformed[Count - 1]);
+                }));
+    printResult("transformPoint, scalar loops", nanosecondsPerOperation(Count, [&]() {
+                    for (size_t i = 0; i < Count; ++i)
+                        transformed[i] = transformPointScalar(a[i], points[i]);
+                    doNotOptimize(transformed[Count - 1]);
+                }));
+    printResult("normalize(float3)", nanosecondsPerOperation(Count, [&]() {
+                    for (size_t i = 0; i < Count; ++i)
+                        transformed[i] = normalize(points[i]);
+                    doNotOptimize(transformed[Count - 1]);
+                }));
+    printResult("normalize(float3), scalar loops", nanosecondsPerOperation(Count, [&]() {
+                    for (size_t i = 0; i < Count; ++i)
+                        transformed[i] = normalizeScalar(points[i]);
+                    doNotOptimize(transformed[Count - 1]);
+                }));
+    printResult("toHalf, bulk", nanosecondsPerOperation(floats.size(), [&]() {
+                    toHalf(floats.data(), halves.data(), floats.size());
+                    doNotOptimize(halves[floats.size() - 1]);
+                }));
+    printResult("toFloat, bulk", nanosecondsPerOperation(floats.size(), [&]() {
+                    toFloat(halves.data(), floats.data(), floats.size());
+                    doNotOptimize(floats[floats.size() - 1]);
+                }));
+
+    if (failures)
+        std::printf("%d results differ from the scalar loops\n", failures);
+    return failures ? 1 : 0;
+}
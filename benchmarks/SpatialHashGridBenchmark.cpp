@@ -0,0 +1,116 @@
+// SpatialHashGrid with 1M points spread over a 2000x2000 world, about four per cell: a full rebuild, serially and on
+// the JobSystem, then 100k queries of each kind around random positions, singly and batched. Returns non-zero if a
+// sample of the queries disagrees with a brute-force scan.
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "Benchmark.h"
+#include "JobSystem.h"
+#include "SpatialHashGrid.h"
+
+namespace
+{
+constexpr size_t PointCount = 1000000;
+constexpr size_t QueryCount = 100000;
+constexpr float Extent = 2000.0f;
+constexpr float CellSize = 4.0f;
+constexpr float Radius = 8.0f;
+} // namespace
+
+int main()
+{
+    std::mt19937 random(29);
+    std::uniform_real_distribution<float> coordinate(0.0f, Extent);
+    std::vector<float> x(PointCount), y(PointCount), queryX(QueryCount), queryY(QueryCount);
+    for (size_t i = 0; i < PointCount; ++i)
+    {
+        x[i] = coordinate(random);
+        y[i] = coordinate(random);
+    }
+    for (size_t i = 0; i < QueryCount; ++i)
+    {
+        queryX[i] = coordinate(random);
+        queryY[i] = coordinate(random);
+    }
+    std::vector<SpatialHashGrid::Rect> rects(QueryCount);
+    for (size_t i = 0; i < QueryCount; ++i)
+        rects[i] = {queryX[i] - Radius, queryY[i] - Radius, queryX[i] + Radius, queryY[i] + Radius};
+
+    JobSystem jobs;
+    SpatialHashGrid grid(CellSize);
+    char title[128];
+    std::snprintf(title, sizeof(title), "SpatialHashGrid, %zu points, cell size %.0f, %u threads", PointCount,
+                  CellSize, unsigned(jobs.threadCount()));
+    Benchmark::printHeader(title);
+
+    const double rebuildSerial = Benchmark::nanosecondsPerOperation(
+        1, [&]() { grid.rebuild(x.data(), y.data(), PointCount); }, 0.2);
+    const double rebuildParallel = Benchmark::nanosecondsPerOperation(
+        1, [&]() { grid.rebuild(x.data(), y.data(), PointCount, &jobs); }, 0.2);
+    std::printf("  %-44s %10.3f ms\n", "rebuild, serial", rebuildSerial * 1e-6);
+    std::printf("  %-44s %10.3f ms\n", "rebuild, JobSystem", rebuildParallel * 1e-6);
+
+    std::vector<uint32_t> results, offsets;
+    const double rectTime = Benchmark::nanosecondsPerOperation(QueryCount, [&]() {
+        for (const SpatialHashGrid::Rect &rect : rects)
+        {
+            results.clear();
+            grid.queryRect(rect, results);
+            Benchmark::doNotOptimize(results.data());
+        }
+    });
+    const double radiusTime = Benchmark::nanosecondsPerOperation(QueryCount, [&]() {
+        for (size_t i = 0; i < QueryCount; ++i)
+        {
+            results.clear();
+            grid.queryRadius(queryX[i], queryY[i], Radius, results);
+            Benchmark::doNotOptimize(results.data());
+        }
+    });
+    const double nearestTime = Benchmark::nanosecondsPerOperation(QueryCount, [&]() {
+        uint32_t sum = 0;
+        for (size_t i = 0; i < QueryCount; ++i)
+            sum += grid.nearest(queryX[i], queryY[i], CellSize);
+        Benchmark::doNotOptimize(sum);
+    });
+    const double rectsTime = Benchmark::nanosecondsPerOperation(
+        QueryCount, [&]() { grid.queryRects(rects.data(), QueryCount, results, offsets, &jobs); });
+    const double radiiTime = Benchmark::nanosecondsPerOperation(QueryCount, [&]() {
+        grid.queryRadii(queryX.data(), queryY.data(), QueryCount, Radius, results, offsets, &jobs);
+    });
+    Benchmark::printResult("queryRect 16x16, per query", rectTime);
+    Benchmark::printResult("queryRadius 8, per query", radiusTime);
+    Benchmark::printResult("nearest within 4, per query", nearestTime);
+    Benchmark::printResult("queryRects, JobSystem, per query", rectsTime);
+    Benchmark::printResult("queryRadii, JobSystem, per query", radiiTime);
+    std::printf("  %.1f points per radius query on average\n", double(results.size()) / double(QueryCount));
+
+    // The batched radius results are still in results; check a sample of them and of nearest by brute force.
+    bool match = true;
+    for (size_t q = 0; q < QueryCount; q += 997)
+    {
+        std::vector<uint32_t> expected;
+        uint32_t closest = SpatialHashGrid::InvalidIndex;
+        float closestDistance = CellSize * CellSize;
+        for (uint32_t i = 0; i < PointCount; ++i)
+        {
+            const float dx = x[i] - queryX[q], dy = y[i] - queryY[q], distance = dx * dx + dy * dy;
+            if (distance <= Radius * Radius)
+                expected.push_back(i);
+            if (distance <= closestDistance)
+            {
+                closest = i;
+                closestDistance = distance;
+            }
+        }
+        std::vector<uint32_t> found(results.begin() + offsets[q], results.begin() + offsets[q + 1]);
+        std::sort(found.begin(), found.end());
+        match &= found == expected && grid.nearest(queryX[q], queryY[q], CellSize) == closest;
+    }
+    if (!match)
+        std::printf("  MISMATCH\n");
+    return match ? 0 : 1;
+}
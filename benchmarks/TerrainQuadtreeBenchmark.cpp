@@ -0,0 +1,71 @@
+// CDLOD node selection over a 16k x 16k heightmap from a few camera placements, against the 0.5 ms frame budget for
+// it. The heightmap is generated, so the numbers measure the quadtree walk rather than any particular terrain.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "Benchmark.h"
+#include "SimdMath.h"
+#include "TerrainQuadtree.h"
+
+using namespace SimdMath;
+
+namespace
+{
+constexpr uint32_t Size = 16384;
+constexpr double BudgetMilliseconds = 0.5;
+} // namespace
+
+int main()
+{
+    std::vector<uint16_t> heights(size_t(Size) * Size);
+    for (uint32_t z = 0; z < Size; ++z)
+    {
+        for (uint32_t x = 0; x < Size; ++x)
+        {
+            const float u = float(x) / float(Size), v = float(z) / float(Size);
+            const float h = 0.5f + 0.25f * std::sin(u * 37.0f) * std::cos(v * 29.0f) +
+                            0.15f * std::sin(u * 211.0f + v * 173.0f) + 0.05f * std::sin(u * 1531.0f - v * 1327.0f);
+            heights[size_t(z) * Size + x] = uint16_t(std::clamp(h, 0.0f, 1.0f) * 65535.0f);
+        }
+    }
+
+    TerrainQuadtree::Settings settings;
+    settings.lodCount = 9; // the coarsest nodes are 16k samples across
+    settings.heightScale = 800.0f;
+    const TerrainQuadtree quadtree(heights.data(), Size, Size, settings);
+
+    struct Camera {
+        const char *name;
+        float3 eye, target;
+        float far;
+    };
+    const Camera cameras[] = {
+        {"center, near the ground", {8192.0f, 700.0f, 8192.0f}, {12000.0f, 400.0f, 9000.0f}, 20000.0f},
+        {"corner, across the map", {100.0f, 900.0f, 100.0f}, {16000.0f, 0.0f, 16000.0f}, 30000.0f},
+        {"overhead", {8192.0f, 6000.0f, 8000.0f}, {8192.0f, 0.0f, 8192.0f}, 30000.0f},
+    };
+
+    Benchmark::printHeader("TerrainQuadtree::select, 16k x 16k heightmap, 64-sample leaves, 9 LODs");
+    std::vector<TerrainQuadtree::Node> nodes;
+    bool withinBudget = true;
+    for (const Camera &camera : cameras)
+    {
+        const float4x4 viewProjection = float4x4::perspective(1.0f, 16.0f / 9.0f, 0.5f, camera.far) *
+                                        float4x4::lookAt(camera.eye, camera.target, {0.0f, 1.0f, 0.0f});
+        const Frustum frustum = Frustum::fromViewProjection(viewProjection.data());
+        const float eye[3] = {camera.eye.x, camera.eye.y, camera.eye.z};
+        const double nanoseconds = Benchmark::nanosecondsPerOperation(1, [&]() {
+            quadtree.select(eye, frustum, nodes);
+            Benchmark::doNotOptimize(nodes.data());
+        });
+        char name[96];
+        std::snprintf(name, sizeof(name), "%s, %zu nodes", camera.name, nodes.size());
+        Benchmark::printResult(name, nanoseconds);
+        withinBudget &= nanoseconds * 1e-6 <= BudgetMilliseconds;
+    }
+    std::printf("  %s the %.1f ms budget\n", withinBudget ? "all within" : "OVER", BudgetMilliseconds);
+    return 0;
+}
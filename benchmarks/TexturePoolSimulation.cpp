@@ -0,0 +1,151 @@
+// Drives TexturePool with a synthetic post-processing chain for 1000 frames with three frames in flight: an HDR scene
+// color target, a three-level bloom downsample chain, a half-resolution upsample and a tonemapped output every frame,
+// plus a capture target every tenth frame. Each target is released after its last use in the frame. The output
+// grows from 1920x1080 to 2560x1440 at frame 400. Prints the hit rate and the textures and bytes retained over time,
+// and the cost of an acquire and release pair. Returns non-zero if a texture is handed out again within frameLatency
+// frames of its release.
+
+#include <cstdio>
+#include <unordered_map>
+#include <vector>
+
+#include "Benchmark.h"
+#include "TexturePool.h"
+
+namespace
+{
+constexpr uint64_t FrameCount = 1000;
+constexpr uint64_t ResizeFrame = 400;
+// MTL::PixelFormat and MTL::TextureUsage values, and their bytes per pixel.
+constexpr uint32_t RGBA16Float = 115, RGBA8Unorm = 70;
+constexpr uint32_t ShaderReadRenderTarget = 1 | 4;
+constexpr uint32_t StoragePrivate = 2;
+
+struct Target {
+    uint32_t divisor; // of the output size
+    uint32_t pixelFormat, bytesPerPixel;
+    uint32_t lastUse; // index of the step after which it is released
+};
+
+// In order of first use; step i acquires target i and then releases every target whose last use is i.
+const Target PostChain[] = {
+    {1, RGBA16Float, 8, 1}, // scene color, read by the first downsample
+    {2, RGBA16Float, 8, 4}, // bloom level 1, read by the upsample
+    {4, RGBA16Float, 8, 3}, // bloom level 2
+    {8, RGBA16Float, 8, 4}, // bloom level 3, read by the upsample
+    {2, RGBA16Float, 8, 5}, // bloom upsample, composited into the output
+    {1, RGBA8Unorm, 4, 5},  // tonemapped output
+};
+const Target Capture = {1, RGBA8Unorm, 4, 0};
+
+class Simulation {
+  public:
+    explicit Simulation(const TexturePool::Settings &settings) : _settings(settings), _pool(settings) {}
+
+    // Runs one frame and returns whether every acquire respected the latency.
+    bool frame(uint64_t frame, uint32_t width, uint32_t height)
+    {
+        _trimmed.clear();
+        _pool.beginFrame(frame, _trimmed);
+        for (void *pTexture : _trimmed)
+            _released.erase(pTexture);
+
+        bool ok = true;
+        constexpr size_t StepCount = sizeof(PostChain) / sizeof(PostChain[0]);
+        void *pTextures[StepCount];
+        for (size_t step = 0; step < StepCount; ++step)
+        {
+            pTextures[step] = acquire(PostChain[step], width, height, frame, ok);
+            for (size_t i = 0; i <= step; ++i)
+            {
+                if (PostChain[i].lastUse == step)
+                    release(pTextures[i], frame);
+            }
+        }
+        if (frame % 10 == 0)
+            release(acquire(Capture, width, height, frame, ok), frame);
+        return ok;
+    }
+
+    const TexturePool &pool() const { return _pool; }
+
+  private:
+    void *acquire(const Target &target, uint32_t width, uint32_t height, uint64_t frame, bool &ok)
+    {
+        TexturePool::Descriptor desc;
+        desc.width = width / target.divisor;
+        desc.height = height / target.divisor;
+        desc.pixelFormat = target.pixelFormat;
+        desc.usage = ShaderReadRenderTarget;
+        desc.storageMode = StoragePrivate;
+        void *pTexture = _pool.acquire(desc);
+        if (pTexture)
+        {
+            ok = ok && _released.at(pTexture) + _settings.frameLatency <= frame;
+            return pTexture;
+        }
+        pTexture = reinterpret_cast<void *>(uintptr_t(++_created) * 16);
+        _pool.add(desc, pTexture, uint64_t(desc.width) * desc.height * target.bytesPerPixel);
+        return pTexture;
+    }
+
+    void release(void *pTexture, uint64_t frame)
+    {
+        _pool.release(pTexture);
+        _released[pTexture] = frame;
+    }
+
+    TexturePool::Settings _settings;
+    TexturePool _pool;
+    uint64_t _created = 0;
+    std::unordered_map<void *, uint64_t> _released; // frame each known texture was last released in
+    std::vector<void *> _trimmed;
+};
+
+void printRetained(const char *when, const TexturePool::Stats &stats)
+{
+    std::printf("  %-24s hit rate %.3f, %u textures (%.0f MB) retained\n", when, stats.hitRate(),
+                stats.texturesInUse + stats.texturesIdle, double(stats.bytesInUse + stats.bytesIdle) / (1 << 20));
+}
+} // namespace
+
+int main()
+{
+    const TexturePool::Settings settings = {3, 120};
+    Simulation simulation(settings);
+    bool ok = true;
+    uint64_t trimmedBy = 0;
+    uint64_t textures = 0;
+
+    Benchmark::printHeader("TexturePool, synthetic post chain, 3 frames in flight, 120 idle frames");
+    for (uint64_t frame = 1; frame <= FrameCount; ++frame)
+    {
+        const bool large = frame >= ResizeFrame;
+        ok = simulation.frame(frame, large ? 2560 : 1920, large ? 1440 : 1080) && ok;
+
+        const TexturePool::Stats &stats = simulation.pool().stats();
+        const uint64_t count = stats.texturesInUse + stats.texturesIdle;
+        if (frame == 200)
+            printRetained("at frame 200", stats);
+        if (frame == ResizeFrame - 1)
+        {
+            printRetained("before the resize", stats);
+            textures = count;
+        }
+        // The chain needs as many textures at either size, so the old ones are gone once the count is back down.
+        if (frame > ResizeFrame && trimmedBy == 0 && count <= textures)
+            trimmedBy = frame;
+    }
+    printRetained("at frame 1000", simulation.pool().stats());
+    std::printf("  1920x1080 targets trimmed by frame %llu\n", (unsigned long long)trimmedBy);
+
+    // Steady state at the new size: every acquire hits.
+    uint64_t frame = FrameCount;
+    const double frameTime = Benchmark::nanosecondsPerOperation(1, [&]() { simulation.frame(++frame, 2560, 1440); });
+    // Six targets a frame, and the capture every tenth.
+    Benchmark::printResult("acquire + release, per target", frameTime / 6.1);
+
+    if (!ok)
+        std::printf("  REUSED WITHIN FRAME LATENCY\n");
+    return ok ? 0 : 1;
+}
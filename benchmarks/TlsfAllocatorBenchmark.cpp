@@ -0,0 +1,89 @@
+// TlsfAllocator against the first-fit RangeAllocator on the same workload: a 256 MB heap holding 1024 live
+// allocations of 256 B to 1 MB, log-uniform, with alignments of 256 B to 64 KB, where each operation frees a random
+// live allocation and makes a new one. Prints the cost of an allocate and free pair and the fragmentation left.
+// Returns non-zero if TlsfAllocator fails an allocation the steady state should always have room for.
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "Benchmark.h"
+#include "RangeAllocator.h"
+#include "TlsfAllocator.h"
+
+namespace
+{
+constexpr uint64_t Capacity = uint64_t(256) << 20;
+constexpr size_t LiveCount = 1024;
+constexpr size_t OperationCount = 1 << 20;
+
+struct Operation {
+    uint64_t size, alignment;
+    uint32_t victim; // index of the live allocation freed first
+};
+} // namespace
+
+int main()
+{
+    std::mt19937 random(42);
+    std::uniform_real_distribution<double> logSize(std::log2(256.0), std::log2(1024.0 * 1024.0));
+    std::uniform_int_distribution<uint32_t> alignmentShift(8, 16), victim(0, LiveCount - 1);
+    std::vector<Operation> operations(OperationCount);
+    for (Operation &operation : operations)
+        operation = {uint64_t(std::exp2(logSize(random))), uint64_t(1) << alignmentShift(random), victim(random)};
+
+    Benchmark::printHeader("TlsfAllocator, 256 MB, 1024 live allocations of 256 B to 1 MB");
+
+    // Allocations average 126 KB, so the live set fills about half the heap and nothing should fail.
+    TlsfAllocator tlsf(Capacity);
+    std::vector<TlsfAllocator::Allocation> tlsfLive(LiveCount);
+    size_t failures = 0;
+    for (size_t i = 0; i < LiveCount; ++i)
+        tlsfLive[i] = tlsf.allocate(operations[i].size, operations[i].alignment);
+    size_t next = 0;
+    const double tlsfTime = Benchmark::nanosecondsPerOperation(OperationCount, [&]() {
+        for (size_t i = 0; i < OperationCount; ++i, next = next + 1 == OperationCount ? 0 : next + 1)
+        {
+            const Operation &operation = operations[next];
+            TlsfAllocator::Allocation &allocation = tlsfLive[operation.victim];
+            if (allocation.valid())
+                tlsf.free(allocation);
+            allocation = tlsf.allocate(operation.size, operation.alignment);
+            failures += !allocation.valid();
+        }
+    });
+    const TlsfAllocator::Stats stats = tlsf.stats();
+    Benchmark::printResult("TlsfAllocator, allocate + free", tlsfTime);
+    std::printf("  %.1f MB used, %u free blocks, largest %.1f MB, fragmentation %.2f, %zu failed\n",
+                double(stats.usedSize) / (1 << 20), stats.freeBlockCount, double(stats.largestFreeBlock) / (1 << 20),
+                stats.fragmentation, failures);
+
+    // RangeAllocator walks its free map from the lowest offset, so it is timed on a fraction of the operations.
+    constexpr size_t RangeOperationCount = OperationCount / 16;
+    RangeAllocator range(Capacity);
+    struct RangeLive {
+        size_t offset, size;
+    };
+    std::vector<RangeLive> rangeLive(LiveCount);
+    for (size_t i = 0; i < LiveCount; ++i)
+        rangeLive[i] = {range.allocate(operations[i].size, operations[i].alignment), operations[i].size};
+    next = 0;
+    const double rangeTime = Benchmark::nanosecondsPerOperation(RangeOperationCount, [&]() {
+        for (size_t i = 0; i < RangeOperationCount; ++i, next = next + 1 == OperationCount ? 0 : next + 1)
+        {
+            const Operation &operation = operations[next];
+            RangeLive &allocation = rangeLive[operation.victim];
+            if (allocation.offset != RangeAllocator::InvalidOffset)
+                range.free(allocation.offset, allocation.size);
+            allocation = {range.allocate(operation.size, operation.alignment), operation.size};
+        }
+    });
+    Benchmark::printResult("RangeAllocator (first fit), allocate + free", rangeTime);
+    std::printf("  %.1f MB used, largest free block %.1f MB\n", double(range.usedSize()) / (1 << 20),
+                double(range.largestFreeBlock()) / (1 << 20));
+
+    if (failures > 0)
+        std::printf("  ALLOCATION FAILED\n");
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,129 @@
+// TransformHierarchy::update for 1M nodes in 1000 trees with a fan-out of 8: a frame where every root moves, so
+// every world matrix is recomputed, a frame where 1% of the nodes change, and a frame after 1000 reparents, which
+// re-sorts the whole hierarchy. Each runs on one thread and across the JobSystem. Returns non-zero if a world matrix
+// differs from the product of the float4x4::transform chain.
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "Benchmark.h"
+#include "JobSystem.h"
+#include "SimdMath.h"
+#include "TransformHierarchy.h"
+
+using namespace SimdMath;
+
+namespace
+{
+constexpr size_t NodeCount = 1000000;
+constexpr size_t RootCount = 1000;
+
+struct Local {
+    float translation[3];
+    float rotation[4];
+    float scale[3];
+};
+
+using NodeId = TransformHierarchy::NodeId;
+
+float4x4 reference(const TransformHierarchy &hierarchy, const std::vector<Local> &locals, NodeId node)
+{
+    const Local &l = locals[node];
+    const float4x4 local = float4x4::transform({l.translation[0], l.translation[1], l.translation[2]},
+                                               {l.rotation[0], l.rotation[1], l.rotation[2], l.rotation[3]},
+                                               {l.scale[0], l.scale[1], l.scale[2]});
+    const NodeId parent = hierarchy.parent(node);
+    return parent == TransformHierarchy::InvalidNode ? local : reference(hierarchy, locals, parent) * local;
+}
+
+bool matches(const TransformHierarchy &hierarchy, const std::vector<Local> &locals)
+{
+    for (NodeId node = 0; node < NodeCount; node += 997)
+    {
+        const float4x4 expected = reference(hierarchy, locals, node);
+        const float *actual = hierarchy.worldMatrix(node).m;
+        for (int i = 0; i < 16; ++i)
+        {
+            if (std::fabs(actual[i] - expected.data()[i]) > 1e-3f * (1.0f + std::fabs(expected.data()[i])))
+                return false;
+        }
+    }
+    return true;
+}
+} // namespace
+
+int main()
+{
+    TransformHierarchy hierarchy;
+    std::vector<Local> locals(NodeCount);
+    std::mt19937 random(3);
+    std::uniform_real_distribution<float> offset(-2.0f, 2.0f), unit(-1.0f, 1.0f), scales(0.9f, 1.1f);
+    for (size_t i = 0; i < NodeCount; ++i)
+    {
+        hierarchy.create(i < RootCount ? TransformHierarchy::InvalidNode : NodeId(i / 8));
+        const float4 q = {unit(random), unit(random), unit(random), unit(random)};
+        const float length = std::sqrt(q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w);
+        locals[i] = {{offset(random), offset(random), offset(random)},
+                     {q.x / length, q.y / length, q.z / length, q.w / length},
+                     {scales(random), scales(random), scales(random)}};
+        hierarchy.setLocal(NodeId(i), locals[i].translation, locals[i].rotation, locals[i].scale);
+    }
+    JobSystem jobs;
+    hierarchy.update(&jobs);
+    bool match = matches(hierarchy, locals);
+
+    // Moving the roots back and forth dirties every node below them.
+    auto moveRoots = [&]() {
+        for (NodeId root = 0; root < RootCount; ++root)
+        {
+            locals[root].translation[0] = -locals[root].translation[0];
+            hierarchy.setTranslation(root, locals[root].translation);
+        }
+    };
+    std::vector<NodeId> changed(NodeCount / 100);
+    for (NodeId &node : changed)
+        node = NodeId(std::uniform_int_distribution<size_t>(RootCount, NodeCount - 1)(random));
+    auto changeOnePercent = [&]() {
+        for (NodeId node : changed)
+        {
+            locals[node].translation[1] = -locals[node].translation[1];
+            hierarchy.setTranslation(node, locals[node].translation);
+        }
+    };
+    // Swaps the parents of two leaves; leaves have no descendants, so this never creates a cycle.
+    auto reparent = [&]() {
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            const NodeId a = NodeId(NodeCount - 1 - i), b = NodeId(NodeCount - 1001 - i);
+            const NodeId parentA = hierarchy.parent(a);
+            hierarchy.setParent(a, hierarchy.parent(b));
+            hierarchy.setParent(b, parentA);
+        }
+    };
+
+    char title[128];
+    std::snprintf(title, sizeof(title), "TransformHierarchy::update, 1M nodes, %u worker threads, ms per frame",
+                  std::thread::hardware_concurrency());
+    Benchmark::printHeader(title);
+    auto frame = [&](const char *name, auto &&change, JobSystem *pJobs) {
+        const double ns = Benchmark::nanosecondsPerOperation(1, [&]() {
+            change();
+            hierarchy.update(pJobs);
+            Benchmark::doNotOptimize(hierarchy.worldMatrices()[0]);
+        });
+        std::printf("  %-44s %10.2f ms\n", name, ns * 1e-6);
+        match &= matches(hierarchy, locals);
+    };
+    frame("every node changed, one thread", moveRoots, nullptr);
+    frame("every node changed, JobSystem", moveRoots, &jobs);
+    frame("1% of nodes changed, one thread", changeOnePercent, nullptr);
+    frame("1% of nodes changed, JobSystem", changeOnePercent, &jobs);
+    frame("1000 reparents, re-sort + update, JobSystem", reparent, &jobs);
+
+    if (!match)
+        std::printf("  MISMATCH\n");
+    return match ? 0 : 1;
+}
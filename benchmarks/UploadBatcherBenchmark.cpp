@@ -0,0 +1,322 @@
+// UploadBatcher on synthetic upload patterns. Each pattern runs for 60 frames against simulated GPU memory: the copies
+// a flush returns execute three frames later, reading the staging ring as it is then, and the resources must end up
+// byte for byte what applying the uploads and copies in recording order gives. Reports how many copies the uploads
+// coalesced into and the CPU cost per upload, and returns non-zero on any mismatch.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "Benchmark.h"
+#include "UploadBatcher.h"
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+constexpr int FrameCount = 60;
+constexpr uint64_t FrameLatency = 3;
+
+// Staging and the GPU resources as plain memory, plus a reference copy of the resources updated directly.
+class Simulation {
+  public:
+    Simulation(const UploadBatcher::Settings &settings, size_t resourceCount, size_t resourceSize)
+        : _batcher(settings), _ring(settings.stagingSize),
+          _resources(resourceCount, std::vector<uint8_t>(resourceSize)), _reference(_resources),
+          _handles(resourceCount)
+    {
+    }
+
+    std::mt19937 random{7};
+
+    void upload(size_t resource, uint64_t offset, uint64_t size)
+    {
+        _data.resize(size);
+        for (uint8_t &byte : _data)
+            byte = uint8_t(random());
+
+        const Clock::time_point start = Clock::now();
+        const uint64_t staging = _batcher.upload(&_handles[resource], offset, size);
+        _uploadTime += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        if (staging == UploadBatcher::InvalidOffset)
+        {
+            ++_overflows;
+            return;
+        }
+        std::memcpy(&_ring[staging], _data.data(), size);
+        _recorded.push_back({size_t(-1), 0, resource, offset, size, _data});
+    }
+
+    void copy(size_t source, uint64_t sourceOffset, size_t destination, uint64_t destinationOffset, uint64_t size)
+    {
+        _batcher.copy(&_handles[source], sourceOffset, &_handles[destination], destinationOffset, size);
+        _recorded.push_back({source, sourceOffset, destination, destinationOffset, size, {}});
+    }
+
+    // Flushes the frame's copies, and runs those of the frame the latency lets the next frame reuse the staging of.
+    void endFrame()
+    {
+        Frame frame;
+        const Clock::time_point start = Clock::now();
+        frame.serial = _batcher.flush(frame.copies);
+        _flushTime += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        _uploads += _batcher.stats().uploads;
+        _copies += _batcher.stats().copies;
+        frame.operations = std::move(_recorded);
+        _recorded.clear();
+        _inFlight.push_back(std::move(frame));
+
+        if (_inFlight.back().serial >= FrameLatency)
+        {
+            const uint64_t completed = _inFlight.front().serial;
+            execute(_inFlight.front());
+            _inFlight.pop_front();
+            _batcher.release(completed);
+        }
+    }
+
+    // Runs what is left and reports; returns whether the resources match the reference.
+    bool report(const char *name)
+    {
+        for (const Frame &frame : _inFlight)
+            execute(frame);
+        _inFlight.clear();
+        const bool match = _resources == _reference;
+        std::printf("  %-24s %8llu %8llu %7.1fx %9llu %9.1f %9.1f  %s\n", name, (unsigned long long)_uploads,
+                    (unsigned long long)_copies, double(_uploads) / double(std::max<uint64_t>(_copies, 1)),
+                    (unsigned long long)_overflows, _uploadTime / double(std::max<uint64_t>(_uploads, 1)),
+                    _flushTime / double(std::max<uint64_t>(_uploads, 1)), match ? "ok" : "MISMATCH");
+        return match;
+    }
+
+  private:
+    struct Operation {
+        size_t source; // size_t(-1) for an upload, whose bytes are in data
+        uint64_t sourceOffset;
+        size_t destination;
+        uint64_t destinationOffset;
+        uint64_t size;
+        std::vector<uint8_t> data;
+    };
+
+    struct Frame {
+        uint64_t serial;
+        std::vector<UploadBatcher::Copy> copies;
+        std::vector<Operation> operations;
+    };
+
+    size_t index(const void *pHandle) const { return size_t(static_cast<const int *>(pHandle) - _handles.data()); }
+
+    void execute(const Frame &frame)
+    {
+        for (const UploadBatcher::Copy &copy : frame.copies)
+        {
+            const uint8_t *pSource = copy.pSource ? &_resources[index(copy.pSource)][copy.sourceOffset]
+                                                  : &_ring[copy.sourceOffset];
+            std::memmove(&_resources[index(copy.pDestination)][copy.destinationOffset], pSource, copy.size);
+        }
+        for (const Operation &op : frame.operations)
+        {
+            const uint8_t *pSource = op.source == size_t(-1) ? op.data.data() : &_reference[op.source][op.sourceOffset];
+            std::memmove(&_reference[op.destination][op.destinationOffset], pSource, op.size);
+        }
+    }
+
+    UploadBatcher _batcher;
+    std::vector<uint8_t> _ring;
+    std::vector<std::vector<uint8_t>> _resources, _reference;
+    std::vector<int> _handles; // their addresses stand for the resources
+    std::vector<Operation> _recorded;
+    std::deque<Frame> _inFlight;
+    std::vector<uint8_t> _data;
+    uint64_t _uploads = 0, _copies = 0, _overflows = 0;
+    double _uploadTime = 0.0, _flushTime = 0.0;
+};
+
+// Meshes of 24 to 2000 vertices uploaded as positions, attributes and 16-bit indices into three buffers, as
+// GeometryPool does.
+void uploadMeshes(Simulation &simulation)
+{
+    std::uniform_int_distribution<uint64_t> vertexCounts(24, 2000);
+    uint64_t vertices = 0, indices = 0;
+    for (int mesh = 0; mesh < 64; ++mesh)
+    {
+        const uint64_t count = vertexCounts(simulation.random);
+        simulation.upload(0, vertices * 16, count * 16);
+        simulation.upload(1, vertices * 8, count * 8);
+        simulation.upload(2, indices * 2, count * 6 * 2);
+        vertices += count;
+        indices += count * 6;
+    }
+}
+} // namespace
+
+int main()
+{
+    Benchmark::printHeader("UploadBatcher, 60 frames per pattern, copies executed 3 frames late");
+    std::printf("  %-24s %8s %8s %8s %9s %9s %9s\n", "pattern", "uploads", "copies", "ratio", "overflows", "upload ns",
+                "flush ns");
+
+    const UploadBatcher::Settings settings;
+    bool match = true;
+    {
+        Simulation simulation(settings, 1, 4 << 20);
+        for (int frame = 0; frame < FrameCount; ++frame)
+        {
+            for (uint64_t i = 0; i < 4096; ++i)
+                simulation.upload(0, i * 256, 256);
+            simulation.endFrame();
+        }
+        match &= simulation.report("sequential 256 B");
+    }
+    {
+        Simulation simulation(settings, 3, 8 << 20);
+        for (int frame = 0; frame < FrameCount; ++frame)
+        {
+            uploadMeshes(simulation);
+            simulation.endFrame();
+        }
+        match &= simulation.report("interleaved meshes");
+    }
+    {
+        // Without per-destination chunks, interleaved streams break at every switch.
+        UploadBatcher::Settings tiny = settings;
+        tiny.chunkSize = 4;
+        Simulation simulation(tiny, 3, 8 << 20);
+        for (int frame = 0; frame < FrameCount; ++frame)
+        {
+            uploadMeshes(simulation);
+            simulation.endFrame();
+        }
+        match &= simulation.report("interleaved, 4 B chunks");
+    }
+    {
+        Simulation simulation(settings, 2, 4 << 20);
+        std::uniform_int_distribution<int> percent(0, 99);
+        for (int frame = 0; frame < FrameCount; ++frame)
+        {
+            for (uint64_t i = 0; i < 8192; ++i)
+            {
+                if (percent(simulation.random) < 50)
+                    simulation.upload(0, i * 128, 128);
+            }
+            simulation.endFrame();
+        }
+        match &= simulation.report("half the blocks");
+    }
+    {
+        Simulation simulation(settings, 1, 1 << 20);
+        std::vector<uint64_t> order(4096);
+        for (int frame = 0; frame < FrameCount; ++frame)
+        {
+            for (uint64_t i = 0; i < order.size(); ++i)
+                order[i] = i;
+            std::shuffle(order.begin(), order.end(), simulation.random);
+            for (uint64_t i : order)
+                simulation.upload(0, i * 256, 256);
+            simulation.endFrame();
+        }
+        match &= simulation.report("shuffled 256 B blocks");
+    }
+    {
+        Simulation simulation(settings, 4, 16 << 20);
+        std::uniform_int_distribution<uint64_t> sizes(16, 256), offsets(0, (16 << 20) / 4 - 1024);
+        std::uniform_int_distribution<size_t> resources(0, 3);
+        for (int frame = 0; frame < FrameCount; ++frame)
+        {
+            for (int i = 0; i < 2048; ++i)
+            {
+                simulation.upload(resources(simulation.random), offsets(simulation.random) * 4,
+                                  sizes(simulation.random) * 4);
+            }
+            simulation.endFrame();
+        }
+        match &= simulation.report("random scatter");
+    }
+    {
+        // Rewrites of overlapping ranges must land in recording order.
+        Simulation simulation(settings, 1, 1 << 20);
+        std::uniform_int_distribution<uint64_t> offsets(0, 255);
+        for (int frame = 0; frame < FrameCount; ++frame)
+        {
+            for (int i = 0; i < 1024; ++i)
+                simulation.upload(0, offsets(simulation.random) * 64, 4096);
+            simulation.endFrame();
+        }
+        match &= simulation.report("overlapping rewrites");
+    }
+    {
+        // GeometryPool compaction: live ranges move between two buffers, with uploads before and after the move and
+        // writes to the source after it was read.
+        Simulation simulation(settings, 2, 4 << 20);
+        std::uniform_int_distribution<int> percent(0, 99);
+        for (int frame = 0; frame < FrameCount; ++frame)
+        {
+            const size_t from = frame % 2, to = 1 - from;
+            for (uint64_t i = 0; i < 256; ++i)
+                simulation.upload(from, i * 4096, 4096);
+            uint64_t packed = 0;
+            for (uint64_t i = 0; i < 1024; ++i)
+            {
+                if (percent(simulation.random) < 70)
+                {
+                    simulation.copy(from, i * 1024, to, packed, 1024);
+                    packed += 1024;
+                }
+            }
+            for (uint64_t i = 0; i < 64; ++i)
+                simulation.upload(to, packed + i * 512, 512);
+            for (uint64_t i = 0; i < 16; ++i)
+                simulation.upload(from, i * 256, 256);
+            simulation.endFrame();
+        }
+        match &= simulation.report("compaction");
+    }
+    {
+        // Frames that need more than a third of the ring overflow, and the caller stages those uploads elsewhere.
+        UploadBatcher::Settings small = settings;
+        small.stagingSize = 1 << 20;
+        Simulation simulation(small, 2, 4 << 20);
+        std::uniform_int_distribution<uint64_t> counts(16, 600);
+        for (int frame = 0; frame < FrameCount; ++frame)
+        {
+            const uint64_t count = counts(simulation.random);
+            for (uint64_t i = 0; i < count; ++i)
+                simulation.upload(i % 2, i * 1024, 1024);
+            simulation.endFrame();
+        }
+        match &= simulation.report("1 MB ring");
+    }
+
+    // The batcher alone, with no simulated memory in the way.
+    int destinations[3];
+    std::vector<UploadBatcher::Copy> copies;
+    const char *const Patterns[] = {"sequential", "3 interleaved streams", "shuffled"};
+    for (int pattern = 0; pattern < 3; ++pattern)
+    {
+        UploadBatcher batcher(settings);
+        std::vector<uint64_t> offsets(2048);
+        for (size_t i = 0; i < offsets.size(); ++i)
+            offsets[i] = pattern == 1 ? (i / 3) * 256 : i * 256;
+        if (pattern == 2)
+            std::shuffle(offsets.begin(), offsets.end(), std::mt19937(1));
+
+        uint64_t serial = 0;
+        char name[64];
+        std::snprintf(name, sizeof(name), "upload + flush, %s", Patterns[pattern]);
+        Benchmark::printResult(name, Benchmark::nanosecondsPerOperation(offsets.size(), [&]() {
+                                   for (size_t i = 0; i < offsets.size(); ++i)
+                                       batcher.upload(&destinations[pattern == 1 ? i % 3 : 0], offsets[i], 256);
+                                   copies.clear();
+                                   serial = batcher.flush(copies);
+                                   if (serial > 2)
+                                       batcher.release(serial - 2);
+                               }));
+    }
+
+    return match ? 0 : 1;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "RenderGraph.h"
+#include "SyncPlanner.h"
+
+// Decides which compute passes of a compiled RenderGraph run on a second, compute-only queue, where they overlap
+// the graphics queue's work. Decisions come from a model of the two queues: each runs its passes in order, a pass
+// starts once the passes it depends on have finished, plus eventLatency when one of them ran on the other queue,
+// and while both queues are busy each progresses at overlapEfficiency of its speed alone, as they share the GPU.
+// Compute passes are moved from one queue to the other, one at a time, whenever that shortens the modelled frame.
+//
+// Pass costs are estimates in any consistent unit, such as microseconds measured on earlier frames.
+class AsyncComputeScheduler {
+  public:
+    using PassId = RenderGraph::PassId;
+    static constexpr uint32_t GraphicsQueue = 0;
+    static constexpr uint32_t ComputeQueue = 1;
+
+    struct Settings {
+        float eventLatency = 15.0f;
+        float overlapEfficiency = 0.75f; // 0.5 when overlapping gains nothing, 1 when it is free
+    };
+
+    explicit AsyncComputeScheduler(const Settings &settings);
+
+    // pCosts holds a cost per pass of the graph, indexed by PassId.
+    void schedule(const RenderGraph &graph, const float *pCosts);
+
+    uint32_t queue(PassId pass) const { return _queues[pass]; }
+    // Modelled frame times with every pass on the graphics queue, and as scheduled.
+    float serialTime() const { return _serialTime; }
+    float scheduledTime() const { return _scheduledTime; }
+
+    // Feeds the scheduled graph's passes, in execution order, to the planner, so SyncPlanner::PassId i is
+    // graph.order()[i], with Metal tracking hazards within each queue. Cross-queue hazards become event waits.
+    void plan(const RenderGraph &graph, SyncPlanner &planner) const;
+
+    // The modelled frame time of the graph's passes on the given queues, indexed by PassId.
+    float simulate(const RenderGraph &graph, const float *pCosts, const uint32_t *pQueues);
+
+  private:
+    Settings _settings;
+    std::vector<uint32_t> _queues;
+    float _serialTime = 0.0f;
+    float _scheduledTime = 0.0f;
+
+    // simulate() scratch, per PassId.
+    std::vector<float> _finish;
+    std::vector<PassId> _queueOrder[2];
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <Metal/Metal.hpp>
+#include <vector>
+
+#include "DescriptorTable.h"
+
+// Must match MaterialData in shaders/square.metal. Instances name their material by index, and the material names
+// its texture and sampler by their slots in the BindlessTable.
+struct MaterialData {
+    uint32_t albedoTexture;
+    uint32_t sampler;
+    uint32_t padding[2];
+};
+
+// Every texture and sampler shaders may sample, in one argument buffer laid out as BindlessTable in
+// shaders/square.metal: an array of MaxTextures textures followed by one of MaxSamplers samplers. Slots come from a
+// DescriptorTable each, so a freed slot is only written again once no frame in flight can read it, and the argument
+// buffer is written in place. Encoders using the table call useResources() to make its textures resident.
+class BindlessTable {
+  public:
+    static constexpr uint32_t MaxTextures = 1024;
+    static constexpr uint32_t MaxSamplers = 16;
+
+    BindlessTable(MTL::Device *pDevice, uint32_t frameLatency);
+    ~BindlessTable();
+
+    // Call once per frame, before adding or removing anything.
+    void beginFrame();
+
+    // The table retains what it is given until it is removed. Returns InvalidHandle when the table is full.
+    DescriptorTable::Handle addTexture(MTL::Texture *pTexture);
+    DescriptorTable::Handle addSampler(MTL::SamplerState *pSampler);
+    void removeTexture(DescriptorTable::Handle handle);
+    void removeSampler(DescriptorTable::Handle handle);
+
+    MTL::Buffer *argumentBuffer() const { return _pArgumentBuffer; }
+    void useResources(MTL::RenderCommandEncoder *pEncoder);
+
+    DescriptorTable::Stats textureStats() const { return _textureSlots.stats(); }
+
+  private:
+    struct Removed {
+        NS::Object *pObject;
+        uint64_t frame;
+    };
+
+    MTL::Device *_pDevice;
+    uint32_t _frameLatency;
+    MTL::ArgumentEncoder *_pArgumentEncoder;
+    MTL::Buffer *_pArgumentBuffer;
+    DescriptorTable _textureSlots;
+    DescriptorTable _samplerSlots;
+    uint64_t _frame = 0;
+    std::vector<MTL::Texture *> _textures; // per slot
+    std::vector<MTL::SamplerState *> _samplers;
+    std::vector<MTL::Resource *> _residentTextures; // the non-null _textures, for useResources()
+    bool _residentDirty = false;
+    std::vector<Removed> _removed; // released frameLatency frames after their removal
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+struct Sphere {
+    float x, y, z;
+    float radius;
+};
+
+struct AABB {
+    float minX, minY, minZ;
+    float maxX, maxY, maxZ;
+};
+
+// A point p is inside when dot(normal, p) + distance >= 0.
+struct Plane {
+    float nx, ny, nz;
+    float distance;
+
+    float signedDistance(float x, float y, float z) const { return nx * x + ny * y + nz * z + distance; }
+};
+
+struct Frustum {
+    enum { Left, Right, Bottom, Top, Near, Far, PlaneCount };
+
+    Plane planes[PlaneCount];
+
+    // m is a column-major view-projection matrix producing Metal clip space (z in [0, w]).
+    static Frustum fromViewProjection(const float *m)
+    {
+        auto row = [m](int r, float out[4]) {
+            for (int c = 0; c < 4; ++c)
+                out[c] = m[c * 4 + r];
+        };
+        float r0[4], r1[4], r2[4], r3[4];
+        row(0, r0);
+        row(1, r1);
+        row(2, r2);
+        row(3, r3);
+
+        Frustum f;
+        auto set = [&f](int i, float a, float b, float c, float d) {
+            const float length = std::sqrt(a * a + b * b + c * c);
+            f.planes[i] = {a / length, b / length, c / length, d / length};
+        };
+        set(Left, r3[0] + r0[0], r3[1] + r0[1], r3[2] + r0[2], r3[3] + r0[3]);
+        set(Right, r3[0] - r0[0], r3[1] - r0[1], r3[2] - r0[2], r3[3] - r0[3]);
+        set(Bottom, r3[0] + r1[0], r3[1] + r1[1], r3[2] + r1[2], r3[3] + r1[3]);
+        set(Top, r3[0] - r1[0], r3[1] - r1[1], r3[2] - r1[2], r3[3] - r1[3]);
+        set(Near, r2[0], r2[1], r2[2], r2[3]);
+        set(Far, r3[0] - r2[0], r3[1] - r2[1], r3[2] - r2[2], r3[3] - r2[3]);
+        return f;
+    }
+
+    bool intersects(const Sphere &s) const
+    {
+        for (const Plane &p : planes)
+        {
+            if (p.signedDistance(s.x, s.y, s.z) < -s.radius)
+                return false;
+        }
+        return true;
+    }
+
+    bool intersects(const AABB &b) const
+    {
+        for (const Plane &p : planes)
+        {
+            // Test the box corner furthest along the plane normal.
+            const float x = p.nx >= 0.0f ? b.maxX : b.minX;
+            const float y = p.ny >= 0.0f ? b.maxY : b.minY;
+            const float z = p.nz >= 0.0f ? b.maxZ : b.minZ;
+            if (p.signedDistance(x, y, z) < 0.0f)
+                return false;
+        }
+        return true;
+    }
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "FrustumCulling.h"
+#include "SimdMath.h"
+
+class JobSystem;
+
+// Per-cascade constants; must match ShadowCascade in shaders/shadow.metal.
+struct ShadowCascade {
+    SimdMath::float4x4 lightViewProjection; // world to the cascade's clip space
+    float atlasScaleOffset[4];              // atlas uv = clip xy * scale + offset
+    float splitDepth;                       // view depth where the next cascade takes over
+    float texelSize;                        // world units per shadow texel
+    float padding[2];
+};
+
+static_assert(sizeof(ShadowCascade) == 96, "ShadowCascade must match the shader layout");
+
+// Directional light shadows over cascades of the view frustum, all rendered into one depth atlas.
+//
+// Split depths blend logarithmic and uniform spacing (the practical split scheme). Each cascade is fitted with the
+// bounding sphere of its frustum slice, whose size does not change as the camera turns, and its orthographic
+// projection is snapped to whole shadow texels in light space, so shadow edges do not shimmer as the camera moves. The
+// projection is a texel wider than the sphere on every side, so the snapped square still contains it.
+//
+// Casters are culled for all cascades in one pass: their bounding spheres are moved into light space eight at a time
+// and tested against every cascade's sides and far plane. Nothing is culled toward the light, since casters between
+// the light and a cascade still shadow it; the shadow pass clamps their depth instead of clipping them.
+class CascadedShadows {
+  public:
+    static constexpr uint32_t MaxCascades = 4;
+    static constexpr uint32_t AtlasColumns = 2;
+
+    struct Settings {
+        uint32_t cascadeCount = 4;
+        uint32_t resolution = 1024;    // texels per side of one cascade
+        float splitLambda = 0.75f;     // 0 splits uniformly, 1 logarithmically
+        float shadowDistance = 100.0f; // view depth the last cascade ends at
+        float casterMargin = 50.0f;    // how far toward the light the depth range reaches beyond a cascade
+    };
+
+    struct Camera {
+        const float *viewMatrix; // column-major world-to-view, right-handed looking down -z
+        float fovY;
+        float aspect;
+        float nearZ;
+    };
+
+    struct Viewport {
+        uint32_t x, y, size;
+    };
+
+    explicit CascadedShadows(const Settings &settings);
+
+    // lightDirection points from the light into the scene.
+    void update(const Camera &camera, const float lightDirection[3]);
+
+    // ppVisible[c] receives the indices of the casters of cascade c, in increasing order, and needs room for count
+    // entries; pCounts[c] receives how many there are.
+    void cullCasters(const FrustumCulling::SphereSoA &casters, size_t count, uint32_t *const *ppVisible,
+                     size_t *pCounts, JobSystem *pJobs = nullptr) const;
+
+    uint32_t cascadeCount() const { return _settings.cascadeCount; }
+    const ShadowCascade &cascade(uint32_t index) const { return _cascades[index]; }
+    const ShadowCascade *cascades() const { return _cascades; }
+    Viewport viewport(uint32_t index) const;
+    uint32_t atlasWidth() const;
+    uint32_t atlasHeight() const;
+
+    // Practical split scheme: pSplits receives count + 1 depths from nearZ to farZ.
+    static void computeSplits(float nearZ, float farZ, uint32_t count, float lambda, float *pSplits);
+
+  private:
+    struct Bounds {
+        float centerX, centerY; // light space, snapped
+        float halfSize;
+        float farDepth;
+    };
+
+    Settings _settings;
+    ShadowCascade _cascades[MaxCascades] = {};
+    Bounds _bounds[MaxCascades] = {};
+    SimdMath::float3 _lightRight = {}, _lightUp = {}, _lightForward = {};
+};
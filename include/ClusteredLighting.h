@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "SceneComponents.h"
+
+class JobSystem;
+
+// Per-frame constants of the cluster grid; must match ClusterGrid in shaders/square.metal. A fragment's cluster is
+// (x * pixelToClusterX, y * pixelToClusterY) in pixels from the top left, and log2(viewDepth) * depthScale +
+// depthBias along the exponential depth slices.
+struct ClusterGrid {
+    uint32_t countX, countY, countZ;
+    uint32_t lightCount;
+    float pixelToClusterX, pixelToClusterY;
+    float depthScale, depthBias;
+};
+
+// The lights of one cluster are lightIndices[offset, offset + count).
+struct ClusterRange {
+    uint32_t offset;
+    uint32_t count;
+};
+
+static_assert(sizeof(LightComponent) == 32, "LightComponent is uploaded as the shader's ClusterLight");
+
+// Assigns point lights to the clusters of a froxel grid: the view frustum split into countX x countY screen tiles and
+// countZ exponentially spaced depth slices. Each light is tested against the view-space bounds of the clusters
+// under its projected rectangle, eight clusters at a time.
+//
+// Binning runs over chunks of lights in parallel. Every chunk counts its lights per cluster, a prefix sum over the
+// counts gives each chunk its place in every cluster's list, and the chunks then write their indices straight into
+// the upload buffer. Lights keep their input order within a cluster.
+class LightClusters {
+  public:
+    static constexpr uint32_t MaxLights = 65536;
+
+    struct Settings {
+        uint32_t countX = 16, countY = 9, countZ = 24;
+    };
+
+    // Byte offsets of the sections written by write(), each aligned for binding as a buffer offset.
+    struct Layout {
+        size_t gridOffset;
+        size_t lightsOffset;  // LightComponent[lightCount]
+        size_t rangesOffset;  // ClusterRange[clusterCount]
+        size_t indicesOffset; // uint16_t[indexCount]
+        size_t size;
+    };
+
+    explicit LightClusters(const Settings &settings);
+
+    // Symmetric right-handed perspective looking down -z, as float4x4::perspective builds it.
+    void setProjection(float fovY, float viewportWidth, float viewportHeight, float nearZ, float farZ);
+
+    // viewMatrix is column-major world-to-view. Light positions are in world space. Cluster lists hold 16-bit light
+    // indices, so only the first MaxLights lights are binned and uploaded; returns how many that was.
+    size_t build(const float *viewMatrix, const LightComponent *pLights, size_t count, JobSystem *pJobs = nullptr);
+
+    Layout layout() const;
+    // Writes the grid constants, the lights, the per-cluster ranges and the index lists; pDestination needs
+    // layout().size bytes, typically the mapped contents of this frame's buffer.
+    void write(void *pDestination, JobSystem *pJobs = nullptr) const;
+
+    size_t lightCount() const { return _lightCount; }
+    size_t clusterCount() const { return _clusterCount; }
+    size_t indexCount() const { return _indexCount; }
+
+  private:
+    void binLights(const float *viewMatrix, size_t chunk, size_t begin, size_t end);
+    uint32_t sliceOf(float depth) const;
+
+    Settings _settings;
+    size_t _clusterCount;
+    ClusterGrid _grid = {};
+    float _tanHalfX = 1.0f, _tanHalfY = 1.0f;
+    float _inverseTanHalfX = 1.0f, _inverseTanHalfY = 1.0f;
+    float _nearZ = 0.1f, _farZ = 100.0f;
+
+    // View-space bounds of every cluster, x fastest, with depth measured along -z; padded for eight-wide loads.
+    std::vector<float> _minX, _minY, _minDepth, _maxX, _maxY, _maxDepth;
+
+    // Per build.
+    const LightComponent *_pLights = nullptr;
+    size_t _lightCount = 0;
+    size_t _chunkCount = 0;
+    std::vector<std::vector<uint32_t>> _chunkPairs; // cluster << 16 | light, per chunk of lights
+    std::vector<uint32_t> _chunkOffsets;            // per chunk and cluster: first index slot
+    std::vector<ClusterRange> _ranges;
+    size_t _indexCount = 0;
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Hands out the slots of a fixed-size GPU descriptor table, such as the texture array of a bindless argument buffer.
+// A handle packs the slot index, which is what shaders see, with a generation counter, so a handle kept past its
+// free() is detected instead of silently naming whatever took the slot next. A freed slot is retired for
+// frameLatency frames before it can be reused, as frames still in flight may read it. The table never touches the
+// descriptors themselves: the caller encodes each one at the index of the handle it was given, as BindlessTable does.
+class DescriptorTable {
+  public:
+    using Handle = uint32_t;
+    static constexpr Handle InvalidHandle = 0;
+    static constexpr uint32_t IndexBits = 20;
+    static constexpr uint32_t MaxCapacity = 1u << IndexBits;
+
+    struct Settings {
+        uint32_t capacity = 1024; // at most MaxCapacity
+        uint32_t frameLatency = 3;
+    };
+
+    struct Stats {
+        uint32_t capacity;
+        uint32_t allocated;
+        uint32_t retired; // freed, waiting for the frames in flight
+        uint32_t highWater;
+    };
+
+    explicit DescriptorTable(const Settings &settings);
+
+    // Starts a frame; frame numbers increase by one per frame. Slots retired long enough ago become free again.
+    void beginFrame(uint64_t frame);
+
+    // InvalidHandle when every slot is allocated or retired.
+    Handle allocate();
+    void free(Handle handle);
+
+    bool valid(Handle handle) const
+    {
+        const uint32_t i = index(handle);
+        return handle != InvalidHandle && i < _generations.size() && _generations[i] == generation(handle) &&
+               _allocated[i];
+    }
+    static uint32_t index(Handle handle) { return handle & (MaxCapacity - 1); }
+    static uint32_t generation(Handle handle) { return handle >> IndexBits; }
+
+    Stats stats() const;
+
+  private:
+    static constexpr uint32_t GenerationMask = (1u << (32 - IndexBits)) - 1;
+    static constexpr uint32_t EndOfList = UINT32_MAX;
+
+    struct Retired {
+        uint32_t index;
+        uint64_t frame;
+    };
+
+    Settings _settings;
+    uint64_t _frame = 0;
+    uint32_t _allocatedCount = 0;
+    uint32_t _highWater = 0; // slots below it have been used
+    uint32_t _freeHead = EndOfList;
+    std::vector<uint32_t> _nextFree;    // per slot, while it is on the free list
+    std::vector<uint32_t> _generations; // per slot, of its current or next handle
+    std::vector<bool> _allocated;
+    std::vector<Retired> _retired; // in free order
+    size_t _retiredHead = 0;
+};
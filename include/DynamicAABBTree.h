@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Bounds.h"
+
+// Bounding volume hierarchy over moving objects. Leaves store a fattened copy of each object's bounds, so small
+// motions do not touch the tree; a proxy that leaves its fat bounds is reinserted with a surface-area cost descent
+// and the ancestors are rebalanced with AVL-style rotations. For bulk motion where the topology can stay as is,
+// setBounds + refit recomputes all internal bounds in one linear sweep instead: refit keeps the nodes in depth-first
+// order (re-laying them out first if the topology changed), so children always follow their parent in memory.
+//
+// Queries test internal nodes against the fat bounds and leaves against the exact ones. They are const and can run
+// concurrently with each other, but not with updates.
+class DynamicAABBTree {
+  public:
+    using ProxyId = uint32_t;
+    static constexpr ProxyId InvalidProxy = UINT32_MAX;
+
+    explicit DynamicAABBTree(float margin = 0.1f);
+
+    ProxyId insert(const AABB &bounds, uint32_t userData);
+    void remove(ProxyId proxy);
+
+    // Updates the proxy's bounds, reinserting it only if they left its fat bounds or shrank well inside them.
+    // displacement, if given, is the expected motion over the next frame and extends the fat bounds along it.
+    // Returns whether the tree changed.
+    bool move(ProxyId proxy, const AABB &bounds, const float displacement[3] = nullptr);
+
+    // Updates the proxy's bounds without restructuring. The ancestors, and so queries, are only correct again after
+    // the next refit().
+    void setBounds(ProxyId proxy, const AABB &bounds);
+    void refit();
+
+    // Append the userData of every proxy whose bounds pass the test.
+    void queryOverlap(const AABB &bounds, std::vector<uint32_t> &results) const;
+    void queryFrustum(const Frustum &frustum, std::vector<uint32_t> &results) const;
+
+    // Nearest proxy hit by the ray within maxDistance, or InvalidProxy. direction need not be normalized; the
+    // distance is in units of its length.
+    ProxyId pick(const float origin[3], const float direction[3], float maxDistance, float *pDistance = nullptr) const;
+
+    uint32_t userData(ProxyId proxy) const { return _proxies[proxy].userData; }
+    const AABB &bounds(ProxyId proxy) const { return _proxies[proxy].bounds; }
+    const AABB &fatBounds(ProxyId proxy) const { return _nodes[_proxies[proxy].node].bounds; }
+
+    size_t size() const { return _proxyCount; }
+    int height() const;
+    // Sum of internal node surface areas over the root's; lower means cheaper queries.
+    float areaRatio() const;
+    // Walks the whole tree checking its links and heights, that siblings differ in height by at most one, and that
+    // every node's bounds contain its children's and every leaf's its proxy's. For tests; linear in the size.
+    bool validate() const;
+
+  private:
+    static constexpr uint32_t NullNode = UINT32_MAX;
+
+    struct Node {
+        AABB bounds;     // fattened for leaves
+        uint32_t parent; // next free node while on the free list
+        uint32_t child1, child2;
+        int32_t height; // 0 for leaves, -1 for free nodes
+        uint32_t proxy; // leaves only
+        uint32_t userData;
+
+        bool isLeaf() const { return child1 == NullNode; }
+    };
+
+    struct Proxy {
+        AABB bounds;   // exact
+        uint32_t node; // next free proxy while on the free list
+        uint32_t userData;
+    };
+
+    uint32_t allocateNode();
+    void freeNode(uint32_t node);
+    void insertLeaf(uint32_t leaf);
+    void removeLeaf(uint32_t leaf);
+    uint32_t balance(uint32_t node);
+    void fixUpwards(uint32_t node);
+    void relayout();
+    void collectLeaves(uint32_t node, std::vector<uint32_t> &results) const;
+
+    std::vector<Node> _nodes;
+    std::vector<Proxy> _proxies;
+    uint32_t _root = NullNode;
+    uint32_t _freeNodes = NullNode;
+    uint32_t _freeProxies = NullNode;
+    size_t _proxyCount = 0;
+    float _margin;
+    bool _topologyChanged = false; // since the last relayout
+};
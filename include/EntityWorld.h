@@ -0,0 +1,269 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "JobSystem.h"
+
+struct Entity {
+    static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+    uint32_t index = InvalidIndex;
+    uint32_t generation = 0;
+
+    bool operator==(const Entity &o) const { return index == o.index && generation == o.generation; }
+    bool operator!=(const Entity &o) const { return !(*this == o); }
+};
+
+// Components are plain data, moved between archetypes with memcpy. Ids are handed out on first use, at most 64.
+namespace EntityComponents
+{
+const uint32_t MaxComponentTypes = 64;
+
+struct TypeInfo {
+    size_t size;
+    size_t alignment;
+};
+
+uint32_t registerType(size_t size, size_t alignment);
+const TypeInfo &typeInfo(uint32_t id);
+
+// const T names the same component as T; it only marks a read-only argument in forEach.
+template <typename T> uint32_t id()
+{
+    if constexpr (std::is_const_v<T>)
+    {
+        return id<std::remove_const_t<T>>();
+    }
+    else
+    {
+        static_assert(std::is_trivially_copyable_v<T>, "components must be trivially copyable");
+        static const uint32_t componentId = registerType(sizeof(T), alignof(T));
+        return componentId;
+    }
+}
+
+template <typename... Ts> uint64_t mask()
+{
+    return (uint64_t(0) | ... | (uint64_t(1) << id<Ts>()));
+}
+} // namespace EntityComponents
+
+// All entities with exactly one set of components. They live in fixed-size chunks, each holding one array per
+// component plus the entity handles, so iteration walks contiguous arrays.
+class Archetype {
+  public:
+    static constexpr size_t ChunkSize = 16 * 1024;
+
+    struct Chunk {
+        struct Free {
+            void operator()(uint8_t *p) const;
+        };
+        std::unique_ptr<uint8_t, Free> data;
+        uint32_t count = 0;
+    };
+
+    explicit Archetype(uint64_t mask);
+
+    uint64_t mask() const { return _mask; }
+    uint32_t chunkCapacity() const { return _chunkCapacity; }
+    size_t size() const { return _size; }
+
+    size_t chunkCount() const { return _chunks.size(); }
+    uint32_t chunkSize(size_t chunk) const { return _chunks[chunk].count; }
+    Entity *entities(size_t chunk) const { return reinterpret_cast<Entity *>(_chunks[chunk].data.get()); }
+    void *column(size_t chunk, uint32_t component) const
+    {
+        assert(_columnOffsets[component] != NoColumn);
+        return _chunks[chunk].data.get() + _columnOffsets[component];
+    }
+    template <typename T> T *column(size_t chunk) const
+    {
+        return static_cast<T *>(column(chunk, EntityComponents::id<T>()));
+    }
+
+  private:
+    friend class EntityWorld;
+
+    static constexpr size_t NoColumn = SIZE_MAX;
+
+    // Appends an entity with uninitialized components; returns its chunk and row.
+    std::pair<uint32_t, uint32_t> push(Entity entity);
+    // Fills the hole with the last entity, whose handle is returned so the caller can update its location.
+    Entity swapRemove(uint32_t chunk, uint32_t row);
+
+    uint64_t _mask;
+    std::vector<uint32_t> _components;
+    size_t _columnOffsets[EntityComponents::MaxComponentTypes];
+    uint32_t _chunkCapacity;
+    std::vector<Chunk> _chunks;
+    size_t _size = 0;
+    Archetype *_addEdges[EntityComponents::MaxComponentTypes] = {};
+    Archetype *_removeEdges[EntityComponents::MaxComponentTypes] = {};
+};
+
+// Structural changes recorded while the world is being iterated, applied later with EntityWorld::apply. Recording
+// is thread-safe, so the tasks of a parallel forEach can share one buffer. Entities created here are placeholders
+// that only mean something to later commands in the same buffer.
+class EntityCommandBuffer {
+  public:
+    Entity create();
+    void destroy(Entity entity);
+
+    template <typename T> void add(Entity entity, const T &value)
+    {
+        record(Op::Add, entity, EntityComponents::id<T>(), &value, sizeof(T));
+    }
+    template <typename T> void remove(Entity entity) { record(Op::Remove, entity, EntityComponents::id<T>()); }
+
+    bool empty() const { return _commands.empty(); }
+    void clear();
+
+  private:
+    friend class EntityWorld;
+
+    static constexpr uint32_t PendingGeneration = UINT32_MAX;
+
+    enum class Op : uint8_t { Create, Destroy, Add, Remove };
+
+    struct Command {
+        Op op;
+        uint32_t component;
+        Entity entity;
+        size_t dataOffset;
+    };
+
+    void record(Op op, Entity entity, uint32_t component = 0, const void *pData = nullptr, size_t size = 0);
+
+    std::mutex _mutex;
+    std::vector<Command> _commands;
+    std::vector<uint8_t> _data;
+    uint32_t _pendingCount = 0;
+};
+
+// Archetype-based entity storage. Adding or removing a component moves the entity to the archetype of its new
+// component set; archetypes remember those transitions, so repeated changes skip the lookup. Queries are cached per
+// component set and pick up new archetypes as they are created.
+//
+// Structural changes are not allowed while iterating; record them in an EntityCommandBuffer instead.
+class EntityWorld {
+  public:
+    EntityWorld();
+    ~EntityWorld();
+
+    EntityWorld(const EntityWorld &) = delete;
+    EntityWorld &operator=(const EntityWorld &) = delete;
+
+    template <typename... Ts> Entity create(const Ts &...components)
+    {
+        const Entity entity = createInArchetype(archetypeFor(EntityComponents::mask<Ts...>()));
+        (set(entity, components), ...);
+        return entity;
+    }
+    void destroy(Entity entity);
+    bool isAlive(Entity entity) const;
+    size_t size() const { return _aliveCount; }
+
+    template <typename T> void add(Entity entity, const T &value)
+    {
+        addComponent(entity, EntityComponents::id<T>(), &value);
+    }
+    template <typename T> void remove(Entity entity) { removeComponent(entity, EntityComponents::id<T>()); }
+
+    // nullptr if the entity does not have the component.
+    template <typename T> T *get(Entity entity) const
+    {
+        return static_cast<T *>(component(entity, EntityComponents::id<T>()));
+    }
+
+    void apply(EntityCommandBuffer &commands);
+
+    // fn(Entity, Ts &...) for every entity having at least the components Ts.
+    template <typename... Ts, typename Fn> void forEach(Fn &&fn)
+    {
+        forEachChunk<Ts...>([&fn](size_t count, const Entity *pEntities, Ts *...columns) {
+            for (size_t i = 0; i < count; ++i)
+                fn(pEntities[i], columns[i]...);
+        });
+    }
+
+    // fn(count, const Entity *, Ts *...) once per chunk, with the component arrays of that chunk.
+    template <typename... Ts, typename Fn> void forEachChunk(Fn &&fn)
+    {
+        IterationScope scope(*this);
+        for (Archetype *pArchetype : query(EntityComponents::mask<Ts...>()))
+        {
+            for (size_t chunk = 0; chunk < pArchetype->chunkCount(); ++chunk)
+                fn(size_t(pArchetype->chunkSize(chunk)), pArchetype->entities(chunk),
+                   pArchetype->template column<Ts>(chunk)...);
+        }
+    }
+
+    // As forEach, with chunks spread over the job system. fn runs concurrently and must only touch its own entities.
+    template <typename... Ts, typename Fn> void parallelForEach(JobSystem &jobs, Fn &&fn)
+    {
+        IterationScope scope(*this);
+        std::vector<std::pair<Archetype *, uint32_t>> chunks;
+        for (Archetype *pArchetype : query(EntityComponents::mask<Ts...>()))
+        {
+            for (size_t chunk = 0; chunk < pArchetype->chunkCount(); ++chunk)
+                chunks.emplace_back(pArchetype, uint32_t(chunk));
+        }
+
+        jobs.parallelFor(chunks.size(), 1, [&](size_t begin, size_t end) {
+            for (size_t c = begin; c < end; ++c)
+            {
+                Archetype *pArchetype = chunks[c].first;
+                const uint32_t chunk = chunks[c].second;
+                const Entity *pEntities = pArchetype->entities(chunk);
+                const auto columns = std::make_tuple(pArchetype->template column<Ts>(chunk)...);
+                for (size_t i = 0; i < pArchetype->chunkSize(chunk); ++i)
+                    fn(pEntities[i], std::get<Ts *>(columns)[i]...);
+            }
+        });
+    }
+
+    size_t archetypeCount() const { return _archetypes.size(); }
+
+  private:
+    struct Location {
+        Archetype *pArchetype = nullptr;
+        uint32_t chunk = 0;
+        uint32_t row = 0;
+        uint32_t generation = 0;
+    };
+
+    struct IterationScope {
+        explicit IterationScope(EntityWorld &world) : world(world) { ++world._iterating; }
+        ~IterationScope() { --world._iterating; }
+        EntityWorld &world;
+    };
+
+    template <typename T> void set(Entity entity, const T &value)
+    {
+        memcpy(component(entity, EntityComponents::id<T>()), &value, sizeof(T));
+    }
+
+    Archetype *archetypeFor(uint64_t mask);
+    const std::vector<Archetype *> &query(uint64_t mask);
+    Entity createInArchetype(Archetype *pArchetype);
+    void moveToArchetype(Entity entity, Archetype *pTarget);
+    void addComponent(Entity entity, uint32_t component, const void *pValue);
+    void removeComponent(Entity entity, uint32_t component);
+    void *component(Entity entity, uint32_t component) const;
+
+    std::unordered_map<uint64_t, std::unique_ptr<Archetype>> _archetypes;
+    std::unordered_map<uint64_t, std::vector<Archetype *>> _queries; // by required component mask
+    std::vector<Location> _locations;                                 // by entity index
+    std::vector<uint32_t> _freeIndices;
+    size_t _aliveCount = 0;
+    int _iterating = 0;
+};
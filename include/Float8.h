@@ -0,0 +1,190 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Eight float lanes: one AVX register, or two SSE / NEON registers, with a scalar fallback. Only the operations the
+// batch culling and LOD code needs.
+#if defined(__AVX__)
+struct Float8 {
+    __m256 v;
+
+    static Float8 load(const float *p) { return {_mm256_loadu_ps(p)}; }
+    static Float8 set(float f) { return {_mm256_set1_ps(f)}; }
+    void store(float *p) const { _mm256_storeu_ps(p, v); }
+    Float8 operator+(Float8 o) const { return {_mm256_add_ps(v, o.v)}; }
+    Float8 operator-(Float8 o) const { return {_mm256_sub_ps(v, o.v)}; }
+    Float8 operator*(Float8 o) const { return {_mm256_mul_ps(v, o.v)}; }
+    Float8 operator/(Float8 o) const { return {_mm256_div_ps(v, o.v)}; }
+    Float8 sqrt() const { return {_mm256_sqrt_ps(v)}; }
+    static Float8 min(Float8 a, Float8 b) { return {_mm256_min_ps(a.v, b.v)}; }
+    static Float8 max(Float8 a, Float8 b) { return {_mm256_max_ps(a.v, b.v)}; }
+    // Lanes where condition >= 0 take a, the others b.
+    static Float8 selectNonNegative(Float8 condition, Float8 a, Float8 b)
+    {
+        return {_mm256_blendv_ps(b.v, a.v, _mm256_cmp_ps(condition.v, _mm256_setzero_ps(), _CMP_GE_OQ))};
+    }
+    uint32_t nonNegativeMask() const
+    {
+        return uint32_t(_mm256_movemask_ps(_mm256_cmp_ps(v, _mm256_setzero_ps(), _CMP_GE_OQ)));
+    }
+    float minLane() const
+    {
+        __m128 m = _mm_min_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        m = _mm_min_ps(m, _mm_movehl_ps(m, m));
+        return _mm_cvtss_f32(_mm_min_ss(m, _mm_shuffle_ps(m, m, 1)));
+    }
+    float maxLane() const
+    {
+        __m128 m = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+        return _mm_cvtss_f32(_mm_max_ss(m, _mm_shuffle_ps(m, m, 1)));
+    }
+};
+#elif defined(__SSE__)
+struct Float8 {
+    __m128 lo, hi;
+
+    static Float8 load(const float *p) { return {_mm_loadu_ps(p), _mm_loadu_ps(p + 4)}; }
+    static Float8 set(float f) { return {_mm_set1_ps(f), _mm_set1_ps(f)}; }
+    void store(float *p) const
+    {
+        _mm_storeu_ps(p, lo);
+        _mm_storeu_ps(p + 4, hi);
+    }
+    Float8 operator+(Float8 o) const { return {_mm_add_ps(lo, o.lo), _mm_add_ps(hi, o.hi)}; }
+    Float8 operator-(Float8 o) const { return {_mm_sub_ps(lo, o.lo), _mm_sub_ps(hi, o.hi)}; }
+    Float8 operator*(Float8 o) const { return {_mm_mul_ps(lo, o.lo), _mm_mul_ps(hi, o.hi)}; }
+    Float8 operator/(Float8 o) const { return {_mm_div_ps(lo, o.lo), _mm_div_ps(hi, o.hi)}; }
+    Float8 sqrt() const { return {_mm_sqrt_ps(lo), _mm_sqrt_ps(hi)}; }
+    static Float8 min(Float8 a, Float8 b) { return {_mm_min_ps(a.lo, b.lo), _mm_min_ps(a.hi, b.hi)}; }
+    static Float8 max(Float8 a, Float8 b) { return {_mm_max_ps(a.lo, b.lo), _mm_max_ps(a.hi, b.hi)}; }
+    static Float8 selectNonNegative(Float8 condition, Float8 a, Float8 b)
+    {
+        const __m128 lo = _mm_cmpge_ps(condition.lo, _mm_setzero_ps());
+        const __m128 hi = _mm_cmpge_ps(condition.hi, _mm_setzero_ps());
+        return {_mm_or_ps(_mm_and_ps(lo, a.lo), _mm_andnot_ps(lo, b.lo)),
+                _mm_or_ps(_mm_and_ps(hi, a.hi), _mm_andnot_ps(hi, b.hi))};
+    }
+    uint32_t nonNegativeMask() const
+    {
+        return uint32_t(_mm_movemask_ps(_mm_cmpge_ps(lo, _mm_setzero_ps()))) |
+               uint32_t(_mm_movemask_ps(_mm_cmpge_ps(hi, _mm_setzero_ps()))) << 4;
+    }
+    float minLane() const
+    {
+        __m128 m = _mm_min_ps(lo, hi);
+        m = _mm_min_ps(m, _mm_movehl_ps(m, m));
+        return _mm_cvtss_f32(_mm_min_ss(m, _mm_shuffle_ps(m, m, 1)));
+    }
+    float maxLane() const
+    {
+        __m128 m = _mm_max_ps(lo, hi);
+        m = _mm_max_ps(m, _mm_movehl_ps(m, m));
+        return _mm_cvtss_f32(_mm_max_ss(m, _mm_shuffle_ps(m, m, 1)));
+    }
+};
+#elif defined(__ARM_NEON)
+struct Float8 {
+    float32x4_t lo, hi;
+
+    static Float8 load(const float *p) { return {vld1q_f32(p), vld1q_f32(p + 4)}; }
+    static Float8 set(float f) { return {vdupq_n_f32(f), vdupq_n_f32(f)}; }
+    void store(float *p) const
+    {
+        vst1q_f32(p, lo);
+        vst1q_f32(p + 4, hi);
+    }
+    Float8 operator+(Float8 o) const { return {vaddq_f32(lo, o.lo), vaddq_f32(hi, o.hi)}; }
+    Float8 operator-(Float8 o) const { return {vsubq_f32(lo, o.lo), vsubq_f32(hi, o.hi)}; }
+    Float8 operator*(Float8 o) const { return {vmulq_f32(lo, o.lo), vmulq_f32(hi, o.hi)}; }
+    Float8 operator/(Float8 o) const { return {vdivq_f32(lo, o.lo), vdivq_f32(hi, o.hi)}; }
+    Float8 sqrt() const { return {vsqrtq_f32(lo), vsqrtq_f32(hi)}; }
+    static Float8 min(Float8 a, Float8 b) { return {vminq_f32(a.lo, b.lo), vminq_f32(a.hi, b.hi)}; }
+    static Float8 max(Float8 a, Float8 b) { return {vmaxq_f32(a.lo, b.lo), vmaxq_f32(a.hi, b.hi)}; }
+    static Float8 selectNonNegative(Float8 condition, Float8 a, Float8 b)
+    {
+        return {vbslq_f32(vcgeq_f32(condition.lo, vdupq_n_f32(0.0f)), a.lo, b.lo),
+                vbslq_f32(vcgeq_f32(condition.hi, vdupq_n_f32(0.0f)), a.hi, b.hi)};
+    }
+    uint32_t nonNegativeMask() const
+    {
+        static const uint32_t Bits[4] = {1, 2, 4, 8};
+        const uint32x4_t bits = vld1q_u32(Bits);
+        return vaddvq_u32(vandq_u32(vcgeq_f32(lo, vdupq_n_f32(0.0f)), bits)) |
+               vaddvq_u32(vandq_u32(vcgeq_f32(hi, vdupq_n_f32(0.0f)), bits)) << 4;
+    }
+    float minLane() const { return vminvq_f32(vminq_f32(lo, hi)); }
+    float maxLane() const { return vmaxvq_f32(vmaxq_f32(lo, hi)); }
+};
+#else
+struct Float8 {
+    float v[8];
+
+    static Float8 load(const float *p)
+    {
+        Float8 r;
+        memcpy(r.v, p, sizeof(r.v));
+        return r;
+    }
+    static Float8 set(float f) { return {{f, f, f, f, f, f, f, f}}; }
+    void store(float *p) const { memcpy(p, v, sizeof(v)); }
+    template <typename Op> Float8 apply(Float8 o, Op op) const
+    {
+        Float8 r;
+        for (int i = 0; i < 8; ++i)
+            r.v[i] = op(v[i], o.v[i]);
+        return r;
+    }
+    Float8 operator+(Float8 o) const { return apply(o, [](float a, float b) { return a + b; }); }
+    Float8 operator-(Float8 o) const { return apply(o, [](float a, float b) { return a - b; }); }
+    Float8 operator*(Float8 o) const { return apply(o, [](float a, float b) { return a * b; }); }
+    Float8 operator/(Float8 o) const { return apply(o, [](float a, float b) { return a / b; }); }
+    Float8 sqrt() const
+    {
+        Float8 r;
+        for (int i = 0; i < 8; ++i)
+            r.v[i] = std::sqrt(v[i]);
+        return r;
+    }
+    static Float8 min(Float8 a, Float8 b) { return a.apply(b, [](float x, float y) { return y < x ? y : x; }); }
+    static Float8 max(Float8 a, Float8 b) { return a.apply(b, [](float x, float y) { return x < y ? y : x; }); }
+    static Float8 selectNonNegative(Float8 condition, Float8 a, Float8 b)
+    {
+        Float8 r;
+        for (int i = 0; i < 8; ++i)
+            r.v[i] = condition.v[i] >= 0.0f ? a.v[i] : b.v[i];
+        return r;
+    }
+    uint32_t nonNegativeMask() const
+    {
+        uint32_t mask = 0;
+        for (int i = 0; i < 8; ++i)
+            mask |= uint32_t(v[i] >= 0.0f) << i;
+        return mask;
+    }
+    float minLane() const
+    {
+        float m = v[0];
+        for (int i = 1; i < 8; ++i)
+            m = v[i] < m ? v[i] : m;
+        return m;
+    }
+    float maxLane() const
+    {
+        float m = v[0];
+        for (int i = 1; i < 8; ++i)
+            m = v[i] > m ? v[i] : m;
+        return m;
+    }
+};
+#endif
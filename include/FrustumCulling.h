@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Bounds.h"
+
+class JobSystem;
+
+// Frustum tests over structure-of-arrays bounds, eight objects at a time (AVX, or two 4-wide halves on SSE and
+// NEON). The indices of the visible objects are written to pVisible in increasing order and their count returned;
+// pVisible must have room for count entries, which the parallel path uses as scratch space.
+namespace FrustumCulling
+{
+struct SphereSoA {
+    const float *x, *y, *z, *radius;
+};
+
+struct AABBSoA {
+    const float *minX, *minY, *minZ;
+    const float *maxX, *maxY, *maxZ;
+};
+
+size_t cullSpheres(const Frustum &frustum, const SphereSoA &spheres, size_t count, uint32_t *pVisible,
+                   JobSystem *pJobs = nullptr);
+
+size_t cullAABBs(const Frustum &frustum, const AABBSoA &boxes, size_t count, uint32_t *pVisible,
+                 JobSystem *pJobs = nullptr);
+} // namespace FrustumCulling
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Lossless compression for geometry packs.
+//
+// Index buffers (triangle lists) are stored as one code byte per triangle that either reuses an edge of the
+// previous triangle (strip-style, usually leaving only the new vertex to encode) or falls back to three
+// zigzag-delta varints. Each triangle depends on the previous one, so index decoding is scalar rather than SIMD:
+// table-driven and specialized per index size. Vertex buffers are split into byte planes, delta coded along the
+// vertex stream and bit-packed in 16 byte blocks of 0/2/4/8 bits per value; decoding of a block is SIMD on SSE2 and
+// NEON.
+//
+// There is no entropy coding stage: on benchmarks/GeometryCodecBenchmark.cpp's corpus an ideal order-0 coder over the
+// same deltas would shrink vertex streams by a fifth at most, and a table-driven decoder would cost more decode
+// throughput than that saves in I/O.
+namespace GeometryCodec
+{
+struct Stats
+{
+    size_t rawSize = 0;
+    size_t encodedSize = 0;
+
+    double ratio() const { return encodedSize ? double(rawSize) / double(encodedSize) : 0.0; }
+};
+
+std::vector<uint8_t> encodeIndexBuffer(const uint32_t *pIndices, size_t indexCount, Stats *pStats = nullptr);
+
+// indexSize is 2 or 4, matching MTL::IndexTypeUInt16 / MTL::IndexTypeUInt32.
+bool decodeIndexBuffer(void *pDestination, size_t indexCount, size_t indexSize, const uint8_t *pData,
+                       size_t dataSize);
+
+std::vector<uint8_t> encodeVertexBuffer(const void *pVertices, size_t vertexCount, size_t vertexSize,
+                                        Stats *pStats = nullptr);
+
+bool decodeVertexBuffer(void *pDestination, size_t vertexCount, size_t vertexSize, const uint8_t *pData,
+                        size_t dataSize);
+} // namespace GeometryCodec
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <Metal/Metal.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "RangeAllocator.h"
+#include "StagingUploader.h"
+
+// Suballocates static meshes into one private buffer per vertex stream plus one index buffer, filled through a
+// StagingUploader. Meshes are drawn with a base vertex, so their indices stay mesh-relative and use 16-bit indices
+// whenever the mesh has few enough vertices. Removing meshes leaves holes that compact() squeezes out; running out of
+// space grows and compacts.
+class GeometryPool {
+  public:
+    using MeshId = uint32_t;
+    static constexpr MeshId InvalidMesh = UINT32_MAX;
+
+    struct Mesh {
+        size_t baseVertex = 0;
+        size_t vertexCount = 0;
+        size_t indexOffset = 0; // bytes
+        size_t indexCount = 0;
+        MTL::IndexType indexType = MTL::IndexType::IndexTypeUInt16;
+        bool live = false;
+    };
+
+    GeometryPool(MTL::Device *pDevice, StagingUploader *pUploader, std::vector<size_t> vertexStrides,
+                 size_t vertexCapacity, size_t indexCapacity);
+    ~GeometryPool();
+
+    // ppVertexStreams holds one pointer per stream, each to vertexCount tightly packed elements of that stride.
+    MeshId addMesh(const void *const *ppVertexStreams, size_t vertexCount, const uint32_t *pIndices,
+                   size_t indexCount);
+    // GeometryCodec-encoded streams and indices are decoded directly into staging.
+    MeshId addEncodedMesh(const uint8_t *const *ppVertexStreams, const size_t *pVertexStreamSizes,
+                          size_t vertexCount, const uint8_t *pIndices, size_t indexDataSize, size_t indexCount);
+    void removeMesh(MeshId mesh);
+
+    void compact();
+
+    void bind(MTL::RenderCommandEncoder *pEnc) const;
+    void draw(MTL::RenderCommandEncoder *pEnc, MeshId mesh, size_t instanceCount = 1, size_t baseInstance = 0) const;
+
+    const Mesh &mesh(MeshId mesh) const { return _meshes[mesh]; }
+    MTL::Buffer *vertexBuffer(size_t stream) const { return _vertexBuffers[stream]; }
+    MTL::Buffer *indexBuffer() const { return _pIndexBuffer; }
+
+    size_t vertexCapacity() const { return _vertexAllocator.capacity(); }
+    size_t indexCapacity() const { return _indexAllocator.capacity(); }
+    size_t usedVertices() const { return _vertexAllocator.usedSize(); }
+    size_t usedIndexBytes() const { return _indexAllocator.usedSize(); }
+
+  private:
+    MeshId allocateMesh(size_t vertexCount, size_t indexCount);
+    uint8_t *uploadIndices(const Mesh &m);
+    void rebuild(size_t vertexCapacity, size_t indexCapacity);
+
+    MTL::Device *_pDevice;
+    StagingUploader *_pUploader;
+    std::vector<size_t> _vertexStrides;
+    std::vector<MTL::Buffer *> _vertexBuffers;
+    MTL::Buffer *_pIndexBuffer = nullptr;
+    RangeAllocator _vertexAllocator;
+    RangeAllocator _indexAllocator;
+    std::vector<Mesh> _meshes;
+    std::vector<MeshId> _freeMeshIds;
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <Metal/Metal.hpp>
+#include <source_location>
+
+#include "MemoryTracker.h"
+
+// Accounts for the memory allocated through MTL::Device in a process-wide MemoryTracker. Each allocation site wraps
+// the object it creates in track(), which records its allocated size under a category and debug name along with the
+// callsite, and destroys it with release(), which also takes objects that were never tracked. Resources placed in a
+// heap are covered by the heap's record and are not tracked themselves.
+namespace GpuMemory
+{
+MemoryTracker &tracker();
+
+MTL::Buffer *track(MTL::Buffer *pBuffer, MemoryCategory category, const char *name,
+                   std::source_location location = std::source_location::current());
+MTL::Texture *track(MTL::Texture *pTexture, MemoryCategory category, const char *name,
+                    std::source_location location = std::source_location::current());
+MTL::IndirectCommandBuffer *track(MTL::IndirectCommandBuffer *pCommandBuffer, MemoryCategory category, const char *name,
+                                  std::source_location location = std::source_location::current());
+MTL::Heap *track(MTL::Heap *pHeap, MemoryCategory category, const char *name,
+                 std::source_location location = std::source_location::current());
+
+void release(NS::Object *pObject);
+} // namespace GpuMemory
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <Metal/Metal.hpp>
+#include <unordered_map>
+#include <vector>
+
+#include "TlsfAllocator.h"
+
+// Places buffers and textures in large placement heaps instead of giving each its own device allocation. Every heap
+// is managed by a TlsfAllocator; a new heap is created when none of the resource's storage mode has room, and a
+// resource larger than the heap size gets a heap of its own size. The heaps are hazard tracked like standalone
+// resources, so placed resources need no extra synchronization.
+class HeapAllocator {
+  public:
+    HeapAllocator(MTL::Device *pDevice, size_t heapSize);
+    ~HeapAllocator();
+
+    MTL::Buffer *newBuffer(size_t length, MTL::StorageMode storageMode);
+    // The texture is placed in a heap of pDesc's storage mode.
+    MTL::Texture *newTexture(const MTL::TextureDescriptor *pDesc);
+    // Releases a resource from newBuffer or newTexture and returns its range to the heap. The GPU must be done with it.
+    void free(MTL::Resource *pResource);
+    // Whether pResource was placed by newBuffer or newTexture and not freed yet.
+    bool placed(MTL::Resource *pResource) const { return _placements.count(pResource) != 0; }
+
+    // Summed over all heaps; largestFreeBlock is the largest in any one heap.
+    TlsfAllocator::Stats stats() const;
+    size_t heapCount() const { return _heaps.size(); }
+
+  private:
+    struct Heap {
+        MTL::Heap *pHeap;
+        MTL::StorageMode storageMode;
+        TlsfAllocator allocator;
+    };
+
+    struct Placement {
+        uint32_t heap;
+        TlsfAllocator::Allocation allocation;
+    };
+
+    Placement place(const MTL::SizeAndAlign &sizeAndAlign, MTL::StorageMode storageMode);
+
+    MTL::Device *_pDevice;
+    size_t _heapSize;
+    std::vector<Heap> _heaps;
+    std::unordered_map<MTL::Resource *, Placement> _placements;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Bounds.h"
+
+// Layout of MTL::DrawIndexedPrimitivesIndirectArguments.
+struct DrawIndexedArguments {
+    uint32_t indexCount;
+    uint32_t instanceCount;
+    uint32_t indexStart;
+    int32_t baseVertex;
+    uint32_t baseInstance;
+};
+
+// One drawable object as seen by the culling kernel; must match CullObject in shaders/culling.metal.
+struct CullObject {
+    Sphere bounds;
+    uint32_t indexCount;
+    uint32_t indexOffset; // bytes into the index buffer
+    int32_t baseVertex;
+    uint32_t indexType; // MTL::IndexType
+    uint32_t baseInstance;
+    uint32_t instanceCount; // objects with no instances left after CPU culling are skipped
+    uint32_t padding[2];
+};
+
+namespace IndirectCulling
+{
+// CPU reference of the cullAndEncode kernel: writes the draw arguments of every object intersecting the frustum to
+// pOut, compacted, and returns how many were written. pOut must have room for objectCount draws; the entries past
+// the returned count are scratch. The GPU compacts with an atomic counter, so it produces the same set of draws in
+// an unspecified order.
+size_t cullAndCompact(const Frustum &frustum, const CullObject *pObjects, size_t objectCount,
+                      DrawIndexedArguments *pOut);
+} // namespace IndirectCulling
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Metal/Metal.hpp>
+#include <vector>
+
+#include "IndirectCulling.h"
+
+// Culls objects on the GPU and encodes the surviving draws into an indirect command buffer, which the render pass
+// then runs with a single executeCommandsInBuffer. The draws inherit the pipeline state and vertex buffers bound on
+// the render encoder, so the pipeline must be created with supportIndirectCommandBuffers. Each frame in flight has
+// its own command buffer and execution range, so culling a frame, which may run on another queue, never rewrites
+// what an earlier frame's render pass is still executing.
+class IndirectDrawPass {
+  public:
+    IndirectDrawPass(MTL::Device *pDevice, MTL::Library *pLibrary, size_t maxObjects, size_t framesInFlight);
+    ~IndirectDrawPass();
+
+    // Object data is per frame in flight too, as instance counts change every frame.
+    void setObjects(const CullObject *pObjects, size_t objectCount, size_t frame);
+
+    void encodeCulling(MTL::CommandBuffer *pCmd, const Frustum &frustum, MTL::Buffer *pIndexBuffer, size_t frame);
+    void execute(MTL::RenderCommandEncoder *pEnc, MTL::Buffer *pIndexBuffer, size_t frame);
+
+  private:
+    struct Frame {
+        MTL::IndirectCommandBuffer *pCommandBuffer;
+        MTL::Buffer *pArgumentBuffer; // encodes pCommandBuffer for the culling kernel
+        MTL::Buffer *pObjectBuffer;
+        MTL::Buffer *pExecutionRangeBuffer;
+        uint32_t objectCount;
+    };
+
+    MTL::Device *_pDevice;
+    MTL::ComputePipelineState *_pCullPSO;
+    std::vector<Frame> _frames;
+    size_t _maxObjects;
+};
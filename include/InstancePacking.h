@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// Per-instance data read by vertexMain through [[instance_id]]; must match InstanceData in shaders/square.metal.
+struct InstanceData {
+    float rows[3][4]; // 4x3 object-to-world transform, stored as the first three rows of the 4x4 matrix
+    uint32_t materialIndex;
+    uint32_t color; // RGBA8, red in the lowest byte
+    uint32_t padding[2];
+};
+
+static_assert(sizeof(InstanceData) == 64, "InstanceData must match the shader layout");
+
+// Scene-side instance state, one array per component so that systems updating a single component stay dense.
+struct InstanceSoA {
+    std::vector<float> positionX, positionY, positionZ;
+    std::vector<float> rotationX, rotationY, rotationZ, rotationW;
+    std::vector<float> scaleX, scaleY, scaleZ;
+    std::vector<uint32_t> materialIndex;
+    std::vector<uint32_t> color;
+
+    size_t size() const { return positionX.size(); }
+    void resize(size_t count);
+    void set(size_t i, const float position[3], const float rotation[4], const float scale[3], uint32_t material,
+             uint32_t rgba);
+};
+
+namespace InstancePacking
+{
+// Converts instances [first, first + count) to GPU layout. pOut is typically mapped buffer memory, so each record
+// is written once, in order, with streaming stores where available. With pJobs, ranges of the output are packed in
+// parallel.
+void pack(const InstanceSoA &instances, size_t first, size_t count, InstanceData *pOut, JobSystem *pJobs = nullptr);
+// Packs only the listed instances, e.g. the survivors of frustum culling, in list order.
+void packIndexed(const InstanceSoA &instances, const uint32_t *pIndices, size_t count, InstanceData *pOut,
+                 JobSystem *pJobs = nullptr);
+} // namespace InstancePacking
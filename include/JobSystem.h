@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed pool of worker threads running data-parallel loops. parallelFor blocks until the loop is done, with the
+// calling thread taking chunks as well. It is not reentrant: a task must not call parallelFor itself.
+class JobSystem {
+  public:
+    using RangeFunction = std::function<void(size_t begin, size_t end)>;
+
+    explicit JobSystem(size_t threadCount = std::thread::hardware_concurrency());
+    ~JobSystem();
+
+    JobSystem(const JobSystem &) = delete;
+    JobSystem &operator=(const JobSystem &) = delete;
+
+    // Worker threads plus the calling thread.
+    size_t threadCount() const { return _workers.size() + 1; }
+
+    void parallelFor(size_t count, size_t grainSize, const RangeFunction &function);
+
+  private:
+    void workerLoop();
+    void runChunks();
+
+    std::vector<std::thread> _workers;
+    std::mutex _dispatchMutex;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+    const RangeFunction *_pFunction = nullptr;
+    size_t _count = 0;
+    size_t _grainSize = 1;
+    std::atomic<size_t> _next{0};
+    size_t _busyWorkers = 0;
+    uint64_t _generation = 0;
+    bool _quit = false;
+};
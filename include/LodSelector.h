@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "FrustumCulling.h"
+
+class JobSystem;
+
+// Picks a level of detail per object from the screen-space error of each LOD: the LOD's geometric error in world
+// units, projected at the distance of the object's bounding sphere. An object takes the coarsest LOD whose projected
+// error is within the threshold.
+//
+// Switching is damped with a dead band. An object refines as soon as its LOD's error exceeds the threshold, but only
+// coarsens once the coarser LOD's error falls below threshold * (1 - hysteresis), so objects near a transition do
+// not flip every frame.
+//
+// With a triangle budget, the threshold is raised within the frame until the selection fits: every LOD transition is
+// binned by the projected error at which it happens, weighted by the triangles it adds, and the smallest threshold
+// that stays within the budget is read off the cumulative histogram. The budget accounts for the dead band, so the
+// selection never exceeds it unless even the coarsest LODs do.
+class LodSelector {
+  public:
+    static constexpr uint32_t MaxLods = 8;
+    static constexpr uint32_t InvalidMesh = UINT32_MAX;
+
+    struct Lod {
+        float error; // world-space deviation from the full-detail mesh
+        uint32_t triangleCount;
+    };
+
+    struct Settings {
+        float errorThreshold = 1.0f; // pixels
+        float hysteresis = 0.25f;    // width of the dead band, as a fraction of the threshold
+        uint64_t triangleBudget = 0; // 0 for none
+        float nearDistance = 0.1f;   // objects closer than this, or around the camera, use this distance
+    };
+
+    struct View {
+        float position[3];
+        float projectionScale; // pixels per world unit at distance 1, see projectionScale()
+    };
+
+    static float projectionScale(float viewportHeight, float fovY);
+
+    explicit LodSelector(const Settings &settings);
+
+    // LODs are ordered finest first, with non-decreasing errors and at most MaxLods of them.
+    uint32_t addMesh(const Lod *pLods, uint32_t lodCount);
+    uint32_t lodCount(uint32_t mesh) const { return _meshes[mesh].lodCount; }
+
+    // pMeshes holds each object's mesh. pLods holds the LODs selected last frame and receives the new ones; values
+    // past a mesh's last LOD are clamped, so any initial value works. Returns the number of triangles selected.
+    uint64_t select(const View &view, const FrustumCulling::SphereSoA &bounds, const uint32_t *pMeshes, size_t count,
+                    uint8_t *pLods, JobSystem *pJobs = nullptr);
+
+    Settings &settings() { return _settings; }
+    const Settings &settings() const { return _settings; }
+    // Threshold the last select used, raised above the configured one when the budget required it.
+    float threshold() const { return _threshold; }
+
+  private:
+    struct Mesh {
+        uint32_t lodCount;
+        float error[MaxLods];
+        uint32_t triangleCount[MaxLods];
+    };
+
+    void computeScales(const View &view, const FrustumCulling::SphereSoA &bounds, size_t begin, size_t end);
+    void binTransitions(const uint32_t *pMeshes, size_t begin, size_t end, uint64_t *pHistogram, uint64_t &coarsest);
+    float budgetThreshold(size_t chunkCount) const;
+
+    Settings _settings;
+    float _threshold = 0.0f;
+    std::vector<Mesh> _meshes;
+
+    // Scratch: projected pixels per world unit of error for each object, and per-chunk transition histograms.
+    std::vector<float> _scales;
+    std::vector<uint64_t> _histograms;
+    std::vector<uint64_t> _coarsestTriangles;
+};
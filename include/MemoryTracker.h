@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <source_location>
+#include <unordered_map>
+
+enum class MemoryCategory : uint8_t {
+    Geometry,
+    Instances,
+    Lights,
+    Textures,
+    RenderTargets,
+    Heaps,
+    ArgumentBuffers,
+    Staging,
+    Other,
+    Count
+};
+
+const char *memoryCategoryName(MemoryCategory category);
+
+// Accounts for GPU memory allocations: each live allocation is recorded with its size, category, debug name and the
+// callsite that created it, and per-category totals keep their high-water marks and the change over the current
+// frame. Recording an allocation is a hash map insert and a few additions, and nothing is done per frame beyond
+// endFrame() rolling the deltas over, so it can stay on in release builds. An allocation is known only by its
+// address and the size the caller reports, so heaps, buffers and textures are tracked the same way.
+//
+// Names are not copied and must outlive the allocation, as string literals do. Not thread-safe; allocations are
+// tracked from the thread recording frames.
+class MemoryTracker {
+  public:
+    static constexpr size_t CategoryCount = size_t(MemoryCategory::Count);
+
+    struct Settings {
+        uint64_t budget = 0;          // bytes; 0 disables the warning
+        float warningFraction = 0.9f; // of the budget, at which endFrame() warns
+    };
+
+    struct CategoryStats {
+        uint64_t bytes;
+        uint64_t highWater;
+        int64_t frameDelta; // change in bytes over the last completed frame
+        uint32_t allocations;
+    };
+
+    struct Allocation {
+        uint64_t size;
+        MemoryCategory category;
+        const char *name;
+        const char *file;
+        uint32_t line;
+        uint64_t frame; // in which it was allocated
+    };
+
+    explicit MemoryTracker(const Settings &settings);
+
+    void setBudget(uint64_t budget) { _settings.budget = budget; }
+
+    void track(const void *pObject, uint64_t size, MemoryCategory category, const char *name,
+               std::source_location location = std::source_location::current());
+    // Ignores objects that were never tracked, so every release can go through it.
+    void untrack(const void *pObject);
+
+    // Ends the frame: the bytes allocated since the last call become the frame deltas. Returns true on the frame
+    // the total first reaches warningFraction of the budget; it warns again once the total has dropped below
+    // three quarters of that and risen back.
+    bool endFrame();
+
+    uint64_t frame() const { return _frame; }
+    const CategoryStats &category(MemoryCategory category) const { return _categories[size_t(category)]; }
+    uint64_t bytes() const { return _bytes; }
+    uint64_t highWater() const { return _highWater; }
+    int64_t frameDelta() const { return _frameDelta; }
+    uint64_t budget() const { return _settings.budget; }
+    size_t allocationCount() const { return _allocations.size(); }
+
+    // The totals, categories and every live allocation, largest first, as a JSON object.
+    void writeJson(std::ostream &out) const;
+
+  private:
+    Settings _settings;
+    uint64_t _frame = 0;
+    uint64_t _bytes = 0;
+    uint64_t _highWater = 0;
+    int64_t _frameDelta = 0;
+    bool _warned = false;
+    std::array<CategoryStats, CategoryCount> _categories = {};
+    std::array<uint64_t, CategoryCount> _frameStartBytes = {}; // per category, when the frame began
+    uint64_t _frameStartTotal = 0;
+    std::unordered_map<const void *, Allocation> _allocations;
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Bounds.h"
+#include "FrustumCulling.h"
+
+// CPU occlusion culling against a small software depth buffer. Occluder triangles are rasterized eight pixels at a
+// time into 8x4 pixel tiles; instead of interpolating depth per pixel, every covered pixel of a tile receives the
+// triangle's farthest depth over that tile, so the buffer never claims more occlusion than the real geometry gives.
+// Each tile also keeps its farthest depth, which resolves most occludee tests without looking at single pixels.
+// Coverage is sampled at pixel centers, as a GPU depth test would at this resolution, so a box seen only through a
+// gap between occluders narrower than a pixel may be culled.
+//
+// Depth is Metal's clip z / w in [0, 1], nearer being smaller. Matrices are column-major clip-from-object.
+class OcclusionCuller {
+  public:
+    static constexpr uint32_t TileWidth = 8;
+    static constexpr uint32_t TileHeight = 4;
+
+    // A quarter of the output resolution per axis is usually plenty; 480x270 for a 1080p view.
+    OcclusionCuller(uint32_t width, uint32_t height);
+
+    void clear();
+
+    // Rasterizes a triangle list whose positions are three floats, positionStride bytes apart. Triangles crossing
+    // the near plane are skipped, which only makes the culling less aggressive. Both windings are drawn.
+    void renderOccluder(const float *pPositions, size_t positionStride, const uint32_t *pIndices, size_t indexCount,
+                        const float *clipFromObject);
+
+    // False only if the box is off screen or every pixel it covers holds a nearer occluder.
+    bool isVisible(const AABB &bounds, const float *clipFromWorld) const;
+
+    // Keeps the candidates (indices into boxes, e.g. the output of FrustumCulling) that are not occluded, in order.
+    // pVisible may alias pCandidates.
+    size_t cullAABBs(const FrustumCulling::AABBSoA &boxes, const uint32_t *pCandidates, size_t count,
+                     const float *clipFromWorld, uint32_t *pVisible) const;
+
+    uint32_t width() const { return _width; }
+    uint32_t height() const { return _height; }
+
+  private:
+    void rasterizeTriangle(const float *v0, const float *v1, const float *v2);
+
+    uint32_t _width, _height;
+    uint32_t _tilesX, _tilesY;
+    std::vector<float> _depth;        // per tile, TileHeight rows of TileWidth pixels
+    std::vector<float> _tileMaxDepth; // farthest depth in each tile
+};
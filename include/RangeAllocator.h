@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+
+// First-fit allocator over a linear range with coalescing of freed blocks. It only does the bookkeeping, so it is
+// used to place suballocations inside GPU buffers.
+class RangeAllocator {
+  public:
+    static constexpr size_t InvalidOffset = SIZE_MAX;
+
+    explicit RangeAllocator(size_t capacity = 0);
+
+    void reset(size_t capacity);
+    void grow(size_t capacity);
+
+    size_t allocate(size_t size, size_t alignment = 1);
+    void free(size_t offset, size_t size);
+
+    size_t capacity() const { return _capacity; }
+    size_t usedSize() const { return _usedSize; }
+    size_t largestFreeBlock() const;
+
+  private:
+    std::map<size_t, size_t> _freeBlocks; // offset -> size
+    size_t _capacity = 0;
+    size_t _usedSize = 0;
+};
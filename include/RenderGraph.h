@@ -0,0 +1,175 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Frame graph: passes declare the resources they read and write, and compile() culls the passes whose results are
+// never used, orders the rest by their dependencies, finds the lifetime of every transient texture and places
+// transients whose lifetimes do not overlap at overlapping offsets of one heap. The graph holds descriptions, never
+// Metal objects; TransientHeap creates the heap and the aliased textures at the offsets it assigns.
+//
+// Resource handles are versioned. Writing a handle returns the handle of the resource's next version, and a pass
+// reading a handle runs after the pass that wrote that version and before the one that writes the next. A write
+// replaces the contents, so a pass that also needs them reads the handle first. Passes writing imported resources,
+// which live outside the graph, are the roots everything else is kept alive for.
+//
+// Render passes name the textures they render into with writeAttachment(), and those they read in tile memory, with
+// programmable blending, with readAttachment(). compile() merges consecutive render passes with compatible
+// attachments into one Metal render pass, so what one renders stays in tile memory for the next, and gives every
+// attachment the cheapest load and store actions: contents are loaded only when the pass reads them, stored only when
+// a pass outside the render pass reads them later, and a transient never loaded or stored is memoryless and takes no
+// heap memory at all.
+class RenderGraph {
+  public:
+    using PassId = uint32_t;
+    using ResourceId = uint32_t; // a version of a resource
+    static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+    enum class PassType : uint8_t { Render, Compute, Blit };
+
+    // Values match MTL::LoadAction and MTL::StoreAction.
+    enum class LoadAction : uint8_t { DontCare, Load, Clear };
+    enum class StoreAction : uint8_t { DontCare, Store };
+
+    // Passes merge into one render pass of at most MaxColorAttachments color attachments and one depth/stencil one.
+    static constexpr uint32_t MaxColorAttachments = 8;
+
+    // The MTL::TextureDescriptor fields a transient is created from, as their Metal enum values. size and alignment
+    // are what the device needs to place it in a heap (MTL::Device::heapTextureSizeAndAlign).
+    struct TextureDesc {
+        uint32_t width = 1, height = 1;
+        uint32_t pixelFormat = 0; // MTL::PixelFormat
+        uint32_t usage = 0;       // MTL::TextureUsage
+        uint32_t sampleCount = 1;
+        uint64_t size = 0;
+        uint64_t alignment = 1;
+    };
+
+    struct Resource {
+        std::string name;
+        TextureDesc desc;
+        bool imported = false;
+        uint32_t versionCount = 0;
+        // Set by compile(): positions in order() of the first and last pass using the resource, and where it is
+        // placed in the heap. Unused transients get no placement.
+        uint32_t firstUse = InvalidIndex, lastUse = InvalidIndex;
+        uint64_t heapOffset = 0;
+        bool memoryless = false; // only ever in tile memory, so not placed
+    };
+
+    struct AttachmentUse {
+        ResourceId version; // written, or read with write unset
+        bool write;
+        bool clear;
+    };
+
+    struct Pass {
+        std::string name;
+        PassType type = PassType::Render;
+        std::function<void()> execute;
+        std::vector<ResourceId> reads;
+        std::vector<ResourceId> writes; // the versions the pass produces
+        std::vector<AttachmentUse> attachments;
+        bool culled = false;
+        uint32_t renderPass = InvalidIndex; // set by compile() for render passes
+    };
+
+    // The attachments of a merged render pass, with the actions of its first load and its last store.
+    struct Attachment {
+        uint32_t resource;
+        LoadAction load;
+        StoreAction store;
+    };
+
+    struct RenderPass {
+        std::vector<PassId> passes; // in execution order
+        std::vector<Attachment> attachments;
+    };
+
+    // Attachment bytes moved between tile and device memory per frame: with every render pass on its own, loading
+    // what it does not clear and storing everything, and as compiled. Memoryless bytes are the heap space saved.
+    struct AttachmentTraffic {
+        uint64_t unmergedBytes = 0;
+        uint64_t plannedBytes = 0;
+        uint64_t memorylessBytes = 0;
+    };
+
+    // Clears the passes and resources, keeping their storage for the next frame.
+    void reset();
+
+    ResourceId createTexture(const char *name, const TextureDesc &desc);
+    ResourceId importResource(const char *name);
+    // The description of an imported texture is only used to match attachment sizes and count their traffic; one
+    // imported without it is never merged with other attachments.
+    ResourceId importResource(const char *name, const TextureDesc &desc);
+
+    PassId addPass(const char *name, PassType type, std::function<void()> execute);
+    void read(PassId pass, ResourceId resource);
+    // resource must be the latest version; returns the version the pass produces.
+    ResourceId write(PassId pass, ResourceId resource);
+    // A write the render pass renders. The pass loads the previous contents only if it read them, as with write(),
+    // and clears the attachment first if clear is set.
+    ResourceId writeAttachment(PassId pass, ResourceId resource, bool clear = false);
+    // A read of an attachment's contents at the pixel being shaded, which lets the writer merge with the pass.
+    void readAttachment(PassId pass, ResourceId resource);
+
+    void compile();
+    // Runs the execute functions of the passes left after culling, in order.
+    void execute() const;
+    // Same, calling begin before the first pass of each merged render pass and end after its last, so the passes
+    // can share the encoder begin creates.
+    void execute(const std::function<void(uint32_t renderPass)> &begin,
+                 const std::function<void(uint32_t renderPass)> &end) const;
+
+    // Surviving passes in execution order.
+    const std::vector<PassId> &order() const { return _order; }
+    const Pass &pass(PassId pass) const { return _passes[pass]; }
+    // Set by compile(): the passes that must run before this one, culled ones included.
+    const std::vector<PassId> &dependencies(PassId pass) const { return _dependencies[pass]; }
+    size_t passCount() const { return _passes.size(); }
+
+    uint32_t resourceIndex(ResourceId resource) const { return _versions[resource].resource; }
+    const Resource &resource(ResourceId resource) const { return _resources[_versions[resource].resource]; }
+    const std::vector<Resource> &resources() const { return _resources; }
+
+    const std::vector<RenderPass> &renderPasses() const { return _renderPasses; }
+    const AttachmentTraffic &attachmentTraffic() const { return _attachmentTraffic; }
+
+    // Heap bytes the placed transients need, and what they would take without aliasing.
+    uint64_t heapSize() const { return _heapSize; }
+    uint64_t transientSize() const { return _transientSize; }
+
+  private:
+    struct Version {
+        uint32_t resource;
+        PassId writer;       // InvalidIndex for the initial version
+        ResourceId replaced; // the version the write replaced
+        std::vector<PassId> readers;
+    };
+
+    void cullPasses();
+    void sortPasses();
+    void findLifetimes();
+    void mergeRenderPasses();
+    // Whether the pass reads the version as an attachment, in tile memory.
+    bool inTile(const Pass &pass, ResourceId version) const;
+    bool canMerge(const RenderPass &renderPass, const Pass &pass) const;
+    void chooseAttachmentActions();
+    void placeTransients();
+
+    std::vector<Pass> _passes;
+    std::vector<Resource> _resources;
+    std::vector<Version> _versions;
+    std::vector<uint32_t> _latestVersion; // per resource
+
+    // compile() scratch and results.
+    std::vector<std::vector<PassId>> _dependencies; // per pass: passes that must run before it
+    std::vector<PassId> _order;
+    std::vector<RenderPass> _renderPasses;
+    AttachmentTraffic _attachmentTraffic;
+    uint64_t _heapSize = 0;
+    uint64_t _transientSize = 0;
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <Metal/Metal.hpp>
+#include <vector>
+
+#include "TexturePool.h"
+
+// Render targets for passes that need them for part of a frame: acquire one, encode with it, release it in the same
+// frame, and a later frame gets the same texture back once the GPU is done with it. Textures nobody asks for again
+// are released after maxIdleFrames.
+class RenderTargetPool {
+  public:
+    RenderTargetPool(MTL::Device *pDevice, const TexturePool::Settings &settings);
+    ~RenderTargetPool();
+
+    // Call once per frame, before acquiring.
+    void beginFrame();
+
+    MTL::Texture *acquire(MTL::PixelFormat pixelFormat, uint32_t width, uint32_t height, MTL::TextureUsage usage,
+                          MTL::StorageMode storageMode = MTL::StorageModePrivate, uint32_t sampleCount = 1);
+    void release(MTL::Texture *pTexture);
+
+    const TexturePool::Stats &stats() const { return _pool.stats(); }
+
+  private:
+    void releaseTextures();
+
+    MTL::Device *_pDevice;
+    TexturePool _pool;
+    uint64_t _frame = 0;
+    std::vector<void *> _removed;
+};
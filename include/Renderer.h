@@ -1,32 +1,117 @@
-#include <simd/simd.h>
-
 #include <AppKit/AppKit.hpp>
 #include <Foundation/Foundation.hpp>
 #include <Metal/Metal.hpp>
 #include <MetalKit/MetalKit.hpp>
 #include <QuartzCore/QuartzCore.hpp>
+#include <atomic>
 #include <cassert>
 #include <fstream>
 #include <iostream>
+#include <semaphore>
 #include <sstream>
 
+#include "AsyncComputeScheduler.h"
+#include "BindlessTable.h"
+#include "CascadedShadows.h"
+#include "ClusteredLighting.h"
+#include "EntityWorld.h"
+#include "FrustumCulling.h"
+#include "GeometryPool.h"
+#include "HeapAllocator.h"
+#include "IndirectDrawPass.h"
+#include "InstancePacking.h"
+#include "JobSystem.h"
+#include "RenderGraph.h"
+#include "RetirementQueue.h"
+#include "SceneComponents.h"
+#include "SimdMath.h"
+#include "StagingUploader.h"
+#include "SyncEncoder.h"
+#include "SyncPlanner.h"
+#include "TerrainRenderer.h"
+#include "TransientHeap.h"
+
 class Renderer {
   public:
+    static constexpr int MaxFramesInFlight = 3;
+
     Renderer(MTL::Device *pDevice);
     ~Renderer();
 
     void buildShaders();
     void buildTextures();
     void buildBuffers();
+    void buildTerrain();
+    void buildIndirectDraws();
+    void updateInstances(const Frustum &frustum);
+    void updateLights(const float *viewMatrix, MTK::View *pView);
+    void updateShadows(const float *viewMatrix, MTK::View *pView);
+    void encodeShadows(MTL::CommandBuffer *pCmd, MTL::RenderPassDescriptor *pRpd);
+    void encodeScene(MTL::CommandBuffer *pCmd, MTK::View *pView, MTL::Texture *pShadowAtlas);
     void draw(MTK::View *pView);
 
+    // Releases the object once the GPU is done with the frame being recorded, and every frame before it.
+    void retire(NS::Object *pObject) { _retirement.retire(pObject); }
+
+    // Casters drawn into each cascade of the shadow atlas last frame.
+    size_t shadowDrawCount(uint32_t cascade) const { return _shadowDrawCounts[cascade]; }
+
   private:
+    // Instances [first, first + count) of a frame buffer, all drawn with the same mesh.
+    struct MeshRun {
+        GeometryPool::MeshId mesh;
+        size_t first, count;
+    };
+
+    void releaseRetired();
+    MTL::Buffer *frameBuffer(MTL::Buffer *&pBuffer, size_t size);
+    const uint32_t *groupByMesh(const uint32_t *pIndices, size_t count, std::vector<MeshRun> &runs);
+
     MTL::Device *_pDevice;
     MTL::CommandQueue *_pCommandQueue;
+    MTL::CommandQueue *_pComputeQueue; // for compute passes the scheduler moves off the graphics queue
     MTL::Library *_pShaderLibrary;
+    MTL::Library *_pCullingLibrary;
     MTL::RenderPipelineState *_pPSO; // PSO -> PipelineStateObject
-    MTL::Texture *_pTexture;
-    MTL::Buffer *_pVertexPositionsBuffer;
-    MTL::Buffer *_pVertexTextureCoordinatesBuffer;
-    MTL::Buffer *_pVertexIndicesBuffer;
+    MTL::RenderPipelineState *_pShadowPSO;
+    MTL::DepthStencilState *_pShadowDepthState;
+    MTL::DepthStencilState *_pSceneDepthState; // the quad is in clip space, so it draws over the terrain
+    BindlessTable *_pBindlessTable;
+    MTL::Buffer *_pMaterialBuffer; // MaterialData, indexed by RenderableComponent::material
+    StagingUploader *_pUploader; // fills the geometry pool's private buffers
+    GeometryPool *_pGeometryPool;
+    TerrainRenderer *_pTerrain;
+    MTL::Texture *_pTerrainTexture;
+    IndirectDrawPass *_pIndirectDrawPass;
+    std::vector<MeshRun> _meshRuns;      // of this frame's instance buffer
+    std::vector<CullObject> _cullObjects; // one per run, given to the GPU culling pass this frame
+    EntityWorld _world;
+    InstanceSoA _instances; // gathered from _world each frame
+    std::vector<float> _instanceRadius;
+    std::vector<GeometryPool::MeshId> _instanceMesh;
+    std::vector<uint32_t> _visibleInstances;
+    std::vector<uint32_t> _meshStarts;       // groupByMesh scratch, per mesh id
+    std::vector<uint32_t> _groupedInstances; // groupByMesh output when there is more than one mesh
+    JobSystem _jobs;
+    HeapAllocator *_pFrameHeaps; // places the per-frame instance, light and shadow instance buffers
+    MTL::Buffer *_pInstanceBuffers[MaxFramesInFlight] = {};
+    LightClusters _lightClusters{LightClusters::Settings{}};
+    std::vector<LightComponent> _lights; // gathered from _world each frame
+    MTL::Buffer *_pLightBuffers[MaxFramesInFlight] = {};
+    CascadedShadows _shadows{CascadedShadows::Settings{}};
+    std::vector<uint32_t> _shadowCasters[CascadedShadows::MaxCascades];
+    size_t _shadowDrawCounts[CascadedShadows::MaxCascades] = {};
+    std::vector<MeshRun> _shadowRuns[CascadedShadows::MaxCascades]; // of this frame's shadow instance buffer
+    MTL::Buffer *_pShadowInstanceBuffers[MaxFramesInFlight] = {};
+    RenderGraph _graph; // rebuilt every frame
+    TransientHeap *_pTransientHeap;
+    AsyncComputeScheduler _scheduler{AsyncComputeScheduler::Settings{}};
+    std::vector<float> _passCosts; // per graph pass, estimated
+    SyncPlanner _syncPlanner;
+    SyncEncoder *_pSyncEncoder;
+    std::atomic<int> _pendingCommandBuffers[MaxFramesInFlight] = {}; // per frame in flight
+    size_t _frame = 0;
+    RetirementQueue _retirement;
+    std::vector<void *> _released;
+    std::counting_semaphore<MaxFramesInFlight> _frameSemaphore{MaxFramesInFlight};
 };
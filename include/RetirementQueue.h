@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Defers destroying resources the GPU may still be using. Objects retired while a frame is being recorded are
+// batched with that frame, and handed back for destruction once the frame and every frame before it have completed,
+// which their command buffers' completion handlers report with complete(). Retiring is a push onto the frame's
+// batch, and batches keep their storage from frame to frame. The queue never releases anything itself; the caller
+// destroys what complete() hands back however each object needs.
+//
+// Everything but complete() is called from the thread recording frames; complete() may be called from any thread.
+class RetirementQueue {
+  public:
+    struct Stats {
+        uint32_t pendingFrames;
+        uint64_t pendingObjects;
+        uint64_t releasedObjects;
+    };
+
+    RetirementQueue();
+
+    RetirementQueue(const RetirementQueue &) = delete;
+    RetirementQueue &operator=(const RetirementQueue &) = delete;
+
+    // The serial of the frame being recorded, from 1.
+    uint64_t frame() const { return _frame; }
+
+    // The object is no longer used by frames recorded after this one.
+    void retire(void *pObject) { _batches[_current].objects.push_back(pObject); }
+
+    // Ends the frame being recorded and returns its serial, for its command buffer to pass to complete().
+    uint64_t endFrame();
+
+    // Every frame must be reported, but in any order: a frame spread over several queues can finish, or have its
+    // handler run, before an earlier one.
+    void complete(uint64_t frame);
+
+    // Appends the objects of every completed frame to released, for the caller to destroy.
+    void collect(std::vector<void *> &released);
+
+    Stats stats() const;
+
+  private:
+    struct Batch {
+        uint64_t frame;
+        std::vector<void *> objects;
+    };
+
+    uint64_t _frame = 1;
+    std::atomic<uint64_t> _completedFrame{0}; // every frame up to it has completed
+    std::mutex _completionMutex;
+    std::vector<uint64_t> _earlyCompletions; // frames completed after _completedFrame + 1, under the mutex
+    // A ring of batches: [_oldest, _current] are in use, the current one last.
+    std::vector<Batch> _batches;
+    size_t _oldest = 0;
+    size_t _current = 0;
+    uint64_t _releasedObjects = 0;
+};
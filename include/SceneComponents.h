@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+// Components of the renderer's EntityWorld.
+
+struct TransformComponent {
+    float position[3];
+    float rotation[4]; // quaternion xyzw
+    float scale[3];
+};
+
+struct RenderableComponent {
+    uint32_t mesh; // GeometryPool::MeshId
+    uint32_t material;
+    uint32_t color;     // RGBA8
+    float boundsRadius; // in world units, scale included
+};
+
+struct LightComponent {
+    float position[3];
+    float radius;
+    float color[3];
+    float intensity;
+};
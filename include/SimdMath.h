@@ -0,0 +1,728 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__AVX__) || defined(__F16C__)
+#include <immintrin.h>
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Vector, quaternion and matrix types with the size and alignment of their Metal shader counterparts, so they can be
+// copied straight into buffers the shaders read. float3 is padded to 16 bytes like Metal's; its fourth lane is
+// unspecified. Use the packed types for tightly packed vertex data.
+//
+// Four-wide operations run on SSE2 (with SSE4.1 dot products), NEON or a scalar fallback; matrix products use AVX,
+// with FMA when available, two columns at a time. Conversions to and from half use F16C or NEON when available.
+namespace SimdMath
+{
+namespace detail
+{
+// Four float lanes, in the style of Float8. Loads and stores are aligned.
+#if defined(__SSE2__)
+struct Lane4 {
+    __m128 v;
+
+    static Lane4 load(const float *p) { return {_mm_load_ps(p)}; }
+    static Lane4 set(float f) { return {_mm_set1_ps(f)}; }
+    void store(float *p) const { _mm_store_ps(p, v); }
+    Lane4 operator+(Lane4 o) const { return {_mm_add_ps(v, o.v)}; }
+    Lane4 operator-(Lane4 o) const { return {_mm_sub_ps(v, o.v)}; }
+    Lane4 operator*(Lane4 o) const { return {_mm_mul_ps(v, o.v)}; }
+    Lane4 operator/(Lane4 o) const { return {_mm_div_ps(v, o.v)}; }
+    Lane4 operator-() const { return {_mm_xor_ps(v, _mm_set1_ps(-0.0f))}; }
+    static Lane4 min(Lane4 a, Lane4 b) { return {_mm_min_ps(a.v, b.v)}; }
+    static Lane4 max(Lane4 a, Lane4 b) { return {_mm_max_ps(a.v, b.v)}; }
+    Lane4 sqrt() const { return {_mm_sqrt_ps(v)}; }
+    Lane4 abs() const { return {_mm_andnot_ps(_mm_set1_ps(-0.0f), v)}; }
+    // Dot products broadcast to every lane; dot3 ignores the fourth lane.
+#if defined(__SSE4_1__)
+    static Lane4 dot4(Lane4 a, Lane4 b) { return {_mm_dp_ps(a.v, b.v, 0xff)}; }
+    static Lane4 dot3(Lane4 a, Lane4 b) { return {_mm_dp_ps(a.v, b.v, 0x7f)}; }
+#else
+    static Lane4 dot4(Lane4 a, Lane4 b)
+    {
+        __m128 m = _mm_mul_ps(a.v, b.v);
+        m = _mm_add_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+        return {_mm_add_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)))};
+    }
+    static Lane4 dot3(Lane4 a, Lane4 b)
+    {
+        const __m128 xyz = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+        return dot4({_mm_and_ps(a.v, xyz)}, b);
+    }
+#endif
+    template <int I> Lane4 splat() const { return {_mm_shuffle_ps(v, v, _MM_SHUFFLE(I, I, I, I))}; }
+    Lane4 yzxw() const { return {_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 0, 2, 1))}; }
+    Lane4 zxyw() const { return {_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 1, 0, 2))}; }
+};
+#elif defined(__ARM_NEON)
+struct Lane4 {
+    float32x4_t v;
+
+    static Lane4 load(const float *p) { return {vld1q_f32(p)}; }
+    static Lane4 set(float f) { return {vdupq_n_f32(f)}; }
+    void store(float *p) const { vst1q_f32(p, v); }
+    Lane4 operator+(Lane4 o) const { return {vaddq_f32(v, o.v)}; }
+    Lane4 operator-(Lane4 o) const { return {vsubq_f32(v, o.v)}; }
+    Lane4 operator*(Lane4 o) const { return {vmulq_f32(v, o.v)}; }
+    Lane4 operator/(Lane4 o) const { return {vdivq_f32(v, o.v)}; }
+    Lane4 operator-() const { return {vnegq_f32(v)}; }
+    static Lane4 min(Lane4 a, Lane4 b) { return {vminq_f32(a.v, b.v)}; }
+    static Lane4 max(Lane4 a, Lane4 b) { return {vmaxq_f32(a.v, b.v)}; }
+    Lane4 sqrt() const { return {vsqrtq_f32(v)}; }
+    Lane4 abs() const { return {vabsq_f32(v)}; }
+    static Lane4 dot4(Lane4 a, Lane4 b) { return {vdupq_n_f32(vaddvq_f32(vmulq_f32(a.v, b.v)))}; }
+    static Lane4 dot3(Lane4 a, Lane4 b)
+    {
+        return {vdupq_n_f32(vaddvq_f32(vsetq_lane_f32(0.0f, vmulq_f32(a.v, b.v), 3)))};
+    }
+    template <int I> Lane4 splat() const { return {vdupq_laneq_f32(v, I)}; }
+    Lane4 yzxw() const
+    {
+        static const uint8_t Indices[16] = {4, 5, 6, 7, 8, 9, 10, 11, 0, 1, 2, 3, 12, 13, 14, 15};
+        return {vreinterpretq_f32_u8(vqtbl1q_u8(vreinterpretq_u8_f32(v), vld1q_u8(Indices)))};
+    }
+    Lane4 zxyw() const
+    {
+        static const uint8_t Indices[16] = {8, 9, 10, 11, 0, 1, 2, 3, 4, 5, 6, 7, 12, 13, 14, 15};
+        return {vreinterpretq_f32_u8(vqtbl1q_u8(vreinterpretq_u8_f32(v), vld1q_u8(Indices)))};
+    }
+};
+#else
+struct Lane4 {
+    float v[4];
+
+    static Lane4 load(const float *p)
+    {
+        Lane4 r;
+        memcpy(r.v, p, sizeof(r.v));
+        return r;
+    }
+    static Lane4 set(float f) { return {{f, f, f, f}}; }
+    void store(float *p) const { memcpy(p, v, sizeof(v)); }
+    template <typename Op> Lane4 apply(Lane4 o, Op op) const
+    {
+        return {{op(v[0], o.v[0]), op(v[1], o.v[1]), op(v[2], o.v[2]), op(v[3], o.v[3])}};
+    }
+    Lane4 operator+(Lane4 o) const { return apply(o, [](float a, float b) { return a + b; }); }
+    Lane4 operator-(Lane4 o) const { return apply(o, [](float a, float b) { return a - b; }); }
+    Lane4 operator*(Lane4 o) const { return apply(o, [](float a, float b) { return a * b; }); }
+    Lane4 operator/(Lane4 o) const { return apply(o, [](float a, float b) { return a / b; }); }
+    Lane4 operator-() const { return {{-v[0], -v[1], -v[2], -v[3]}}; }
+    static Lane4 min(Lane4 a, Lane4 b) { return a.apply(b, [](float x, float y) { return y < x ? y : x; }); }
+    static Lane4 max(Lane4 a, Lane4 b) { return a.apply(b, [](float x, float y) { return x < y ? y : x; }); }
+    Lane4 sqrt() const { return {{std::sqrt(v[0]), std::sqrt(v[1]), std::sqrt(v[2]), std::sqrt(v[3])}}; }
+    Lane4 abs() const { return {{std::fabs(v[0]), std::fabs(v[1]), std::fabs(v[2]), std::fabs(v[3])}}; }
+    static Lane4 dot4(Lane4 a, Lane4 b)
+    {
+        return set(a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2] + a.v[3] * b.v[3]);
+    }
+    static Lane4 dot3(Lane4 a, Lane4 b) { return set(a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2]); }
+    template <int I> Lane4 splat() const { return set(v[I]); }
+    Lane4 yzxw() const { return {{v[1], v[2], v[0], v[3]}}; }
+    Lane4 zxyw() const { return {{v[2], v[0], v[1], v[3]}}; }
+};
+#endif
+} // namespace detail
+
+struct alignas(8) float2 {
+    float x, y;
+};
+
+struct alignas(16) float3 {
+    float x, y, z;
+};
+
+struct alignas(16) float4 {
+    float x, y, z, w;
+};
+
+// Vector part in xyz, scalar part in w, like simd_quatf.
+struct alignas(16) quatf {
+    float x, y, z, w;
+
+    static quatf identity() { return {0.0f, 0.0f, 0.0f, 1.0f}; }
+    // axis must be normalized; angle in radians.
+    static quatf fromAxisAngle(const float3 &axis, float angle)
+    {
+        const float s = std::sin(0.5f * angle);
+        return {axis.x * s, axis.y * s, axis.z * s, std::cos(0.5f * angle)};
+    }
+};
+
+struct packed_float2 {
+    float x, y;
+};
+
+struct packed_float3 {
+    float x, y, z;
+};
+
+struct packed_float4 {
+    float x, y, z, w;
+};
+
+// IEEE binary16, stored as its bits.
+struct half {
+    uint16_t bits;
+};
+
+struct alignas(4) half2 {
+    half x, y;
+};
+
+struct alignas(8) half3 {
+    half x, y, z;
+};
+
+struct alignas(8) half4 {
+    half x, y, z, w;
+};
+
+struct packed_half3 {
+    half x, y, z;
+};
+
+namespace detail
+{
+template <typename V> inline constexpr bool IsLaneVector = std::is_same_v<V, float3> || std::is_same_v<V, float4>;
+
+template <typename V> Lane4 load(const V &v)
+{
+    return Lane4::load(&v.x);
+}
+
+template <typename V> V store(Lane4 lanes)
+{
+    V v;
+    lanes.store(&v.x);
+    return v;
+}
+} // namespace detail
+
+template <typename V>
+concept LaneVector = detail::IsLaneVector<V>;
+
+// float3 and float4 arithmetic, component-wise.
+template <LaneVector V> V operator+(const V &a, const V &b)
+{
+    return detail::store<V>(detail::load(a) + detail::load(b));
+}
+template <LaneVector V> V operator-(const V &a, const V &b)
+{
+    return detail::store<V>(detail::load(a) - detail::load(b));
+}
+template <LaneVector V> V operator*(const V &a, const V &b)
+{
+    return detail::store<V>(detail::load(a) * detail::load(b));
+}
+template <LaneVector V> V operator/(const V &a, const V &b)
+{
+    return detail::store<V>(detail::load(a) / detail::load(b));
+}
+template <LaneVector V> V operator*(const V &a, float s)
+{
+    return detail::store<V>(detail::load(a) * detail::Lane4::set(s));
+}
+template <LaneVector V> V operator*(float s, const V &a)
+{
+    return a * s;
+}
+template <LaneVector V> V operator/(const V &a, float s)
+{
+    return detail::store<V>(detail::load(a) / detail::Lane4::set(s));
+}
+template <LaneVector V> V operator-(const V &a)
+{
+    return detail::store<V>(-detail::load(a));
+}
+template <LaneVector V> V &operator+=(V &a, const V &b)
+{
+    return a = a + b;
+}
+template <LaneVector V> V &operator-=(V &a, const V &b)
+{
+    return a = a - b;
+}
+template <LaneVector V> V &operator*=(V &a, float s)
+{
+    return a = a * s;
+}
+
+template <LaneVector V> V min(const V &a, const V &b)
+{
+    return detail::store<V>(detail::Lane4::min(detail::load(a), detail::load(b)));
+}
+template <LaneVector V> V max(const V &a, const V &b)
+{
+    return detail::store<V>(detail::Lane4::max(detail::load(a), detail::load(b)));
+}
+template <LaneVector V> V abs(const V &a)
+{
+    return detail::store<V>(detail::load(a).abs());
+}
+template <LaneVector V> V clamp(const V &a, const V &low, const V &high)
+{
+    return min(max(a, low), high);
+}
+template <LaneVector V> V lerp(const V &a, const V &b, float t)
+{
+    const detail::Lane4 la = detail::load(a);
+    return detail::store<V>(la + (detail::load(b) - la) * detail::Lane4::set(t));
+}
+
+inline float dot(const float3 &a, const float3 &b)
+{
+    float result[4];
+    detail::Lane4::dot3(detail::load(a), detail::load(b)).store(result);
+    return result[0];
+}
+inline float dot(const float4 &a, const float4 &b)
+{
+    float result[4];
+    detail::Lane4::dot4(detail::load(a), detail::load(b)).store(result);
+    return result[0];
+}
+template <LaneVector V> float lengthSquared(const V &a)
+{
+    return dot(a, a);
+}
+template <LaneVector V> float length(const V &a)
+{
+    return std::sqrt(dot(a, a));
+}
+template <LaneVector V> float distance(const V &a, const V &b)
+{
+    return length(a - b);
+}
+// Zero-length vectors produce NaNs.
+inline float3 normalize(const float3 &a)
+{
+    const detail::Lane4 v = detail::load(a);
+    return detail::store<float3>(v / detail::Lane4::dot3(v, v).sqrt());
+}
+inline float4 normalize(const float4 &a)
+{
+    const detail::Lane4 v = detail::load(a);
+    return detail::store<float4>(v / detail::Lane4::dot4(v, v).sqrt());
+}
+inline float3 cross(const float3 &a, const float3 &b)
+{
+    const detail::Lane4 la = detail::load(a), lb = detail::load(b);
+    return detail::store<float3>((la * lb.yzxw() - la.yzxw() * lb).yzxw());
+}
+
+// float2 is too narrow to gain from SIMD registers.
+inline float2 operator+(const float2 &a, const float2 &b)
+{
+    return {a.x + b.x, a.y + b.y};
+}
+inline float2 operator-(const float2 &a, const float2 &b)
+{
+    return {a.x - b.x, a.y - b.y};
+}
+inline float2 operator*(const float2 &a, const float2 &b)
+{
+    return {a.x * b.x, a.y * b.y};
+}
+inline float2 operator/(const float2 &a, const float2 &b)
+{
+    return {a.x / b.x, a.y / b.y};
+}
+inline float2 operator*(const float2 &a, float s)
+{
+    return {a.x * s, a.y * s};
+}
+inline float2 operator*(float s, const float2 &a)
+{
+    return a * s;
+}
+inline float2 operator/(const float2 &a, float s)
+{
+    return {a.x / s, a.y / s};
+}
+inline float2 operator-(const float2 &a)
+{
+    return {-a.x, -a.y};
+}
+inline float2 min(const float2 &a, const float2 &b)
+{
+    return {std::fmin(a.x, b.x), std::fmin(a.y, b.y)};
+}
+inline float2 max(const float2 &a, const float2 &b)
+{
+    return {std::fmax(a.x, b.x), std::fmax(a.y, b.y)};
+}
+inline float2 lerp(const float2 &a, const float2 &b, float t)
+{
+    return a + (b - a) * t;
+}
+inline float dot(const float2 &a, const float2 &b)
+{
+    return a.x * b.x + a.y * b.y;
+}
+inline float length(const float2 &a)
+{
+    return std::sqrt(dot(a, a));
+}
+inline float2 normalize(const float2 &a)
+{
+    return a / length(a);
+}
+
+inline packed_float3 pack(const float3 &v)
+{
+    return {v.x, v.y, v.z};
+}
+inline float3 unpack(const packed_float3 &v)
+{
+    return {v.x, v.y, v.z};
+}
+
+// Quaternions. Products compose right to left, like matrices: (a * b) rotates by b first.
+inline quatf operator*(const quatf &a, const quatf &b)
+{
+    return {a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y, a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+            a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w, a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z};
+}
+inline quatf conjugate(const quatf &q)
+{
+    return {-q.x, -q.y, -q.z, q.w};
+}
+inline quatf normalize(const quatf &q)
+{
+    const float4 v = normalize(float4{q.x, q.y, q.z, q.w});
+    return {v.x, v.y, v.z, v.w};
+}
+// v + 2w (u x v) + 2 u x (u x v), with u the vector part of a unit quaternion.
+inline float3 rotate(const quatf &q, const float3 &v)
+{
+    const float3 u = {q.x, q.y, q.z};
+    const float3 t = cross(u, v) * 2.0f;
+    return v + t * q.w + cross(u, t);
+}
+// Shortest-path spherical interpolation, falling back to a normalized lerp for nearly equal rotations.
+inline quatf slerp(const quatf &a, const quatf &b, float t)
+{
+    float4 to = {b.x, b.y, b.z, b.w};
+    const float4 from = {a.x, a.y, a.z, a.w};
+    float cosAngle = dot(from, to);
+    if (cosAngle < 0.0f)
+    {
+        to = -to;
+        cosAngle = -cosAngle;
+    }
+
+    float4 result;
+    if (cosAngle > 0.9995f)
+    {
+        result = normalize(lerp(from, to, t));
+    }
+    else
+    {
+        const float angle = std::acos(cosAngle);
+        const float inverseSin = 1.0f / std::sin(angle);
+        result = from * (std::sin((1.0f - t) * angle) * inverseSin) + to * (std::sin(t * angle) * inverseSin);
+    }
+    return {result.x, result.y, result.z, result.w};
+}
+
+// Column-major, like Metal's float4x4.
+struct alignas(16) float4x4 {
+    float4 columns[4];
+
+    const float *data() const { return &columns[0].x; }
+
+    static float4x4 identity() { return scale({1.0f, 1.0f, 1.0f}); }
+    static float4x4 translation(const float3 &t)
+    {
+        return {{{1.0f, 0.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f, 0.0f}, {t.x, t.y, t.z, 1.0f}}};
+    }
+    static float4x4 scale(const float3 &s)
+    {
+        return {{{s.x, 0.0f, 0.0f, 0.0f}, {0.0f, s.y, 0.0f, 0.0f}, {0.0f, 0.0f, s.z, 0.0f}, {0.0f, 0.0f, 0.0f, 1.0f}}};
+    }
+    static float4x4 rotation(const quatf &q)
+    {
+        const float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+        const float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+        const float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+        return {{{1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy), 0.0f},
+                 {2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx), 0.0f},
+                 {2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy), 0.0f},
+                 {0.0f, 0.0f, 0.0f, 1.0f}}};
+    }
+    // Translation * rotation * scale.
+    static float4x4 transform(const float3 &t, const quatf &r, const float3 &s)
+    {
+        float4x4 m = rotation(r);
+        m.columns[0] *= s.x;
+        m.columns[1] *= s.y;
+        m.columns[2] *= s.z;
+        m.columns[3] = {t.x, t.y, t.z, 1.0f};
+        return m;
+    }
+    // Right-handed, looking down -z, into Metal clip space (z in [0, w]).
+    static float4x4 perspective(float fovY, float aspect, float nearZ, float farZ)
+    {
+        const float ys = 1.0f / std::tan(0.5f * fovY);
+        const float xs = ys / aspect;
+        const float zs = farZ / (nearZ - farZ);
+        return {{{xs, 0.0f, 0.0f, 0.0f},
+                 {0.0f, ys, 0.0f, 0.0f},
+                 {0.0f, 0.0f, zs, -1.0f},
+                 {0.0f, 0.0f, nearZ * zs, 0.0f}}};
+    }
+    static float4x4 orthographic(float left, float right, float bottom, float top, float nearZ, float farZ)
+    {
+        const float xs = 2.0f / (right - left), ys = 2.0f / (top - bottom), zs = 1.0f / (nearZ - farZ);
+        return {{{xs, 0.0f, 0.0f, 0.0f},
+                 {0.0f, ys, 0.0f, 0.0f},
+                 {0.0f, 0.0f, zs, 0.0f},
+                 {-(left + right) / (right - left), -(top + bottom) / (top - bottom), nearZ * zs, 1.0f}}};
+    }
+    // Right-handed view matrix.
+    static float4x4 lookAt(const float3 &eye, const float3 &target, const float3 &up)
+    {
+        const float3 z = normalize(eye - target);
+        const float3 x = normalize(cross(up, z));
+        const float3 y = cross(z, x);
+        return {{{x.x, y.x, z.x, 0.0f},
+                 {x.y, y.y, z.y, 0.0f},
+                 {x.z, y.z, z.z, 0.0f},
+                 {-dot(x, eye), -dot(y, eye), -dot(z, eye), 1.0f}}};
+    }
+};
+
+inline float4 operator*(const float4x4 &m, const float4 &v)
+{
+    using detail::load;
+    const detail::Lane4 lv = detail::load(v);
+    return detail::store<float4>(load(m.columns[0]) * lv.splat<0>() + load(m.columns[1]) * lv.splat<1>() +
+                                 load(m.columns[2]) * lv.splat<2>() + load(m.columns[3]) * lv.splat<3>());
+}
+
+inline float4x4 operator*(const float4x4 &a, const float4x4 &b)
+{
+    float4x4 result;
+#if defined(__AVX__)
+    // Two columns of the result per step: every column of a is broadcast to both halves and scaled by the matching
+    // component of the two columns of b.
+    const __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&a.columns[0]));
+    const __m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&a.columns[1]));
+    const __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&a.columns[2]));
+    const __m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&a.columns[3]));
+    for (int c = 0; c < 4; c += 2)
+    {
+        const __m256 bc = _mm256_loadu_ps(&b.columns[c].x);
+#if defined(__FMA__)
+        __m256 r = _mm256_mul_ps(a0, _mm256_permute_ps(bc, 0x00));
+        r = _mm256_fmadd_ps(a1, _mm256_permute_ps(bc, 0x55), r);
+        r = _mm256_fmadd_ps(a2, _mm256_permute_ps(bc, 0xaa), r);
+        r = _mm256_fmadd_ps(a3, _mm256_permute_ps(bc, 0xff), r);
+#else
+        const __m256 r01 = _mm256_add_ps(_mm256_mul_ps(a0, _mm256_permute_ps(bc, 0x00)),
+                                         _mm256_mul_ps(a1, _mm256_permute_ps(bc, 0x55)));
+        const __m256 r23 = _mm256_add_ps(_mm256_mul_ps(a2, _mm256_permute_ps(bc, 0xaa)),
+                                         _mm256_mul_ps(a3, _mm256_permute_ps(bc, 0xff)));
+        const __m256 r = _mm256_add_ps(r01, r23);
+#endif
+        _mm256_storeu_ps(&result.columns[c].x, r);
+    }
+#else
+    using detail::load;
+    const detail::Lane4 a0 = load(a.columns[0]), a1 = load(a.columns[1]);
+    const detail::Lane4 a2 = load(a.columns[2]), a3 = load(a.columns[3]);
+    for (int c = 0; c < 4; ++c)
+    {
+        const detail::Lane4 bc = load(b.columns[c]);
+        (a0 * bc.splat<0>() + a1 * bc.splat<1>() + a2 * bc.splat<2>() + a3 * bc.splat<3>()).store(&result.columns[c].x);
+    }
+#endif
+    return result;
+}
+
+inline float4x4 transpose(const float4x4 &m)
+{
+    const float4 *c = m.columns;
+    return {{{c[0].x, c[1].x, c[2].x, c[3].x},
+             {c[0].y, c[1].y, c[2].y, c[3].y},
+             {c[0].z, c[1].z, c[2].z, c[3].z},
+             {c[0].w, c[1].w, c[2].w, c[3].w}}};
+}
+
+// General inverse by cofactors; a singular matrix produces infinities.
+inline float4x4 inverse(const float4x4 &matrix)
+{
+    const float *m = matrix.data();
+    float inv[16];
+    inv[0] = m[5] * m[10] * m[15] - m[5] * m[11] * m[14] - m[9] * m[6] * m[15] + m[9] * m[7] * m[14] +
+             m[13] * m[6] * m[11] - m[13] * m[7] * m[10];
+    inv[4] = -m[4] * m[10] * m[15] + m[4] * m[11] * m[14] + m[8] * m[6] * m[15] - m[8] * m[7] * m[14] -
+             m[12] * m[6] * m[11] + m[12] * m[7] * m[10];
+    inv[8] = m[4] * m[9] * m[15] - m[4] * m[11] * m[13] - m[8] * m[5] * m[15] + m[8] * m[7] * m[13] +
+             m[12] * m[5] * m[11] - m[12] * m[7] * m[9];
+    inv[12] = -m[4] * m[9] * m[14] + m[4] * m[10] * m[13] + m[8] * m[5] * m[14] - m[8] * m[6] * m[13] -
+              m[12] * m[5] * m[10] + m[12] * m[6] * m[9];
+    inv[1] = -m[1] * m[10] * m[15] + m[1] * m[11] * m[14] + m[9] * m[2] * m[15] - m[9] * m[3] * m[14] -
+             m[13] * m[2] * m[11] + m[13] * m[3] * m[10];
+    inv[5] = m[0] * m[10] * m[15] - m[0] * m[11] * m[14] - m[8] * m[2] * m[15] + m[8] * m[3] * m[14] +
+             m[12] * m[2] * m[11] - m[12] * m[3] * m[10];
+    inv[9] = -m[0] * m[9] * m[15] + m[0] * m[11] * m[13] + m[8] * m[1] * m[15] - m[8] * m[3] * m[13] -
+             m[12] * m[1] * m[11] + m[12] * m[3] * m[9];
+    inv[13] = m[0] * m[9] * m[14] - m[0] * m[10] * m[13] - m[8] * m[1] * m[14] + m[8] * m[2] * m[13] +
+              m[12] * m[1] * m[10] - m[12] * m[2] * m[9];
+    inv[2] = m[1] * m[6] * m[15] - m[1] * m[7] * m[14] - m[5] * m[2] * m[15] + m[5] * m[3] * m[14] +
+             m[13] * m[2] * m[7] - m[13] * m[3] * m[6];
+    inv[6] = -m[0] * m[6] * m[15] + m[0] * m[7] * m[14] + m[4] * m[2] * m[15] - m[4] * m[3] * m[14] -
+             m[12] * m[2] * m[7] + m[12] * m[3] * m[6];
+    inv[10] = m[0] * m[5] * m[15] - m[0] * m[7] * m[13] - m[4] * m[1] * m[15] + m[4] * m[3] * m[13] +
+              m[12] * m[1] * m[7] - m[12] * m[3] * m[5];
+    inv[14] = -m[0] * m[5] * m[14] + m[0] * m[6] * m[13] + m[4] * m[1] * m[14] - m[4] * m[2] * m[13] -
+              m[12] * m[1] * m[6] + m[12] * m[2] * m[5];
+    inv[3] = -m[1] * m[6] * m[11] + m[1] * m[7] * m[10] + m[5] * m[2] * m[11] - m[5] * m[3] * m[10] -
+             m[9] * m[2] * m[7] + m[9] * m[3] * m[6];
+    inv[7] = m[0] * m[6] * m[11] - m[0] * m[7] * m[10] - m[4] * m[2] * m[11] + m[4] * m[3] * m[10] +
+             m[8] * m[2] * m[7] - m[8] * m[3] * m[6];
+    inv[11] = -m[0] * m[5] * m[11] + m[0] * m[7] * m[9] + m[4] * m[1] * m[11] - m[4] * m[3] * m[9] -
+              m[8] * m[1] * m[7] + m[8] * m[3] * m[5];
+    inv[15] = m[0] * m[5] * m[10] - m[0] * m[6] * m[9] - m[4] * m[1] * m[10] + m[4] * m[2] * m[9] +
+              m[8] * m[1] * m[6] - m[8] * m[2] * m[5];
+
+    const float inverseDeterminant = 1.0f / (m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12]);
+    float4x4 result;
+    for (int c = 0; c < 4; ++c)
+        result.columns[c] = float4{inv[c * 4], inv[c * 4 + 1], inv[c * 4 + 2], inv[c * 4 + 3]} * inverseDeterminant;
+    return result;
+}
+
+// The vector is used in place rather than widened to a float4 in memory, which would stall its load.
+inline float3 transformPoint(const float4x4 &m, const float3 &p)
+{
+    using detail::load;
+    const detail::Lane4 lp = load(p);
+    return detail::store<float3>(load(m.columns[0]) * lp.splat<0>() + load(m.columns[1]) * lp.splat<1>() +
+                                 load(m.columns[2]) * lp.splat<2>() + load(m.columns[3]));
+}
+
+inline float3 transformDirection(const float4x4 &m, const float3 &d)
+{
+    using detail::load;
+    const detail::Lane4 ld = load(d);
+    return detail::store<float3>(load(m.columns[0]) * ld.splat<0>() + load(m.columns[1]) * ld.splat<1>() +
+                                 load(m.columns[2]) * ld.splat<2>());
+}
+
+// Round to nearest even; overflow gives infinity and NaNs stay NaNs.
+inline half toHalf(float f)
+{
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    const uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
+
+    uint16_t result;
+    if (bits >= (127u + 16u) << 23) // at least 65536: infinity, or NaN
+    {
+        result = bits > 0x7f800000u ? 0x7e00 : 0x7c00;
+    }
+    else if (bits < 113u << 23) // below the smallest normal half
+    {
+        // Adding a float whose ulp is the smallest subnormal half rounds the mantissa into place.
+        const uint32_t magicBits = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+        float magic, value;
+        memcpy(&magic, &magicBits, sizeof(magic));
+        memcpy(&value, &bits, sizeof(value));
+        value += magic;
+        memcpy(&bits, &value, sizeof(bits));
+        result = uint16_t(bits - magicBits);
+    }
+    else
+    {
+        const uint32_t odd = (bits >> 13) & 1;
+        bits += ((15u - 127u) << 23) + 0xfff + odd;
+        result = uint16_t(bits >> 13);
+    }
+    return {uint16_t(result | (sign >> 16))};
+}
+
+inline float toFloat(half h)
+{
+    const uint32_t shiftedExponent = 0x7c00u << 13;
+    uint32_t bits = uint32_t(h.bits & 0x7fff) << 13;
+    const uint32_t exponent = bits & shiftedExponent;
+    bits += (127u - 15u) << 23;
+
+    if (exponent == shiftedExponent) // infinity or NaN
+    {
+        bits += (128u - 16u) << 23;
+    }
+    else if (exponent == 0) // zero or subnormal: renormalize through a float subtraction
+    {
+        bits += 1u << 23;
+        const uint32_t magicBits = 113u << 23;
+        float magic, value;
+        memcpy(&magic, &magicBits, sizeof(magic));
+        memcpy(&value, &bits, sizeof(value));
+        value -= magic;
+        memcpy(&bits, &value, sizeof(bits));
+    }
+    bits |= uint32_t(h.bits & 0x8000) << 16;
+
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+// Bulk conversions, e.g. for packing vertex attributes.
+inline void toHalf(const float *pIn, half *pOut, size_t count)
+{
+    size_t i = 0;
+#if defined(__F16C__)
+    for (; i + 8 <= count; i += 8)
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(pOut + i),
+                         _mm256_cvtps_ph(_mm256_loadu_ps(pIn + i), _MM_FROUND_TO_NEAREST_INT));
+#elif defined(__ARM_NEON)
+    for (; i + 4 <= count; i += 4)
+        vst1_u16(&pOut[i].bits, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(pIn + i))));
+#endif
+    for (; i < count; ++i)
+        pOut[i] = toHalf(pIn[i]);
+}
+
+inline void toFloat(const half *pIn, float *pOut, size_t count)
+{
+    size_t i = 0;
+#if defined(__F16C__)
+    for (; i + 8 <= count; i += 8)
+        _mm256_storeu_ps(pOut + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pIn + i))));
+#elif defined(__ARM_NEON)
+    for (; i + 4 <= count; i += 4)
+        vst1q_f32(pOut + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(&pIn[i].bits))));
+#endif
+    for (; i < count; ++i)
+        pOut[i] = toFloat(pIn[i]);
+}
+
+static_assert(sizeof(float2) == 8 && alignof(float2) == 8, "float2 must match Metal");
+static_assert(sizeof(float3) == 16 && alignof(float3) == 16, "float3 must match Metal");
+static_assert(sizeof(float4) == 16 && alignof(float4) == 16, "float4 must match Metal");
+static_assert(sizeof(quatf) == 16 && alignof(quatf) == 16, "quatf must match float4");
+static_assert(sizeof(float4x4) == 64 && alignof(float4x4) == 16, "float4x4 must match Metal");
+static_assert(sizeof(packed_float2) == 8 && alignof(packed_float2) == 4, "packed_float2 must match Metal");
+static_assert(sizeof(packed_float3) == 12 && alignof(packed_float3) == 4, "packed_float3 must match Metal");
+static_assert(sizeof(packed_float4) == 16 && alignof(packed_float4) == 4, "packed_float4 must match Metal");
+static_assert(sizeof(half) == 2 && sizeof(half2) == 4 && alignof(half2) == 4, "half2 must match Metal");
+static_assert(sizeof(half3) == 8 && alignof(half3) == 8, "half3 must match Metal");
+static_assert(sizeof(half4) == 8 && alignof(half4) == 8, "half4 must match Metal");
+static_assert(sizeof(packed_half3) == 6, "packed_half3 must match Metal");
+} // namespace SimdMath
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+// 2D points hashed into uniform cells, rebuilt from scratch each frame with a counting sort over the buckets. After a
+// rebuild the points of each bucket are contiguous, with their positions stored next to the original indices, so a
+// query only reads the buckets it visits. Several cells can share a bucket; queries filter by position and report
+// every point once.
+//
+// The sort runs in two passes to keep writes cache friendly: points are first split by the high bits of their
+// bucket into a few hundred partitions, then each partition, small enough to stay in cache, is sorted into place.
+// Both passes split into independent jobs and the result does not depend on the thread count.
+//
+// Points have no extent: to find sprites overlapping a region, grow the region by the largest sprite half-size.
+class SpatialHashGrid {
+  public:
+    static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+    struct Rect {
+        float minX, minY, maxX, maxY;
+    };
+
+    // bucketCount is rounded up to a power of two; 0 picks one bucket per point on every rebuild.
+    explicit SpatialHashGrid(float cellSize, size_t bucketCount = 0);
+
+    void rebuild(const float *pX, const float *pY, size_t count, JobSystem *pJobs = nullptr);
+
+    // Indices of the points inside (boundary included) are appended to results.
+    void queryRect(const Rect &rect, std::vector<uint32_t> &results) const;
+    void queryRadius(float x, float y, float radius, std::vector<uint32_t> &results) const;
+
+    // Closest point within maxDistance, e.g. for picking, or InvalidIndex.
+    uint32_t nearest(float x, float y, float maxDistance) const;
+
+    // Batched queries. The results of query i are results[offsets[i], offsets[i + 1]); offsets gets count + 1
+    // entries.
+    void queryRects(const Rect *pRects, size_t count, std::vector<uint32_t> &results, std::vector<uint32_t> &offsets,
+                    JobSystem *pJobs = nullptr) const;
+    void queryRadii(const float *pX, const float *pY, size_t count, float radius, std::vector<uint32_t> &results,
+                    std::vector<uint32_t> &offsets, JobSystem *pJobs = nullptr) const;
+
+    size_t size() const { return _points.size(); }
+    size_t bucketCount() const { return _bucketStart.empty() ? 0 : _bucketStart.size() - 1; }
+    float cellSize() const { return _cellSize; }
+
+  private:
+    struct Point {
+        float x, y;
+        uint32_t index;
+    };
+
+    // 16 bytes, so the partition pass writes one aligned record per point.
+    struct PartitionedPoint {
+        Point point;
+        uint32_t bucket;
+    };
+
+    int32_t cellCoordinate(float v) const;
+    uint32_t bucketOf(int32_t cellX, int32_t cellY) const;
+    // visit(point) for every point inside the rect, each once.
+    template <typename Visit> void visitRect(const Rect &rect, const Visit &visit) const;
+    template <typename Query>
+    void batch(size_t count, std::vector<uint32_t> &results, std::vector<uint32_t> &offsets, JobSystem *pJobs,
+               const Query &query) const;
+
+    float _cellSize;
+    float _inverseCellSize;
+    size_t _requestedBuckets;
+    uint32_t _bucketMask = 0;
+
+    std::vector<uint32_t> _bucketStart; // bucketCount + 1 entries
+    std::vector<Point> _points;         // sorted by bucket
+
+    // Rebuild scratch.
+    std::vector<uint32_t> _chunkOffsets; // per input chunk and partition
+    std::vector<uint32_t> _partitionStart;
+    std::vector<PartitionedPoint> _partitioned;
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <Metal/Metal.hpp>
+#include <vector>
+
+#include "UploadBatcher.h"
+
+// Fills private buffers from the CPU through a shared, write-combined staging ring. upload() returns where in the
+// ring to write the data, and encode() copies everything uploaded since the previous frame with one blit encoder,
+// coalescing adjacent uploads through an UploadBatcher. Uploads the ring has no room for get a staging buffer of
+// their own. Buffer-to-buffer copies, such as moving contents into a larger buffer, go through the same encoder,
+// after the uploads they depend on. Staging is reused once frameLatency frames have passed, so it relies on the
+// caller having at most that many frames in flight.
+class StagingUploader {
+  public:
+    StagingUploader(MTL::Device *pDevice, const UploadBatcher::Settings &settings, uint32_t frameLatency);
+    ~StagingUploader();
+
+    // Call once per frame, once the frame frameLatency frames back has completed.
+    void beginFrame();
+
+    // Where to write size bytes for the destination range; they reach it when the frame's encode() runs.
+    void *upload(MTL::Buffer *pDestination, size_t offset, size_t size);
+    void copy(MTL::Buffer *pSource, size_t sourceOffset, MTL::Buffer *pDestination, size_t destinationOffset,
+              size_t size);
+    // Releases a buffer once the frames that may copy from it have completed.
+    void retire(MTL::Buffer *pBuffer);
+
+    // Call once per frame: encodes the copies, if any, ahead of the passes that read their destinations.
+    void encode(MTL::CommandBuffer *pCmd);
+
+    const UploadBatcher::Stats &stats() const { return _batcher.stats(); }
+
+  private:
+    struct Retired {
+        MTL::Buffer *pBuffer;
+        uint64_t serial; // of the flush whose copies last read it
+    };
+
+    MTL::Device *_pDevice;
+    MTL::Buffer *_pStaging;
+    UploadBatcher _batcher;
+    uint32_t _frameLatency;
+    uint64_t _serial = 0; // of the last flush, one per frame
+    std::vector<Retired> _retired; // in retirement order
+    std::vector<UploadBatcher::Copy> _copies;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <Metal/Metal.hpp>
+#include <vector>
+
+#include "SyncPlanner.h"
+
+// Encodes a SyncPlanner's plan: an MTL::SharedEvent per queue, whose values keep increasing from frame to frame so
+// the CPU can follow them too, and a set of MTL::Fence objects per queue, grown to the most a frame has needed. For
+// each pass, call encodeWaits() on its command buffer before creating the encoder, encodeFences() on the encoder
+// before any work, and encodeSignal() on the command buffer once the encoder has ended.
+class SyncEncoder {
+  public:
+    explicit SyncEncoder(MTL::Device *pDevice);
+    ~SyncEncoder();
+
+    // Call once per frame, after planner.plan() and before encoding any of its passes, and endFrame() once they are
+    // all encoded. The planner is read until then, so the next frame is planned after endFrame().
+    void beginFrame(const SyncPlanner &planner);
+    void endFrame();
+
+    void encodeWaits(SyncPlanner::PassId pass, MTL::CommandBuffer *pCmd) const;
+    void encodeFences(SyncPlanner::PassId pass, MTL::RenderCommandEncoder *pEncoder) const;
+    void encodeFences(SyncPlanner::PassId pass, MTL::ComputeCommandEncoder *pEncoder) const;
+    void encodeFences(SyncPlanner::PassId pass, MTL::BlitCommandEncoder *pEncoder) const;
+    void encodeSignal(SyncPlanner::PassId pass, MTL::CommandBuffer *pCmd) const;
+
+  private:
+    MTL::Device *_pDevice;
+    const SyncPlanner *_pPlanner = nullptr;
+    std::vector<MTL::SharedEvent *> _events;        // per queue
+    SyncTimeline _timeline;
+    std::vector<std::vector<MTL::Fence *>> _fences; // per queue
+    std::vector<MTL::Fence *> _frameFences;         // per plan fence
+};
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "RenderGraph.h"
+
+// Derives the GPU synchronization for a frame of encoder passes from the resource accesses they declare, for
+// resources Metal does not track. Passes are given in submission order, each on a queue, and every read-after-write,
+// write-after-read and write-after-write hazard between two passes becomes a wait:
+//
+// - on the same queue, the consumer waits for an MTL::Fence the producer updates at its end;
+// - across queues, the producer's command buffer signals its queue's MTL::Event and the consumer's waits for it.
+//
+// Waits are minimal in that a hazard gets none when the consumer already waits, at the same stage or earlier, for a
+// pass that transitively waited for the producer. Producers are visited latest first so that one wait covers as many
+// earlier ones as possible. Render pass waits are placed before the first stage that needs them, so a pass's vertex
+// work can overlap a producer whose results it only reads in the fragment stage. Fences are reused once their last
+// waiter has been submitted, so a frame needs as many fences per queue as are pending at once. Signals are only
+// added for passes another queue waits for, and their values increase in submission order, as a queue executes them.
+class SyncPlanner {
+  public:
+    using PassId = uint32_t;
+    using PassType = RenderGraph::PassType;
+    static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+    // Render stages in pipeline order; compute and blit accesses use Vertex.
+    enum class Stage : uint8_t { Vertex, Fragment };
+
+    struct FenceWait {
+        uint32_t fence;
+        Stage beforeStage;
+    };
+
+    struct EventWait {
+        uint32_t queue; // whose event
+        uint64_t value;
+    };
+
+    // What to encode around a pass: event waits on its command buffer before the encoder, fence waits at the start
+    // of the encoder, the fence update at its end, and the event signal on the command buffer after it.
+    struct PassPlan {
+        std::vector<EventWait> eventWaits;
+        std::vector<FenceWait> fenceWaits;
+        uint32_t updateFence = InvalidIndex;
+        uint64_t signalValue = 0; // 0 when the pass signals nothing
+    };
+
+    struct Stats {
+        uint32_t hazards;
+        uint32_t fenceWaits;
+        uint32_t eventWaits;
+        uint32_t redundantWaits; // hazards already covered by other waits
+    };
+
+    void reset(uint32_t queueCount);
+
+    PassId addPass(uint32_t queue, PassType type);
+    void read(PassId pass, uint32_t resource, Stage stage = Stage::Vertex);
+    void write(PassId pass, uint32_t resource, Stage stage = Stage::Vertex);
+
+    // Without fences, hazards between passes of one queue are left to Metal's hazard tracking, and only those
+    // across queues get waits.
+    void plan(bool fences = true);
+
+    const PassPlan &passPlan(PassId pass) const { return _plans[pass]; }
+    uint32_t passQueue(PassId pass) const { return _passes[pass].queue; }
+    PassType passType(PassId pass) const { return _passes[pass].type; }
+    size_t passCount() const { return _passes.size(); }
+    uint32_t queueCount() const { return _queueCount; }
+    // Fences are numbered across queues; fenceCount() of them are needed.
+    uint32_t fenceCount() const { return _fenceCount; }
+    uint32_t fenceQueue(uint32_t fence) const { return _fenceQueues[fence]; }
+    // Event values signaled per queue this frame, numbered from 1.
+    uint64_t signalCount(uint32_t queue) const { return _signalCounts[queue]; }
+    const Stats &stats() const { return _stats; }
+
+  private:
+    struct Access {
+        uint32_t resource;
+        Stage stage;
+        bool write;
+    };
+
+    struct Pass {
+        uint32_t queue;
+        PassType type;
+        std::vector<Access> accesses;
+    };
+
+    struct ResourceState {
+        PassId lastWriter = InvalidIndex;
+        std::vector<PassId> readers; // since the last write
+    };
+
+    uint64_t *known(PassId pass, Stage stage) { return &_known[(size_t(pass) * 2 + size_t(stage)) * _bitsetWords]; }
+    void assignSignals();
+    void allocateFences();
+
+    uint32_t _queueCount = 0;
+    std::vector<Pass> _passes;
+    std::vector<PassPlan> _plans;
+    std::vector<uint32_t> _fenceQueues;
+    std::vector<uint64_t> _signalCounts;
+    uint32_t _fenceCount = 0;
+    Stats _stats = {};
+
+    // plan() scratch: per pass, the passes known complete before each of its stages starts, as bitsets.
+    size_t _bitsetWords = 0;
+    std::vector<uint64_t> _known;
+    std::vector<PassId> _lastFenceWaiter; // per pass: the last pass waiting for its fence
+    std::vector<ResourceState> _resources;
+};
+
+// Numbers the event values of successive frames' plans so that each queue's values keep increasing, as a
+// shared event's must. A plan's values start from 1 every frame; they are offset by everything earlier frames
+// signaled. The frame's signal counts are copied when it begins, so planning the next frame before this one ends
+// does not move its values.
+class SyncTimeline {
+  public:
+    // Call once per frame, after planner.plan() and before encoding any of its passes.
+    void beginFrame(const SyncPlanner &planner);
+    // Call once the frame's passes are all encoded.
+    void endFrame();
+
+    uint32_t queueCount() const { return uint32_t(_bases.size()); }
+    // The value to signal or wait for on the queue's event, for a value in the current frame's plan.
+    uint64_t value(uint32_t queue, uint64_t planValue) const { return _bases[queue] + planValue; }
+
+  private:
+    std::vector<uint64_t> _bases;        // per queue: the last value signaled by earlier frames
+    std::vector<uint64_t> _frameSignals; // per queue: the values the current frame signals
+    bool _inFrame = false;
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Bounds.h"
+
+// CDLOD node selection over a heightfield. Every node is drawn with the same grid mesh scaled to the node's size;
+// a node at LOD l covers leafSize << l heightmap samples. Selection walks the quadtree from the coarsest level and
+// stops descending once a node lies outside the distance range of the next finer LOD.
+class TerrainQuadtree {
+  public:
+    struct Settings {
+        uint32_t leafSize = 64;        // heightmap samples per side of an LOD 0 node, also the grid resolution
+        uint32_t lodCount = 8;
+        float leafRange = 128.0f;      // view distance covered by LOD 0, doubled at each coarser level
+        float morphStartRatio = 0.66f; // fraction of a LOD's range after which it morphs to the next level
+        float sampleSpacing = 1.0f;    // world units between heightmap samples
+        float heightScale = 1.0f;      // world height of a full-scale (65535) sample
+    };
+
+    static constexpr uint32_t WholeNode = 4;
+
+    // One selected node, in the layout the terrain vertex shader reads; must match TerrainNode in terrain.metal.
+    // A node whose children are partly out of range is drawn only over the other quadrants (0-3, bit 0 selecting
+    // +x and bit 1 +z), using the matching quarter of the grid mesh.
+    struct Node {
+        float x, z; // world position of the node's minimum corner
+        float size; // world size of the node's side
+        float lod;
+        float morphStart, morphEnd;
+        uint32_t quadrant;
+        uint32_t padding;
+    };
+
+    TerrainQuadtree(const uint16_t *pHeights, uint32_t width, uint32_t height, const Settings &settings);
+
+    void select(const float cameraPosition[3], const Frustum &frustum, std::vector<Node> &nodes) const;
+
+    const Settings &settings() const { return _settings; }
+    uint32_t width() const { return _width; }
+    uint32_t height() const { return _height; }
+
+  private:
+    struct Level {
+        uint32_t width, height; // nodes
+        std::vector<uint16_t> minHeights, maxHeights;
+    };
+
+    bool selectNode(uint32_t lod, uint32_t nodeX, uint32_t nodeZ, const float cameraPosition[3],
+                    const Frustum &frustum, std::vector<Node> &nodes) const;
+    AABB nodeBounds(uint32_t lod, uint32_t nodeX, uint32_t nodeZ) const;
+    void addNode(uint32_t lod, const AABB &bounds, uint32_t quadrant, std::vector<Node> &nodes) const;
+
+    Settings _settings;
+    uint32_t _width, _height;
+    std::vector<Level> _levels;
+    std::vector<float> _ranges;
+    std::vector<float> _morphStarts;
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <Metal/Metal.hpp>
+#include <vector>
+
+#include "TerrainQuadtree.h"
+
+// Must match TerrainUniforms in shaders/terrain.metal.
+struct TerrainUniforms {
+    float viewProjection[16];
+    float cameraPosition[4];
+    float inverseTerrainSize[2];
+    float heightScale;
+    float gridDim;
+};
+
+// Draws a heightfield with CDLOD: one grid mesh instanced over the nodes TerrainQuadtree selects each frame, with
+// heights sampled from an R16Unorm heightmap texture in the vertex stage. The render pass needs a depth attachment.
+class TerrainRenderer {
+  public:
+    TerrainRenderer(MTL::Device *pDevice, MTL::Library *pLibrary, MTL::PixelFormat colorFormat,
+                    MTL::PixelFormat depthFormat, const uint16_t *pHeights, uint32_t width, uint32_t height,
+                    const TerrainQuadtree::Settings &settings, size_t framesInFlight);
+    ~TerrainRenderer();
+
+    // viewProjection is column-major; frame selects the node buffer, which must not be in use by the GPU.
+    void draw(MTL::RenderCommandEncoder *pEnc, const float *viewProjection, const float cameraPosition[3],
+              MTL::Texture *pColorTexture, size_t frame);
+
+    const std::vector<TerrainQuadtree::Node> &selectedNodes() const { return _nodes; }
+
+  private:
+    void buildGrid();
+
+    MTL::Device *_pDevice;
+    MTL::RenderPipelineState *_pPSO;
+    MTL::DepthStencilState *_pDepthState;
+    MTL::Texture *_pHeightmap;
+    MTL::Buffer *_pGridVertices;
+    MTL::Buffer *_pGridIndices;
+    MTL::IndexType _gridIndexType;
+    size_t _quadrantIndexCount;
+    std::vector<MTL::Buffer *> _nodeBuffers;
+    TerrainQuadtree _quadtree;
+    std::vector<TerrainQuadtree::Node> _nodes;
+    std::vector<TerrainQuadtree::Node> _sortedNodes;
+};
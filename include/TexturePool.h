@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Recycles textures between frames, keyed by a hash of their descriptor. A released texture only becomes available
+// again frameLatency frames later, once the GPU can no longer be using it, and idle textures nobody asked for in
+// maxIdleFrames are trimmed. Among the textures that are ready, the most recently released is reused first, so spare
+// ones age out. The pool never creates or destroys a texture itself: on a miss the caller makes one and add()s it with
+// its size, and trimmed textures are handed back for the caller to destroy, so RenderTargetPool wraps it for Metal.
+class TexturePool {
+  public:
+    // The MTL::TextureDescriptor fields a texture is matched on, as their Metal enum values.
+    struct Descriptor {
+        uint32_t width = 1, height = 1;
+        uint32_t pixelFormat = 0; // MTL::PixelFormat
+        uint32_t usage = 0;       // MTL::TextureUsage
+        uint32_t storageMode = 0; // MTL::StorageMode
+        uint32_t sampleCount = 1;
+
+        bool operator==(const Descriptor &other) const = default;
+    };
+
+    struct Settings {
+        uint32_t frameLatency = 3; // frames in flight
+        uint32_t maxIdleFrames = 120;
+    };
+
+    struct Stats {
+        uint64_t requests = 0, hits = 0;
+        uint32_t texturesInUse = 0, texturesIdle = 0;
+        uint64_t bytesInUse = 0, bytesIdle = 0; // bytes retained while idle
+
+        float hitRate() const { return requests ? float(hits) / float(requests) : 0.0f; }
+    };
+
+    explicit TexturePool(const Settings &settings);
+
+    // Starts a frame; frame numbers increase by one per frame. Idle textures past maxIdleFrames are removed and
+    // appended to trimmed for the caller to destroy.
+    void beginFrame(uint64_t frame, std::vector<void *> &trimmed);
+
+    // A matching texture released at least frameLatency frames ago, now in use again, or nullptr on a miss, after
+    // which the caller creates one and add()s it.
+    void *acquire(const Descriptor &desc);
+    void add(const Descriptor &desc, void *pTexture, uint64_t size);
+    void release(void *pTexture);
+
+    // Removes every texture, idle or in use, appending them to removed.
+    void clear(std::vector<void *> &removed);
+
+    const Stats &stats() const { return _stats; }
+
+  private:
+    struct Record {
+        Descriptor desc;
+        uint64_t hash;
+        uint64_t size;
+        uint64_t releasedFrame;
+        bool inUse;
+    };
+
+    static uint64_t hash(const Descriptor &desc);
+
+    Settings _settings;
+    uint64_t _frame = 0;
+    Stats _stats;
+    std::unordered_map<void *, Record> _textures;
+    std::unordered_map<uint64_t, std::vector<void *>> _idle; // by descriptor hash, in release order
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Two-level segregated fit allocator over a linear range, with O(1) allocate and free. Free blocks are kept in lists
+// indexed by a power-of-two class and 16 linear subdivisions of it; two levels of bitmaps find the first non-empty
+// list large enough with a couple of bit scans. Sizes are kept in units of the granularity, so offsets are always
+// multiples of it. Block headers live in a vector of their own rather than in the range, which the allocator never
+// touches, so HeapAllocator uses it for placement heaps the CPU cannot write into. A freed block is merged with free
+// neighbours at once, so freeing everything leaves a single block again.
+class TlsfAllocator {
+  public:
+    static constexpr uint32_t InvalidBlock = UINT32_MAX;
+
+    struct Allocation {
+        uint64_t offset = 0;
+        uint64_t size = 0; // rounded up to the granularity
+        uint32_t block = InvalidBlock;
+
+        bool valid() const { return block != InvalidBlock; }
+    };
+
+    struct Stats {
+        uint64_t capacity;
+        uint64_t usedSize;
+        uint64_t largestFreeBlock;
+        uint32_t allocationCount;
+        uint32_t freeBlockCount;
+        // 1 - largestFreeBlock / free size: 0 when all free space is one block.
+        float fragmentation;
+    };
+
+    // granularity must be a power of two.
+    explicit TlsfAllocator(uint64_t capacity, uint64_t granularity = 256);
+
+    // alignment must be a power of two. Returns an invalid allocation when no free block is large enough.
+    Allocation allocate(uint64_t size, uint64_t alignment = 1);
+    void free(const Allocation &allocation);
+
+    uint64_t capacity() const { return _capacity; }
+    uint64_t usedSize() const { return _usedUnits << _granularityShift; }
+    Stats stats() const;
+
+  private:
+    static constexpr uint32_t SecondLevelShift = 4;
+    static constexpr uint32_t SecondLevelCount = 1u << SecondLevelShift;
+    static constexpr uint32_t FirstLevelCount = 65 - SecondLevelShift;
+
+    struct Block {
+        uint64_t offset; // units
+        uint64_t size;   // units
+        uint32_t previousPhysical, nextPhysical;
+        uint32_t previousFree, nextFree;
+        bool free;
+    };
+
+    uint32_t newBlock(uint64_t offset, uint64_t size);
+    void insertFree(uint32_t block);
+    void removeFree(uint32_t block);
+    // Splits the first units of block off as a block of its own and returns the rest.
+    uint32_t split(uint32_t block, uint64_t units);
+    uint32_t findFree(uint64_t units) const;
+
+    uint64_t _capacity;
+    uint32_t _granularityShift;
+    uint64_t _usedUnits = 0;
+    uint32_t _allocationCount = 0;
+    uint32_t _freeBlockCount = 0;
+
+    std::vector<Block> _blocks;
+    std::vector<uint32_t> _unusedBlocks;
+    uint64_t _firstLevelBitmap = 0;
+    uint32_t _secondLevelBitmaps[FirstLevelCount] = {};
+    uint32_t _freeLists[FirstLevelCount][SecondLevelCount];
+};
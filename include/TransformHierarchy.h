@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+struct alignas(64) Matrix4 {
+    float m[16]; // column-major
+};
+
+// Scene graph transforms in structure-of-arrays form. Nodes are kept sorted by depth, so one pass over the levels
+// in order sees every parent's world matrix before its children. Only nodes whose local transform changed, or whose
+// parent's world matrix changed, are recomputed; each level is split across the job system.
+//
+// Structural changes (destroy, setParent, or a create under a node deeper than the last one created) are applied by
+// the next update(), which re-sorts every node. Node ids stay valid across re-sorts; a destroyed node's id, and its
+// descendants', may be handed out again by create() after that update.
+class TransformHierarchy {
+  public:
+    using NodeId = uint32_t;
+    static constexpr NodeId InvalidNode = UINT32_MAX;
+
+    NodeId create(NodeId parent = InvalidNode);
+    // Destroys the node and all its descendants.
+    void destroy(NodeId node);
+    // Moves the node, with its subtree, under parent, or to the root for InvalidNode. The local transform is kept, so
+    // the node's world matrix follows its new parent. parent must not be the node or one of its descendants.
+    void setParent(NodeId node, NodeId parent);
+
+    void setLocal(NodeId node, const float translation[3], const float rotation[4], const float scale[3]);
+    void setTranslation(NodeId node, const float translation[3]);
+    void setRotation(NodeId node, const float rotation[4]);
+
+    void update(JobSystem *pJobs = nullptr);
+
+    const Matrix4 &worldMatrix(NodeId node) const { return _world[_slotOfNode[node]]; }
+    NodeId parent(NodeId node) const;
+    // Slots in use; destroyed nodes keep theirs until the next update().
+    size_t size() const { return _nodeOfSlot.size(); }
+
+    // World matrices in depth order, e.g. for a bulk upload; slotOf maps a node to its index here.
+    const Matrix4 *worldMatrices() const { return _world.data(); }
+    uint32_t slotOf(NodeId node) const { return _slotOfNode[node]; }
+
+  private:
+    void restructure();
+    void updateRange(size_t begin, size_t end);
+
+    // Indexed by slot.
+    std::vector<float> _translationX, _translationY, _translationZ;
+    std::vector<float> _rotationX, _rotationY, _rotationZ, _rotationW;
+    std::vector<float> _scaleX, _scaleY, _scaleZ;
+    std::vector<uint32_t> _parentSlot;
+    std::vector<uint32_t> _depth;
+    std::vector<uint8_t> _localDirty;
+    std::vector<uint8_t> _worldChanged;
+    std::vector<uint8_t> _destroyed; // until the next restructure()
+    std::vector<Matrix4> _world;
+    std::vector<NodeId> _nodeOfSlot;
+
+    std::vector<uint32_t> _slotOfNode; // InvalidNode once destroyed
+    std::vector<NodeId> _freeNodes;
+    std::vector<size_t> _levelStart;
+    bool _orderDirty = false;
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <Metal/Metal.hpp>
+#include <vector>
+
+#include "RenderGraph.h"
+#include "RenderTargetPool.h"
+
+// Backs the transient textures of a compiled RenderGraph with one placement heap, creating each texture at the offset
+// the graph assigned, so textures whose lifetimes do not overlap share memory. The heap is hazard tracked, which
+// keeps Metal ordering the passes that touch it. Textures are cached by descriptor and offset, so a graph that is
+// rebuilt the same way every frame creates no new textures. Transients the graph made memoryless live outside the
+// heap, in a RenderTargetPool: each allocate() releases the previous frame's and acquires this frame's, so a graph
+// whose layout changes reuses them once frameLatency frames have passed instead of creating new ones.
+class TransientHeap {
+  public:
+    TransientHeap(MTL::Device *pDevice, uint32_t frameLatency);
+    ~TransientHeap();
+
+    // A private 2D texture with the size and alignment it needs in the heap.
+    RenderGraph::TextureDesc describe(MTL::PixelFormat pixelFormat, uint32_t width, uint32_t height,
+                                      MTL::TextureUsage usage, uint32_t sampleCount = 1) const;
+
+    // Grows the heap if the graph needs more and creates the textures of its placed transients.
+    void allocate(const RenderGraph &graph);
+    MTL::Texture *texture(const RenderGraph &graph, RenderGraph::ResourceId resource) const;
+
+    // An autoreleased descriptor for one of the graph's merged render passes, with its transient attachments and the
+    // load and store actions compile() chose. Imported attachments get their actions; the caller sets their textures.
+    MTL::RenderPassDescriptor *renderPassDescriptor(const RenderGraph &graph, uint32_t renderPass) const;
+
+    size_t heapSize() const { return _pHeap ? _pHeap->size() : 0; }
+
+  private:
+    struct CachedTexture {
+        RenderGraph::TextureDesc desc;
+        uint64_t heapOffset;
+        MTL::Texture *pTexture;
+        bool used;
+    };
+
+    MTL::TextureDescriptor *newDescriptor(const RenderGraph::TextureDesc &desc) const;
+    void releaseTextures();
+
+    MTL::Device *_pDevice;
+    MTL::Heap *_pHeap = nullptr;
+    std::vector<CachedTexture> _cache;
+    RenderTargetPool _memorylessTargets;
+    std::vector<MTL::Texture *> _memorylessInUse; // acquired by the last allocate
+    std::vector<MTL::Texture *> _textures; // per graph resource, from the last allocate
+};
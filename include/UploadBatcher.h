@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <compare>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Plans the copies that move CPU-written data into GPU-private resources. Uploads are written into a staging ring
+// and recorded as copies, and flush() hands back the copies recorded since the previous one with adjacent ones
+// coalesced, so a blit encoder issues a few large copies instead of one per upload. The staging space a flush's
+// copies read is reused once the caller reports them done with release().
+//
+// Copies coalesce when they are contiguous in both their source and destination. To keep interleaved uploads to
+// several resources contiguous in the ring, each destination appends to its own chunk of the ring, starting at
+// chunkSize bytes and doubling each time the destination fills one. Copies are returned grouped by destination and
+// in offset order, except that a copy reading a resource an earlier copy wrote, or writing one an earlier copy read,
+// is placed after it, and copies overlapping in one destination keep the order they were recorded in. upload()
+// returns an offset into the ring and destinations are opaque pointers, so the caller writes the data and encodes the
+// copies.
+class UploadBatcher {
+  public:
+    static constexpr uint64_t InvalidOffset = UINT64_MAX;
+
+    struct Settings {
+        uint64_t stagingSize = 8 << 20;
+        uint64_t chunkSize = 64 << 10;
+        uint64_t alignment = 4; // of a chunk's first upload; sizes should be multiples of it to coalesce
+    };
+
+    struct Copy {
+        void *pSource; // nullptr for the staging ring
+        uint64_t sourceOffset;
+        void *pDestination;
+        uint64_t destinationOffset;
+        uint64_t size;
+    };
+
+    struct Stats {
+        uint64_t uploads;      // uploads and copies recorded before the last flush
+        uint64_t copies;       // they were coalesced into
+        uint64_t bytes;        // they moved
+        uint64_t stagingBytes; // of the ring in use, including chunk space left unused
+        uint64_t overflows;    // uploads the ring had no room for, in total
+    };
+
+    explicit UploadBatcher(const Settings &settings);
+
+    // Reserves size bytes of staging for the destination range, returning their offset in the ring for the caller
+    // to write, or InvalidOffset when the ring has no room; the caller then stages the data elsewhere and copy()s it.
+    uint64_t upload(void *pDestination, uint64_t destinationOffset, uint64_t size);
+    // Records a copy between resources.
+    void copy(void *pSource, uint64_t sourceOffset, void *pDestination, uint64_t destinationOffset, uint64_t size);
+
+    // Appends the copies recorded since the last flush, coalesced and ordered, to copies, and returns the flush's
+    // serial, from 1.
+    uint64_t flush(std::vector<Copy> &copies);
+    // The copies of every flush up to this serial have run, so their staging space is free.
+    void release(uint64_t serial);
+
+    const Stats &stats() const { return _stats; }
+
+  private:
+    static constexpr size_t MaxRuns = 16;
+
+    // A destination's chunk of the ring, until the next flush.
+    struct Run {
+        void *pDestination;
+        uint64_t cursor, end; // in the ring
+        uint64_t nextOffset;  // in the destination, just after its last upload
+        uint64_t chunkSize;
+    };
+
+    struct Batch {
+        uint64_t serial;
+        uint64_t head;  // the ring's head when it was flushed
+        uint64_t bytes; // allocated for it, including padding at the end of the ring
+    };
+
+    struct Pending {
+        Copy copy;
+        uint32_t phase; // after those of earlier copies writing its source or reading its destination
+    };
+
+    struct SortKey {
+        uint32_t phase;
+        uintptr_t destination;
+        uint64_t destinationOffset;
+        uint32_t index; // into _pending
+
+        auto operator<=>(const SortKey &other) const = default;
+    };
+
+    // The latest phases in which a resource was written and read, plus one; 0 when it was not.
+    struct Access {
+        uint32_t written = 0;
+        uint32_t read = 0;
+    };
+
+    uint64_t align(uint64_t offset) const { return (offset + _settings.alignment - 1) & ~(_settings.alignment - 1); }
+    uint64_t allocate(uint64_t size);
+    void trim(Run &run);
+    void assignPhases();
+
+    Settings _settings;
+    uint64_t _serial = 0;
+    uint64_t _head = 0, _tail = 0; // the ring's used space is [_tail, _head), wrapping
+    uint64_t _used = 0;
+    uint64_t _batchBytes = 0;
+    std::vector<Batch> _batches;     // flushed and not released, oldest first
+    std::vector<Run> _runs;          // oldest first
+    std::vector<Pending> _pending;   // in recording order
+    // flush() scratch
+    std::vector<SortKey> _sorted;
+    std::unordered_map<const void *, Access> _accesses;
+    Stats _stats = {};
+};
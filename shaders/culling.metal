@@ -0,0 +1,66 @@
+#include <metal_stdlib>
+using namespace metal;
+
+// Must match CullObject in IndirectCulling.h.
+struct CullObject {
+    packed_float3 center;
+    float radius;
+    uint indexCount;
+    uint indexOffset;
+    int baseVertex;
+    uint indexType;
+    uint baseInstance;
+    uint instanceCount;
+    uint2 padding;
+};
+
+struct Frustum {
+    float4 planes[6];
+};
+
+struct ExecutionRange {
+    uint location;
+    atomic_uint length;
+};
+
+struct CullArguments {
+    command_buffer commandBuffer [[id(0)]];
+};
+
+kernel void cullAndEncode(
+        uint objectId [[thread_position_in_grid]],
+        constant Frustum& frustum [[buffer(0)]],
+        device const CullObject* objects [[buffer(1)]],
+        constant uint& objectCount [[buffer(2)]],
+        device const uchar* indexBuffer [[buffer(3)]],
+        device ExecutionRange& range [[buffer(4)]],
+        device const CullArguments& arguments [[buffer(5)]]) {
+    if (objectId >= objectCount) {
+        return;
+    }
+
+    const CullObject object = objects[objectId];
+    if (object.instanceCount == 0) {
+        return;
+    }
+
+    const float3 center = float3(object.center);
+    for (int i = 0; i < 6; ++i) {
+        if (dot(frustum.planes[i].xyz, center) + frustum.planes[i].w < -object.radius) {
+            return;
+        }
+    }
+
+    const uint slot = atomic_fetch_add_explicit(&range.length, 1, memory_order_relaxed);
+    render_command cmd(arguments.commandBuffer, slot);
+
+    if (object.indexType == 0) {
+        cmd.draw_indexed_primitives(primitive_type::triangle, object.indexCount,
+                                    (device const ushort*)(indexBuffer + object.indexOffset),
+                                    object.instanceCount, object.baseVertex, object.baseInstance);
+    } else {
+        cmd.draw_indexed_primitives(primitive_type::triangle, object.indexCount,
+                                    (device const uint*)(indexBuffer + object.indexOffset),
+                                    object.instanceCount, object.baseVertex, object.baseInstance);
+    }
+}
@@ -0,0 +1,32 @@
+#include <metal_stdlib>
+using namespace metal;
+
+// Must match InstanceData in InstancePacking.h.
+struct InstanceData {
+    float4 rows[3];
+    uint materialIndex;
+    uint color;
+};
+
+// Must match ShadowCascade in CascadedShadows.h.
+struct ShadowCascade {
+    float4x4 lightViewProjection;
+    float4 atlasScaleOffset;
+    float splitDepth;
+    float texelSize;
+    float2 padding;
+};
+
+// Depth-only: the cascade's viewport places it in the shadow atlas.
+float4 vertex shadowVertex(
+        uint vertexId [[vertex_id]],
+        uint instanceId [[instance_id]],
+        device const float4* positions [[buffer(0)]],
+        device const InstanceData* instances [[buffer(2)]],
+        constant ShadowCascade& cascade [[buffer(3)]]) {
+    const InstanceData instance = instances[instanceId];
+    const float4 position = positions[vertexId];
+    const float4 world = float4(dot(instance.rows[0], position), dot(instance.rows[1], position),
+                                dot(instance.rows[2], position), 1.0f);
+    return cascade.lightViewProjection * world;
+}
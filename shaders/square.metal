@@ -1,25 +1,132 @@
 #include <metal_stdlib>
 using namespace metal;
 
+// Must match InstanceData in InstancePacking.h.
+struct InstanceData {
+    float4 rows[3];
+    uint materialIndex;
+    uint color;
+};
+
+// Must match ClusterGrid and ClusterRange in ClusteredLighting.h.
+struct ClusterGrid {
+    uint countX, countY, countZ;
+    uint lightCount;
+    float pixelToClusterX, pixelToClusterY;
+    float depthScale, depthBias;
+};
+
+struct ClusterRange {
+    uint offset;
+    uint count;
+};
+
+// Must match LightComponent in SceneComponents.h.
+struct ClusterLight {
+    packed_float3 position;
+    float radius;
+    packed_float3 color;
+    float intensity;
+};
+
+// Must match ShadowCascade in CascadedShadows.h.
+struct ShadowCascade {
+    float4x4 lightViewProjection;
+    float4 atlasScaleOffset;
+    float splitDepth;
+    float texelSize;
+    float2 padding;
+};
+
+// Must match MaterialData in BindlessTable.h.
+struct MaterialData {
+    uint albedoTexture;
+    uint sampler;
+    uint2 padding;
+};
+
+// Must match the layout BindlessTable encodes: MaxTextures textures, then MaxSamplers samplers.
+struct BindlessTable {
+    array<texture2d<float>, 1024> textures [[id(0)]];
+    array<sampler, 16> samplers [[id(1024)]];
+};
+
 struct vertexOut {
     float4 pos [[position]];
     float2 textureCoord;
+    float4 color;
+    float3 worldPosition;
+    float viewDepth;
+    uint materialIndex [[flat]];
 };
 
 vertexOut vertex vertexMain(
         uint vertexId [[vertex_id]],
+        uint instanceId [[instance_id]],
         device const float4* positions [[buffer(0)]],
-        device const float2* textureCoordinates [[buffer(1)]]) {
+        device const float2* textureCoordinates [[buffer(1)]],
+        device const InstanceData* instances [[buffer(2)]]) {
     vertexOut out;
 
-    out.pos = positions[vertexId];
+    const InstanceData instance = instances[instanceId];
+    const float4 position = positions[vertexId];
+
+    out.pos = float4(dot(instance.rows[0], position), dot(instance.rows[1], position),
+                     dot(instance.rows[2], position), position.w);
+    out.worldPosition = out.pos.xyz;
+    out.viewDepth = out.pos.w;
     out.textureCoord = textureCoordinates[vertexId];
+    out.color = unpack_unorm4x8_to_float(instance.color);
+    out.materialIndex = instance.materialIndex;
     return out;
 }
 
-float4 fragment fragmentMain(vertexOut in [[stage_in]], texture2d<float> colorTexture [[texture(0)]]) {
-    constexpr sampler textureSampler (mag_filter::linear, min_filter::linear);
+// Fraction of the sun reaching the fragment, from the first cascade whose split depth covers it. The comparison is
+// biased by two texels of depth, and filtered over 2x2 texels by the sampler.
+float sunVisibility(float3 worldPosition, float viewDepth, depth2d<float> shadowAtlas,
+                    constant ShadowCascade* cascades, uint cascadeCount) {
+    constexpr sampler shadowSampler(filter::linear, address::clamp_to_edge, compare_func::less_equal);
+
+    uint c = 0;
+    while (c < cascadeCount && viewDepth > cascades[c].splitDepth)
+        ++c;
+    if (c == cascadeCount)
+        return 1.0f;
+
+    const ShadowCascade cascade = cascades[c];
+    const float4 clip = cascade.lightViewProjection * float4(worldPosition, 1.0f);
+    const float2 uv = clip.xy * cascade.atlasScaleOffset.xy + cascade.atlasScaleOffset.zw;
+    const float bias = 2.0f * cascade.texelSize * abs(cascade.lightViewProjection[2][2]);
+    return shadowAtlas.sample_compare(shadowSampler, uv, clip.z - bias);
+}
+
+float4 fragment fragmentMain(
+        vertexOut in [[stage_in]],
+        depth2d<float> shadowAtlas [[texture(1)]],
+        constant ClusterGrid& grid [[buffer(0)]],
+        device const ClusterLight* lights [[buffer(1)]],
+        device const ClusterRange* clusters [[buffer(2)]],
+        device const ushort* lightIndices [[buffer(3)]],
+        constant ShadowCascade* cascades [[buffer(4)]],
+        constant uint& cascadeCount [[buffer(5)]],
+        constant BindlessTable& bindless [[buffer(6)]],
+        device const MaterialData* materials [[buffer(7)]]) {
+    const MaterialData material = materials[in.materialIndex];
+    const float4 colorSample =
+        bindless.textures[material.albedoTexture].sample(bindless.samplers[material.sampler], in.textureCoord);
+
+    const uint x = min(uint(in.pos.x * grid.pixelToClusterX), grid.countX - 1);
+    const uint y = min(uint(in.pos.y * grid.pixelToClusterY), grid.countY - 1);
+    const uint z = uint(clamp(log2(max(in.viewDepth, 1e-6f)) * grid.depthScale + grid.depthBias, 0.0f,
+                              float(grid.countZ - 1)));
+    const ClusterRange cluster = clusters[(z * grid.countY + y) * grid.countX + x];
 
-    const float4 colorSample = colorTexture.sample(textureSampler, in.textureCoord);
-    return colorSample;
+    float3 lighting = float3(0.0f);
+    for (uint i = 0; i < cluster.count; ++i) {
+        const ClusterLight light = lights[lightIndices[cluster.offset + i]];
+        const float falloff = saturate(1.0f - distance(float3(light.position), in.worldPosition) / light.radius);
+        lighting += float3(light.color) * light.intensity * falloff * falloff;
+    }
+    const float sun = sunVisibility(in.worldPosition, in.viewDepth, shadowAtlas, cascades, cascadeCount);
+    return colorSample * in.color * float4(mix(0.6f, 1.0f, sun) + lighting, 1.0f);
 }
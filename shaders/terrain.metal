@@ -0,0 +1,65 @@
+#include <metal_stdlib>
+using namespace metal;
+
+// Must match TerrainQuadtree::Node.
+struct TerrainNode {
+    float2 position;
+    float size;
+    float lod;
+    float morphStart;
+    float morphEnd;
+    uint quadrant;
+    uint padding;
+};
+
+// Must match TerrainUniforms in TerrainRenderer.h.
+struct TerrainUniforms {
+    float4x4 viewProjection;
+    float4 cameraPosition;
+    float2 inverseTerrainSize;
+    float heightScale;
+    float gridDim;
+};
+
+struct terrainOut {
+    float4 pos [[position]];
+    float2 textureCoord;
+};
+
+// Grid vertices are in [0, 1] over the node. Near the far end of a node's LOD range every odd vertex slides onto
+// its even neighbour, so the grid matches the next coarser LOD by the time that takes over.
+terrainOut vertex terrainVertex(
+        uint vertexId [[vertex_id]],
+        uint instanceId [[instance_id]],
+        device const float2* gridPositions [[buffer(0)]],
+        device const TerrainNode* nodes [[buffer(1)]],
+        constant TerrainUniforms& uniforms [[buffer(2)]],
+        texture2d<float> heightmap [[texture(0)]]) {
+    constexpr sampler heightSampler(coord::normalized, address::clamp_to_edge, filter::linear);
+
+    const TerrainNode node = nodes[instanceId];
+    float2 gridPosition = gridPositions[vertexId];
+
+    float2 world = node.position + gridPosition * node.size;
+    float height = heightmap.sample(heightSampler, world * uniforms.inverseTerrainSize, level(0)).r;
+
+    const float distanceToCamera = distance(uniforms.cameraPosition.xyz, float3(world.x, height * uniforms.heightScale, world.y));
+    const float morph = saturate((distanceToCamera - node.morphStart) / (node.morphEnd - node.morphStart));
+    const float2 odd = fract(gridPosition * uniforms.gridDim * 0.5) * 2.0 / uniforms.gridDim;
+    gridPosition -= odd * morph;
+
+    world = node.position + gridPosition * node.size;
+    const float2 textureCoord = world * uniforms.inverseTerrainSize;
+    height = heightmap.sample(heightSampler, textureCoord, level(0)).r * uniforms.heightScale;
+
+    terrainOut out;
+    out.pos = uniforms.viewProjection * float4(world.x, height, world.y, 1.0);
+    out.textureCoord = textureCoord;
+    return out;
+}
+
+float4 fragment terrainFragment(terrainOut in [[stage_in]], texture2d<float> colorTexture [[texture(0)]]) {
+    constexpr sampler textureSampler(address::repeat, mag_filter::linear, min_filter::linear);
+
+    return colorTexture.sample(textureSampler, in.textureCoord * 256.0);
+}
@@ -74,6 +74,7 @@ void AppDelegate::applicationDidFinishLaunching(NS::Notification *pNotification)
 
     _pMtkView = MTK::View::alloc()->init(frame, _pDevice);
     _pMtkView->setColorPixelFormat(MTL::PixelFormat::PixelFormatBGRA8Unorm_sRGB);
+    _pMtkView->setDepthStencilPixelFormat(MTL::PixelFormat::PixelFormatDepth32Float);
     _pMtkView->setClearColor(MTL::ClearColor::Make(1.0, 0.0, 0.0, 1.0));
 
     _pViewDelegate = new MTKViewDelegate(_pDevice);
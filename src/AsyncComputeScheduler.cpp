@@ -0,0 +1,141 @@
+#include "AsyncComputeScheduler.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+AsyncComputeScheduler::AsyncComputeScheduler(const Settings &settings) : _settings(settings)
+{
+}
+
+void AsyncComputeScheduler::schedule(const RenderGraph &graph, const float *pCosts)
+{
+    _queues.assign(graph.passCount(), GraphicsQueue);
+    _serialTime = simulate(graph, pCosts, _queues.data());
+
+    // A move can pay off only once a later one is made, so sweep until a sweep changes nothing.
+    float best = _serialTime;
+    for (bool improved = true; improved;)
+    {
+        improved = false;
+        for (PassId pass : graph.order())
+        {
+            if (graph.pass(pass).type != RenderGraph::PassType::Compute)
+                continue;
+            _queues[pass] ^= 1;
+            const float time = simulate(graph, pCosts, _queues.data());
+            if (time < best)
+            {
+                best = time;
+                improved = true;
+            }
+            else
+            {
+                _queues[pass] ^= 1;
+            }
+        }
+    }
+    _scheduledTime = best;
+}
+
+float AsyncComputeScheduler::simulate(const RenderGraph &graph, const float *pCosts, const uint32_t *pQueues)
+{
+    constexpr float Never = std::numeric_limits<float>::infinity();
+
+    for (std::vector<PassId> &order : _queueOrder)
+        order.clear();
+    for (PassId pass : graph.order())
+        _queueOrder[pQueues[pass]].push_back(pass);
+    _finish.assign(graph.passCount(), -1.0f);
+
+    // Each queue is idle, waiting for its next pass's inputs until a known time, or running a pass with some work
+    // left. Time advances from one pass starting or finishing to the next.
+    enum class State { Idle, Waiting, Running };
+    State states[2] = {State::Idle, State::Idle};
+    size_t next[2] = {0, 0};
+    float startTimes[2] = {};
+    float remaining[2] = {};
+    float now = 0.0f;
+
+    for (;;)
+    {
+        for (uint32_t queue = 0; queue < 2; ++queue)
+        {
+            if (states[queue] != State::Idle || next[queue] == _queueOrder[queue].size())
+                continue;
+            float start = now;
+            bool ready = true;
+            for (PassId dependency : graph.dependencies(_queueOrder[queue][next[queue]]))
+            {
+                if (graph.pass(dependency).culled)
+                    continue;
+                if (_finish[dependency] < 0.0f)
+                {
+                    ready = false;
+                    break;
+                }
+                const float latency = pQueues[dependency] != queue ? _settings.eventLatency : 0.0f;
+                start = std::max(start, _finish[dependency] + latency);
+            }
+            if (ready)
+            {
+                states[queue] = State::Waiting;
+                startTimes[queue] = start;
+            }
+        }
+
+        const float rate = states[0] == State::Running && states[1] == State::Running ? _settings.overlapEfficiency
+                                                                                      : 1.0f;
+        float eventTimes[2];
+        float nextTime = Never;
+        for (uint32_t queue = 0; queue < 2; ++queue)
+        {
+            eventTimes[queue] = states[queue] == State::Running   ? now + remaining[queue] / rate
+                                : states[queue] == State::Waiting ? startTimes[queue]
+                                                                  : Never;
+            nextTime = std::min(nextTime, eventTimes[queue]);
+        }
+        if (nextTime == Never)
+            break;
+
+        for (uint32_t queue = 0; queue < 2; ++queue)
+        {
+            if (states[queue] == State::Running)
+            {
+                if (eventTimes[queue] <= nextTime)
+                {
+                    _finish[_queueOrder[queue][next[queue]++]] = nextTime;
+                    states[queue] = State::Idle;
+                }
+                else
+                {
+                    remaining[queue] -= (nextTime - now) * rate;
+                }
+            }
+            else if (states[queue] == State::Waiting && eventTimes[queue] <= nextTime)
+            {
+                states[queue] = State::Running;
+                remaining[queue] = pCosts[_queueOrder[queue][next[queue]]];
+            }
+        }
+        now = nextTime;
+    }
+
+    assert(next[0] == _queueOrder[0].size() && next[1] == _queueOrder[1].size());
+    return now;
+}
+
+void AsyncComputeScheduler::plan(const RenderGraph &graph, SyncPlanner &planner) const
+{
+    planner.reset(2);
+    for (PassId pass : graph.order())
+    {
+        const RenderGraph::Pass &p = graph.pass(pass);
+        const SyncPlanner::PassId id = planner.addPass(_queues[pass], p.type);
+        for (RenderGraph::ResourceId version : p.reads)
+            planner.read(id, graph.resourceIndex(version));
+        for (RenderGraph::ResourceId version : p.writes)
+            planner.write(id, graph.resourceIndex(version));
+    }
+    planner.plan(false);
+}
@@ -0,0 +1,127 @@
+#include "BindlessTable.h"
+
+#include <cassert>
+
+#include "GpuMemory.h"
+
+BindlessTable::BindlessTable(MTL::Device *pDevice, uint32_t frameLatency)
+    : _pDevice(pDevice->retain()), _frameLatency(frameLatency), _textureSlots({MaxTextures, frameLatency}),
+      _samplerSlots({MaxSamplers, frameLatency}), _textures(MaxTextures, nullptr), _samplers(MaxSamplers, nullptr)
+{
+    MTL::ArgumentDescriptor *pTextures = MTL::ArgumentDescriptor::alloc()->init();
+    pTextures->setDataType(MTL::DataTypeTexture);
+    pTextures->setTextureType(MTL::TextureType2D);
+    pTextures->setAccess(MTL::BindingAccessReadOnly);
+    pTextures->setIndex(0);
+    pTextures->setArrayLength(MaxTextures);
+
+    MTL::ArgumentDescriptor *pSamplers = MTL::ArgumentDescriptor::alloc()->init();
+    pSamplers->setDataType(MTL::DataTypeSampler);
+    pSamplers->setIndex(MaxTextures);
+    pSamplers->setArrayLength(MaxSamplers);
+
+    const NS::Object *arguments[] = {pTextures, pSamplers};
+    _pArgumentEncoder = _pDevice->newArgumentEncoder(NS::Array::array(arguments, 2));
+    pTextures->release();
+    pSamplers->release();
+    assert(_pArgumentEncoder);
+
+    _pArgumentBuffer = GpuMemory::track(
+        _pDevice->newBuffer(_pArgumentEncoder->encodedLength(), MTL::ResourceStorageModeManaged),
+        MemoryCategory::ArgumentBuffers, "bindlessTable");
+    _pArgumentEncoder->setArgumentBuffer(_pArgumentBuffer, 0);
+}
+
+BindlessTable::~BindlessTable()
+{
+    for (const Removed &removed : _removed)
+        GpuMemory::release(removed.pObject);
+    for (MTL::Texture *pTexture : _textures)
+    {
+        if (pTexture)
+            GpuMemory::release(pTexture);
+    }
+    for (MTL::SamplerState *pSampler : _samplers)
+    {
+        if (pSampler)
+            pSampler->release();
+    }
+    GpuMemory::release(_pArgumentBuffer);
+    _pArgumentEncoder->release();
+    _pDevice->release();
+}
+
+void BindlessTable::beginFrame()
+{
+    ++_frame;
+    _textureSlots.beginFrame(_frame);
+    _samplerSlots.beginFrame(_frame);
+
+    size_t released = 0;
+    while (released < _removed.size() && _removed[released].frame + _frameLatency <= _frame)
+        GpuMemory::release(_removed[released++].pObject);
+    _removed.erase(_removed.begin(), _removed.begin() + released);
+}
+
+DescriptorTable::Handle BindlessTable::addTexture(MTL::Texture *pTexture)
+{
+    const DescriptorTable::Handle handle = _textureSlots.allocate();
+    if (handle == DescriptorTable::InvalidHandle)
+        return handle;
+
+    const uint32_t slot = DescriptorTable::index(handle);
+    _textures[slot] = pTexture->retain();
+    _pArgumentEncoder->setTexture(pTexture, slot);
+    // Entries are laid out as the device chooses, so the whole buffer is flushed.
+    _pArgumentBuffer->didModifyRange(NS::Range::Make(0, _pArgumentBuffer->length()));
+    _residentDirty = true;
+    return handle;
+}
+
+DescriptorTable::Handle BindlessTable::addSampler(MTL::SamplerState *pSampler)
+{
+    const DescriptorTable::Handle handle = _samplerSlots.allocate();
+    if (handle == DescriptorTable::InvalidHandle)
+        return handle;
+
+    const uint32_t slot = DescriptorTable::index(handle);
+    _samplers[slot] = pSampler->retain();
+    _pArgumentEncoder->setSamplerState(pSampler, MaxTextures + slot);
+    _pArgumentBuffer->didModifyRange(NS::Range::Make(0, _pArgumentBuffer->length()));
+    return handle;
+}
+
+// The entry is left as it is, and what it names is kept alive for the frames in flight that may still read it.
+void BindlessTable::removeTexture(DescriptorTable::Handle handle)
+{
+    _textureSlots.free(handle);
+    MTL::Texture *&pTexture = _textures[DescriptorTable::index(handle)];
+    _removed.push_back({pTexture, _frame});
+    pTexture = nullptr;
+    _residentDirty = true;
+}
+
+void BindlessTable::removeSampler(DescriptorTable::Handle handle)
+{
+    _samplerSlots.free(handle);
+    MTL::SamplerState *&pSampler = _samplers[DescriptorTable::index(handle)];
+    _removed.push_back({pSampler, _frame});
+    pSampler = nullptr;
+}
+
+void BindlessTable::useResources(MTL::RenderCommandEncoder *pEncoder)
+{
+    if (_residentDirty)
+    {
+        _residentTextures.clear();
+        for (MTL::Texture *pTexture : _textures)
+        {
+            if (pTexture)
+                _residentTextures.push_back(pTexture);
+        }
+        _residentDirty = false;
+    }
+    if (!_residentTextures.empty())
+        pEncoder->useResources(_residentTextures.data(), _residentTextures.size(), MTL::ResourceUsageRead,
+                               MTL::RenderStageFragment);
+}
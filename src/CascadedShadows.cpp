@@ -0,0 +1,222 @@
+#include "CascadedShadows.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "Float8.h"
+#include "JobSystem.h"
+
+using namespace SimdMath;
+
+namespace
+{
+const size_t ChunkSize = 16 * 1024;
+
+// Light-space bounds of every cascade, splatted for the eight-wide tests.
+struct CascadeTest {
+    Float8 centerX, centerY, halfSize, farDepth;
+};
+
+size_t writeVisible(uint32_t mask, size_t first, uint32_t *pOut)
+{
+    size_t written = 0;
+    while (mask)
+    {
+        pOut[written++] = uint32_t(first + __builtin_ctz(mask));
+        mask &= mask - 1;
+    }
+    return written;
+}
+} // namespace
+
+CascadedShadows::CascadedShadows(const Settings &settings) : _settings(settings)
+{
+    assert(settings.cascadeCount > 0 && settings.cascadeCount <= MaxCascades);
+    assert(settings.resolution > 2 && settings.shadowDistance > 0.0f);
+}
+
+void CascadedShadows::computeSplits(float nearZ, float farZ, uint32_t count, float lambda, float *pSplits)
+{
+    assert(nearZ > 0.0f && farZ > nearZ && count > 0);
+    for (uint32_t i = 0; i <= count; ++i)
+    {
+        const float t = float(i) / float(count);
+        const float logarithmic = nearZ * std::pow(farZ / nearZ, t);
+        const float uniform = nearZ + (farZ - nearZ) * t;
+        pSplits[i] = lambda * logarithmic + (1.0f - lambda) * uniform;
+    }
+    pSplits[0] = nearZ;
+    pSplits[count] = farZ;
+}
+
+CascadedShadows::Viewport CascadedShadows::viewport(uint32_t index) const
+{
+    const uint32_t size = _settings.resolution;
+    return {index % AtlasColumns * size, index / AtlasColumns * size, size};
+}
+
+uint32_t CascadedShadows::atlasWidth() const
+{
+    return std::min(_settings.cascadeCount, AtlasColumns) * _settings.resolution;
+}
+
+uint32_t CascadedShadows::atlasHeight() const
+{
+    return (_settings.cascadeCount + AtlasColumns - 1) / AtlasColumns * _settings.resolution;
+}
+
+void CascadedShadows::update(const Camera &camera, const float lightDirection[3])
+{
+    const uint32_t cascadeCount = _settings.cascadeCount;
+    const float resolution = float(_settings.resolution);
+
+    // The light's basis depends on nothing but its direction, so texel snapping in it stays put as the camera moves.
+    _lightForward = normalize(float3{lightDirection[0], lightDirection[1], lightDirection[2]});
+    const float3 reference = std::fabs(_lightForward.y) < 0.99f ? float3{0.0f, 1.0f, 0.0f} : float3{1.0f, 0.0f, 0.0f};
+    _lightRight = normalize(cross(_lightForward, reference));
+    _lightUp = cross(_lightRight, _lightForward);
+    const float4x4 lightView = {{{_lightRight.x, _lightUp.x, -_lightForward.x, 0.0f},
+                                 {_lightRight.y, _lightUp.y, -_lightForward.y, 0.0f},
+                                 {_lightRight.z, _lightUp.z, -_lightForward.z, 0.0f},
+                                 {0.0f, 0.0f, 0.0f, 1.0f}}};
+
+    // Camera position and axes from the rows of the world-to-view matrix.
+    const float *v = camera.viewMatrix;
+    const float3 right = {v[0], v[4], v[8]}, up = {v[1], v[5], v[9]}, back = {v[2], v[6], v[10]};
+    const float3 eye = -(right * v[12] + up * v[13] + back * v[14]);
+
+    const float tanHalfY = std::tan(0.5f * camera.fovY), tanHalfX = tanHalfY * camera.aspect;
+    // Squared slope of the frustum's corner rays away from its axis.
+    const float slope = tanHalfX * tanHalfX + tanHalfY * tanHalfY;
+
+    float splits[MaxCascades + 1];
+    computeSplits(camera.nearZ, _settings.shadowDistance, cascadeCount, _settings.splitLambda, splits);
+
+    for (uint32_t c = 0; c < cascadeCount; ++c)
+    {
+        // Smallest sphere around the slice between depths n and f: its center lies on the view axis, equally far from
+        // the near and far corners, unless that is beyond the far plane.
+        const float n = splits[c], f = splits[c + 1];
+        const float centerDepth = std::min(0.5f * (f + n) * (1.0f + slope), f);
+        const float farOffset = f - centerDepth;
+        // Rounded up so float noise in the rotation cannot change the projection's scale.
+        const float radius = std::ceil(std::sqrt(farOffset * farOffset + f * f * slope) * 16.0f) / 16.0f;
+        const float3 center = eye - back * centerDepth;
+
+        // Snapping moves the center by up to a texel, so the sides keep a texel of margin around the sphere.
+        const float texelSize = 2.0f * radius / (resolution - 2.0f);
+        const float halfSize = radius + texelSize;
+        Bounds &bounds = _bounds[c];
+        bounds.centerX = std::floor(dot(center, _lightRight) / texelSize) * texelSize;
+        bounds.centerY = std::floor(dot(center, _lightUp) / texelSize) * texelSize;
+        bounds.halfSize = halfSize;
+        const float depth = dot(center, _lightForward);
+        bounds.farDepth = depth + radius;
+
+        const float4x4 projection = float4x4::orthographic(
+            bounds.centerX - halfSize, bounds.centerX + halfSize, bounds.centerY - halfSize, bounds.centerY + halfSize,
+            depth - radius - _settings.casterMargin, bounds.farDepth);
+
+        ShadowCascade &cascade = _cascades[c];
+        cascade.lightViewProjection = projection * lightView;
+        const Viewport tile = viewport(c);
+        const float width = float(atlasWidth()), height = float(atlasHeight());
+        cascade.atlasScaleOffset[0] = 0.5f * resolution / width;
+        cascade.atlasScaleOffset[1] = -0.5f * resolution / height;
+        cascade.atlasScaleOffset[2] = (0.5f * resolution + float(tile.x)) / width;
+        cascade.atlasScaleOffset[3] = (0.5f * resolution + float(tile.y)) / height;
+        cascade.splitDepth = f;
+        cascade.texelSize = texelSize;
+    }
+}
+
+void CascadedShadows::cullCasters(const FrustumCulling::SphereSoA &casters, size_t count, uint32_t *const *ppVisible,
+                                  size_t *pCounts, JobSystem *pJobs) const
+{
+    const uint32_t cascadeCount = _settings.cascadeCount;
+    CascadeTest tests[MaxCascades];
+    for (uint32_t c = 0; c < cascadeCount; ++c)
+        tests[c] = {Float8::set(_bounds[c].centerX), Float8::set(_bounds[c].centerY),
+                    Float8::set(_bounds[c].halfSize), Float8::set(_bounds[c].farDepth)};
+    const Float8 rightX = Float8::set(_lightRight.x), rightY = Float8::set(_lightRight.y),
+                 rightZ = Float8::set(_lightRight.z);
+    const Float8 upX = Float8::set(_lightUp.x), upY = Float8::set(_lightUp.y), upZ = Float8::set(_lightUp.z);
+    const Float8 forwardX = Float8::set(_lightForward.x), forwardY = Float8::set(_lightForward.y),
+                 forwardZ = Float8::set(_lightForward.z);
+
+    // Casters are moved into light space once and tested against every cascade. Within a cascade's sides the sphere's
+    // light-space box is tested, which only keeps a few extra casters near its corners.
+    auto test = [&](const float *pX, const float *pY, const float *pZ, const float *pRadius, uint32_t *pMasks) {
+        const Float8 x = Float8::load(pX), y = Float8::load(pY), z = Float8::load(pZ);
+        const Float8 radius = Float8::load(pRadius);
+        const Float8 lightX = x * rightX + y * rightY + z * rightZ;
+        const Float8 lightY = x * upX + y * upY + z * upZ;
+        const Float8 nearDepth = x * forwardX + y * forwardY + z * forwardZ - radius;
+        for (uint32_t c = 0; c < cascadeCount; ++c)
+        {
+            const CascadeTest &t = tests[c];
+            const Float8 reach = t.halfSize + radius;
+            const Float8 dx = Float8::max(lightX - t.centerX, t.centerX - lightX);
+            const Float8 dy = Float8::max(lightY - t.centerY, t.centerY - lightY);
+            pMasks[c] = (reach - dx).nonNegativeMask() & (reach - dy).nonNegativeMask() &
+                        (t.farDepth - nearDepth).nonNegativeMask();
+        }
+    };
+
+    auto cullRange = [&](size_t begin, size_t end, size_t *pRangeCounts) {
+        uint32_t masks[MaxCascades];
+        std::fill(pRangeCounts, pRangeCounts + cascadeCount, 0);
+        size_t first = begin;
+        for (; first + 8 <= end; first += 8)
+        {
+            test(casters.x + first, casters.y + first, casters.z + first, casters.radius + first, masks);
+            for (uint32_t c = 0; c < cascadeCount; ++c)
+                pRangeCounts[c] += writeVisible(masks[c], first, ppVisible[c] + begin + pRangeCounts[c]);
+        }
+        if (first < end)
+        {
+            const size_t lanes = end - first;
+            float storage[4][8] = {};
+            memcpy(storage[0], casters.x + first, lanes * sizeof(float));
+            memcpy(storage[1], casters.y + first, lanes * sizeof(float));
+            memcpy(storage[2], casters.z + first, lanes * sizeof(float));
+            memcpy(storage[3], casters.radius + first, lanes * sizeof(float));
+            test(storage[0], storage[1], storage[2], storage[3], masks);
+            for (uint32_t c = 0; c < cascadeCount; ++c)
+                pRangeCounts[c] += writeVisible(masks[c] & ((1u << lanes) - 1), first,
+                                                ppVisible[c] + begin + pRangeCounts[c]);
+        }
+    };
+
+    if (!pJobs || count <= ChunkSize)
+    {
+        cullRange(0, count, pCounts);
+        return;
+    }
+
+    // Each chunk compacts into its own slice of every cascade's list; the slices are then moved together in order.
+    const size_t chunkCount = (count + ChunkSize - 1) / ChunkSize;
+    std::vector<size_t> chunkVisible(chunkCount * MaxCascades);
+    pJobs->parallelFor(chunkCount, 1, [&](size_t firstChunk, size_t lastChunk) {
+        for (size_t chunk = firstChunk; chunk < lastChunk; ++chunk)
+        {
+            const size_t begin = chunk * ChunkSize;
+            cullRange(begin, std::min(begin + ChunkSize, count), &chunkVisible[chunk * MaxCascades]);
+        }
+    });
+
+    for (uint32_t c = 0; c < cascadeCount; ++c)
+    {
+        size_t visibleCount = chunkVisible[c];
+        for (size_t chunk = 1; chunk < chunkCount; ++chunk)
+        {
+            const size_t chunkCasters = chunkVisible[chunk * MaxCascades + c];
+            memmove(ppVisible[c] + visibleCount, ppVisible[c] + chunk * ChunkSize, chunkCasters * sizeof(uint32_t));
+            visibleCount += chunkCasters;
+        }
+        pCounts[c] = visibleCount;
+    }
+}
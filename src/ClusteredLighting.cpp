@@ -0,0 +1,235 @@
+#include "ClusteredLighting.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#include "Float8.h"
+#include "JobSystem.h"
+
+namespace
+{
+const size_t ChunkSize = 1024;
+// Buffer offsets bound to constant address space arguments must be multiples of 256 bytes on macOS.
+const size_t SectionAlignment = 256;
+
+size_t alignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// floor(value) clamped to [0, count - 1], safe for values far outside the int range. Clamping first makes the
+// conversion's truncation a floor, without the library call std::floor is on SSE2.
+uint32_t clampedCell(float value, uint32_t count)
+{
+    return uint32_t(std::clamp(value, 0.0f, float(count - 1)));
+}
+
+template <typename Function> void forEachChunk(size_t chunkCount, JobSystem *pJobs, const Function &function)
+{
+    auto run = [&](size_t firstChunk, size_t lastChunk) {
+        for (size_t chunk = firstChunk; chunk < lastChunk; ++chunk)
+            function(chunk);
+    };
+    if (pJobs && chunkCount > 1)
+        pJobs->parallelFor(chunkCount, 1, run);
+    else
+        run(0, chunkCount);
+}
+} // namespace
+
+LightClusters::LightClusters(const Settings &settings)
+    : _settings(settings), _clusterCount(size_t(settings.countX) * settings.countY * settings.countZ)
+{
+    // Pairs pack the cluster and the light into 16 bits each.
+    assert(_clusterCount > 0 && _clusterCount <= 65536);
+
+    const size_t padded = _clusterCount + 8;
+    for (std::vector<float> *pBounds : {&_minX, &_minY, &_minDepth, &_maxX, &_maxY, &_maxDepth})
+        pBounds->assign(padded, 0.0f);
+    _ranges.resize(_clusterCount);
+    setProjection(1.0f, 1.0f, 1.0f, _nearZ, _farZ);
+}
+
+void LightClusters::setProjection(float fovY, float viewportWidth, float viewportHeight, float nearZ, float farZ)
+{
+    assert(nearZ > 0.0f && farZ > nearZ && viewportWidth > 0.0f && viewportHeight > 0.0f);
+
+    const uint32_t countX = _settings.countX, countY = _settings.countY, countZ = _settings.countZ;
+    _tanHalfY = std::tan(0.5f * fovY);
+    _tanHalfX = _tanHalfY * viewportWidth / viewportHeight;
+    _inverseTanHalfX = 1.0f / _tanHalfX;
+    _inverseTanHalfY = 1.0f / _tanHalfY;
+    _nearZ = nearZ;
+    _farZ = farZ;
+
+    const float logDepthRange = std::log2(farZ / nearZ);
+    _grid = {countX,
+             countY,
+             countZ,
+             0,
+             float(countX) / viewportWidth,
+             float(countY) / viewportHeight,
+             float(countZ) / logDepthRange,
+             -float(countZ) * std::log2(nearZ) / logDepthRange};
+
+    // Tile edges are planes through the eye, so a cluster's extent along x and y is widest at one of its depths.
+    for (uint32_t z = 0; z < countZ; ++z)
+    {
+        const float depth0 = nearZ * std::pow(farZ / nearZ, float(z) / float(countZ));
+        const float depth1 = nearZ * std::pow(farZ / nearZ, float(z + 1) / float(countZ));
+        for (uint32_t y = 0; y < countY; ++y)
+        {
+            const float top = (1.0f - 2.0f * float(y) / float(countY)) * _tanHalfY;
+            const float bottom = (1.0f - 2.0f * float(y + 1) / float(countY)) * _tanHalfY;
+            for (uint32_t x = 0; x < countX; ++x)
+            {
+                const float left = (-1.0f + 2.0f * float(x) / float(countX)) * _tanHalfX;
+                const float right = (-1.0f + 2.0f * float(x + 1) / float(countX)) * _tanHalfX;
+
+                const size_t cluster = (size_t(z) * countY + y) * countX + x;
+                _minX[cluster] = std::min(left * depth0, left * depth1);
+                _maxX[cluster] = std::max(right * depth0, right * depth1);
+                _minY[cluster] = std::min(bottom * depth0, bottom * depth1);
+                _maxY[cluster] = std::max(top * depth0, top * depth1);
+                _minDepth[cluster] = depth0;
+                _maxDepth[cluster] = depth1;
+            }
+        }
+    }
+}
+
+uint32_t LightClusters::sliceOf(float depth) const
+{
+    return clampedCell(std::log2(depth) * _grid.depthScale + _grid.depthBias, _settings.countZ);
+}
+
+void LightClusters::binLights(const float *m, size_t chunk, size_t begin, size_t end)
+{
+    const uint32_t countX = _settings.countX, countY = _settings.countY;
+    std::vector<uint32_t> &pairs = _chunkPairs[chunk];
+    uint32_t *pCounts = _chunkOffsets.data() + chunk * _clusterCount;
+    pairs.clear();
+
+    for (size_t light = begin; light < end; ++light)
+    {
+        const float *p = _pLights[light].position;
+        const float radius = _pLights[light].radius;
+        const float x = m[0] * p[0] + m[4] * p[1] + m[8] * p[2] + m[12];
+        const float y = m[1] * p[0] + m[5] * p[1] + m[9] * p[2] + m[13];
+        const float depth = -(m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14]);
+        if (depth + radius < _nearZ || depth - radius > _farZ)
+            continue;
+
+        // Screen rectangle of the sphere's view-space box, whose x / depth and y / depth are extreme at its nearest
+        // or farthest depth.
+        const float nearDepth = std::max(depth - radius, _nearZ), farDepth = depth + radius;
+        const float inverseNear = 1.0f / nearDepth, inverseFar = 1.0f / farDepth;
+        const float left = std::min((x - radius) * inverseNear, (x - radius) * inverseFar) * _inverseTanHalfX;
+        const float right = std::max((x + radius) * inverseNear, (x + radius) * inverseFar) * _inverseTanHalfX;
+        const float bottom = std::min((y - radius) * inverseNear, (y - radius) * inverseFar) * _inverseTanHalfY;
+        const float top = std::max((y + radius) * inverseNear, (y + radius) * inverseFar) * _inverseTanHalfY;
+        if (right < -1.0f || left > 1.0f || top < -1.0f || bottom > 1.0f)
+            continue;
+
+        const uint32_t x0 = clampedCell((left + 1.0f) * 0.5f * float(countX), countX);
+        const uint32_t x1 = clampedCell((right + 1.0f) * 0.5f * float(countX), countX);
+        const uint32_t y0 = clampedCell((1.0f - top) * 0.5f * float(countY), countY);
+        const uint32_t y1 = clampedCell((1.0f - bottom) * 0.5f * float(countY), countY);
+        const uint32_t z0 = sliceOf(nearDepth), z1 = sliceOf(std::min(farDepth, _farZ));
+
+        // Sphere against the clusters' boxes, eight along x at a time.
+        const Float8 centerX = Float8::set(x), centerY = Float8::set(y), centerDepth = Float8::set(depth);
+        const Float8 radiusSquared = Float8::set(radius * radius), zero = Float8::set(0.0f);
+        auto distance = [&zero](Float8 center, const float *pMin, const float *pMax) {
+            return Float8::max(Float8::max(Float8::load(pMin) - center, center - Float8::load(pMax)), zero);
+        };
+        for (uint32_t z = z0; z <= z1; ++z)
+        {
+            for (uint32_t y = y0; y <= y1; ++y)
+            {
+                const size_t row = (size_t(z) * countY + y) * countX;
+                for (uint32_t first = x0; first <= x1; first += 8)
+                {
+                    const size_t cluster = row + first;
+                    const Float8 dx = distance(centerX, &_minX[cluster], &_maxX[cluster]);
+                    const Float8 dy = distance(centerY, &_minY[cluster], &_maxY[cluster]);
+                    const Float8 dz = distance(centerDepth, &_minDepth[cluster], &_maxDepth[cluster]);
+                    uint32_t mask = (radiusSquared - (dx * dx + dy * dy + dz * dz)).nonNegativeMask();
+                    if (x1 - first < 7)
+                        mask &= (2u << (x1 - first)) - 1;
+                    while (mask)
+                    {
+                        const uint32_t hit = uint32_t(cluster) + __builtin_ctz(mask);
+                        pairs.push_back(hit << 16 | uint32_t(light));
+                        ++pCounts[hit];
+                        mask &= mask - 1;
+                    }
+                }
+            }
+        }
+    }
+}
+
+size_t LightClusters::build(const float *viewMatrix, const LightComponent *pLights, size_t count, JobSystem *pJobs)
+{
+    count = std::min<size_t>(count, MaxLights);
+    _pLights = pLights;
+    _lightCount = count;
+    _grid.lightCount = uint32_t(count);
+    _chunkCount = (count + ChunkSize - 1) / ChunkSize;
+    if (_chunkPairs.size() < _chunkCount)
+        _chunkPairs.resize(_chunkCount);
+    _chunkOffsets.assign(_chunkCount * _clusterCount, 0);
+
+    forEachChunk(_chunkCount, pJobs, [&](size_t chunk) {
+        binLights(viewMatrix, chunk, chunk * ChunkSize, std::min((chunk + 1) * ChunkSize, count));
+    });
+
+    // Cluster-major prefix sum: each chunk's share of a cluster's list follows the previous chunk's.
+    uint32_t offset = 0;
+    for (size_t cluster = 0; cluster < _clusterCount; ++cluster)
+    {
+        _ranges[cluster].offset = offset;
+        for (size_t chunk = 0; chunk < _chunkCount; ++chunk)
+        {
+            uint32_t &entry = _chunkOffsets[chunk * _clusterCount + cluster];
+            const uint32_t chunkLights = entry;
+            entry = offset;
+            offset += chunkLights;
+        }
+        _ranges[cluster].count = offset - _ranges[cluster].offset;
+    }
+    _indexCount = offset;
+    return count;
+}
+
+LightClusters::Layout LightClusters::layout() const
+{
+    Layout layout;
+    layout.gridOffset = 0;
+    layout.lightsOffset = alignUp(sizeof(ClusterGrid), SectionAlignment);
+    layout.rangesOffset = alignUp(layout.lightsOffset + _lightCount * sizeof(LightComponent), SectionAlignment);
+    layout.indicesOffset = alignUp(layout.rangesOffset + _clusterCount * sizeof(ClusterRange), SectionAlignment);
+    layout.size = layout.indicesOffset + std::max<size_t>(_indexCount, 1) * sizeof(uint16_t);
+    return layout;
+}
+
+void LightClusters::write(void *pDestination, JobSystem *pJobs) const
+{
+    const Layout sections = layout();
+    uint8_t *pBytes = static_cast<uint8_t *>(pDestination);
+    memcpy(pBytes + sections.gridOffset, &_grid, sizeof(_grid));
+    if (_lightCount)
+        memcpy(pBytes + sections.lightsOffset, _pLights, _lightCount * sizeof(LightComponent));
+    memcpy(pBytes + sections.rangesOffset, _ranges.data(), _clusterCount * sizeof(ClusterRange));
+
+    uint16_t *pIndices = reinterpret_cast<uint16_t *>(pBytes + sections.indicesOffset);
+    forEachChunk(_chunkCount, pJobs, [&](size_t chunk) {
+        std::vector<uint32_t> cursor(_chunkOffsets.begin() + chunk * _clusterCount,
+                                     _chunkOffsets.begin() + (chunk + 1) * _clusterCount);
+        for (uint32_t pair : _chunkPairs[chunk])
+            pIndices[cursor[pair >> 16]++] = uint16_t(pair);
+    });
+}
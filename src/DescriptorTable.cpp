@@ -0,0 +1,74 @@
+#include "DescriptorTable.h"
+
+#include <cassert>
+
+DescriptorTable::DescriptorTable(const Settings &settings) : _settings(settings)
+{
+    assert(settings.capacity > 0 && settings.capacity <= MaxCapacity);
+    _nextFree.resize(settings.capacity);
+    _generations.assign(settings.capacity, 1);
+    _allocated.assign(settings.capacity, false);
+}
+
+void DescriptorTable::beginFrame(uint64_t frame)
+{
+    _frame = frame;
+
+    // Oldest first, so the slots that are ready are a prefix.
+    while (_retiredHead < _retired.size() && _retired[_retiredHead].frame + _settings.frameLatency <= frame)
+    {
+        const uint32_t index = _retired[_retiredHead++].index;
+        _nextFree[index] = _freeHead;
+        _freeHead = index;
+    }
+    // Slots are freed every frame, so the list is rarely drained; drop the released prefix once it is the larger half.
+    if (_retiredHead > _retired.size() / 2)
+    {
+        _retired.erase(_retired.begin(), _retired.begin() + _retiredHead);
+        _retiredHead = 0;
+    }
+}
+
+DescriptorTable::Handle DescriptorTable::allocate()
+{
+    // Freed slots first, so the part of the table in use stays compact.
+    uint32_t index;
+    if (_freeHead != EndOfList)
+    {
+        index = _freeHead;
+        _freeHead = _nextFree[index];
+    }
+    else if (_highWater < _settings.capacity)
+    {
+        index = _highWater++;
+    }
+    else
+    {
+        return InvalidHandle;
+    }
+
+    _allocated[index] = true;
+    ++_allocatedCount;
+    return (_generations[index] << IndexBits) | index;
+}
+
+void DescriptorTable::free(Handle handle)
+{
+    assert(valid(handle));
+    const uint32_t index = DescriptorTable::index(handle);
+    _allocated[index] = false;
+    --_allocatedCount;
+
+    // Generation 0 is skipped when it wraps, so no handle is ever InvalidHandle.
+    uint32_t &generation = _generations[index];
+    generation = (generation + 1) & GenerationMask;
+    if (generation == 0)
+        generation = 1;
+
+    _retired.push_back({index, _frame});
+}
+
+DescriptorTable::Stats DescriptorTable::stats() const
+{
+    return {_settings.capacity, _allocatedCount, uint32_t(_retired.size() - _retiredHead), _highWater};
+}
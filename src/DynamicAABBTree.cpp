@@ -0,0 +1,609 @@
+#include "DynamicAABBTree.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace
+{
+// Motion prediction: fat bounds are stretched this many frames of displacement ahead.
+const float DisplacementMultiplier = 4.0f;
+// Fat bounds larger than the fresh ones grown by this many margins are considered stale and the proxy reinserted.
+const float HugeMarginMultiplier = 4.0f;
+// Traversal stacks live on the stack; AVL balancing keeps the height around 1.44 log2(n).
+const int MaxStackDepth = 256;
+
+AABB combine(const AABB &a, const AABB &b)
+{
+    return {std::min(a.minX, b.minX), std::min(a.minY, b.minY), std::min(a.minZ, b.minZ),
+            std::max(a.maxX, b.maxX), std::max(a.maxY, b.maxY), std::max(a.maxZ, b.maxZ)};
+}
+
+bool contains(const AABB &outer, const AABB &inner)
+{
+    return outer.minX <= inner.minX && outer.minY <= inner.minY && outer.minZ <= inner.minZ &&
+           inner.maxX <= outer.maxX && inner.maxY <= outer.maxY && inner.maxZ <= outer.maxZ;
+}
+
+bool overlaps(const AABB &a, const AABB &b)
+{
+    return a.minX <= b.maxX && b.minX <= a.maxX && a.minY <= b.maxY && b.minY <= a.maxY && a.minZ <= b.maxZ &&
+           b.minZ <= a.maxZ;
+}
+
+// Half the surface area, which is all the insertion cost needs.
+float area(const AABB &b)
+{
+    const float x = b.maxX - b.minX, y = b.maxY - b.minY, z = b.maxZ - b.minZ;
+    return x * y + y * z + z * x;
+}
+
+AABB expand(const AABB &b, float margin)
+{
+    return {b.minX - margin, b.minY - margin, b.minZ - margin, b.maxX + margin, b.maxY + margin, b.maxZ + margin};
+}
+
+enum class Containment { Outside, Intersecting, Inside };
+
+Containment classify(const Frustum &frustum, const AABB &b)
+{
+    Containment result = Containment::Inside;
+    for (const Plane &p : frustum.planes)
+    {
+        const float px = p.nx >= 0.0f ? b.maxX : b.minX, nx = p.nx >= 0.0f ? b.minX : b.maxX;
+        const float py = p.ny >= 0.0f ? b.maxY : b.minY, ny = p.ny >= 0.0f ? b.minY : b.maxY;
+        const float pz = p.nz >= 0.0f ? b.maxZ : b.minZ, nz = p.nz >= 0.0f ? b.minZ : b.maxZ;
+        if (p.signedDistance(px, py, pz) < 0.0f)
+            return Containment::Outside;
+        if (p.signedDistance(nx, ny, nz) < 0.0f)
+            result = Containment::Intersecting;
+    }
+    return result;
+}
+
+// Slab test; returns the entry distance, or a negative value on a miss.
+float intersectRay(const AABB &b, const float origin[3], const float inverseDirection[3], float maxDistance)
+{
+    const float *pMin = &b.minX, *pMax = &b.maxX;
+    float tMin = 0.0f, tMax = maxDistance;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float t0 = (pMin[axis] - origin[axis]) * inverseDirection[axis];
+        float t1 = (pMax[axis] - origin[axis]) * inverseDirection[axis];
+        if (t0 > t1)
+            std::swap(t0, t1);
+        // Written so that NaNs from a ray lying in a slab plane keep the current interval.
+        tMin = t0 > tMin ? t0 : tMin;
+        tMax = t1 < tMax ? t1 : tMax;
+        if (tMin > tMax)
+            return -1.0f;
+    }
+    return tMin;
+}
+} // namespace
+
+DynamicAABBTree::DynamicAABBTree(float margin) : _margin(margin)
+{
+}
+
+DynamicAABBTree::ProxyId DynamicAABBTree::insert(const AABB &bounds, uint32_t userData)
+{
+    ProxyId proxy;
+    if (_freeProxies != NullNode)
+    {
+        proxy = _freeProxies;
+        _freeProxies = _proxies[proxy].node;
+    }
+    else
+    {
+        proxy = ProxyId(_proxies.size());
+        _proxies.emplace_back();
+    }
+
+    const uint32_t leaf = allocateNode();
+    _nodes[leaf].bounds = expand(bounds, _margin);
+    _nodes[leaf].proxy = proxy;
+    _nodes[leaf].userData = userData;
+    _proxies[proxy] = {bounds, leaf, userData};
+    insertLeaf(leaf);
+    ++_proxyCount;
+    return proxy;
+}
+
+void DynamicAABBTree::remove(ProxyId proxy)
+{
+    assert(proxy < _proxies.size() && _proxies[proxy].node < _nodes.size());
+
+    const uint32_t leaf = _proxies[proxy].node;
+    removeLeaf(leaf);
+    freeNode(leaf);
+    _proxies[proxy].node = _freeProxies;
+    _freeProxies = proxy;
+    --_proxyCount;
+}
+
+bool DynamicAABBTree::move(ProxyId proxy, const AABB &bounds, const float displacement[3])
+{
+    assert(proxy < _proxies.size());
+
+    _proxies[proxy].bounds = bounds;
+    const uint32_t leaf = _proxies[proxy].node;
+
+    AABB fat = expand(bounds, _margin);
+    if (displacement)
+    {
+        float *pMin = &fat.minX, *pMax = &fat.maxX;
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            const float d = displacement[axis] * DisplacementMultiplier;
+            (d < 0.0f ? pMin[axis] : pMax[axis]) += d;
+        }
+    }
+
+    const AABB &current = _nodes[leaf].bounds;
+    if (contains(current, bounds) && contains(expand(fat, HugeMarginMultiplier * _margin), current))
+        return false;
+
+    removeLeaf(leaf);
+    _nodes[leaf].bounds = fat;
+    insertLeaf(leaf);
+    return true;
+}
+
+void DynamicAABBTree::setBounds(ProxyId proxy, const AABB &bounds)
+{
+    assert(proxy < _proxies.size());
+
+    _proxies[proxy].bounds = bounds;
+    _nodes[_proxies[proxy].node].bounds = expand(bounds, _margin);
+}
+
+void DynamicAABBTree::refit()
+{
+    if (_topologyChanged)
+        relayout();
+
+    // Children follow their parent, so a reverse sweep sees them refitted first.
+    for (size_t i = _nodes.size(); i-- > 0;)
+    {
+        Node &n = _nodes[i];
+        if (!n.isLeaf())
+            n.bounds = combine(_nodes[n.child1].bounds, _nodes[n.child2].bounds);
+    }
+}
+
+// Renumbers the nodes in depth-first preorder, dropping free ones.
+void DynamicAABBTree::relayout()
+{
+    _topologyChanged = false;
+    _freeNodes = NullNode;
+    if (_root == NullNode)
+    {
+        _nodes.clear();
+        return;
+    }
+
+    std::vector<uint32_t> newIndex(_nodes.size(), NullNode);
+    std::vector<Node> nodes;
+    nodes.reserve(2 * _proxyCount - 1);
+
+    std::vector<uint32_t> stack;
+    stack.push_back(_root);
+    while (!stack.empty())
+    {
+        const uint32_t node = stack.back();
+        stack.pop_back();
+        newIndex[node] = uint32_t(nodes.size());
+        nodes.push_back(_nodes[node]);
+
+        const Node &n = _nodes[node];
+        if (!n.isLeaf())
+        {
+            stack.push_back(n.child2);
+            stack.push_back(n.child1);
+        }
+    }
+
+    for (Node &n : nodes)
+    {
+        n.parent = n.parent == NullNode ? NullNode : newIndex[n.parent];
+        if (n.isLeaf())
+        {
+            _proxies[n.proxy].node = uint32_t(&n - nodes.data());
+        }
+        else
+        {
+            n.child1 = newIndex[n.child1];
+            n.child2 = newIndex[n.child2];
+        }
+    }
+
+    _nodes.swap(nodes);
+    _root = 0;
+}
+
+void DynamicAABBTree::queryOverlap(const AABB &bounds, std::vector<uint32_t> &results) const
+{
+    if (_root == NullNode)
+        return;
+
+    uint32_t stack[MaxStackDepth];
+    int top = 0;
+    stack[top++] = _root;
+    while (top > 0)
+    {
+        const uint32_t node = stack[--top];
+        const Node &n = _nodes[node];
+        if (!overlaps(n.bounds, bounds))
+            continue;
+
+        if (n.isLeaf())
+        {
+            if (overlaps(_proxies[n.proxy].bounds, bounds))
+                results.push_back(n.userData);
+        }
+        else
+        {
+            assert(top + 2 <= MaxStackDepth);
+            stack[top++] = n.child1;
+            stack[top++] = n.child2;
+        }
+    }
+}
+
+void DynamicAABBTree::queryFrustum(const Frustum &frustum, std::vector<uint32_t> &results) const
+{
+    if (_root == NullNode)
+        return;
+
+    uint32_t stack[MaxStackDepth];
+    int top = 0;
+    stack[top++] = _root;
+    while (top > 0)
+    {
+        const uint32_t node = stack[--top];
+        const Node &n = _nodes[node];
+        if (n.isLeaf())
+        {
+            if (frustum.intersects(_proxies[n.proxy].bounds))
+                results.push_back(n.userData);
+            continue;
+        }
+
+        const Containment containment = classify(frustum, n.bounds);
+        if (containment == Containment::Outside)
+            continue;
+        if (containment == Containment::Inside)
+        {
+            // Exact bounds lie inside the fat ones, which lie inside their ancestors', so the whole subtree is visible.
+            collectLeaves(node, results);
+            continue;
+        }
+
+        assert(top + 2 <= MaxStackDepth);
+        stack[top++] = n.child1;
+        stack[top++] = n.child2;
+    }
+}
+
+void DynamicAABBTree::collectLeaves(uint32_t node, std::vector<uint32_t> &results) const
+{
+    uint32_t stack[MaxStackDepth];
+    int top = 0;
+    stack[top++] = node;
+    while (top > 0)
+    {
+        const Node &n = _nodes[stack[--top]];
+        if (n.isLeaf())
+        {
+            results.push_back(n.userData);
+        }
+        else
+        {
+            assert(top + 2 <= MaxStackDepth);
+            stack[top++] = n.child1;
+            stack[top++] = n.child2;
+        }
+    }
+}
+
+DynamicAABBTree::ProxyId DynamicAABBTree::pick(const float origin[3], const float direction[3], float maxDistance,
+                                               float *pDistance) const
+{
+    if (_root == NullNode)
+        return InvalidProxy;
+
+    const float inverseDirection[3] = {1.0f / direction[0], 1.0f / direction[1], 1.0f / direction[2]};
+
+    struct Entry {
+        uint32_t node;
+        float distance;
+    };
+    Entry stack[MaxStackDepth];
+    int top = 0;
+
+    ProxyId best = InvalidProxy;
+    float bestDistance = maxDistance;
+
+    const float rootDistance = intersectRay(_nodes[_root].bounds, origin, inverseDirection, bestDistance);
+    if (rootDistance >= 0.0f)
+        stack[top++] = {_root, rootDistance};
+
+    while (top > 0)
+    {
+        const Entry entry = stack[--top];
+        if (entry.distance > bestDistance)
+            continue;
+
+        const Node &n = _nodes[entry.node];
+        if (n.isLeaf())
+        {
+            const float distance = intersectRay(_proxies[n.proxy].bounds, origin, inverseDirection, bestDistance);
+            if (distance >= 0.0f)
+            {
+                best = n.proxy;
+                bestDistance = distance;
+            }
+            continue;
+        }
+
+        // Visit the nearer child first so that its hits prune the other one.
+        Entry near = {n.child1, intersectRay(_nodes[n.child1].bounds, origin, inverseDirection, bestDistance)};
+        Entry far = {n.child2, intersectRay(_nodes[n.child2].bounds, origin, inverseDirection, bestDistance)};
+        if (far.distance >= 0.0f && (near.distance < 0.0f || far.distance < near.distance))
+            std::swap(near, far);
+
+        assert(top + 2 <= MaxStackDepth);
+        if (far.distance >= 0.0f)
+            stack[top++] = far;
+        if (near.distance >= 0.0f)
+            stack[top++] = near;
+    }
+
+    if (pDistance && best != InvalidProxy)
+        *pDistance = bestDistance;
+    return best;
+}
+
+int DynamicAABBTree::height() const
+{
+    return _root == NullNode ? 0 : _nodes[_root].height;
+}
+
+float DynamicAABBTree::areaRatio() const
+{
+    if (_root == NullNode)
+        return 0.0f;
+
+    const float rootArea = area(_nodes[_root].bounds);
+    float totalArea = 0.0f;
+    for (const Node &n : _nodes)
+    {
+        if (n.height > 0)
+            totalArea += area(n.bounds);
+    }
+    return rootArea > 0.0f ? totalArea / rootArea : 0.0f;
+}
+
+bool DynamicAABBTree::validate() const
+{
+    if (_root == NullNode)
+        return _proxyCount == 0;
+    if (_nodes[_root].parent != NullNode)
+        return false;
+
+    size_t leaves = 0;
+    std::vector<uint32_t> stack = {_root};
+    while (!stack.empty())
+    {
+        const uint32_t node = stack.back();
+        stack.pop_back();
+        const Node &n = _nodes[node];
+        if (n.isLeaf())
+        {
+            if (n.height != 0 || n.proxy >= _proxies.size() || _proxies[n.proxy].node != node ||
+                !contains(n.bounds, _proxies[n.proxy].bounds))
+                return false;
+            ++leaves;
+            continue;
+        }
+
+        const Node &c1 = _nodes[n.child1];
+        const Node &c2 = _nodes[n.child2];
+        if (c1.parent != node || c2.parent != node || n.height != 1 + std::max(c1.height, c2.height) ||
+            std::abs(c1.height - c2.height) > 1 || !contains(n.bounds, c1.bounds) || !contains(n.bounds, c2.bounds))
+            return false;
+        stack.push_back(n.child1);
+        stack.push_back(n.child2);
+    }
+    return leaves == _proxyCount;
+}
+
+uint32_t DynamicAABBTree::allocateNode()
+{
+    uint32_t node;
+    if (_freeNodes != NullNode)
+    {
+        node = _freeNodes;
+        _freeNodes = _nodes[node].parent;
+    }
+    else
+    {
+        node = uint32_t(_nodes.size());
+        _nodes.emplace_back();
+    }
+
+    Node &n = _nodes[node];
+    n.parent = NullNode;
+    n.child1 = NullNode;
+    n.child2 = NullNode;
+    n.height = 0;
+    n.proxy = NullNode;
+    n.userData = 0;
+    return node;
+}
+
+void DynamicAABBTree::freeNode(uint32_t node)
+{
+    _nodes[node].parent = _freeNodes;
+    _nodes[node].height = -1;
+    _nodes[node].child1 = NullNode;
+    _freeNodes = node;
+}
+
+void DynamicAABBTree::insertLeaf(uint32_t leaf)
+{
+    _topologyChanged = true;
+    if (_root == NullNode)
+    {
+        _root = leaf;
+        _nodes[leaf].parent = NullNode;
+        return;
+    }
+
+    // Descend towards the sibling with the lowest surface-area cost: creating a new parent at a node costs the
+    // combined area, and every level passed on the way down grows by the leaf's bounds.
+    const AABB leafBounds = _nodes[leaf].bounds;
+    uint32_t sibling = _root;
+    while (!_nodes[sibling].isLeaf())
+    {
+        const Node &n = _nodes[sibling];
+        const float combinedArea = area(combine(n.bounds, leafBounds));
+        const float cost = 2.0f * combinedArea;
+        const float inheritanceCost = 2.0f * (combinedArea - area(n.bounds));
+
+        auto descendCost = [&](uint32_t child) {
+            const Node &c = _nodes[child];
+            const float grown = area(combine(c.bounds, leafBounds));
+            return (c.isLeaf() ? grown : grown - area(c.bounds)) + inheritanceCost;
+        };
+        const float cost1 = descendCost(n.child1);
+        const float cost2 = descendCost(n.child2);
+
+        if (cost < cost1 && cost < cost2)
+            break;
+        sibling = cost1 < cost2 ? n.child1 : n.child2;
+    }
+
+    const uint32_t oldParent = _nodes[sibling].parent;
+    const uint32_t newParent = allocateNode();
+    Node &p = _nodes[newParent];
+    p.parent = oldParent;
+    p.bounds = combine(leafBounds, _nodes[sibling].bounds);
+    p.height = _nodes[sibling].height + 1;
+    p.child1 = sibling;
+    p.child2 = leaf;
+    _nodes[sibling].parent = newParent;
+    _nodes[leaf].parent = newParent;
+
+    if (oldParent == NullNode)
+        _root = newParent;
+    else if (_nodes[oldParent].child1 == sibling)
+        _nodes[oldParent].child1 = newParent;
+    else
+        _nodes[oldParent].child2 = newParent;
+
+    fixUpwards(_nodes[leaf].parent);
+}
+
+void DynamicAABBTree::removeLeaf(uint32_t leaf)
+{
+    _topologyChanged = true;
+    if (leaf == _root)
+    {
+        _root = NullNode;
+        return;
+    }
+
+    const uint32_t parent = _nodes[leaf].parent;
+    const uint32_t grandParent = _nodes[parent].parent;
+    const uint32_t sibling = _nodes[parent].child1 == leaf ? _nodes[parent].child2 : _nodes[parent].child1;
+
+    freeNode(parent);
+    _nodes[sibling].parent = grandParent;
+
+    if (grandParent == NullNode)
+    {
+        _root = sibling;
+        return;
+    }
+
+    if (_nodes[grandParent].child1 == parent)
+        _nodes[grandParent].child1 = sibling;
+    else
+        _nodes[grandParent].child2 = sibling;
+
+    fixUpwards(grandParent);
+}
+
+// Rebalances and refits from node to the root.
+void DynamicAABBTree::fixUpwards(uint32_t node)
+{
+    while (node != NullNode)
+    {
+        node = balance(node);
+
+        Node &n = _nodes[node];
+        const Node &c1 = _nodes[n.child1];
+        const Node &c2 = _nodes[n.child2];
+        n.height = 1 + std::max(c1.height, c2.height);
+        n.bounds = combine(c1.bounds, c2.bounds);
+        node = n.parent;
+    }
+}
+
+// While node's subtrees differ in height by more than one, rotates the taller child up into node's place. Returns
+// the root of the rebalanced subtree.
+uint32_t DynamicAABBTree::balance(uint32_t iA)
+{
+    Node &a = _nodes[iA];
+    if (a.isLeaf() || a.height < 2)
+        return iA;
+
+    const uint32_t iB = a.child1;
+    const uint32_t iC = a.child2;
+    const int difference = _nodes[iC].height - _nodes[iB].height;
+    if (difference >= -1 && difference <= 1)
+        return iA;
+
+    // Rotate the taller child (up) above A; its taller grandchild stays with it and the other moves under A.
+    const bool rightHeavy = difference > 1;
+    const uint32_t iUp = rightHeavy ? iC : iB;
+    const uint32_t iStay = rightHeavy ? iB : iC;
+    Node &up = _nodes[iUp];
+    const uint32_t iF = up.child1;
+    const uint32_t iG = up.child2;
+
+    up.child1 = iA;
+    up.parent = a.parent;
+    a.parent = iUp;
+    if (up.parent == NullNode)
+        _root = iUp;
+    else if (_nodes[up.parent].child1 == iA)
+        _nodes[up.parent].child1 = iUp;
+    else
+        _nodes[up.parent].child2 = iUp;
+
+    const bool keepF = _nodes[iF].height > _nodes[iG].height;
+    const uint32_t iKeep = keepF ? iF : iG;
+    const uint32_t iMove = keepF ? iG : iF;
+
+    up.child2 = iKeep;
+    if (rightHeavy)
+        a.child2 = iMove;
+    else
+        a.child1 = iMove;
+    _nodes[iMove].parent = iA;
+
+    a.bounds = combine(_nodes[iStay].bounds, _nodes[iMove].bounds);
+    a.height = 1 + std::max(_nodes[iStay].height, _nodes[iMove].height);
+
+    // One rotation evens out a difference of two, as removals and leaf-level insertions leave. An insertion that
+    // stopped beside a tall subtree leaves more, so the demoted node is rebalanced in turn and the new root rechecked.
+    balance(iA);
+    const Node &c1 = _nodes[up.child1];
+    const Node &c2 = _nodes[up.child2];
+    up.bounds = combine(c1.bounds, c2.bounds);
+    up.height = 1 + std::max(c1.height, c2.height);
+    return balance(iUp);
+}
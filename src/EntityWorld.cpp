@@ -0,0 +1,329 @@
+#include "EntityWorld.h"
+
+#include <algorithm>
+#include <new>
+
+namespace
+{
+const size_t ChunkAlignment = 64;
+
+// Written once per type under the mutex, before the id is handed out; read without locking.
+std::mutex typeMutex;
+EntityComponents::TypeInfo types[EntityComponents::MaxComponentTypes];
+uint32_t typeCount = 0;
+
+size_t alignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+} // namespace
+
+namespace EntityComponents
+{
+uint32_t registerType(size_t size, size_t alignment)
+{
+    std::lock_guard<std::mutex> lock(typeMutex);
+    assert(typeCount < MaxComponentTypes && alignment <= ChunkAlignment);
+    types[typeCount] = {size, alignment};
+    return typeCount++;
+}
+
+const TypeInfo &typeInfo(uint32_t id)
+{
+    return types[id];
+}
+} // namespace EntityComponents
+
+void Archetype::Chunk::Free::operator()(uint8_t *p) const
+{
+    ::operator delete(p, std::align_val_t(ChunkAlignment));
+}
+
+Archetype::Archetype(uint64_t mask) : _mask(mask)
+{
+    std::fill(std::begin(_columnOffsets), std::end(_columnOffsets), NoColumn);
+
+    size_t rowSize = sizeof(Entity);
+    for (uint32_t id = 0; id < EntityComponents::MaxComponentTypes; ++id)
+    {
+        if (mask & (uint64_t(1) << id))
+        {
+            _components.push_back(id);
+            rowSize += EntityComponents::typeInfo(id).size;
+        }
+    }
+
+    // Leave room for the padding between columns, then lay them out in id order.
+    size_t capacity = ChunkSize / rowSize;
+    for (;; --capacity)
+    {
+        size_t offset = capacity * sizeof(Entity);
+        for (uint32_t id : _components)
+        {
+            const EntityComponents::TypeInfo &info = EntityComponents::typeInfo(id);
+            offset = alignUp(offset, info.alignment);
+            _columnOffsets[id] = offset;
+            offset += capacity * info.size;
+        }
+        if (offset <= ChunkSize)
+            break;
+    }
+    assert(capacity > 0);
+    _chunkCapacity = uint32_t(capacity);
+}
+
+std::pair<uint32_t, uint32_t> Archetype::push(Entity entity)
+{
+    if (_chunks.empty() || _chunks.back().count == _chunkCapacity)
+    {
+        Chunk chunk;
+        chunk.data.reset(static_cast<uint8_t *>(::operator new(ChunkSize, std::align_val_t(ChunkAlignment))));
+        _chunks.push_back(std::move(chunk));
+    }
+
+    const uint32_t chunk = uint32_t(_chunks.size() - 1);
+    const uint32_t row = _chunks[chunk].count++;
+    entities(chunk)[row] = entity;
+    ++_size;
+    return {chunk, row};
+}
+
+Entity Archetype::swapRemove(uint32_t chunk, uint32_t row)
+{
+    const uint32_t lastChunk = uint32_t(_chunks.size() - 1);
+    const uint32_t lastRow = _chunks[lastChunk].count - 1;
+
+    const Entity moved = entities(lastChunk)[lastRow];
+    if (chunk != lastChunk || row != lastRow)
+    {
+        entities(chunk)[row] = moved;
+        for (uint32_t id : _components)
+        {
+            const size_t size = EntityComponents::typeInfo(id).size;
+            memcpy(static_cast<uint8_t *>(column(chunk, id)) + row * size,
+                   static_cast<uint8_t *>(column(lastChunk, id)) + lastRow * size, size);
+        }
+    }
+
+    if (--_chunks[lastChunk].count == 0)
+        _chunks.pop_back();
+    --_size;
+    return moved;
+}
+
+Entity EntityCommandBuffer::create()
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    const Entity entity = {_pendingCount++, PendingGeneration};
+    _commands.push_back({Op::Create, 0, entity, 0});
+    return entity;
+}
+
+void EntityCommandBuffer::destroy(Entity entity)
+{
+    record(Op::Destroy, entity);
+}
+
+void EntityCommandBuffer::clear()
+{
+    _commands.clear();
+    _data.clear();
+    _pendingCount = 0;
+}
+
+void EntityCommandBuffer::record(Op op, Entity entity, uint32_t component, const void *pData, size_t size)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _commands.push_back({op, component, entity, _data.size()});
+    if (size)
+        _data.insert(_data.end(), static_cast<const uint8_t *>(pData), static_cast<const uint8_t *>(pData) + size);
+}
+
+EntityWorld::EntityWorld()
+{
+    archetypeFor(0);
+}
+
+EntityWorld::~EntityWorld() = default;
+
+Archetype *EntityWorld::archetypeFor(uint64_t mask)
+{
+    std::unique_ptr<Archetype> &pArchetype = _archetypes[mask];
+    if (!pArchetype)
+    {
+        assert(_iterating == 0);
+        pArchetype = std::make_unique<Archetype>(mask);
+        for (auto &[queryMask, archetypes] : _queries)
+        {
+            if ((mask & queryMask) == queryMask)
+                archetypes.push_back(pArchetype.get());
+        }
+    }
+    return pArchetype.get();
+}
+
+const std::vector<Archetype *> &EntityWorld::query(uint64_t mask)
+{
+    auto it = _queries.find(mask);
+    if (it != _queries.end())
+        return it->second;
+
+    std::vector<Archetype *> &archetypes = _queries[mask];
+    for (auto &[archetypeMask, pArchetype] : _archetypes)
+    {
+        if ((archetypeMask & mask) == mask)
+            archetypes.push_back(pArchetype.get());
+    }
+    return archetypes;
+}
+
+Entity EntityWorld::createInArchetype(Archetype *pArchetype)
+{
+    assert(_iterating == 0);
+
+    Entity entity;
+    if (!_freeIndices.empty())
+    {
+        entity.index = _freeIndices.back();
+        _freeIndices.pop_back();
+    }
+    else
+    {
+        entity.index = uint32_t(_locations.size());
+        _locations.emplace_back();
+    }
+
+    Location &location = _locations[entity.index];
+    entity.generation = location.generation;
+    location.pArchetype = pArchetype;
+    std::tie(location.chunk, location.row) = pArchetype->push(entity);
+    ++_aliveCount;
+    return entity;
+}
+
+void EntityWorld::destroy(Entity entity)
+{
+    assert(_iterating == 0 && isAlive(entity));
+
+    Location &location = _locations[entity.index];
+    const Entity moved = location.pArchetype->swapRemove(location.chunk, location.row);
+    if (moved != entity)
+    {
+        _locations[moved.index].chunk = location.chunk;
+        _locations[moved.index].row = location.row;
+    }
+
+    location.pArchetype = nullptr;
+    ++location.generation;
+    _freeIndices.push_back(entity.index);
+    --_aliveCount;
+}
+
+bool EntityWorld::isAlive(Entity entity) const
+{
+    return entity.index < _locations.size() && _locations[entity.index].pArchetype &&
+           _locations[entity.index].generation == entity.generation;
+}
+
+// Copies the components both archetypes share; the target's other components are left uninitialized.
+void EntityWorld::moveToArchetype(Entity entity, Archetype *pTarget)
+{
+    assert(_iterating == 0);
+
+    Location &location = _locations[entity.index];
+    Archetype *pSource = location.pArchetype;
+    const auto [chunk, row] = pTarget->push(entity);
+
+    for (uint32_t id : pTarget->_components)
+    {
+        if (pSource->_mask & (uint64_t(1) << id))
+        {
+            const size_t size = EntityComponents::typeInfo(id).size;
+            memcpy(static_cast<uint8_t *>(pTarget->column(chunk, id)) + row * size,
+                   static_cast<uint8_t *>(pSource->column(location.chunk, id)) + location.row * size, size);
+        }
+    }
+
+    const Entity moved = pSource->swapRemove(location.chunk, location.row);
+    if (moved != entity)
+    {
+        _locations[moved.index].chunk = location.chunk;
+        _locations[moved.index].row = location.row;
+    }
+
+    location.pArchetype = pTarget;
+    location.chunk = chunk;
+    location.row = row;
+}
+
+void EntityWorld::addComponent(Entity entity, uint32_t component, const void *pValue)
+{
+    assert(isAlive(entity));
+
+    Archetype *pSource = _locations[entity.index].pArchetype;
+    if (!(pSource->_mask & (uint64_t(1) << component)))
+    {
+        Archetype *&pTarget = pSource->_addEdges[component];
+        if (!pTarget)
+            pTarget = archetypeFor(pSource->_mask | (uint64_t(1) << component));
+        moveToArchetype(entity, pTarget);
+    }
+    memcpy(this->component(entity, component), pValue, EntityComponents::typeInfo(component).size);
+}
+
+void EntityWorld::removeComponent(Entity entity, uint32_t component)
+{
+    assert(isAlive(entity));
+
+    Archetype *pSource = _locations[entity.index].pArchetype;
+    if (!(pSource->_mask & (uint64_t(1) << component)))
+        return;
+
+    Archetype *&pTarget = pSource->_removeEdges[component];
+    if (!pTarget)
+        pTarget = archetypeFor(pSource->_mask & ~(uint64_t(1) << component));
+    moveToArchetype(entity, pTarget);
+}
+
+void *EntityWorld::component(Entity entity, uint32_t component) const
+{
+    assert(isAlive(entity));
+
+    const Location &location = _locations[entity.index];
+    if (!(location.pArchetype->_mask & (uint64_t(1) << component)))
+        return nullptr;
+    return static_cast<uint8_t *>(location.pArchetype->column(location.chunk, component)) +
+           location.row * EntityComponents::typeInfo(component).size;
+}
+
+void EntityWorld::apply(EntityCommandBuffer &commands)
+{
+    std::vector<Entity> created(commands._pendingCount);
+    auto resolve = [&created](Entity entity) {
+        return entity.generation == EntityCommandBuffer::PendingGeneration ? created[entity.index] : entity;
+    };
+
+    for (const EntityCommandBuffer::Command &command : commands._commands)
+    {
+        switch (command.op)
+        {
+        case EntityCommandBuffer::Op::Create:
+            created[command.entity.index] = createInArchetype(archetypeFor(0));
+            break;
+        case EntityCommandBuffer::Op::Destroy:
+            // Several tasks may have queued the same destruction.
+            if (isAlive(resolve(command.entity)))
+                destroy(resolve(command.entity));
+            break;
+        case EntityCommandBuffer::Op::Add:
+            if (isAlive(resolve(command.entity)))
+                addComponent(resolve(command.entity), command.component, commands._data.data() + command.dataOffset);
+            break;
+        case EntityCommandBuffer::Op::Remove:
+            if (isAlive(resolve(command.entity)))
+                removeComponent(resolve(command.entity), command.component);
+            break;
+        }
+    }
+    commands.clear();
+}
@@ -0,0 +1,170 @@
+#include "FrustumCulling.h"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "Float8.h"
+#include "JobSystem.h"
+
+namespace
+{
+const size_t ChunkSize = 16 * 1024;
+
+// Bit i of the result is set when sphere first + i is inside all six planes.
+uint32_t testSpheres(const Frustum &frustum, const FrustumCulling::SphereSoA &s, size_t first)
+{
+    const Float8 x = Float8::load(s.x + first), y = Float8::load(s.y + first), z = Float8::load(s.z + first);
+    const Float8 radius = Float8::load(s.radius + first);
+    uint32_t mask = 0xff;
+    for (const Plane &p : frustum.planes)
+    {
+        const Float8 d = x * Float8::set(p.nx) + y * Float8::set(p.ny) + z * Float8::set(p.nz) +
+                         Float8::set(p.distance) + radius;
+        mask &= d.nonNegativeMask();
+    }
+    return mask;
+}
+
+// Boxes are tested in center/extent form: inside a plane when dot(n, center) + d >= |n| . extent negated.
+uint32_t testBoxes(const Frustum &frustum, const FrustumCulling::AABBSoA &b, size_t first)
+{
+    const Float8 half = Float8::set(0.5f);
+    const Float8 minX = Float8::load(b.minX + first), maxX = Float8::load(b.maxX + first);
+    const Float8 minY = Float8::load(b.minY + first), maxY = Float8::load(b.maxY + first);
+    const Float8 minZ = Float8::load(b.minZ + first), maxZ = Float8::load(b.maxZ + first);
+    const Float8 cx = (minX + maxX) * half, cy = (minY + maxY) * half, cz = (minZ + maxZ) * half;
+    const Float8 ex = (maxX - minX) * half, ey = (maxY - minY) * half, ez = (maxZ - minZ) * half;
+    uint32_t mask = 0xff;
+    for (const Plane &p : frustum.planes)
+    {
+        const Float8 d = cx * Float8::set(p.nx) + cy * Float8::set(p.ny) + cz * Float8::set(p.nz) +
+                         Float8::set(p.distance) + ex * Float8::set(std::fabs(p.nx)) +
+                         ey * Float8::set(std::fabs(p.ny)) + ez * Float8::set(std::fabs(p.nz));
+        mask &= d.nonNegativeMask();
+    }
+    return mask;
+}
+
+// Entry m packs, a nibble each from the lowest, the lane numbers of the set bits of the 8-bit mask m.
+struct LaneTable {
+    uint32_t lanes[256];
+
+    constexpr LaneTable() : lanes()
+    {
+        for (uint32_t mask = 0; mask < 256; ++mask)
+        {
+            uint32_t written = 0;
+            for (uint32_t lane = 0; lane < 8; ++lane)
+            {
+                if (mask & (1u << lane))
+                    lanes[mask] |= lane << (4 * written++);
+            }
+        }
+    }
+};
+constexpr LaneTable SetLanes;
+
+// Writes all eight entries and advances by the number of visible ones, so there is no branch per object to
+// mispredict; pOut must have room for eight entries.
+size_t writeVisibleBatch(uint32_t mask, size_t first, uint32_t *pOut)
+{
+    const uint32_t lanes = SetLanes.lanes[mask];
+    for (uint32_t k = 0; k < 8; ++k)
+        pOut[k] = uint32_t(first + ((lanes >> (4 * k)) & 7));
+    return size_t(__builtin_popcount(mask));
+}
+
+size_t writeVisible(uint32_t mask, size_t first, uint32_t *pOut)
+{
+    size_t written = 0;
+    while (mask)
+    {
+        pOut[written++] = uint32_t(first + __builtin_ctz(mask));
+        mask &= mask - 1;
+    }
+    return written;
+}
+
+// test(bounds, first) covers eight objects from first; the last partial batch is copied into padded storage.
+template <typename Bounds, typename Test, typename PadTail>
+size_t cullRange(const Frustum &frustum, const Bounds &bounds, size_t begin, size_t end, uint32_t *pOut,
+                 const Test &test, const PadTail &padTail)
+{
+    // pOut + visibleCount never passes first, so a full batch has room for all eight entries.
+    size_t visibleCount = 0;
+    size_t first = begin;
+    for (; first + 8 <= end; first += 8)
+        visibleCount += writeVisibleBatch(test(frustum, bounds, first), first, pOut + visibleCount);
+
+    if (first < end)
+    {
+        float storage[6][8] = {};
+        const Bounds tail = padTail(bounds, first, end - first, storage);
+        const uint32_t mask = test(frustum, tail, 0) & ((1u << (end - first)) - 1);
+        visibleCount += writeVisible(mask, first, pOut + visibleCount);
+    }
+    return visibleCount;
+}
+
+// Each chunk compacts into its own slice of pVisible; the slices are then moved together in order.
+template <typename Bounds, typename Test, typename PadTail>
+size_t cull(const Frustum &frustum, const Bounds &bounds, size_t count, uint32_t *pVisible, JobSystem *pJobs,
+            const Test &test, const PadTail &padTail)
+{
+    if (!pJobs || count <= ChunkSize)
+        return cullRange(frustum, bounds, 0, count, pVisible, test, padTail);
+
+    const size_t chunkCount = (count + ChunkSize - 1) / ChunkSize;
+    std::vector<size_t> chunkVisible(chunkCount);
+    pJobs->parallelFor(chunkCount, 1, [&](size_t firstChunk, size_t lastChunk) {
+        for (size_t chunk = firstChunk; chunk < lastChunk; ++chunk)
+        {
+            const size_t begin = chunk * ChunkSize;
+            const size_t end = begin + ChunkSize < count ? begin + ChunkSize : count;
+            chunkVisible[chunk] = cullRange(frustum, bounds, begin, end, pVisible + begin, test, padTail);
+        }
+    });
+
+    size_t visibleCount = chunkVisible[0];
+    for (size_t chunk = 1; chunk < chunkCount; ++chunk)
+    {
+        memmove(pVisible + visibleCount, pVisible + chunk * ChunkSize, chunkVisible[chunk] * sizeof(uint32_t));
+        visibleCount += chunkVisible[chunk];
+    }
+    return visibleCount;
+}
+
+const float *padArray(const float *pSource, size_t lanes, float *pStorage)
+{
+    memcpy(pStorage, pSource, lanes * sizeof(float));
+    return pStorage;
+}
+} // namespace
+
+namespace FrustumCulling
+{
+size_t cullSpheres(const Frustum &frustum, const SphereSoA &spheres, size_t count, uint32_t *pVisible,
+                   JobSystem *pJobs)
+{
+    return cull(frustum, spheres, count, pVisible, pJobs, testSpheres,
+                [](const SphereSoA &s, size_t first, size_t lanes, float storage[6][8]) {
+                    return SphereSoA{padArray(s.x + first, lanes, storage[0]), padArray(s.y + first, lanes, storage[1]),
+                                     padArray(s.z + first, lanes, storage[2]),
+                                     padArray(s.radius + first, lanes, storage[3])};
+                });
+}
+
+size_t cullAABBs(const Frustum &frustum, const AABBSoA &boxes, size_t count, uint32_t *pVisible, JobSystem *pJobs)
+{
+    return cull(frustum, boxes, count, pVisible, pJobs, testBoxes,
+                [](const AABBSoA &b, size_t first, size_t lanes, float storage[6][8]) {
+                    return AABBSoA{padArray(b.minX + first, lanes, storage[0]),
+                                   padArray(b.minY + first, lanes, storage[1]),
+                                   padArray(b.minZ + first, lanes, storage[2]),
+                                   padArray(b.maxX + first, lanes, storage[3]),
+                                   padArray(b.maxY + first, lanes, storage[4]),
+                                   padArray(b.maxZ + first, lanes, storage[5])};
+                });
+}
+} // namespace FrustumCulling
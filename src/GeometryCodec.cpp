@@ -0,0 +1,564 @@
+#include "GeometryCodec.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+const size_t BlockSize = 16;
+
+enum TriangleCode : uint8_t
+{
+    TriangleLiteral = 0,
+    TriangleEdge = 1,      // + edge * 3 + rotation, followed by the new vertex as a varint
+    TriangleEdgeNext = 10, // + edge * 3 + rotation, new vertex is the next unseen index
+};
+
+uint32_t zigzag32(int32_t v) { return (uint32_t(v) << 1) ^ uint32_t(v >> 31); }
+
+int32_t unzigzag32(uint32_t v) { return int32_t(v >> 1) ^ -int32_t(v & 1); }
+
+uint8_t zigzag8(uint8_t v) { return uint8_t((v << 1) ^ uint8_t(int8_t(v) >> 7)); }
+
+[[maybe_unused]] uint8_t unzigzag8(uint8_t v) { return uint8_t((v >> 1) ^ uint8_t(-(v & 1))); }
+
+void writeVarint(std::vector<uint8_t> &out, uint32_t v)
+{
+    while (v >= 0x80)
+    {
+        out.push_back(uint8_t(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back(uint8_t(v));
+}
+
+bool readVarint(const uint8_t *&pData, const uint8_t *pEnd, uint32_t &v)
+{
+    v = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        if (pData == pEnd)
+            return false;
+        uint8_t byte = *pData++;
+        v |= uint32_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+void rotateTriangle(const uint32_t *pTri, int rotation, uint32_t *pOut)
+{
+    pOut[0] = pTri[rotation % 3];
+    pOut[1] = pTri[(rotation + 1) % 3];
+    pOut[2] = pTri[(rotation + 2) % 3];
+}
+
+// Where each corner of an edge-coded triangle comes from, per code: 0-2 are the previous triangle's corners and 3 the
+// new vertex. Equivalent to rotating {edge[0], edge[1], new vertex} back by the code's rotation, without the modulos.
+struct EdgeCorners {
+    uint8_t corners[TriangleEdgeNext + 9][3];
+
+    constexpr EdgeCorners() : corners()
+    {
+        for (int code = TriangleEdge; code < TriangleEdgeNext + 9; ++code)
+        {
+            const int match = code >= TriangleEdgeNext ? code - TriangleEdgeNext : code - TriangleEdge;
+            const int e = match / 3, r = match % 3;
+            const uint8_t rotated[3] = {uint8_t((e + 1) % 3), uint8_t(e), 3};
+            for (int i = 0; i < 3; ++i)
+                corners[code][i] = rotated[((3 - r) % 3 + i) % 3];
+        }
+    }
+};
+
+constexpr EdgeCorners EdgeCornerTable;
+
+// Most deltas fit one byte, so the loop is skipped for them.
+bool readVarintFast(const uint8_t *&pData, const uint8_t *pEnd, uint32_t &v)
+{
+    if (pData != pEnd && *pData < 0x80)
+    {
+        v = *pData++;
+        return true;
+    }
+    return readVarint(pData, pEnd, v);
+}
+
+// Each triangle depends on the one before it, through its shared edge, the next unseen index and the varint stream,
+// so the loop stays serial; it is specialized per index size and has one branch per triangle on the common paths.
+template <typename Index>
+bool decodeTriangles(Index *pOut, size_t triangleCount, const uint8_t *pCodes, const uint8_t *&pPayload,
+                     const uint8_t *pEnd)
+{
+    uint32_t corners[4] = {}; // the previous triangle, then the new vertex
+    uint32_t next = 0;
+    uint32_t last = 0;
+
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        const uint8_t code = pCodes[t];
+        uint32_t a, b, c;
+        if (code >= TriangleEdge && code < TriangleEdgeNext + 9)
+        {
+            uint32_t fresh = next;
+            if (code < TriangleEdgeNext)
+            {
+                uint32_t v;
+                if (!readVarintFast(pPayload, pEnd, v))
+                    return false;
+                fresh = next + uint32_t(unzigzag32(v));
+            }
+            corners[3] = fresh;
+            const uint8_t *pCorners = EdgeCornerTable.corners[code];
+            a = corners[pCorners[0]];
+            b = corners[pCorners[1]];
+            c = corners[pCorners[2]];
+            // The edge's corners are below next already.
+            next = fresh >= next ? fresh + 1 : next;
+            last = fresh;
+        }
+        else if (code == TriangleLiteral)
+        {
+            uint32_t v[3];
+            for (int i = 0; i < 3; ++i)
+            {
+                if (!readVarintFast(pPayload, pEnd, v[i]))
+                    return false;
+            }
+            a = last + uint32_t(unzigzag32(v[0]));
+            b = a + uint32_t(unzigzag32(v[1]));
+            c = b + uint32_t(unzigzag32(v[2]));
+            last = c;
+            next = a >= next ? a + 1 : next;
+            next = b >= next ? b + 1 : next;
+            next = c >= next ? c + 1 : next;
+        }
+        else
+        {
+            return false;
+        }
+
+        pOut[t * 3 + 0] = Index(a);
+        pOut[t * 3 + 1] = Index(b);
+        pOut[t * 3 + 2] = Index(c);
+        corners[0] = a;
+        corners[1] = b;
+        corners[2] = c;
+    }
+    return true;
+}
+
+int blockBits(const uint8_t *pBlock)
+{
+    uint8_t maxValue = 0;
+    for (size_t i = 0; i < BlockSize; ++i)
+        maxValue = pBlock[i] > maxValue ? pBlock[i] : maxValue;
+
+    if (maxValue == 0)
+        return 0;
+    if (maxValue < 4)
+        return 2;
+    if (maxValue < 16)
+        return 4;
+    return 8;
+}
+
+int modeBits(int mode) { return mode == 0 ? 0 : 1 << mode; }
+
+int bitsMode(int bits) { return bits == 0 ? 0 : bits == 2 ? 1 : bits == 4 ? 2 : 3; }
+
+// Unpacks one block of zigzagged deltas, undoes the zigzag and prefix-sums it onto the running value of the
+// plane. Returns the last decoded byte, which carries into the next block.
+#if defined(__SSE2__)
+uint8_t decodeBlock(const uint8_t *pPayload, int bits, uint8_t carry, uint8_t *pOut)
+{
+    __m128i v;
+    if (bits == 0)
+    {
+        v = _mm_setzero_si128();
+    }
+    else if (bits == 8)
+    {
+        v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pPayload));
+    }
+    else if (bits == 4)
+    {
+        __m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(pPayload));
+        __m128i doubled = _mm_unpacklo_epi8(packed, packed);
+        __m128i odd = _mm_set1_epi16(int16_t(0xff00));
+        __m128i lo = _mm_andnot_si128(odd, doubled);
+        __m128i hi = _mm_and_si128(odd, _mm_srli_epi16(doubled, 4));
+        v = _mm_and_si128(_mm_or_si128(lo, hi), _mm_set1_epi8(0x0f));
+    }
+    else
+    {
+        int32_t word;
+        memcpy(&word, pPayload, sizeof(word));
+        __m128i packed = _mm_cvtsi32_si128(word);
+        __m128i doubled = _mm_unpacklo_epi8(packed, packed);
+        __m128i quad = _mm_unpacklo_epi16(doubled, doubled);
+        __m128i lane0 = _mm_set1_epi32(0x000000ff);
+        __m128i lane1 = _mm_set1_epi32(0x0000ff00);
+        __m128i lane2 = _mm_set1_epi32(0x00ff0000);
+        __m128i lane3 = _mm_set1_epi32(int32_t(0xff000000));
+        __m128i r = _mm_and_si128(quad, lane0);
+        r = _mm_or_si128(r, _mm_and_si128(_mm_srli_epi16(quad, 2), lane1));
+        r = _mm_or_si128(r, _mm_and_si128(_mm_srli_epi16(quad, 4), lane2));
+        r = _mm_or_si128(r, _mm_and_si128(_mm_srli_epi16(quad, 6), lane3));
+        v = _mm_and_si128(r, _mm_set1_epi8(0x03));
+    }
+
+    __m128i sign = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(v, _mm_set1_epi8(1)));
+    v = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(v, 1), _mm_set1_epi8(0x7f)), sign);
+
+    v = _mm_add_epi8(v, _mm_slli_si128(v, 1));
+    v = _mm_add_epi8(v, _mm_slli_si128(v, 2));
+    v = _mm_add_epi8(v, _mm_slli_si128(v, 4));
+    v = _mm_add_epi8(v, _mm_slli_si128(v, 8));
+    v = _mm_add_epi8(v, _mm_set1_epi8(char(carry)));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(pOut), v);
+    return pOut[BlockSize - 1];
+}
+#elif defined(__ARM_NEON)
+uint8_t decodeBlock(const uint8_t *pPayload, int bits, uint8_t carry, uint8_t *pOut)
+{
+    uint8x16_t v;
+    if (bits == 0)
+    {
+        v = vdupq_n_u8(0);
+    }
+    else if (bits == 8)
+    {
+        v = vld1q_u8(pPayload);
+    }
+    else if (bits == 4)
+    {
+        uint8x8_t packed = vld1_u8(pPayload);
+        uint8x8x2_t nibbles = vzip_u8(vand_u8(packed, vdup_n_u8(0x0f)), vshr_n_u8(packed, 4));
+        v = vcombine_u8(nibbles.val[0], nibbles.val[1]);
+    }
+    else
+    {
+        uint32_t word;
+        memcpy(&word, pPayload, sizeof(word));
+        static const uint8_t Spread[16] = {0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3};
+        static const int8_t Shifts[16] = {0, -2, -4, -6, 0, -2, -4, -6, 0, -2, -4, -6, 0, -2, -4, -6};
+        uint8x16_t packed = vreinterpretq_u8_u32(vdupq_n_u32(word));
+        uint8x16_t quad = vqtbl1q_u8(packed, vld1q_u8(Spread));
+        v = vandq_u8(vshlq_u8(quad, vld1q_s8(Shifts)), vdupq_n_u8(0x03));
+    }
+
+    uint8x16_t sign = vreinterpretq_u8_s8(vnegq_s8(vreinterpretq_s8_u8(vandq_u8(v, vdupq_n_u8(1)))));
+    v = veorq_u8(vshrq_n_u8(v, 1), sign);
+
+    uint8x16_t zero = vdupq_n_u8(0);
+    v = vaddq_u8(v, vextq_u8(zero, v, 15));
+    v = vaddq_u8(v, vextq_u8(zero, v, 14));
+    v = vaddq_u8(v, vextq_u8(zero, v, 12));
+    v = vaddq_u8(v, vextq_u8(zero, v, 8));
+    v = vaddq_u8(v, vdupq_n_u8(carry));
+
+    vst1q_u8(pOut, v);
+    return pOut[BlockSize - 1];
+}
+#else
+uint8_t decodeBlock(const uint8_t *pPayload, int bits, uint8_t carry, uint8_t *pOut)
+{
+    for (size_t i = 0; i < BlockSize; ++i)
+    {
+        uint8_t delta = 0;
+        if (bits == 8)
+            delta = pPayload[i];
+        else if (bits == 4)
+            delta = (pPayload[i / 2] >> ((i % 2) * 4)) & 0x0f;
+        else if (bits == 2)
+            delta = (pPayload[i / 4] >> ((i % 4) * 2)) & 0x03;
+
+        carry = uint8_t(carry + unzigzag8(delta));
+        pOut[i] = carry;
+    }
+    return carry;
+}
+#endif
+} // namespace
+
+namespace GeometryCodec
+{
+std::vector<uint8_t> encodeIndexBuffer(const uint32_t *pIndices, size_t indexCount, Stats *pStats)
+{
+    assert(indexCount % 3 == 0);
+
+    const size_t triangleCount = indexCount / 3;
+    std::vector<uint8_t> codes(triangleCount);
+    std::vector<uint8_t> payload;
+    payload.reserve(indexCount);
+
+    uint32_t previous[3] = {};
+    uint32_t next = 0;
+    uint32_t last = 0;
+
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        const uint32_t *pTri = pIndices + t * 3;
+        const uint32_t edges[3][2] = {
+            {previous[1], previous[0]}, {previous[2], previous[1]}, {previous[0], previous[2]}};
+
+        int match = -1;
+        uint32_t rotated[3];
+        for (int e = 0; t > 0 && e < 3 && match < 0; ++e)
+        {
+            for (int r = 0; r < 3; ++r)
+            {
+                rotateTriangle(pTri, r, rotated);
+                if (rotated[0] == edges[e][0] && rotated[1] == edges[e][1])
+                {
+                    match = e * 3 + r;
+                    break;
+                }
+            }
+        }
+
+        if (match >= 0)
+        {
+            uint32_t fresh = rotated[2];
+            if (fresh == next)
+            {
+                codes[t] = uint8_t(TriangleEdgeNext + match);
+            }
+            else
+            {
+                codes[t] = uint8_t(TriangleEdge + match);
+                writeVarint(payload, zigzag32(int32_t(fresh - next)));
+            }
+            last = fresh;
+        }
+        else
+        {
+            codes[t] = TriangleLiteral;
+            for (int i = 0; i < 3; ++i)
+            {
+                writeVarint(payload, zigzag32(int32_t(pTri[i] - last)));
+                last = pTri[i];
+            }
+        }
+
+        for (int i = 0; i < 3; ++i)
+        {
+            previous[i] = pTri[i];
+            next = pTri[i] >= next ? pTri[i] + 1 : next;
+        }
+    }
+
+    codes.insert(codes.end(), payload.begin(), payload.end());
+
+    if (pStats)
+    {
+        pStats->rawSize += indexCount * sizeof(uint32_t);
+        pStats->encodedSize += codes.size();
+    }
+    return codes;
+}
+
+bool decodeIndexBuffer(void *pDestination, size_t indexCount, size_t indexSize, const uint8_t *pData,
+                       size_t dataSize)
+{
+    assert(indexSize == 2 || indexSize == 4);
+
+    const size_t triangleCount = indexCount / 3;
+    if (indexCount % 3 != 0 || dataSize < triangleCount)
+        return false;
+
+    const uint8_t *pCodes = pData;
+    const uint8_t *pPayload = pData + triangleCount;
+    const uint8_t *pEnd = pData + dataSize;
+
+    const bool decoded =
+        indexSize == 2
+            ? decodeTriangles(static_cast<uint16_t *>(pDestination), triangleCount, pCodes, pPayload, pEnd)
+            : decodeTriangles(static_cast<uint32_t *>(pDestination), triangleCount, pCodes, pPayload, pEnd);
+    return decoded && pPayload == pEnd;
+}
+
+std::vector<uint8_t> encodeVertexBuffer(const void *pVertices, size_t vertexCount, size_t vertexSize,
+                                        Stats *pStats)
+{
+    const uint8_t *pBytes = static_cast<const uint8_t *>(pVertices);
+    const size_t blockCount = (vertexCount + BlockSize - 1) / BlockSize;
+
+    std::vector<uint8_t> out;
+    std::vector<uint8_t> deltas(blockCount * BlockSize);
+    std::vector<uint8_t> header((blockCount + 3) / 4);
+
+    for (size_t k = 0; k < vertexSize; ++k)
+    {
+        uint8_t previous = 0;
+        for (size_t i = 0; i < vertexCount; ++i)
+        {
+            uint8_t value = pBytes[i * vertexSize + k];
+            deltas[i] = zigzag8(uint8_t(value - previous));
+            previous = value;
+        }
+        std::fill(deltas.begin() + vertexCount, deltas.end(), 0);
+
+        std::fill(header.begin(), header.end(), 0);
+        for (size_t b = 0; b < blockCount; ++b)
+            header[b / 4] |= uint8_t(bitsMode(blockBits(&deltas[b * BlockSize])) << ((b % 4) * 2));
+        out.insert(out.end(), header.begin(), header.end());
+
+        for (size_t b = 0; b < blockCount; ++b)
+        {
+            const uint8_t *pBlock = &deltas[b * BlockSize];
+            const int bits = modeBits((header[b / 4] >> ((b % 4) * 2)) & 3);
+            if (bits == 8)
+            {
+                out.insert(out.end(), pBlock, pBlock + BlockSize);
+            }
+            else if (bits != 0)
+            {
+                const int perByte = 8 / bits;
+                for (size_t i = 0; i < BlockSize; i += perByte)
+                {
+                    uint8_t packed = 0;
+                    for (int j = 0; j < perByte; ++j)
+                        packed |= uint8_t(pBlock[i + j] << (j * bits));
+                    out.push_back(packed);
+                }
+            }
+        }
+    }
+
+    if (pStats)
+    {
+        pStats->rawSize += vertexCount * vertexSize;
+        pStats->encodedSize += out.size();
+    }
+    return out;
+}
+
+bool decodeVertexBuffer(void *pDestination, size_t vertexCount, size_t vertexSize, const uint8_t *pData,
+                        size_t dataSize)
+{
+    uint8_t *pBytes = static_cast<uint8_t *>(pDestination);
+    const size_t blockCount = (vertexCount + BlockSize - 1) / BlockSize;
+    const size_t headerSize = (blockCount + 3) / 4;
+    const uint8_t *pEnd = pData + dataSize;
+
+    struct PlaneCursor
+    {
+        const uint8_t *pHeader;
+        const uint8_t *pPayload;
+        uint8_t carry;
+    };
+
+    // Locate every plane up front so that the vertices can be decoded in chunks across all planes; scattering a
+    // whole plane at a time into the interleaved output touches every cache line vertexSize times.
+    std::vector<PlaneCursor> planes(vertexSize);
+    for (size_t k = 0; k < vertexSize; ++k)
+    {
+        if (size_t(pEnd - pData) < headerSize)
+            return false;
+        planes[k] = {pData, pData + headerSize, 0};
+        pData += headerSize;
+
+        size_t payloadSize = 0;
+        for (size_t b = 0; b < blockCount; ++b)
+            payloadSize += size_t(modeBits((planes[k].pHeader[b / 4] >> ((b % 4) * 2)) & 3)) * BlockSize / 8;
+        if (size_t(pEnd - pData) < payloadSize)
+            return false;
+        pData += payloadSize;
+    }
+    if (pData != pEnd)
+        return false;
+
+    const size_t ChunkBlocks = 16;
+    std::vector<uint8_t> chunk(vertexSize * ChunkBlocks * BlockSize);
+    uint8_t padded[BlockSize] = {};
+
+    for (size_t firstBlock = 0; firstBlock < blockCount; firstBlock += ChunkBlocks)
+    {
+        const size_t chunkBlocks = std::min(ChunkBlocks, blockCount - firstBlock);
+        const size_t firstVertex = firstBlock * BlockSize;
+        const size_t chunkVertices = std::min(chunkBlocks * BlockSize, vertexCount - firstVertex);
+
+        for (size_t k = 0; k < vertexSize; ++k)
+        {
+            PlaneCursor &plane = planes[k];
+            uint8_t *pPlaneOut = &chunk[k * ChunkBlocks * BlockSize];
+            for (size_t b = 0; b < chunkBlocks; ++b)
+            {
+                const size_t block = firstBlock + b;
+                const int bits = modeBits((plane.pHeader[block / 4] >> ((block % 4) * 2)) & 3);
+                const size_t payloadSize = size_t(bits) * BlockSize / 8;
+
+                // The SIMD paths may load a few bytes past a short payload at the tail of the stream.
+                const uint8_t *pPayload = plane.pPayload;
+                if (size_t(pEnd - pPayload) < BlockSize)
+                {
+                    memcpy(padded, pPayload, payloadSize);
+                    pPayload = padded;
+                }
+
+                plane.carry = decodeBlock(pPayload, bits, plane.carry, pPlaneOut + b * BlockSize);
+                plane.pPayload += payloadSize;
+            }
+        }
+
+        uint8_t *pOut = pBytes + firstVertex * vertexSize;
+        size_t k = 0;
+        for (; k + 4 <= vertexSize; k += 4)
+        {
+            const uint8_t *pPlane0 = &chunk[k * ChunkBlocks * BlockSize];
+            const uint8_t *pPlane1 = pPlane0 + ChunkBlocks * BlockSize;
+            const uint8_t *pPlane2 = pPlane1 + ChunkBlocks * BlockSize;
+            const uint8_t *pPlane3 = pPlane2 + ChunkBlocks * BlockSize;
+            size_t i = 0;
+#if defined(__SSE2__)
+            for (; i + BlockSize <= chunkVertices; i += BlockSize)
+            {
+                __m128i p0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pPlane0 + i));
+                __m128i p1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pPlane1 + i));
+                __m128i p2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pPlane2 + i));
+                __m128i p3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pPlane3 + i));
+                __m128i lo01 = _mm_unpacklo_epi8(p0, p1), hi01 = _mm_unpackhi_epi8(p0, p1);
+                __m128i lo23 = _mm_unpacklo_epi8(p2, p3), hi23 = _mm_unpackhi_epi8(p2, p3);
+                __m128i words[4] = {_mm_unpacklo_epi16(lo01, lo23), _mm_unpackhi_epi16(lo01, lo23),
+                                    _mm_unpacklo_epi16(hi01, hi23), _mm_unpackhi_epi16(hi01, hi23)};
+                for (int w = 0; w < 4; ++w)
+                {
+                    uint8_t *pDst = pOut + (i + w * 4) * vertexSize + k;
+                    int32_t lanes[4];
+                    _mm_storeu_si128(reinterpret_cast<__m128i *>(lanes), words[w]);
+                    memcpy(pDst, &lanes[0], 4);
+                    memcpy(pDst + vertexSize, &lanes[1], 4);
+                    memcpy(pDst + vertexSize * 2, &lanes[2], 4);
+                    memcpy(pDst + vertexSize * 3, &lanes[3], 4);
+                }
+            }
+#endif
+            for (; i < chunkVertices; ++i)
+            {
+                uint32_t word = uint32_t(pPlane0[i]) | uint32_t(pPlane1[i]) << 8 | uint32_t(pPlane2[i]) << 16 |
+                                uint32_t(pPlane3[i]) << 24;
+                memcpy(pOut + i * vertexSize + k, &word, sizeof(word));
+            }
+        }
+        for (; k < vertexSize; ++k)
+        {
+            const uint8_t *pPlane = &chunk[k * ChunkBlocks * BlockSize];
+            for (size_t i = 0; i < chunkVertices; ++i)
+                pOut[i * vertexSize + k] = pPlane[i];
+        }
+    }
+
+    return true;
+}
+} // namespace GeometryCodec
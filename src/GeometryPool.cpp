@@ -0,0 +1,232 @@
+#include "GeometryPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+
+#include "GeometryCodec.h"
+#include "GpuMemory.h"
+
+namespace
+{
+const size_t IndexAlignment = 4;
+
+size_t indexSize(MTL::IndexType indexType)
+{
+    return indexType == MTL::IndexType::IndexTypeUInt16 ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+size_t alignIndexBytes(size_t size) { return (size + IndexAlignment - 1) & ~(IndexAlignment - 1); }
+} // namespace
+
+GeometryPool::GeometryPool(MTL::Device *pDevice, StagingUploader *pUploader, std::vector<size_t> vertexStrides,
+                           size_t vertexCapacity, size_t indexCapacity)
+    : _pDevice(pDevice->retain()), _pUploader(pUploader), _vertexStrides(std::move(vertexStrides)),
+      _vertexBuffers(_vertexStrides.size(), nullptr)
+{
+    rebuild(vertexCapacity, alignIndexBytes(indexCapacity));
+}
+
+GeometryPool::~GeometryPool()
+{
+    for (MTL::Buffer *pBuffer : _vertexBuffers)
+        GpuMemory::release(pBuffer);
+    GpuMemory::release(_pIndexBuffer);
+    _pDevice->release();
+}
+
+GeometryPool::MeshId GeometryPool::addMesh(const void *const *ppVertexStreams, size_t vertexCount,
+                                           const uint32_t *pIndices, size_t indexCount)
+{
+    const MeshId id = allocateMesh(vertexCount, indexCount);
+    const Mesh &m = _meshes[id];
+
+    for (size_t s = 0; s < _vertexStrides.size(); ++s)
+    {
+        const size_t size = vertexCount * _vertexStrides[s];
+        memcpy(_pUploader->upload(_vertexBuffers[s], m.baseVertex * _vertexStrides[s], size), ppVertexStreams[s],
+               size);
+    }
+
+    uint8_t *pIndexData = uploadIndices(m);
+    if (m.indexType == MTL::IndexType::IndexTypeUInt16)
+    {
+        uint16_t *pShortIndices = reinterpret_cast<uint16_t *>(pIndexData);
+        for (size_t i = 0; i < indexCount; ++i)
+            pShortIndices[i] = uint16_t(pIndices[i]);
+    }
+    else
+    {
+        memcpy(pIndexData, pIndices, indexCount * sizeof(uint32_t));
+    }
+
+    return id;
+}
+
+GeometryPool::MeshId GeometryPool::addEncodedMesh(const uint8_t *const *ppVertexStreams,
+                                                  const size_t *pVertexStreamSizes, size_t vertexCount,
+                                                  const uint8_t *pIndices, size_t indexDataSize, size_t indexCount)
+{
+    const MeshId id = allocateMesh(vertexCount, indexCount);
+    const Mesh &m = _meshes[id];
+
+    for (size_t s = 0; s < _vertexStrides.size(); ++s)
+    {
+        void *pVertexData =
+            _pUploader->upload(_vertexBuffers[s], m.baseVertex * _vertexStrides[s], vertexCount * _vertexStrides[s]);
+        if (!GeometryCodec::decodeVertexBuffer(static_cast<uint8_t *>(pVertexData), vertexCount, _vertexStrides[s],
+                                               ppVertexStreams[s], pVertexStreamSizes[s]))
+        {
+            std::cerr << "Malformed encoded vertex stream\n";
+            assert(false);
+        }
+    }
+
+    if (!GeometryCodec::decodeIndexBuffer(uploadIndices(m), indexCount, indexSize(m.indexType), pIndices,
+                                          indexDataSize))
+    {
+        std::cerr << "Malformed encoded index buffer\n";
+        assert(false);
+    }
+
+    return id;
+}
+
+void GeometryPool::removeMesh(MeshId mesh)
+{
+    Mesh &m = _meshes[mesh];
+    assert(m.live);
+
+    _vertexAllocator.free(m.baseVertex, m.vertexCount);
+    _indexAllocator.free(m.indexOffset, alignIndexBytes(m.indexCount * indexSize(m.indexType)));
+    m = Mesh();
+    _freeMeshIds.push_back(mesh);
+}
+
+void GeometryPool::compact() { rebuild(_vertexAllocator.capacity(), _indexAllocator.capacity()); }
+
+void GeometryPool::bind(MTL::RenderCommandEncoder *pEnc) const
+{
+    for (size_t s = 0; s < _vertexBuffers.size(); ++s)
+        pEnc->setVertexBuffer(_vertexBuffers[s], 0, s);
+}
+
+void GeometryPool::draw(MTL::RenderCommandEncoder *pEnc, MeshId mesh, size_t instanceCount,
+                        size_t baseInstance) const
+{
+    const Mesh &m = _meshes[mesh];
+    assert(m.live);
+
+    pEnc->drawIndexedPrimitives(MTL::PrimitiveType::PrimitiveTypeTriangle, NS::UInteger(m.indexCount), m.indexType,
+                                _pIndexBuffer, NS::UInteger(m.indexOffset), NS::UInteger(instanceCount),
+                                NS::Integer(m.baseVertex), NS::UInteger(baseInstance));
+}
+
+GeometryPool::MeshId GeometryPool::allocateMesh(size_t vertexCount, size_t indexCount)
+{
+    assert(vertexCount > 0 && indexCount > 0);
+
+    Mesh m;
+    m.vertexCount = vertexCount;
+    m.indexCount = indexCount;
+    m.indexType = vertexCount <= UINT16_MAX + 1 ? MTL::IndexType::IndexTypeUInt16 : MTL::IndexType::IndexTypeUInt32;
+    m.live = true;
+    const size_t indexBytes = alignIndexBytes(indexCount * indexSize(m.indexType));
+
+    m.baseVertex = _vertexAllocator.allocate(vertexCount);
+    m.indexOffset = _indexAllocator.allocate(indexBytes, IndexAlignment);
+    if (m.baseVertex == RangeAllocator::InvalidOffset || m.indexOffset == RangeAllocator::InvalidOffset)
+    {
+        if (m.baseVertex != RangeAllocator::InvalidOffset)
+            _vertexAllocator.free(m.baseVertex, vertexCount);
+        if (m.indexOffset != RangeAllocator::InvalidOffset)
+            _indexAllocator.free(m.indexOffset, indexBytes);
+
+        // Compacting is enough when the space is only fragmented; otherwise grow geometrically.
+        size_t vertexCapacity = _vertexAllocator.capacity();
+        size_t indexCapacity = _indexAllocator.capacity();
+        if (_vertexAllocator.usedSize() + vertexCount > vertexCapacity)
+            vertexCapacity = std::max(vertexCapacity * 2, _vertexAllocator.usedSize() + vertexCount);
+        if (_indexAllocator.usedSize() + indexBytes > indexCapacity)
+            indexCapacity = alignIndexBytes(std::max(indexCapacity * 2, _indexAllocator.usedSize() + indexBytes));
+        rebuild(vertexCapacity, indexCapacity);
+
+        m.baseVertex = _vertexAllocator.allocate(vertexCount);
+        m.indexOffset = _indexAllocator.allocate(indexBytes, IndexAlignment);
+        assert(m.baseVertex != RangeAllocator::InvalidOffset && m.indexOffset != RangeAllocator::InvalidOffset);
+    }
+
+    MeshId id;
+    if (!_freeMeshIds.empty())
+    {
+        id = _freeMeshIds.back();
+        _freeMeshIds.pop_back();
+        _meshes[id] = m;
+    }
+    else
+    {
+        id = MeshId(_meshes.size());
+        _meshes.push_back(m);
+    }
+    return id;
+}
+
+// The staging for a mesh's indices, padded to IndexAlignment with zeros, as buffer copies move whole words.
+uint8_t *GeometryPool::uploadIndices(const Mesh &m)
+{
+    const size_t size = m.indexCount * indexSize(m.indexType);
+    const size_t alignedSize = alignIndexBytes(size);
+    uint8_t *pIndexData = static_cast<uint8_t *>(_pUploader->upload(_pIndexBuffer, m.indexOffset, alignedSize));
+    memset(pIndexData + size, 0, alignedSize - size);
+    return pIndexData;
+}
+
+// Moves every live mesh into freshly allocated buffers, packed from the start, with GPU copies that the uploader
+// coalesces wherever neighbouring meshes stay neighbours. The old buffers are released once those copies have run.
+void GeometryPool::rebuild(size_t vertexCapacity, size_t indexCapacity)
+{
+    std::vector<MTL::Buffer *> vertexBuffers(_vertexStrides.size());
+    for (size_t s = 0; s < _vertexStrides.size(); ++s)
+    {
+        vertexBuffers[s] =
+            GpuMemory::track(_pDevice->newBuffer(vertexCapacity * _vertexStrides[s], MTL::ResourceStorageModePrivate),
+                             MemoryCategory::Geometry, "geometryVertices");
+    }
+    MTL::Buffer *pIndexBuffer = GpuMemory::track(_pDevice->newBuffer(indexCapacity, MTL::ResourceStorageModePrivate),
+                                                 MemoryCategory::Geometry, "geometryIndices");
+
+    _vertexAllocator.reset(vertexCapacity);
+    _indexAllocator.reset(indexCapacity);
+
+    for (Mesh &m : _meshes)
+    {
+        if (!m.live)
+            continue;
+
+        const size_t indexBytes = alignIndexBytes(m.indexCount * indexSize(m.indexType));
+        const size_t baseVertex = _vertexAllocator.allocate(m.vertexCount);
+        const size_t indexOffset = _indexAllocator.allocate(indexBytes, IndexAlignment);
+        assert(baseVertex != RangeAllocator::InvalidOffset && indexOffset != RangeAllocator::InvalidOffset);
+
+        for (size_t s = 0; s < _vertexStrides.size(); ++s)
+        {
+            _pUploader->copy(_vertexBuffers[s], m.baseVertex * _vertexStrides[s], vertexBuffers[s],
+                             baseVertex * _vertexStrides[s], m.vertexCount * _vertexStrides[s]);
+        }
+        _pUploader->copy(_pIndexBuffer, m.indexOffset, pIndexBuffer, indexOffset, indexBytes);
+
+        m.baseVertex = baseVertex;
+        m.indexOffset = indexOffset;
+    }
+
+    for (size_t s = 0; s < _vertexStrides.size(); ++s)
+    {
+        if (_vertexBuffers[s])
+            _pUploader->retire(_vertexBuffers[s]);
+        _vertexBuffers[s] = vertexBuffers[s];
+    }
+    if (_pIndexBuffer)
+        _pUploader->retire(_pIndexBuffer);
+    _pIndexBuffer = pIndexBuffer;
+}
@@ -0,0 +1,43 @@
+#include "GpuMemory.h"
+
+namespace GpuMemory
+{
+MemoryTracker &tracker()
+{
+    static MemoryTracker tracker(MemoryTracker::Settings{});
+    return tracker;
+}
+
+MTL::Buffer *track(MTL::Buffer *pBuffer, MemoryCategory category, const char *name, std::source_location location)
+{
+    tracker().track(pBuffer, pBuffer->allocatedSize(), category, name, location);
+    return pBuffer;
+}
+
+MTL::Texture *track(MTL::Texture *pTexture, MemoryCategory category, const char *name, std::source_location location)
+{
+    // Memoryless textures only live in tile memory.
+    const uint64_t size = pTexture->storageMode() == MTL::StorageModeMemoryless ? 0 : pTexture->allocatedSize();
+    tracker().track(pTexture, size, category, name, location);
+    return pTexture;
+}
+
+MTL::IndirectCommandBuffer *track(MTL::IndirectCommandBuffer *pCommandBuffer, MemoryCategory category, const char *name,
+                                  std::source_location location)
+{
+    tracker().track(pCommandBuffer, pCommandBuffer->allocatedSize(), category, name, location);
+    return pCommandBuffer;
+}
+
+MTL::Heap *track(MTL::Heap *pHeap, MemoryCategory category, const char *name, std::source_location location)
+{
+    tracker().track(pHeap, pHeap->size(), category, name, location);
+    return pHeap;
+}
+
+void release(NS::Object *pObject)
+{
+    tracker().untrack(pObject);
+    pObject->release();
+}
+} // namespace GpuMemory
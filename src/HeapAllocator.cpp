@@ -0,0 +1,103 @@
+#include "HeapAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "GpuMemory.h"
+
+namespace
+{
+// Placed resources are small compared to the heaps, so a fine granularity wastes little to rounding.
+const uint64_t Granularity = 256;
+// MTLResourceStorageModeShift, which metal-cpp does not declare.
+const uint32_t ResourceStorageModeShift = 4;
+} // namespace
+
+HeapAllocator::HeapAllocator(MTL::Device *pDevice, size_t heapSize) : _pDevice(pDevice->retain()), _heapSize(heapSize)
+{
+}
+
+HeapAllocator::~HeapAllocator()
+{
+    for (const auto &[pResource, placement] : _placements)
+        pResource->release();
+    for (Heap &heap : _heaps)
+        GpuMemory::release(heap.pHeap);
+    _pDevice->release();
+}
+
+HeapAllocator::Placement HeapAllocator::place(const MTL::SizeAndAlign &sizeAndAlign, MTL::StorageMode storageMode)
+{
+    for (uint32_t heap = 0; heap < _heaps.size(); ++heap)
+    {
+        if (_heaps[heap].storageMode != storageMode)
+            continue;
+        const TlsfAllocator::Allocation allocation =
+            _heaps[heap].allocator.allocate(sizeAndAlign.size, sizeAndAlign.align);
+        if (allocation.valid())
+            return {heap, allocation};
+    }
+
+    const size_t heapSize = std::max<size_t>(_heapSize, sizeAndAlign.size);
+    MTL::HeapDescriptor *pDesc = MTL::HeapDescriptor::alloc()->init();
+    pDesc->setType(MTL::HeapTypePlacement);
+    pDesc->setStorageMode(storageMode);
+    pDesc->setHazardTrackingMode(MTL::HazardTrackingModeTracked);
+    pDesc->setSize(heapSize);
+    MTL::Heap *pHeap = _pDevice->newHeap(pDesc);
+    pDesc->release();
+    assert(pHeap);
+    GpuMemory::track(pHeap, MemoryCategory::Heaps, "heapAllocator");
+
+    _heaps.push_back({pHeap, storageMode, TlsfAllocator(heapSize, Granularity)});
+    const TlsfAllocator::Allocation allocation =
+        _heaps.back().allocator.allocate(sizeAndAlign.size, sizeAndAlign.align);
+    assert(allocation.valid());
+    return {uint32_t(_heaps.size() - 1), allocation};
+}
+
+MTL::Buffer *HeapAllocator::newBuffer(size_t length, MTL::StorageMode storageMode)
+{
+    const MTL::ResourceOptions options =
+        MTL::ResourceOptions(storageMode) << ResourceStorageModeShift | MTL::ResourceHazardTrackingModeTracked;
+    const Placement placement = place(_pDevice->heapBufferSizeAndAlign(length, options), storageMode);
+    MTL::Buffer *pBuffer = _heaps[placement.heap].pHeap->newBuffer(length, options, placement.allocation.offset);
+    assert(pBuffer);
+    _placements[pBuffer] = placement;
+    return pBuffer;
+}
+
+MTL::Texture *HeapAllocator::newTexture(const MTL::TextureDescriptor *pDesc)
+{
+    const Placement placement = place(_pDevice->heapTextureSizeAndAlign(pDesc), pDesc->storageMode());
+    MTL::Texture *pTexture = _heaps[placement.heap].pHeap->newTexture(pDesc, placement.allocation.offset);
+    assert(pTexture);
+    _placements[pTexture] = placement;
+    return pTexture;
+}
+
+void HeapAllocator::free(MTL::Resource *pResource)
+{
+    auto it = _placements.find(pResource);
+    assert(it != _placements.end());
+    _heaps[it->second.heap].allocator.free(it->second.allocation);
+    _placements.erase(it);
+    pResource->release();
+}
+
+TlsfAllocator::Stats HeapAllocator::stats() const
+{
+    TlsfAllocator::Stats total = {};
+    for (const Heap &heap : _heaps)
+    {
+        const TlsfAllocator::Stats stats = heap.allocator.stats();
+        total.capacity += stats.capacity;
+        total.usedSize += stats.usedSize;
+        total.largestFreeBlock = std::max(total.largestFreeBlock, stats.largestFreeBlock);
+        total.allocationCount += stats.allocationCount;
+        total.freeBlockCount += stats.freeBlockCount;
+    }
+    const uint64_t freeSize = total.capacity - total.usedSize;
+    total.fragmentation = freeSize > 0 ? 1.0f - float(total.largestFreeBlock) / float(freeSize) : 0.0f;
+    return total;
+}
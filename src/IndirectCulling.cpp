@@ -0,0 +1,28 @@
+#include "IndirectCulling.h"
+
+namespace IndirectCulling
+{
+size_t cullAndCompact(const Frustum &frustum, const CullObject *pObjects, size_t objectCount,
+                      DrawIndexedArguments *pOut)
+{
+    // Whether an object is visible is close to random in object order, so there are no branches to mispredict: every
+    // plane is tested, and every object's arguments are written to the next slot, which only a visible one keeps. The
+    // slot is at most the object's own index, so pOut needs no room beyond objectCount.
+    size_t visibleCount = 0;
+    for (size_t i = 0; i < objectCount; ++i)
+    {
+        const CullObject &object = pObjects[i];
+        const Sphere &s = object.bounds;
+        bool visible = object.instanceCount != 0;
+        for (const Plane &p : frustum.planes)
+            visible &= p.signedDistance(s.x, s.y, s.z) >= -s.radius;
+
+        // MTL::IndexTypeUInt16 == 0, so the byte offset is shifted by 1 for 16-bit indices and 2 for 32-bit ones.
+        const uint32_t indexShift = object.indexType == 0 ? 1 : 2;
+        pOut[visibleCount] = {object.indexCount, object.instanceCount, object.indexOffset >> indexShift,
+                              object.baseVertex, object.baseInstance};
+        visibleCount += visible;
+    }
+    return visibleCount;
+}
+} // namespace IndirectCulling
@@ -0,0 +1,114 @@
+#include "IndirectDrawPass.h"
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+
+#include "GpuMemory.h"
+
+IndirectDrawPass::IndirectDrawPass(MTL::Device *pDevice, MTL::Library *pLibrary, size_t maxObjects,
+                                   size_t framesInFlight)
+    : _pDevice(pDevice->retain()), _maxObjects(maxObjects)
+{
+    using NS::StringEncoding::UTF8StringEncoding;
+
+    NS::Error *pError = nullptr;
+    MTL::Function *pCullFunction = pLibrary->newFunction(NS::String::string("cullAndEncode", UTF8StringEncoding));
+    _pCullPSO = _pDevice->newComputePipelineState(pCullFunction, &pError);
+    if (!_pCullPSO)
+    {
+        std::cerr << pError->localizedDescription()->utf8String();
+        assert(false);
+    }
+
+    MTL::IndirectCommandBufferDescriptor *pDesc = MTL::IndirectCommandBufferDescriptor::alloc()->init();
+    pDesc->setCommandTypes(MTL::IndirectCommandTypeDrawIndexed);
+    pDesc->setInheritPipelineState(true);
+    pDesc->setInheritBuffers(true);
+
+    MTL::ArgumentEncoder *pArgumentEncoder = pCullFunction->newArgumentEncoder(5);
+    for (size_t i = 0; i < framesInFlight; ++i)
+    {
+        Frame frame = {};
+        frame.pCommandBuffer =
+            GpuMemory::track(_pDevice->newIndirectCommandBuffer(pDesc, maxObjects, MTL::ResourceStorageModePrivate),
+                             MemoryCategory::Other, "indirectCommands");
+        frame.pArgumentBuffer =
+            GpuMemory::track(_pDevice->newBuffer(pArgumentEncoder->encodedLength(), MTL::ResourceStorageModeShared),
+                             MemoryCategory::ArgumentBuffers, "indirectArguments");
+        pArgumentEncoder->setArgumentBuffer(frame.pArgumentBuffer, 0);
+        pArgumentEncoder->setIndirectCommandBuffer(frame.pCommandBuffer, 0);
+        frame.pObjectBuffer =
+            GpuMemory::track(_pDevice->newBuffer(maxObjects * sizeof(CullObject), MTL::ResourceStorageModeManaged),
+                             MemoryCategory::Instances, "cullObjects");
+        frame.pExecutionRangeBuffer = GpuMemory::track(
+            _pDevice->newBuffer(sizeof(MTL::IndirectCommandBufferExecutionRange), MTL::ResourceStorageModePrivate),
+            MemoryCategory::Other, "executionRange");
+        _frames.push_back(frame);
+    }
+
+    pArgumentEncoder->release();
+    pDesc->release();
+    pCullFunction->release();
+}
+
+IndirectDrawPass::~IndirectDrawPass()
+{
+    for (const Frame &frame : _frames)
+    {
+        GpuMemory::release(frame.pExecutionRangeBuffer);
+        GpuMemory::release(frame.pObjectBuffer);
+        GpuMemory::release(frame.pArgumentBuffer);
+        GpuMemory::release(frame.pCommandBuffer);
+    }
+    _pCullPSO->release();
+    _pDevice->release();
+}
+
+void IndirectDrawPass::setObjects(const CullObject *pObjects, size_t objectCount, size_t frame)
+{
+    assert(objectCount <= _maxObjects);
+
+    Frame &resources = _frames[frame];
+    resources.objectCount = uint32_t(objectCount);
+    if (objectCount == 0)
+        return;
+    memcpy(resources.pObjectBuffer->contents(), pObjects, objectCount * sizeof(CullObject));
+    resources.pObjectBuffer->didModifyRange(NS::Range::Make(0, objectCount * sizeof(CullObject)));
+}
+
+void IndirectDrawPass::encodeCulling(MTL::CommandBuffer *pCmd, const Frustum &frustum, MTL::Buffer *pIndexBuffer,
+                                     size_t frame)
+{
+    const Frame &resources = _frames[frame];
+    const uint32_t objectCount = resources.objectCount;
+
+    MTL::BlitCommandEncoder *pBlit = pCmd->blitCommandEncoder();
+    pBlit->fillBuffer(resources.pExecutionRangeBuffer, NS::Range::Make(0, resources.pExecutionRangeBuffer->length()),
+                      0);
+    pBlit->endEncoding();
+
+    MTL::ComputeCommandEncoder *pEnc = pCmd->computeCommandEncoder();
+    pEnc->setComputePipelineState(_pCullPSO);
+    pEnc->setBytes(&frustum, sizeof(frustum), 0);
+    pEnc->setBuffer(resources.pObjectBuffer, 0, 1);
+    pEnc->setBytes(&objectCount, sizeof(objectCount), 2);
+    pEnc->setBuffer(pIndexBuffer, 0, 3);
+    pEnc->setBuffer(resources.pExecutionRangeBuffer, 0, 4);
+    pEnc->setBuffer(resources.pArgumentBuffer, 0, 5);
+    pEnc->useResource(resources.pCommandBuffer, MTL::ResourceUsageWrite);
+
+    const NS::UInteger threadgroupSize = _pCullPSO->maxTotalThreadsPerThreadgroup() < 64
+                                             ? _pCullPSO->maxTotalThreadsPerThreadgroup()
+                                             : 64;
+    pEnc->dispatchThreads(MTL::Size::Make(objectCount ? objectCount : 1, 1, 1),
+                          MTL::Size::Make(threadgroupSize, 1, 1));
+    pEnc->endEncoding();
+}
+
+void IndirectDrawPass::execute(MTL::RenderCommandEncoder *pEnc, MTL::Buffer *pIndexBuffer, size_t frame)
+{
+    const Frame &resources = _frames[frame];
+    pEnc->useResource(pIndexBuffer, MTL::ResourceUsageRead);
+    pEnc->executeCommandsInBuffer(resources.pCommandBuffer, resources.pExecutionRangeBuffer, 0);
+}
@@ -0,0 +1,134 @@
+#include "InstancePacking.h"
+
+#include <cassert>
+#include <cstring>
+
+#include "JobSystem.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+void InstanceSoA::resize(size_t count)
+{
+    for (std::vector<float> *pComponent : {&positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ,
+                                           &rotationW, &scaleX, &scaleY, &scaleZ})
+        pComponent->resize(count);
+    materialIndex.resize(count);
+    color.resize(count);
+}
+
+void InstanceSoA::set(size_t i, const float position[3], const float rotation[4], const float scale[3],
+                      uint32_t material, uint32_t rgba)
+{
+    positionX[i] = position[0];
+    positionY[i] = position[1];
+    positionZ[i] = position[2];
+    rotationX[i] = rotation[0];
+    rotationY[i] = rotation[1];
+    rotationZ[i] = rotation[2];
+    rotationW[i] = rotation[3];
+    scaleX[i] = scale[0];
+    scaleY[i] = scale[1];
+    scaleZ[i] = scale[2];
+    materialIndex[i] = material;
+    color[i] = rgba;
+}
+
+namespace
+{
+// Output records per parallel range: 256 KB of InstanceData, enough to amortize the dispatch.
+const size_t ChunkSize = 4 * 1024;
+
+// index maps an output slot to the instance it reads, so the contiguous and gathered variants share one loop.
+template <typename Index>
+void packInstances(const InstanceSoA &instances, size_t begin, size_t end, InstanceData *pOut, Index index)
+{
+    const float *px = instances.positionX.data();
+    const float *py = instances.positionY.data();
+    const float *pz = instances.positionZ.data();
+    const float *qx = instances.rotationX.data();
+    const float *qy = instances.rotationY.data();
+    const float *qz = instances.rotationZ.data();
+    const float *qw = instances.rotationW.data();
+    const float *sx = instances.scaleX.data();
+    const float *sy = instances.scaleY.data();
+    const float *sz = instances.scaleZ.data();
+    const uint32_t *pMaterial = instances.materialIndex.data();
+    const uint32_t *pColor = instances.color.data();
+
+    for (size_t o = begin; o < end; ++o)
+    {
+        const size_t i = index(o);
+        const float x = qx[i], y = qy[i], z = qz[i], w = qw[i];
+        const float xx = x * x, yy = y * y, zz = z * z;
+        const float xy = x * y, xz = x * z, yz = y * z;
+        const float wx = w * x, wy = w * y, wz = w * z;
+
+        alignas(16) InstanceData instance;
+        instance.rows[0][0] = (1.0f - 2.0f * (yy + zz)) * sx[i];
+        instance.rows[0][1] = 2.0f * (xy - wz) * sy[i];
+        instance.rows[0][2] = 2.0f * (xz + wy) * sz[i];
+        instance.rows[0][3] = px[i];
+        instance.rows[1][0] = 2.0f * (xy + wz) * sx[i];
+        instance.rows[1][1] = (1.0f - 2.0f * (xx + zz)) * sy[i];
+        instance.rows[1][2] = 2.0f * (yz - wx) * sz[i];
+        instance.rows[1][3] = py[i];
+        instance.rows[2][0] = 2.0f * (xz - wy) * sx[i];
+        instance.rows[2][1] = 2.0f * (yz + wx) * sy[i];
+        instance.rows[2][2] = (1.0f - 2.0f * (xx + yy)) * sz[i];
+        instance.rows[2][3] = pz[i];
+        instance.materialIndex = pMaterial[i];
+        instance.color = pColor[i];
+        instance.padding[0] = 0;
+        instance.padding[1] = 0;
+
+#if defined(__SSE2__)
+        // Mapped GPU memory is never read back, so skip the read-for-ownership of a regular store when aligned.
+        if ((reinterpret_cast<uintptr_t>(pOut + o) & 15) == 0)
+        {
+            const __m128i *pSrc = reinterpret_cast<const __m128i *>(&instance);
+            __m128i *pDst = reinterpret_cast<__m128i *>(pOut + o);
+            _mm_stream_si128(pDst + 0, _mm_load_si128(pSrc + 0));
+            _mm_stream_si128(pDst + 1, _mm_load_si128(pSrc + 1));
+            _mm_stream_si128(pDst + 2, _mm_load_si128(pSrc + 2));
+            _mm_stream_si128(pDst + 3, _mm_load_si128(pSrc + 3));
+            continue;
+        }
+#endif
+        memcpy(pOut + o, &instance, sizeof(instance));
+    }
+
+#if defined(__SSE2__)
+    _mm_sfence();
+#endif
+}
+
+// Every range fences its own streaming stores, so the records are visible once parallelFor returns.
+template <typename Index>
+void packRanges(const InstanceSoA &instances, size_t count, InstanceData *pOut, Index index, JobSystem *pJobs)
+{
+    if (!pJobs || count <= ChunkSize)
+    {
+        packInstances(instances, 0, count, pOut, index);
+        return;
+    }
+    pJobs->parallelFor(count, ChunkSize,
+                       [&](size_t begin, size_t end) { packInstances(instances, begin, end, pOut, index); });
+}
+} // namespace
+
+namespace InstancePacking
+{
+void pack(const InstanceSoA &instances, size_t first, size_t count, InstanceData *pOut, JobSystem *pJobs)
+{
+    assert(first + count <= instances.size());
+    packRanges(instances, count, pOut, [first](size_t o) { return first + o; }, pJobs);
+}
+
+void packIndexed(const InstanceSoA &instances, const uint32_t *pIndices, size_t count, InstanceData *pOut,
+                 JobSystem *pJobs)
+{
+    packRanges(instances, count, pOut, [pIndices](size_t o) { return size_t(pIndices[o]); }, pJobs);
+}
+} // namespace InstancePacking
@@ -0,0 +1,82 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+
+JobSystem::JobSystem(size_t threadCount)
+{
+    for (size_t i = 1; i < std::max<size_t>(threadCount, 1); ++i)
+        _workers.emplace_back(&JobSystem::workerLoop, this);
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _quit = true;
+    }
+    _wake.notify_all();
+    for (std::thread &worker : _workers)
+        worker.join();
+}
+
+void JobSystem::parallelFor(size_t count, size_t grainSize, const RangeFunction &function)
+{
+    grainSize = std::max<size_t>(grainSize, 1);
+    if (count == 0)
+        return;
+    if (_workers.empty() || count <= grainSize)
+    {
+        function(0, count);
+        return;
+    }
+
+    std::lock_guard<std::mutex> dispatchLock(_dispatchMutex);
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _pFunction = &function;
+        _count = count;
+        _grainSize = grainSize;
+        _next.store(0, std::memory_order_relaxed);
+        _busyWorkers = _workers.size();
+        ++_generation;
+    }
+    _wake.notify_all();
+
+    runChunks();
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _done.wait(lock, [this] { return _busyWorkers == 0; });
+    _pFunction = nullptr;
+}
+
+void JobSystem::workerLoop()
+{
+    uint64_t seenGeneration = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [&] { return _quit || _generation != seenGeneration; });
+            if (_quit)
+                return;
+            seenGeneration = _generation;
+        }
+
+        runChunks();
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (--_busyWorkers == 0)
+            _done.notify_one();
+    }
+}
+
+void JobSystem::runChunks()
+{
+    for (;;)
+    {
+        const size_t begin = _next.fetch_add(_grainSize, std::memory_order_relaxed);
+        if (begin >= _count)
+            return;
+        (*_pFunction)(begin, std::min(begin + _grainSize, _count));
+    }
+}
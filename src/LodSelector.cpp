@@ -0,0 +1,200 @@
+#include "LodSelector.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#include "Float8.h"
+#include "JobSystem.h"
+
+namespace
+{
+const size_t ChunkSize = 16 * 1024;
+
+// Transition histogram over projected errors from 2^-16 to 2^16 pixels, eight bins per octave. A bin is the
+// exponent and top three mantissa bits of the float, which orders positive floats like their values.
+const uint32_t BinShift = 20;
+const uint32_t FirstBinKey = (127 - 16) << 3;
+const uint32_t BinCount = 32 << 3;
+
+uint32_t binOf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const uint32_t key = bits >> BinShift;
+    return key <= FirstBinKey ? 0 : std::min(key - FirstBinKey, BinCount - 1);
+}
+
+float binStart(uint32_t bin)
+{
+    const uint32_t bits = (bin + FirstBinKey) << BinShift;
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+template <typename Function> void forEachChunk(size_t count, JobSystem *pJobs, const Function &function)
+{
+    const size_t chunkCount = (count + ChunkSize - 1) / ChunkSize;
+    auto run = [&](size_t firstChunk, size_t lastChunk) {
+        for (size_t chunk = firstChunk; chunk < lastChunk; ++chunk)
+            function(chunk, chunk * ChunkSize, std::min((chunk + 1) * ChunkSize, count));
+    };
+    if (pJobs && chunkCount > 1)
+        pJobs->parallelFor(chunkCount, 1, run);
+    else
+        run(0, chunkCount);
+}
+} // namespace
+
+float LodSelector::projectionScale(float viewportHeight, float fovY)
+{
+    return 0.5f * viewportHeight / std::tan(0.5f * fovY);
+}
+
+LodSelector::LodSelector(const Settings &settings) : _settings(settings)
+{
+}
+
+uint32_t LodSelector::addMesh(const Lod *pLods, uint32_t lodCount)
+{
+    assert(lodCount > 0 && lodCount <= MaxLods);
+
+    Mesh mesh = {};
+    mesh.lodCount = lodCount;
+    for (uint32_t lod = 0; lod < lodCount; ++lod)
+    {
+        assert(lod == 0 || pLods[lod].error >= pLods[lod - 1].error);
+        mesh.error[lod] = pLods[lod].error;
+        mesh.triangleCount[lod] = pLods[lod].triangleCount;
+    }
+    _meshes.push_back(mesh);
+    return uint32_t(_meshes.size() - 1);
+}
+
+// Pixels per world unit of error at each sphere's nearest point, eight spheres at a time.
+void LodSelector::computeScales(const View &view, const FrustumCulling::SphereSoA &bounds, size_t begin, size_t end)
+{
+    const Float8 cameraX = Float8::set(view.position[0]), cameraY = Float8::set(view.position[1]);
+    const Float8 cameraZ = Float8::set(view.position[2]);
+    const Float8 nearDistance = Float8::set(_settings.nearDistance);
+    const Float8 scale = Float8::set(view.projectionScale);
+
+    auto scales = [&](const float *x, const float *y, const float *z, const float *radius, float *pOut) {
+        const Float8 dx = Float8::load(x) - cameraX, dy = Float8::load(y) - cameraY, dz = Float8::load(z) - cameraZ;
+        const Float8 distance = (dx * dx + dy * dy + dz * dz).sqrt() - Float8::load(radius);
+        (scale / Float8::max(distance, nearDistance)).store(pOut);
+    };
+
+    size_t first = begin;
+    for (; first + 8 <= end; first += 8)
+        scales(bounds.x + first, bounds.y + first, bounds.z + first, bounds.radius + first, _scales.data() + first);
+
+    if (first < end)
+    {
+        const size_t lanes = end - first;
+        float storage[5][8] = {};
+        memcpy(storage[0], bounds.x + first, lanes * sizeof(float));
+        memcpy(storage[1], bounds.y + first, lanes * sizeof(float));
+        memcpy(storage[2], bounds.z + first, lanes * sizeof(float));
+        memcpy(storage[3], bounds.radius + first, lanes * sizeof(float));
+        scales(storage[0], storage[1], storage[2], storage[3], storage[4]);
+        memcpy(_scales.data() + first, storage[4], lanes * sizeof(float));
+    }
+}
+
+// Lowering the threshold below error[lod] * scale moves an object from lod to lod - 1, adding the difference in
+// triangles to that projected error's bin. coarsest receives the triangles with every object at its coarsest LOD.
+void LodSelector::binTransitions(const uint32_t *pMeshes, size_t begin, size_t end, uint64_t *pHistogram,
+                                 uint64_t &coarsest)
+{
+    for (size_t i = begin; i < end; ++i)
+    {
+        const Mesh &mesh = _meshes[pMeshes[i]];
+        const float scale = _scales[i];
+        coarsest += mesh.triangleCount[mesh.lodCount - 1];
+        for (uint32_t lod = 1; lod < mesh.lodCount; ++lod)
+            pHistogram[binOf(mesh.error[lod] * scale)] += mesh.triangleCount[lod - 1] - mesh.triangleCount[lod];
+    }
+}
+
+// Smallest threshold whose selection, without the dead band, fits the budget.
+float LodSelector::budgetThreshold(size_t chunkCount) const
+{
+    uint64_t triangles = 0;
+    for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+        triangles += _coarsestTriangles[chunk];
+    if (triangles > _settings.triangleBudget)
+        return FLT_MAX;
+
+    for (uint32_t bin = BinCount; bin-- > 0;)
+    {
+        uint64_t added = 0;
+        for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+            added += _histograms[chunk * BinCount + bin];
+        if (triangles + added > _settings.triangleBudget)
+        {
+            // Transitions beyond the last bin are not bounded by it.
+            return bin == BinCount - 1 ? FLT_MAX : binStart(bin + 1);
+        }
+        triangles += added;
+    }
+    return 0.0f;
+}
+
+uint64_t LodSelector::select(const View &view, const FrustumCulling::SphereSoA &bounds, const uint32_t *pMeshes,
+                             size_t count, uint8_t *pLods, JobSystem *pJobs)
+{
+    const size_t chunkCount = (count + ChunkSize - 1) / ChunkSize;
+    _scales.resize(count);
+    const bool budgeted = _settings.triangleBudget > 0;
+    if (budgeted)
+    {
+        _histograms.assign(chunkCount * BinCount, 0);
+        _coarsestTriangles.assign(chunkCount, 0);
+    }
+
+    forEachChunk(count, pJobs, [&](size_t chunk, size_t begin, size_t end) {
+        computeScales(view, bounds, begin, end);
+        if (budgeted)
+            binTransitions(pMeshes, begin, end, _histograms.data() + chunk * BinCount, _coarsestTriangles[chunk]);
+    });
+
+    // Objects coarsen only at threshold * (1 - hysteresis), so that is where the budget has to hold.
+    const float keep = 1.0f - std::clamp(_settings.hysteresis, 0.0f, 0.99f);
+    _threshold = _settings.errorThreshold;
+    if (budgeted)
+        _threshold = std::max(_threshold, std::min(budgetThreshold(chunkCount) / keep, FLT_MAX));
+    const float refine = _threshold, coarsen = _threshold * keep;
+
+    std::vector<uint64_t> chunkTriangles(chunkCount);
+    forEachChunk(count, pJobs, [&](size_t chunk, size_t begin, size_t end) {
+        uint64_t triangles = 0;
+        for (size_t i = begin; i < end; ++i)
+        {
+            const Mesh &mesh = _meshes[pMeshes[i]];
+            const float scale = _scales[i];
+
+            // fine is the coarsest LOD within the threshold, strict the coarsest within the tighter one. An object
+            // between the two keeps its LOD.
+            uint32_t fine = mesh.lodCount - 1;
+            while (fine > 0 && mesh.error[fine] * scale > refine)
+                --fine;
+            uint32_t strict = fine;
+            while (strict > 0 && mesh.error[strict] * scale > coarsen)
+                --strict;
+
+            const uint32_t lod = std::clamp(uint32_t(pLods[i]), strict, fine);
+            pLods[i] = uint8_t(lod);
+            triangles += mesh.triangleCount[lod];
+        }
+        chunkTriangles[chunk] = triangles;
+    });
+
+    uint64_t triangles = 0;
+    for (uint64_t chunk : chunkTriangles)
+        triangles += chunk;
+    return triangles;
+}
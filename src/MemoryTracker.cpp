@@ -0,0 +1,133 @@
+#include "MemoryTracker.h"
+
+#include <algorithm>
+#include <cassert>
+#include <ostream>
+#include <vector>
+
+namespace
+{
+void writeString(std::ostream &out, const char *text)
+{
+    out << '"';
+    const char *pRun = text ? text : "";
+    for (const char *c = pRun;; ++c)
+    {
+        const bool escape = *c == '"' || *c == '\\' || uint8_t(*c) < 0x20;
+        if (!escape)
+            continue;
+        out.write(pRun, c - pRun);
+        if (!*c)
+            break;
+        pRun = c + 1;
+
+        static const char Hex[] = "0123456789abcdef";
+        if (*c == '"' || *c == '\\')
+            out << '\\' << *c;
+        else if (*c == '\n')
+            out << "\\n";
+        else
+            out << "\\u00" << Hex[*c >> 4] << Hex[*c & 0xf];
+    }
+    out << '"';
+}
+} // namespace
+
+const char *memoryCategoryName(MemoryCategory category)
+{
+    static const char *const Names[] = {"Geometry", "Instances",       "Lights",  "Textures", "RenderTargets",
+                                        "Heaps",    "ArgumentBuffers", "Staging", "Other"};
+    static_assert(std::size(Names) == MemoryTracker::CategoryCount);
+    return size_t(category) < std::size(Names) ? Names[size_t(category)] : "Unknown";
+}
+
+MemoryTracker::MemoryTracker(const Settings &settings) : _settings(settings)
+{
+}
+
+void MemoryTracker::track(const void *pObject, uint64_t size, MemoryCategory category, const char *name,
+                          std::source_location location)
+{
+    assert(pObject && category < MemoryCategory::Count);
+    const Allocation allocation = {size, category, name, location.file_name(), location.line(), _frame};
+    [[maybe_unused]] const bool inserted = _allocations.try_emplace(pObject, allocation).second;
+    assert(inserted);
+
+    CategoryStats &stats = _categories[size_t(category)];
+    stats.bytes += size;
+    stats.highWater = std::max(stats.highWater, stats.bytes);
+    ++stats.allocations;
+    _bytes += size;
+    _highWater = std::max(_highWater, _bytes);
+}
+
+void MemoryTracker::untrack(const void *pObject)
+{
+    auto it = _allocations.find(pObject);
+    if (it == _allocations.end())
+        return;
+
+    CategoryStats &stats = _categories[size_t(it->second.category)];
+    stats.bytes -= it->second.size;
+    --stats.allocations;
+    _bytes -= it->second.size;
+    _allocations.erase(it);
+}
+
+bool MemoryTracker::endFrame()
+{
+    for (size_t i = 0; i < CategoryCount; ++i)
+    {
+        _categories[i].frameDelta = int64_t(_categories[i].bytes - _frameStartBytes[i]);
+        _frameStartBytes[i] = _categories[i].bytes;
+    }
+    _frameDelta = int64_t(_bytes - _frameStartTotal);
+    _frameStartTotal = _bytes;
+    ++_frame;
+
+    if (!_settings.budget)
+        return false;
+    const double threshold = double(_settings.budget) * _settings.warningFraction;
+    if (double(_bytes) < threshold * 0.75)
+        _warned = false;
+    if (_warned || double(_bytes) < threshold)
+        return false;
+    _warned = true;
+    return true;
+}
+
+void MemoryTracker::writeJson(std::ostream &out) const
+{
+    out << "{\"frame\":" << _frame << ",\"bytes\":" << _bytes << ",\"highWater\":" << _highWater
+        << ",\"frameDelta\":" << _frameDelta << ",\"budget\":" << _settings.budget << ",\"categories\":{";
+    for (size_t i = 0; i < CategoryCount; ++i)
+    {
+        const CategoryStats &stats = _categories[i];
+        out << (i ? "," : "");
+        writeString(out, memoryCategoryName(MemoryCategory(i)));
+        out << ":{\"bytes\":" << stats.bytes << ",\"highWater\":" << stats.highWater
+            << ",\"frameDelta\":" << stats.frameDelta << ",\"allocations\":" << stats.allocations << '}';
+    }
+
+    std::vector<const Allocation *> allocations;
+    allocations.reserve(_allocations.size());
+    for (const auto &[pObject, allocation] : _allocations)
+        allocations.push_back(&allocation);
+    std::sort(allocations.begin(), allocations.end(), [](const Allocation *a, const Allocation *b) {
+        return a->size != b->size ? a->size > b->size : a->frame < b->frame;
+    });
+
+    out << "},\"allocations\":[";
+    for (size_t i = 0; i < allocations.size(); ++i)
+    {
+        const Allocation &allocation = *allocations[i];
+        out << (i ? "," : "") << "{\"name\":";
+        writeString(out, allocation.name);
+        out << ",\"category\":";
+        writeString(out, memoryCategoryName(allocation.category));
+        out << ",\"size\":" << allocation.size << ",\"frame\":" << allocation.frame << ",\"file\":";
+        writeString(out, allocation.file);
+        out << ",\"line\":" << allocation.line << '}';
+    }
+    out << "]}";
+}
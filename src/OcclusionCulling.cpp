@@ -0,0 +1,228 @@
+#include "OcclusionCulling.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "Float8.h"
+
+namespace
+{
+// Vertices closer than this in clip w are treated as crossing the near plane.
+const float MinClipW = 1e-5f;
+
+const float LaneCenters[8] = {0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f};
+
+// Screen-space position of a clip-space point: x right and y down in pixels, z in [0, 1].
+struct ScreenVertex {
+    float x, y, z;
+};
+
+// Edge function of the directed edge a -> b; positive on the inside of a triangle with positive area.
+struct Edge {
+    float a, b, c;
+
+    static Edge make(const ScreenVertex &v0, const ScreenVertex &v1)
+    {
+        const float a = v0.y - v1.y;
+        const float b = v1.x - v0.x;
+        return {a, b, -(a * v0.x + b * v0.y)};
+    }
+};
+} // namespace
+
+OcclusionCuller::OcclusionCuller(uint32_t width, uint32_t height)
+    : _width(width), _height(height), _tilesX((width + TileWidth - 1) / TileWidth),
+      _tilesY((height + TileHeight - 1) / TileHeight)
+{
+    assert(width > 0 && height > 0);
+
+    _depth.resize(size_t(_tilesX) * _tilesY * TileWidth * TileHeight);
+    _tileMaxDepth.resize(size_t(_tilesX) * _tilesY);
+    clear();
+}
+
+void OcclusionCuller::clear()
+{
+    std::fill(_depth.begin(), _depth.end(), 1.0f);
+    std::fill(_tileMaxDepth.begin(), _tileMaxDepth.end(), 1.0f);
+}
+
+void OcclusionCuller::renderOccluder(const float *pPositions, size_t positionStride, const uint32_t *pIndices,
+                                     size_t indexCount, const float *m)
+{
+    assert(indexCount % 3 == 0);
+
+    const float halfWidth = 0.5f * float(_width), halfHeight = 0.5f * float(_height);
+    auto transform = [&](uint32_t index, ScreenVertex &out) {
+        const float *p = reinterpret_cast<const float *>(reinterpret_cast<const uint8_t *>(pPositions) +
+                                                         index * positionStride);
+        const float x = m[0] * p[0] + m[4] * p[1] + m[8] * p[2] + m[12];
+        const float y = m[1] * p[0] + m[5] * p[1] + m[9] * p[2] + m[13];
+        const float z = m[2] * p[0] + m[6] * p[1] + m[10] * p[2] + m[14];
+        const float w = m[3] * p[0] + m[7] * p[1] + m[11] * p[2] + m[15];
+        if (w < MinClipW)
+            return false;
+        const float inverseW = 1.0f / w;
+        out = {(x * inverseW + 1.0f) * halfWidth, (1.0f - y * inverseW) * halfHeight, z * inverseW};
+        return true;
+    };
+
+    for (size_t i = 0; i < indexCount; i += 3)
+    {
+        ScreenVertex v[3];
+        if (transform(pIndices[i], v[0]) && transform(pIndices[i + 1], v[1]) && transform(pIndices[i + 2], v[2]))
+            rasterizeTriangle(&v[0].x, &v[1].x, &v[2].x);
+    }
+}
+
+void OcclusionCuller::rasterizeTriangle(const float *p0, const float *p1, const float *p2)
+{
+    ScreenVertex v0 = {p0[0], p0[1], p0[2]}, v1 = {p1[0], p1[1], p1[2]}, v2 = {p2[0], p2[1], p2[2]};
+
+    float area = (v1.x - v0.x) * (v2.y - v0.y) - (v2.x - v0.x) * (v1.y - v0.y);
+    if (area == 0.0f || !std::isfinite(area))
+        return;
+    if (area < 0.0f)
+    {
+        std::swap(v1, v2);
+        area = -area;
+    }
+
+    // Pixel bounds, clamped to the tiled area so that partial edge tiles are filled like any other.
+    const float minX = std::max(std::min({v0.x, v1.x, v2.x}), 0.0f);
+    const float maxX = std::min(std::max({v0.x, v1.x, v2.x}), float(_tilesX * TileWidth) - 1.0f);
+    const float minY = std::max(std::min({v0.y, v1.y, v2.y}), 0.0f);
+    const float maxY = std::min(std::max({v0.y, v1.y, v2.y}), float(_tilesY * TileHeight) - 1.0f);
+    if (minX > maxX || minY > maxY)
+        return;
+
+    const uint32_t tileX0 = uint32_t(minX) / TileWidth, tileX1 = uint32_t(maxX) / TileWidth;
+    const uint32_t tileY0 = uint32_t(minY) / TileHeight, tileY1 = uint32_t(maxY) / TileHeight;
+
+    const Edge edges[3] = {Edge::make(v0, v1), Edge::make(v1, v2), Edge::make(v2, v0)};
+
+    // Depth plane z = zx * x + zy * y + zc.
+    const float zx = ((v1.z - v0.z) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.z - v0.z)) / area;
+    const float zy = ((v1.x - v0.x) * (v2.z - v0.z) - (v1.z - v0.z) * (v2.x - v0.x)) / area;
+    const float zc = v0.z - zx * v0.x - zy * v0.y;
+    const float triangleMaxZ = std::max({v0.z, v1.z, v2.z});
+    // The plane is farthest at one of the tile's corners; pick it by the signs of the gradient.
+    const float cornerX = zx > 0.0f ? float(TileWidth) : 0.0f;
+    const float cornerY = zy > 0.0f ? float(TileHeight) : 0.0f;
+
+    const Float8 laneX = Float8::load(LaneCenters);
+    const Float8 edgeA[3] = {Float8::set(edges[0].a), Float8::set(edges[1].a), Float8::set(edges[2].a)};
+    const Float8 edgeB[3] = {Float8::set(edges[0].b), Float8::set(edges[1].b), Float8::set(edges[2].b)};
+
+    for (uint32_t tileY = tileY0; tileY <= tileY1; ++tileY)
+    {
+        const float y = float(tileY * TileHeight);
+        for (uint32_t tileX = tileX0; tileX <= tileX1; ++tileX)
+        {
+            const size_t tile = size_t(tileY) * _tilesX + tileX;
+            const float x = float(tileX * TileWidth);
+
+            const float tileZ = std::min(zx * (x + cornerX) + zy * (y + cornerY) + zc, triangleMaxZ);
+            if (tileZ >= _tileMaxDepth[tile])
+                continue;
+
+            // Edge values at the first row's pixel centers; each row down adds b.
+            const Float8 px = laneX + Float8::set(x);
+            Float8 e[3];
+            for (int i = 0; i < 3; ++i)
+                e[i] = edgeA[i] * px + Float8::set(edges[i].b * (y + 0.5f) + edges[i].c);
+
+            const Float8 z = Float8::set(tileZ);
+            float *pDepth = _depth.data() + tile * TileWidth * TileHeight;
+            Float8 tileMax = Float8::set(0.0f);
+            for (uint32_t row = 0; row < TileHeight; ++row)
+            {
+                const Float8 inside = Float8::min(Float8::min(e[0], e[1]), e[2]);
+                Float8 depth = Float8::load(pDepth + row * TileWidth);
+                if (inside.nonNegativeMask())
+                {
+                    depth = Float8::selectNonNegative(inside, Float8::min(depth, z), depth);
+                    depth.store(pDepth + row * TileWidth);
+                }
+                tileMax = Float8::max(tileMax, depth);
+                for (int i = 0; i < 3; ++i)
+                    e[i] = e[i] + edgeB[i];
+            }
+            _tileMaxDepth[tile] = tileMax.maxLane();
+        }
+    }
+}
+
+bool OcclusionCuller::isVisible(const AABB &b, const float *m) const
+{
+    // The eight corners, one per lane.
+    const float cornersX[8] = {b.minX, b.maxX, b.minX, b.maxX, b.minX, b.maxX, b.minX, b.maxX};
+    const float cornersY[8] = {b.minY, b.minY, b.maxY, b.maxY, b.minY, b.minY, b.maxY, b.maxY};
+    const float cornersZ[8] = {b.minZ, b.minZ, b.minZ, b.minZ, b.maxZ, b.maxZ, b.maxZ, b.maxZ};
+    const Float8 x = Float8::load(cornersX), y = Float8::load(cornersY), z = Float8::load(cornersZ);
+
+    auto row = [&](int r) {
+        return x * Float8::set(m[r]) + y * Float8::set(m[4 + r]) + z * Float8::set(m[8 + r]) + Float8::set(m[12 + r]);
+    };
+    const Float8 w = row(3);
+    if ((w - Float8::set(MinClipW)).nonNegativeMask() != 0xff)
+        return true;
+
+    const Float8 half = Float8::set(0.5f);
+    const Float8 screenX = (row(0) / w * half + half) * Float8::set(float(_width));
+    const Float8 screenY = (half - row(1) / w * half) * Float8::set(float(_height));
+    const float minZ = (row(2) / w).minLane();
+
+    const float minX = screenX.minLane(), maxX = screenX.maxLane();
+    const float minY = screenY.minLane(), maxY = screenY.maxLane();
+    if (maxX < 0.0f || maxY < 0.0f || minX >= float(_width) || minY >= float(_height) || minZ > 1.0f)
+        return false;
+
+    // Every pixel the box touches, not just those whose centers it covers.
+    const uint32_t pixelX0 = uint32_t(std::max(minX, 0.0f));
+    const uint32_t pixelX1 = std::min(uint32_t(maxX), _width - 1);
+    const uint32_t pixelY0 = uint32_t(std::max(minY, 0.0f));
+    const uint32_t pixelY1 = std::min(uint32_t(maxY), _height - 1);
+
+    const Float8 nearest = Float8::set(minZ);
+    for (uint32_t tileY = pixelY0 / TileHeight; tileY <= pixelY1 / TileHeight; ++tileY)
+    {
+        for (uint32_t tileX = pixelX0 / TileWidth; tileX <= pixelX1 / TileWidth; ++tileX)
+        {
+            const size_t tile = size_t(tileY) * _tilesX + tileX;
+            if (_tileMaxDepth[tile] < minZ)
+                continue;
+
+            // Lanes of this tile inside the box's pixel range.
+            const uint32_t firstLane = std::max(pixelX0, tileX * TileWidth) - tileX * TileWidth;
+            const uint32_t lastLane = std::min(pixelX1, tileX * TileWidth + TileWidth - 1) - tileX * TileWidth;
+            const uint32_t laneMask = (0xffu >> (TileWidth - 1 - lastLane)) & (0xffu << firstLane);
+            const uint32_t firstRow = std::max(pixelY0, tileY * TileHeight) - tileY * TileHeight;
+            const uint32_t lastRow = std::min(pixelY1, tileY * TileHeight + TileHeight - 1) - tileY * TileHeight;
+
+            const float *pDepth = _depth.data() + tile * TileWidth * TileHeight;
+            for (uint32_t row = firstRow; row <= lastRow; ++row)
+            {
+                if ((Float8::load(pDepth + row * TileWidth) - nearest).nonNegativeMask() & laneMask)
+                    return true;
+            }
+        }
+    }
+    return false;
+}
+
+size_t OcclusionCuller::cullAABBs(const FrustumCulling::AABBSoA &boxes, const uint32_t *pCandidates, size_t count,
+                                  const float *clipFromWorld, uint32_t *pVisible) const
+{
+    size_t visibleCount = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const uint32_t index = pCandidates[i];
+        const AABB bounds = {boxes.minX[index], boxes.minY[index], boxes.minZ[index],
+                             boxes.maxX[index], boxes.maxY[index], boxes.maxZ[index]};
+        if (isVisible(bounds, clipFromWorld))
+            pVisible[visibleCount++] = index;
+    }
+    return visibleCount;
+}
@@ -0,0 +1,86 @@
+#include "RangeAllocator.h"
+
+#include <cassert>
+#include <iterator>
+
+RangeAllocator::RangeAllocator(size_t capacity) { reset(capacity); }
+
+void RangeAllocator::reset(size_t capacity)
+{
+    _freeBlocks.clear();
+    if (capacity > 0)
+        _freeBlocks[0] = capacity;
+    _capacity = capacity;
+    _usedSize = 0;
+}
+
+void RangeAllocator::grow(size_t capacity)
+{
+    assert(capacity >= _capacity);
+    if (capacity == _capacity)
+        return;
+
+    const size_t oldCapacity = _capacity;
+    _capacity = capacity;
+    _usedSize += capacity - oldCapacity;
+    free(oldCapacity, capacity - oldCapacity);
+}
+
+size_t RangeAllocator::allocate(size_t size, size_t alignment)
+{
+    assert(size > 0 && alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+    for (auto it = _freeBlocks.begin(); it != _freeBlocks.end(); ++it)
+    {
+        const size_t blockOffset = it->first;
+        const size_t blockSize = it->second;
+        const size_t offset = (blockOffset + alignment - 1) & ~(alignment - 1);
+        if (offset + size > blockOffset + blockSize)
+            continue;
+
+        _freeBlocks.erase(it);
+        if (offset > blockOffset)
+            _freeBlocks[blockOffset] = offset - blockOffset;
+        if (offset + size < blockOffset + blockSize)
+            _freeBlocks[offset + size] = blockOffset + blockSize - (offset + size);
+
+        _usedSize += size;
+        return offset;
+    }
+
+    return InvalidOffset;
+}
+
+void RangeAllocator::free(size_t offset, size_t size)
+{
+    assert(offset + size <= _capacity && size <= _usedSize);
+    _usedSize -= size;
+
+    auto next = _freeBlocks.lower_bound(offset);
+    if (next != _freeBlocks.begin())
+    {
+        auto previous = std::prev(next);
+        assert(previous->first + previous->second <= offset);
+        if (previous->first + previous->second == offset)
+        {
+            offset = previous->first;
+            size += previous->second;
+            _freeBlocks.erase(previous);
+        }
+    }
+    if (next != _freeBlocks.end() && offset + size == next->first)
+    {
+        size += next->second;
+        _freeBlocks.erase(next);
+    }
+
+    _freeBlocks[offset] = size;
+}
+
+size_t RangeAllocator::largestFreeBlock() const
+{
+    size_t largest = 0;
+    for (const auto &block : _freeBlocks)
+        largest = block.second > largest ? block.second : largest;
+    return largest;
+}
@@ -0,0 +1,500 @@
+#include "RenderGraph.h"
+
+#include <algorithm>
+#include <cassert>
+#include <functional>
+#include <queue>
+
+namespace
+{
+uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+void addUnique(std::vector<RenderGraph::PassId> &passes, RenderGraph::PassId pass)
+{
+    if (std::find(passes.begin(), passes.end(), pass) == passes.end())
+        passes.push_back(pass);
+}
+
+// The MTL::PixelFormat depth and stencil formats, which go in the render pass's single depth/stencil slot.
+bool isDepthStencil(uint32_t pixelFormat)
+{
+    return pixelFormat == 250 || (pixelFormat >= 252 && pixelFormat <= 253) || pixelFormat == 255 ||
+           (pixelFormat >= 260 && pixelFormat <= 262);
+}
+} // namespace
+
+void RenderGraph::reset()
+{
+    _passes.clear();
+    _resources.clear();
+    _versions.clear();
+    _latestVersion.clear();
+    _order.clear();
+    _renderPasses.clear();
+    _attachmentTraffic = {};
+    _heapSize = 0;
+    _transientSize = 0;
+}
+
+RenderGraph::ResourceId RenderGraph::createTexture(const char *name, const TextureDesc &desc)
+{
+    assert(desc.size > 0 && desc.alignment > 0);
+
+    Resource resource;
+    resource.name = name;
+    resource.desc = desc;
+    resource.versionCount = 1;
+    _resources.push_back(std::move(resource));
+
+    const ResourceId version = ResourceId(_versions.size());
+    _versions.push_back({uint32_t(_resources.size() - 1), InvalidIndex, InvalidIndex, {}});
+    _latestVersion.push_back(version);
+    return version;
+}
+
+RenderGraph::ResourceId RenderGraph::importResource(const char *name)
+{
+    return importResource(name, TextureDesc{});
+}
+
+RenderGraph::ResourceId RenderGraph::importResource(const char *name, const TextureDesc &desc)
+{
+    Resource resource;
+    resource.name = name;
+    resource.desc = desc;
+    resource.imported = true;
+    resource.versionCount = 1;
+    _resources.push_back(std::move(resource));
+
+    const ResourceId version = ResourceId(_versions.size());
+    _versions.push_back({uint32_t(_resources.size() - 1), InvalidIndex, InvalidIndex, {}});
+    _latestVersion.push_back(version);
+    return version;
+}
+
+RenderGraph::PassId RenderGraph::addPass(const char *name, PassType type, std::function<void()> execute)
+{
+    Pass pass;
+    pass.name = name;
+    pass.type = type;
+    pass.execute = std::move(execute);
+    _passes.push_back(std::move(pass));
+    return PassId(_passes.size() - 1);
+}
+
+void RenderGraph::read(PassId pass, ResourceId resource)
+{
+    assert(pass < _passes.size() && resource < _versions.size());
+    _passes[pass].reads.push_back(resource);
+    _versions[resource].readers.push_back(pass);
+}
+
+RenderGraph::ResourceId RenderGraph::write(PassId pass, ResourceId resource)
+{
+    assert(pass < _passes.size() && resource < _versions.size());
+    const uint32_t index = _versions[resource].resource;
+    assert(_latestVersion[index] == resource && "only the latest version of a resource can be written");
+
+    const ResourceId version = ResourceId(_versions.size());
+    _versions.push_back({index, pass, resource, {}});
+    _latestVersion[index] = version;
+    ++_resources[index].versionCount;
+    _passes[pass].writes.push_back(version);
+    return version;
+}
+
+RenderGraph::ResourceId RenderGraph::writeAttachment(PassId pass, ResourceId resource, bool clear)
+{
+    assert(_passes[pass].type == PassType::Render);
+    const ResourceId version = write(pass, resource);
+    _passes[pass].attachments.push_back({version, true, clear});
+    return version;
+}
+
+void RenderGraph::readAttachment(PassId pass, ResourceId resource)
+{
+    assert(_passes[pass].type == PassType::Render);
+    read(pass, resource);
+    _passes[pass].attachments.push_back({resource, false, false});
+}
+
+void RenderGraph::compile()
+{
+    // A read depends on the version's writer. A write comes after whoever wrote or read the version it replaces.
+    _dependencies.assign(_passes.size(), {});
+
+    for (PassId pass = 0; pass < _passes.size(); ++pass)
+    {
+        for (ResourceId version : _passes[pass].reads)
+        {
+            if (_versions[version].writer != InvalidIndex && _versions[version].writer != pass)
+                addUnique(_dependencies[pass], _versions[version].writer);
+        }
+        for (ResourceId version : _passes[pass].writes)
+        {
+            const Version &replaced = _versions[_versions[version].replaced];
+            if (replaced.writer != InvalidIndex && replaced.writer != pass)
+                addUnique(_dependencies[pass], replaced.writer);
+            for (PassId reader : replaced.readers)
+            {
+                if (reader != pass)
+                    addUnique(_dependencies[pass], reader);
+            }
+        }
+    }
+
+    cullPasses();
+    sortPasses();
+    findLifetimes();
+    mergeRenderPasses();
+    chooseAttachmentActions();
+    placeTransients();
+}
+
+void RenderGraph::cullPasses()
+{
+    // Keep the passes writing imported resources, and transitively the writers of everything a kept pass reads.
+    std::vector<PassId> stack;
+    for (PassId pass = 0; pass < _passes.size(); ++pass)
+    {
+        Pass &p = _passes[pass];
+        p.culled = true;
+        for (ResourceId version : p.writes)
+        {
+            if (_resources[_versions[version].resource].imported)
+            {
+                p.culled = false;
+                stack.push_back(pass);
+                break;
+            }
+        }
+    }
+
+    while (!stack.empty())
+    {
+        const PassId pass = stack.back();
+        stack.pop_back();
+        for (ResourceId version : _passes[pass].reads)
+        {
+            const PassId writer = _versions[version].writer;
+            if (writer != InvalidIndex && _passes[writer].culled)
+            {
+                _passes[writer].culled = false;
+                stack.push_back(writer);
+            }
+        }
+    }
+}
+
+void RenderGraph::sortPasses()
+{
+    // Kahn's algorithm over the surviving passes, taking the earliest declared ready pass first, so passes declared
+    // in a valid order keep it.
+    std::vector<uint32_t> pendingCount(_passes.size(), 0);
+    std::vector<std::vector<PassId>> dependents(_passes.size());
+    size_t liveCount = 0;
+    for (PassId pass = 0; pass < _passes.size(); ++pass)
+    {
+        if (_passes[pass].culled)
+            continue;
+        ++liveCount;
+        for (PassId dependency : _dependencies[pass])
+        {
+            if (!_passes[dependency].culled)
+            {
+                ++pendingCount[pass];
+                dependents[dependency].push_back(pass);
+            }
+        }
+    }
+
+    std::priority_queue<PassId, std::vector<PassId>, std::greater<PassId>> ready;
+    for (PassId pass = 0; pass < _passes.size(); ++pass)
+    {
+        if (!_passes[pass].culled && pendingCount[pass] == 0)
+            ready.push(pass);
+    }
+
+    _order.clear();
+    while (!ready.empty())
+    {
+        const PassId pass = ready.top();
+        ready.pop();
+        _order.push_back(pass);
+        for (PassId dependent : dependents[pass])
+        {
+            if (--pendingCount[dependent] == 0)
+                ready.push(dependent);
+        }
+    }
+    assert(_order.size() == liveCount && "render graph has a dependency cycle");
+}
+
+void RenderGraph::findLifetimes()
+{
+    for (Resource &resource : _resources)
+    {
+        resource.firstUse = resource.lastUse = InvalidIndex;
+        resource.heapOffset = 0;
+        resource.memoryless = false;
+    }
+
+    for (uint32_t position = 0; position < _order.size(); ++position)
+    {
+        const Pass &pass = _passes[_order[position]];
+        for (const std::vector<ResourceId> *pVersions : {&pass.reads, &pass.writes})
+        {
+            for (ResourceId version : *pVersions)
+            {
+                Resource &resource = _resources[_versions[version].resource];
+                if (resource.firstUse == InvalidIndex)
+                    resource.firstUse = position;
+                resource.lastUse = position;
+            }
+        }
+    }
+}
+
+void RenderGraph::mergeRenderPasses()
+{
+    _renderPasses.clear();
+    for (uint32_t position = 0; position < _order.size(); ++position)
+    {
+        Pass &pass = _passes[_order[position]];
+        pass.renderPass = InvalidIndex;
+        if (pass.type != PassType::Render)
+            continue;
+
+        const bool follows = position > 0 && _passes[_order[position - 1]].type == PassType::Render;
+        if (!follows || !canMerge(_renderPasses.back(), pass))
+            _renderPasses.emplace_back();
+
+        RenderPass &renderPass = _renderPasses.back();
+        renderPass.passes.push_back(_order[position]);
+        pass.renderPass = uint32_t(_renderPasses.size() - 1);
+        for (const AttachmentUse &attachment : pass.attachments)
+        {
+            const uint32_t resource = _versions[attachment.version].resource;
+            auto same = [resource](const Attachment &a) { return a.resource == resource; };
+            if (std::find_if(renderPass.attachments.begin(), renderPass.attachments.end(), same) ==
+                renderPass.attachments.end())
+                renderPass.attachments.push_back({resource, LoadAction::DontCare, StoreAction::DontCare});
+        }
+    }
+}
+
+bool RenderGraph::inTile(const Pass &pass, ResourceId version) const
+{
+    for (const AttachmentUse &use : pass.attachments)
+    {
+        if (use.write ? _versions[use.version].replaced == version : use.version == version)
+            return true;
+    }
+    return false;
+}
+
+bool RenderGraph::canMerge(const RenderPass &renderPass, const Pass &pass) const
+{
+    if (pass.attachments.empty() || renderPass.attachments.empty())
+        return false;
+
+    // Reads of attachments, and of the version an attachment write replaces, happen in tile memory; any other read
+    // samples.
+    auto samples = [this](const Pass &p, uint32_t resource) {
+        for (ResourceId version : p.reads)
+        {
+            if (_versions[version].resource == resource && !inTile(p, version))
+                return true;
+        }
+        return false;
+    };
+
+    // Attachments of one render pass all have the same size, and none can be sampled while it is rendered to.
+    const TextureDesc &size = _resources[renderPass.attachments[0].resource].desc;
+    if (size.size == 0)
+        return false;
+    uint32_t colorCount = 0, depthCount = 0;
+    for (const Attachment &attachment : renderPass.attachments)
+    {
+        if (samples(pass, attachment.resource))
+            return false;
+        ++(isDepthStencil(_resources[attachment.resource].desc.pixelFormat) ? depthCount : colorCount);
+    }
+    for (const AttachmentUse &attachment : pass.attachments)
+    {
+        const uint32_t resource = _versions[attachment.version].resource;
+        const TextureDesc &desc = _resources[resource].desc;
+        if (desc.size == 0 || desc.width != size.width || desc.height != size.height ||
+            desc.sampleCount != size.sampleCount)
+            return false;
+        for (PassId other : renderPass.passes)
+        {
+            if (samples(_passes[other], resource))
+                return false;
+        }
+
+        auto same = [resource](const Attachment &a) { return a.resource == resource; };
+        if (std::find_if(renderPass.attachments.begin(), renderPass.attachments.end(), same) ==
+            renderPass.attachments.end())
+            ++(isDepthStencil(desc.pixelFormat) ? depthCount : colorCount);
+    }
+    return colorCount <= MaxColorAttachments && depthCount <= 1;
+}
+
+void RenderGraph::chooseAttachmentActions()
+{
+    _attachmentTraffic = {};
+    for (uint32_t index = 0; index < _renderPasses.size(); ++index)
+    {
+        RenderPass &renderPass = _renderPasses[index];
+        for (Attachment &attachment : renderPass.attachments)
+        {
+            const Resource &resource = _resources[attachment.resource];
+
+            // The first pass using the attachment decides the load, and the last version rendered the store: only
+            // passes after the render pass read it from memory, and one only read keeps its contents there.
+            bool first = true;
+            ResourceId last = InvalidIndex;
+            for (PassId pass : renderPass.passes)
+            {
+                for (const AttachmentUse &use : _passes[pass].attachments)
+                {
+                    if (_versions[use.version].resource != attachment.resource)
+                        continue;
+                    if (first)
+                    {
+                        const std::vector<ResourceId> &reads = _passes[pass].reads;
+                        const bool loads = !use.write || std::find(reads.begin(), reads.end(),
+                                                                   _versions[use.version].replaced) != reads.end();
+                        attachment.load = use.clear ? LoadAction::Clear
+                                          : loads   ? LoadAction::Load
+                                                    : LoadAction::DontCare;
+                        first = false;
+                    }
+                    if (use.write)
+                        last = use.version;
+                }
+            }
+
+            bool readLater = last != InvalidIndex && resource.imported;
+            if (last != InvalidIndex)
+            {
+                for (PassId reader : _versions[last].readers)
+                    readLater = readLater || (!_passes[reader].culled && _passes[reader].renderPass != index);
+            }
+            attachment.store = readLater ? StoreAction::Store : StoreAction::DontCare;
+
+            const uint64_t size = resource.desc.size;
+            _attachmentTraffic.plannedBytes +=
+                (attachment.load == LoadAction::Load ? size : 0) + (attachment.store == StoreAction::Store ? size : 0);
+        }
+    }
+
+    // A transient used by one render pass alone, neither loaded nor stored, only ever lives in tile memory.
+    for (const RenderPass &renderPass : _renderPasses)
+    {
+        for (const Attachment &attachment : renderPass.attachments)
+        {
+            Resource &resource = _resources[attachment.resource];
+            if (resource.imported || attachment.load == LoadAction::Load || attachment.store == StoreAction::Store)
+                continue;
+            const uint32_t first = _passes[_order[resource.firstUse]].renderPass;
+            const uint32_t last = _passes[_order[resource.lastUse]].renderPass;
+            if (first == last && first == _passes[renderPass.passes[0]].renderPass)
+            {
+                resource.memoryless = true;
+                _attachmentTraffic.memorylessBytes += resource.desc.size;
+            }
+        }
+    }
+
+    // Without merging, every render pass loads what it does not clear and stores everything it renders.
+    for (PassId pass : _order)
+    {
+        for (const AttachmentUse &use : _passes[pass].attachments)
+        {
+            const uint64_t size = resource(use.version).desc.size;
+            _attachmentTraffic.unmergedBytes += (use.clear ? 0 : size) + (use.write ? size : 0);
+        }
+    }
+}
+
+void RenderGraph::placeTransients()
+{
+    // Largest first, each at the lowest aligned offset clear of the transients already placed whose lifetimes
+    // overlap its own.
+    std::vector<uint32_t> transients;
+    for (uint32_t index = 0; index < _resources.size(); ++index)
+    {
+        const Resource &resource = _resources[index];
+        if (!resource.imported && !resource.memoryless && resource.firstUse != InvalidIndex)
+            transients.push_back(index);
+    }
+    std::sort(transients.begin(), transients.end(), [this](uint32_t a, uint32_t b) {
+        const Resource &ra = _resources[a], &rb = _resources[b];
+        return ra.desc.size != rb.desc.size ? ra.desc.size > rb.desc.size : ra.firstUse < rb.firstUse;
+    });
+
+    struct Interval {
+        uint64_t begin, end;
+    };
+    std::vector<Interval> occupied;
+    _heapSize = 0;
+    _transientSize = 0;
+    for (size_t placed = 0; placed < transients.size(); ++placed)
+    {
+        Resource &resource = _resources[transients[placed]];
+        occupied.clear();
+        for (size_t other = 0; other < placed; ++other)
+        {
+            const Resource &o = _resources[transients[other]];
+            if (o.firstUse <= resource.lastUse && resource.firstUse <= o.lastUse)
+                occupied.push_back({o.heapOffset, o.heapOffset + o.desc.size});
+        }
+        std::sort(occupied.begin(), occupied.end(), [](const Interval &a, const Interval &b) {
+            return a.begin < b.begin;
+        });
+
+        uint64_t offset = 0;
+        for (const Interval &interval : occupied)
+        {
+            if (interval.end <= offset)
+                continue;
+            if (interval.begin >= offset + resource.desc.size)
+                break;
+            offset = alignUp(interval.end, resource.desc.alignment);
+        }
+
+        resource.heapOffset = offset;
+        _heapSize = std::max(_heapSize, offset + resource.desc.size);
+        _transientSize += resource.desc.size;
+    }
+}
+
+void RenderGraph::execute() const
+{
+    for (PassId pass : _order)
+    {
+        if (_passes[pass].execute)
+            _passes[pass].execute();
+    }
+}
+
+void RenderGraph::execute(const std::function<void(uint32_t renderPass)> &begin,
+                          const std::function<void(uint32_t renderPass)> &end) const
+{
+    for (PassId pass : _order)
+    {
+        const uint32_t renderPass = _passes[pass].renderPass;
+        const std::vector<PassId> *pPasses = renderPass != InvalidIndex ? &_renderPasses[renderPass].passes : nullptr;
+        if (pPasses && pPasses->front() == pass)
+            begin(renderPass);
+        if (_passes[pass].execute)
+            _passes[pass].execute();
+        if (pPasses && pPasses->back() == pass)
+            end(renderPass);
+    }
+}
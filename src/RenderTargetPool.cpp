@@ -0,0 +1,65 @@
+#include "RenderTargetPool.h"
+
+#include <cassert>
+
+#include "GpuMemory.h"
+
+RenderTargetPool::RenderTargetPool(MTL::Device *pDevice, const TexturePool::Settings &settings)
+    : _pDevice(pDevice->retain()), _pool(settings)
+{
+}
+
+RenderTargetPool::~RenderTargetPool()
+{
+    _pool.clear(_removed);
+    releaseTextures();
+    _pDevice->release();
+}
+
+void RenderTargetPool::releaseTextures()
+{
+    for (void *pTexture : _removed)
+        GpuMemory::release(static_cast<MTL::Texture *>(pTexture));
+    _removed.clear();
+}
+
+void RenderTargetPool::beginFrame()
+{
+    _pool.beginFrame(++_frame, _removed);
+    releaseTextures();
+}
+
+MTL::Texture *RenderTargetPool::acquire(MTL::PixelFormat pixelFormat, uint32_t width, uint32_t height,
+                                        MTL::TextureUsage usage, MTL::StorageMode storageMode, uint32_t sampleCount)
+{
+    TexturePool::Descriptor desc;
+    desc.width = width;
+    desc.height = height;
+    desc.pixelFormat = uint32_t(pixelFormat);
+    desc.usage = uint32_t(usage);
+    desc.storageMode = uint32_t(storageMode);
+    desc.sampleCount = sampleCount;
+    if (void *pPooled = _pool.acquire(desc))
+        return static_cast<MTL::Texture *>(pPooled);
+
+    MTL::TextureDescriptor *pDesc = MTL::TextureDescriptor::alloc()->init();
+    pDesc->setTextureType(sampleCount > 1 ? MTL::TextureType2DMultisample : MTL::TextureType2D);
+    pDesc->setPixelFormat(pixelFormat);
+    pDesc->setWidth(width);
+    pDesc->setHeight(height);
+    pDesc->setSampleCount(sampleCount);
+    pDesc->setUsage(usage);
+    pDesc->setStorageMode(storageMode);
+    MTL::Texture *pTexture = _pDevice->newTexture(pDesc);
+    pDesc->release();
+    assert(pTexture);
+    GpuMemory::track(pTexture, MemoryCategory::RenderTargets, "renderTarget");
+
+    _pool.add(desc, pTexture, pTexture->allocatedSize());
+    return pTexture;
+}
+
+void RenderTargetPool::release(MTL::Texture *pTexture)
+{
+    _pool.release(pTexture);
+}
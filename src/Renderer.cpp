@@ -1,10 +1,12 @@
 #include "Renderer.h"
 
-#include <simd/vector_types.h>
-#include <sys/_types/_u_int32_t.h>
-
+#include <algorithm>
+#include <cmath>
 #include <cstring>
 
+#include "GeometryCodec.h"
+#include "GpuMemory.h"
+
 #include "Foundation/NSDictionary.hpp"
 #include "Foundation/NSError.hpp"
 #include "Foundation/NSString.hpp"
@@ -16,21 +18,87 @@
 #include "MetalKit/MTKTextureLoader.hpp"
 #include "MetalKit/MetalKitPrivate.hpp"
 
+namespace
+{
+// The scene is still drawn with an identity view-projection; lights are clustered for this camera until the
+// renderer has a real one.
+const float CameraFovY = 1.0f;
+const float CameraNear = 0.1f;
+const float CameraFar = 100.0f;
+// Points from the sun into the scene.
+const float SunDirection[3] = {-0.3f, -1.0f, -0.2f};
+// Rough GPU microseconds per unit of work, from which the async compute scheduler estimates pass costs.
+const float CullingCostPerObject = 0.05f;
+const float PassCostBase = 20.0f;
+const float DrawCostPerInstance = 0.02f;
+// The terrain is generated until it is loaded from a heightmap file, and seen from above its southern edge.
+const uint32_t TerrainSize = 1024; // heightmap samples per side
+const float TerrainEye[3] = {512.0f, 90.0f, -40.0f};
+const float TerrainTarget[3] = {512.0f, 0.0f, 400.0f};
+const float TerrainFar = 2000.0f;
+// The per-frame instance, light and shadow instance buffers are placed in heaps of this size.
+const size_t FrameHeapSize = size_t(8) << 20;
+// Meshes with visible instances in one frame, each an object of the GPU culling pass.
+const size_t MaxDrawnMeshes = 1024;
+// Instances are culled on the CPU, so each mesh's culling object covers them all.
+const Sphere CullObjectBounds = {0.0f, 0.0f, 0.0f, 1.2f};
+
+std::vector<uint16_t> generateHeights(uint32_t size)
+{
+    std::vector<uint16_t> heights(size_t(size) * size);
+    for (uint32_t z = 0; z < size; ++z)
+    {
+        for (uint32_t x = 0; x < size; ++x)
+        {
+            const float u = float(x) / float(size), v = float(z) / float(size);
+            const float h = 0.5f + 0.25f * std::sin(u * 9.0f) * std::cos(v * 7.0f) +
+                            0.15f * std::sin(u * 23.0f + v * 17.0f) + 0.05f * std::sin(u * 71.0f - v * 53.0f);
+            heights[size_t(z) * size + x] = uint16_t(std::clamp(h, 0.0f, 1.0f) * 65535.0f);
+        }
+    }
+    return heights;
+}
+} // namespace
+
 Renderer::Renderer(MTL::Device *pDevice) : _pDevice(pDevice->retain())
 {
+    GpuMemory::tracker().setBudget(_pDevice->recommendedMaxWorkingSetSize());
     _pCommandQueue = _pDevice->newCommandQueue();
+    _pComputeQueue = _pDevice->newCommandQueue();
+    _pFrameHeaps = new HeapAllocator(_pDevice, FrameHeapSize);
+    _pSyncEncoder = new SyncEncoder(_pDevice);
     buildShaders();
     buildTextures();
     buildBuffers();
+    buildTerrain();
+    buildIndirectDraws();
 }
 
 Renderer::~Renderer()
 {
-    _pTexture->release();
-    _pVertexPositionsBuffer->release();
-    _pVertexTextureCoordinatesBuffer->release();
-    _pVertexIndicesBuffer->release();
+    for (int i = 0; i < MaxFramesInFlight; ++i)
+        _frameSemaphore.acquire();
+    _retirement.complete(_retirement.endFrame());
+    releaseRetired();
+
+    // Releases the per-frame buffers still placed in the heaps.
+    delete _pFrameHeaps;
+    delete _pTerrain;
+    delete _pTransientHeap;
+    GpuMemory::release(_pMaterialBuffer);
+    delete _pBindlessTable;
+    _pTerrainTexture->release();
+    delete _pIndirectDrawPass;
+    delete _pGeometryPool;
+    delete _pUploader;
+    _pSceneDepthState->release();
+    _pShadowDepthState->release();
+    _pShadowPSO->release();
     _pPSO->release();
+    _pCullingLibrary->release();
+    _pShaderLibrary->release();
+    delete _pSyncEncoder;
+    _pComputeQueue->release();
     _pCommandQueue->release();
     _pDevice->release();
 }
@@ -52,21 +120,47 @@ const char *readFileToCharArray(const char *filepath)
     return charArray;
 }
 
-void Renderer::buildShaders()
+MTL::Library *newLibraryFromFile(MTL::Device *pDevice, const char *filepath)
 {
     using NS::StringEncoding::UTF8StringEncoding;
 
-    const char *pSource = readFileToCharArray("shaders/square.metal");
+    const char *pSource = readFileToCharArray(filepath);
     MTL::CompileOptions *pOptions = nullptr;
     NS::Error *pError = nullptr;
 
-    MTL::Library *pLibrary = _pDevice->newLibrary(NS::String::string(pSource, UTF8StringEncoding), pOptions, &pError);
+    MTL::Library *pLibrary = pDevice->newLibrary(NS::String::string(pSource, UTF8StringEncoding), pOptions, &pError);
     if (!pLibrary)
     {
         std::cerr << pError->localizedDescription()->utf8String();
         assert(false);
     }
 
+    delete[] pSource;
+    return pLibrary;
+}
+
+void Renderer::releaseRetired()
+{
+    _retirement.collect(_released);
+    for (void *pObject : _released)
+    {
+        // Placed buffers go back to their heap; everything else was allocated on its own.
+        MTL::Resource *pResource = static_cast<MTL::Resource *>(pObject);
+        if (_pFrameHeaps->placed(pResource))
+            _pFrameHeaps->free(pResource);
+        else
+            GpuMemory::release(static_cast<NS::Object *>(pObject));
+    }
+    _released.clear();
+}
+
+void Renderer::buildShaders()
+{
+    using NS::StringEncoding::UTF8StringEncoding;
+
+    NS::Error *pError = nullptr;
+    MTL::Library *pLibrary = newLibraryFromFile(_pDevice, "shaders/square.metal");
+
     MTL::Function *pVertexFunction = pLibrary->newFunction(NS::String::string("vertexMain", UTF8StringEncoding));
     MTL::Function *pFragmentFunction = pLibrary->newFunction(NS::String::string("fragmentMain", UTF8StringEncoding));
 
@@ -74,6 +168,8 @@ void Renderer::buildShaders()
     pDesc->setVertexFunction(pVertexFunction);
     pDesc->setFragmentFunction(pFragmentFunction);
     pDesc->colorAttachments()->object(0)->setPixelFormat(MTL::PixelFormat::PixelFormatBGRA8Unorm_sRGB);
+    pDesc->setDepthAttachmentPixelFormat(MTL::PixelFormat::PixelFormatDepth32Float);
+    pDesc->setSupportIndirectCommandBuffers(true);
 
     _pPSO = _pDevice->newRenderPipelineState(pDesc, &pError);
     if (!_pPSO)
@@ -82,12 +178,40 @@ void Renderer::buildShaders()
         assert(false);
     }
 
-    delete[] pSource;
-
     pVertexFunction->release();
     pFragmentFunction->release();
     pDesc->release();
     _pShaderLibrary = pLibrary;
+    _pCullingLibrary = newLibraryFromFile(_pDevice, "shaders/culling.metal");
+
+    // Depth-only pipeline for the cascades of the shadow atlas.
+    MTL::Library *pShadowLibrary = newLibraryFromFile(_pDevice, "shaders/shadow.metal");
+    MTL::Function *pShadowFunction =
+        pShadowLibrary->newFunction(NS::String::string("shadowVertex", UTF8StringEncoding));
+    MTL::RenderPipelineDescriptor *pShadowDesc = MTL::RenderPipelineDescriptor::alloc()->init();
+    pShadowDesc->setVertexFunction(pShadowFunction);
+    pShadowDesc->setDepthAttachmentPixelFormat(MTL::PixelFormat::PixelFormatDepth32Float);
+
+    _pShadowPSO = _pDevice->newRenderPipelineState(pShadowDesc, &pError);
+    if (!_pShadowPSO)
+    {
+        std::cerr << pError->localizedDescription()->utf8String();
+        assert(false);
+    }
+
+    MTL::DepthStencilDescriptor *pDepthDesc = MTL::DepthStencilDescriptor::alloc()->init();
+    pDepthDesc->setDepthCompareFunction(MTL::CompareFunction::CompareFunctionLess);
+    pDepthDesc->setDepthWriteEnabled(true);
+    _pShadowDepthState = _pDevice->newDepthStencilState(pDepthDesc);
+
+    pDepthDesc->setDepthCompareFunction(MTL::CompareFunction::CompareFunctionAlways);
+    pDepthDesc->setDepthWriteEnabled(false);
+    _pSceneDepthState = _pDevice->newDepthStencilState(pDepthDesc);
+
+    pDepthDesc->release();
+    pShadowFunction->release();
+    pShadowDesc->release();
+    pShadowLibrary->release();
 }
 
 void Renderer::buildTextures()
@@ -104,64 +228,417 @@ void Renderer::buildTextures()
         std::cerr << pError->localizedDescription()->utf8String();
         assert(false);
     }
-
-    _pTexture = pTexture;
+    GpuMemory::track(pTexture, MemoryCategory::Textures, "stone.png");
+
+    MTL::SamplerDescriptor *pSamplerDesc = MTL::SamplerDescriptor::alloc()->init();
+    pSamplerDesc->setMinFilter(MTL::SamplerMinMagFilterLinear);
+    pSamplerDesc->setMagFilter(MTL::SamplerMinMagFilterLinear);
+    pSamplerDesc->setSupportArgumentBuffers(true);
+    MTL::SamplerState *pSampler = _pDevice->newSamplerState(pSamplerDesc);
+    pSamplerDesc->release();
+
+    // Material 0, the only one so far: the stone texture, sampled linearly.
+    _pBindlessTable = new BindlessTable(_pDevice, MaxFramesInFlight);
+    const MaterialData stone = {DescriptorTable::index(_pBindlessTable->addTexture(pTexture)),
+                                DescriptorTable::index(_pBindlessTable->addSampler(pSampler)),
+                                {}};
+    // The table keeps a reference of its own, untracked once removed; this one textures the terrain.
+    _pTerrainTexture = pTexture;
+    pSampler->release();
+
+    _pMaterialBuffer = GpuMemory::track(_pDevice->newBuffer(&stone, sizeof(stone), MTL::ResourceStorageModeManaged),
+                                        MemoryCategory::Other, "materials");
+    _pTransientHeap = new TransientHeap(_pDevice, MaxFramesInFlight);
 }
 
 void Renderer::buildBuffers()
 {
     const size_t NumVertices = 4;
+    const size_t NumIndices = 6;
 
-    simd::float4 positions[NumVertices] = {
+    SimdMath::float4 positions[NumVertices] = {
         {+0.8f, +0.8f, 0.0f, 1.0f}, {-0.8f, +0.8f, 0.0f, 1.0f}, {-0.8f, -0.8f, 0.0f, 1.0f}, {+0.8f, -0.8f, 0.0f, 1.0f}};
 
-    simd::float2 textureCoordinates[NumVertices] = {{1.0f, 0.0f}, {0.0f, 0.0f}, {0.0f, 1.0f}, {1.0f, 1.0f}};
+    SimdMath::float2 textureCoordinates[NumVertices] = {{1.0f, 0.0f}, {0.0f, 0.0f}, {0.0f, 1.0f}, {1.0f, 1.0f}};
+
+    uint32_t indices[NumIndices] = {0, 1, 2, 2, 3, 0};
+
+    // Stream order matches the vertex buffer indices of vertexMain.
+    _pUploader = new StagingUploader(_pDevice, UploadBatcher::Settings{}, MaxFramesInFlight);
+    _pGeometryPool = new GeometryPool(_pDevice, _pUploader, {sizeof(SimdMath::float4), sizeof(SimdMath::float2)},
+                                      64 * 1024, 256 * 1024);
+
+    // Meshes are created from GeometryCodec-encoded data, as geometry packs store it, and decoded straight into
+    // staging. The quad is generated here, so it is encoded first.
+    const std::vector<uint8_t> encodedStreams[] = {
+        GeometryCodec::encodeVertexBuffer(positions, NumVertices, sizeof(SimdMath::float4)),
+        GeometryCodec::encodeVertexBuffer(textureCoordinates, NumVertices, sizeof(SimdMath::float2))};
+    const std::vector<uint8_t> encodedIndices = GeometryCodec::encodeIndexBuffer(indices, NumIndices);
+    const uint8_t *streams[] = {encodedStreams[0].data(), encodedStreams[1].data()};
+    const size_t streamSizes[] = {encodedStreams[0].size(), encodedStreams[1].size()};
+    const GeometryPool::MeshId quadMesh = _pGeometryPool->addEncodedMesh(
+        streams, streamSizes, NumVertices, encodedIndices.data(), encodedIndices.size(), NumIndices);
+
+    // The bounds radius is the quad's corner distance times the largest scale axis.
+    _world.create(TransformComponent{{0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f, 1.0f}, {1.0f, 1.0f, 1.0f}},
+                  RenderableComponent{quadMesh, 0, 0xffffffff, 1.132f});
+}
 
-    simd::ushort1 indices[NumVertices + 2] = {0, 1, 2, 2, 3, 0};
+void Renderer::buildTerrain()
+{
+    const std::vector<uint16_t> heights = generateHeights(TerrainSize);
+    TerrainQuadtree::Settings settings;
+    settings.lodCount = 5; // the coarsest nodes cover the whole heightmap
+    settings.heightScale = 60.0f;
+
+    MTL::Library *pLibrary = newLibraryFromFile(_pDevice, "shaders/terrain.metal");
+    _pTerrain = new TerrainRenderer(_pDevice, pLibrary, MTL::PixelFormat::PixelFormatBGRA8Unorm_sRGB,
+                                    MTL::PixelFormat::PixelFormatDepth32Float, heights.data(), TerrainSize,
+                                    TerrainSize, settings, MaxFramesInFlight);
+    pLibrary->release();
+}
 
-    const size_t positionsDataSize = NumVertices * sizeof(simd::float3);
-    const size_t textureCoordinatesDataSize = NumVertices * sizeof(simd::float3);
-    const size_t indicesDataSize = (NumVertices + 2) * sizeof(simd::ushort1);
+void Renderer::buildIndirectDraws()
+{
+    _pIndirectDrawPass = new IndirectDrawPass(_pDevice, _pCullingLibrary, MaxDrawnMeshes, MaxFramesInFlight);
+}
 
-    MTL::Buffer *pVertexPositionsBuffer = _pDevice->newBuffer(positionsDataSize, MTL::ResourceStorageModeManaged);
-    MTL::Buffer *pVertexTextureCoordinatesBuffer =
-        _pDevice->newBuffer(textureCoordinatesDataSize, MTL::ResourceStorageModeManaged);
-    MTL::Buffer *pVertexIndicesBuffer = _pDevice->newBuffer(indicesDataSize, MTL::ResourceStorageModeManaged);
+// Orders the listed instances by mesh, keeping list order within each mesh, so that every mesh's instances are one
+// instanced draw, and fills runs in mesh id order. Mesh ids index the pool's mesh array, so a counting sort does it
+// in two passes. Returns pIndices itself when all the instances share one mesh.
+const uint32_t *Renderer::groupByMesh(const uint32_t *pIndices, size_t count, std::vector<MeshRun> &runs)
+{
+    _meshStarts.clear();
+    for (size_t i = 0; i < count; ++i)
+    {
+        const GeometryPool::MeshId mesh = _instanceMesh[pIndices[i]];
+        if (mesh >= _meshStarts.size())
+            _meshStarts.resize(size_t(mesh) + 1, 0);
+        ++_meshStarts[mesh];
+    }
 
-    _pVertexPositionsBuffer = pVertexPositionsBuffer;
-    _pVertexTextureCoordinatesBuffer = pVertexTextureCoordinatesBuffer;
-    _pVertexIndicesBuffer = pVertexIndicesBuffer;
+    runs.clear();
+    uint32_t first = 0;
+    for (GeometryPool::MeshId mesh = 0; mesh < _meshStarts.size(); ++mesh)
+    {
+        const uint32_t meshCount = _meshStarts[mesh];
+        _meshStarts[mesh] = first;
+        if (meshCount > 0)
+            runs.push_back({mesh, first, meshCount});
+        first += meshCount;
+    }
+    if (runs.size() <= 1)
+        return pIndices;
 
-    memcpy(_pVertexPositionsBuffer->contents(), positions, positionsDataSize);
-    memcpy(_pVertexTextureCoordinatesBuffer->contents(), textureCoordinates, textureCoordinatesDataSize);
-    memcpy(_pVertexIndicesBuffer->contents(), indices, indicesDataSize);
+    _groupedInstances.resize(count);
+    for (size_t i = 0; i < count; ++i)
+        _groupedInstances[_meshStarts[_instanceMesh[pIndices[i]]]++] = pIndices[i];
+    return _groupedInstances.data();
+}
 
-    _pVertexPositionsBuffer->didModifyRange(NS::Range::Make(0, _pVertexPositionsBuffer->length()));
-    _pVertexTextureCoordinatesBuffer->didModifyRange(NS::Range::Make(0, _pVertexTextureCoordinatesBuffer->length()));
-    _pVertexIndicesBuffer->didModifyRange(NS::Range::Make(0, _pVertexIndicesBuffer->length()));
+// Gathers the renderable entities, frustum culls them and packs the survivors into this frame's instance buffer,
+// grouped by mesh, then points one indirect draw per mesh at its instances.
+void Renderer::updateInstances(const Frustum &frustum)
+{
+    _instances.resize(0);
+    _instanceRadius.clear();
+    _instanceMesh.clear();
+    _world.forEachChunk<const TransformComponent, const RenderableComponent>(
+        [this](size_t count, const Entity *, const TransformComponent *pTransforms,
+               const RenderableComponent *pRenderables) {
+            const size_t first = _instances.size();
+            _instances.resize(first + count);
+            for (size_t i = 0; i < count; ++i)
+            {
+                _instances.set(first + i, pTransforms[i].position, pTransforms[i].rotation, pTransforms[i].scale,
+                               pRenderables[i].material, pRenderables[i].color);
+                _instanceRadius.push_back(pRenderables[i].boundsRadius);
+                _instanceMesh.push_back(pRenderables[i].mesh);
+            }
+        });
+
+    _visibleInstances.resize(_instances.size());
+    const FrustumCulling::SphereSoA bounds = {_instances.positionX.data(), _instances.positionY.data(),
+                                              _instances.positionZ.data(), _instanceRadius.data()};
+    const size_t visibleCount =
+        FrustumCulling::cullSpheres(frustum, bounds, _instances.size(), _visibleInstances.data(), &_jobs);
+
+    const uint32_t *pGrouped = groupByMesh(_visibleInstances.data(), visibleCount, _meshRuns);
+
+    const size_t size = std::max<size_t>(visibleCount, 1) * sizeof(InstanceData);
+
+    MTL::Buffer *pBuffer = frameBuffer(_pInstanceBuffers[_frame], size);
+
+    InstancePacking::packIndexed(_instances, pGrouped, visibleCount, static_cast<InstanceData *>(pBuffer->contents()),
+                                 &_jobs);
+
+    // The pool moves meshes when it compacts or grows, so the draws' ranges are read back every frame.
+    assert(_meshRuns.size() <= MaxDrawnMeshes);
+    _cullObjects.resize(_meshRuns.size());
+    for (size_t i = 0; i < _meshRuns.size(); ++i)
+    {
+        const MeshRun &run = _meshRuns[i];
+        const GeometryPool::Mesh &mesh = _pGeometryPool->mesh(run.mesh);
+        CullObject &object = _cullObjects[i];
+        object = {};
+        object.bounds = CullObjectBounds;
+        object.indexCount = uint32_t(mesh.indexCount);
+        object.indexOffset = uint32_t(mesh.indexOffset);
+        object.baseVertex = int32_t(mesh.baseVertex);
+        object.indexType = uint32_t(mesh.indexType);
+        object.baseInstance = uint32_t(run.first);
+        object.instanceCount = uint32_t(run.count);
+    }
+    _pIndirectDrawPass->setObjects(_cullObjects.data(), _cullObjects.size(), _frame);
 }
 
-void Renderer::draw(MTK::View *pView)
+// Grows one of the buffers the CPU rewrites every frame, placing it in the frame heaps. They are shared, so the GPU
+// sees the writes without didModifyRange.
+MTL::Buffer *Renderer::frameBuffer(MTL::Buffer *&pBuffer, size_t size)
 {
-    NS::AutoreleasePool *pPool = NS::AutoreleasePool::alloc()->init();
+    if (!pBuffer || pBuffer->length() < size)
+    {
+        if (pBuffer)
+            retire(pBuffer);
+        pBuffer = _pFrameHeaps->newBuffer(size, MTL::StorageModeShared);
+    }
+    return pBuffer;
+}
+
+// Bins the world's lights into the cluster grid and writes the grid, lights and per-cluster index lists into this
+// frame's light buffer.
+void Renderer::updateLights(const float *viewMatrix, MTK::View *pView)
+{
+    const CGSize size = pView->drawableSize();
+    _lightClusters.setProjection(CameraFovY, float(std::max(size.width, 1.0)), float(std::max(size.height, 1.0)),
+                                 CameraNear, CameraFar);
+
+    _lights.clear();
+    _world.forEach<const LightComponent>([this](Entity, const LightComponent &light) { _lights.push_back(light); });
+    _lightClusters.build(viewMatrix, _lights.data(), _lights.size(), &_jobs);
+
+    const size_t bufferSize = _lightClusters.layout().size;
+    MTL::Buffer *pBuffer = frameBuffer(_pLightBuffers[_frame], bufferSize);
+
+    _lightClusters.write(pBuffer->contents(), &_jobs);
+}
+
+// Fits the cascades to the camera, culls the gathered instances against all of them at once and packs each
+// cascade's casters, grouped by mesh, after the previous cascade's in this frame's shadow instance buffer.
+void Renderer::updateShadows(const float *viewMatrix, MTK::View *pView)
+{
+    const CGSize size = pView->drawableSize();
+    const CascadedShadows::Camera camera = {viewMatrix, CameraFovY,
+                                            float(std::max(size.width, 1.0) / std::max(size.height, 1.0)), CameraNear};
+    _shadows.update(camera, SunDirection);
+
+    const uint32_t cascadeCount = _shadows.cascadeCount();
+    uint32_t *pCasters[CascadedShadows::MaxCascades];
+    for (uint32_t cascade = 0; cascade < cascadeCount; ++cascade)
+    {
+        _shadowCasters[cascade].resize(_instances.size());
+        pCasters[cascade] = _shadowCasters[cascade].data();
+    }
+    const FrustumCulling::SphereSoA bounds = {_instances.positionX.data(), _instances.positionY.data(),
+                                              _instances.positionZ.data(), _instanceRadius.data()};
+    _shadows.cullCasters(bounds, _instances.size(), pCasters, _shadowDrawCounts, &_jobs);
+
+    size_t totalCount = 0;
+    for (uint32_t cascade = 0; cascade < cascadeCount; ++cascade)
+        totalCount += _shadowDrawCounts[cascade];
+    const size_t bufferSize = std::max<size_t>(totalCount, 1) * sizeof(InstanceData);
+
+    MTL::Buffer *pBuffer = frameBuffer(_pShadowInstanceBuffers[_frame], bufferSize);
+
+    InstanceData *pInstances = static_cast<InstanceData *>(pBuffer->contents());
+    size_t first = 0;
+    for (uint32_t cascade = 0; cascade < cascadeCount; ++cascade)
+    {
+        const size_t casterCount = _shadowDrawCounts[cascade];
+        const uint32_t *pGrouped = groupByMesh(pCasters[cascade], casterCount, _shadowRuns[cascade]);
+        InstancePacking::packIndexed(_instances, pGrouped, casterCount, pInstances + first, &_jobs);
+        for (MeshRun &run : _shadowRuns[cascade])
+            run.first += first;
+        first += casterCount;
+    }
+}
+
+// One depth-only pass over the atlas, with each cascade drawn into its own viewport. Depth is clamped rather than
+// clipped, so casters between the light and a cascade's near plane still cast.
+void Renderer::encodeShadows(MTL::CommandBuffer *pCmd, MTL::RenderPassDescriptor *pRpd)
+{
+    MTL::RenderCommandEncoder *pEnc = pCmd->renderCommandEncoder(pRpd);
+    pEnc->setRenderPipelineState(_pShadowPSO);
+    pEnc->setDepthStencilState(_pShadowDepthState);
+    pEnc->setDepthClipMode(MTL::DepthClipModeClamp);
+    _pGeometryPool->bind(pEnc);
+    pEnc->setVertexBuffer(_pShadowInstanceBuffers[_frame], 0, 2);
+
+    for (uint32_t cascade = 0; cascade < _shadows.cascadeCount(); ++cascade)
+    {
+        if (_shadowDrawCounts[cascade] == 0)
+            continue;
+
+        const CascadedShadows::Viewport tile = _shadows.viewport(cascade);
+        const double x = tile.x, y = tile.y, size = tile.size;
+        pEnc->setViewport(MTL::Viewport{x, y, size, size, 0.0, 1.0});
+        pEnc->setVertexBytes(&_shadows.cascade(cascade), sizeof(ShadowCascade), 3);
+        for (const MeshRun &run : _shadowRuns[cascade])
+            _pGeometryPool->draw(pEnc, run.mesh, run.count, run.first);
+    }
+
+    pEnc->endEncoding();
+}
 
-    MTL::CommandBuffer *pCmd = _pCommandQueue->commandBuffer();
+void Renderer::encodeScene(MTL::CommandBuffer *pCmd, MTK::View *pView, MTL::Texture *pShadowAtlas)
+{
     MTL::RenderPassDescriptor *pRpd = pView->currentRenderPassDescriptor();
     MTL::RenderCommandEncoder *pEnc = pCmd->renderCommandEncoder(pRpd);
 
+    // The terrain has a camera of its own until the scene does.
+    const CGSize size = pView->drawableSize();
+    const float aspect = float(std::max(size.width, 1.0) / std::max(size.height, 1.0));
+    const SimdMath::float3 eye = {TerrainEye[0], TerrainEye[1], TerrainEye[2]};
+    const SimdMath::float3 target = {TerrainTarget[0], TerrainTarget[1], TerrainTarget[2]};
+    const SimdMath::float4x4 terrainViewProjection =
+        SimdMath::float4x4::perspective(CameraFovY, aspect, CameraNear, TerrainFar) *
+        SimdMath::float4x4::lookAt(eye, target, {0.0f, 1.0f, 0.0f});
+    _pTerrain->draw(pEnc, terrainViewProjection.data(), TerrainEye, _pTerrainTexture, _frame);
+
     pEnc->setRenderPipelineState(_pPSO);
-    pEnc->setVertexBuffer(_pVertexPositionsBuffer, 0, 0);
-    pEnc->setVertexBuffer(_pVertexTextureCoordinatesBuffer, 0, 1);
+    pEnc->setDepthStencilState(_pSceneDepthState);
+    _pGeometryPool->bind(pEnc);
+    pEnc->setVertexBuffer(_pInstanceBuffers[_frame], 0, 2);
+
+    pEnc->setFragmentBuffer(_pBindlessTable->argumentBuffer(), 0, 6);
+    pEnc->setFragmentBuffer(_pMaterialBuffer, 0, 7);
+    _pBindlessTable->useResources(pEnc);
+    const LightClusters::Layout lights = _lightClusters.layout();
+    pEnc->setFragmentBuffer(_pLightBuffers[_frame], lights.gridOffset, 0);
+    pEnc->setFragmentBuffer(_pLightBuffers[_frame], lights.lightsOffset, 1);
+    pEnc->setFragmentBuffer(_pLightBuffers[_frame], lights.rangesOffset, 2);
+    pEnc->setFragmentBuffer(_pLightBuffers[_frame], lights.indicesOffset, 3);
+
+    const uint32_t cascadeCount = _shadows.cascadeCount();
+    pEnc->setFragmentTexture(pShadowAtlas, 1);
+    pEnc->setFragmentBytes(_shadows.cascades(), cascadeCount * sizeof(ShadowCascade), 4);
+    pEnc->setFragmentBytes(&cascadeCount, sizeof(cascadeCount), 5);
+
+    _pIndirectDrawPass->execute(pEnc, _pGeometryPool->indexBuffer(), _frame);
+
+    pEnc->endEncoding();
+}
+
+void Renderer::draw(MTK::View *pView)
+{
+    NS::AutoreleasePool *pPool = NS::AutoreleasePool::alloc()->init();
+
+    _frame = (_frame + 1) % MaxFramesInFlight;
+    _frameSemaphore.acquire();
+    releaseRetired();
+    _pBindlessTable->beginFrame();
+    _pUploader->beginFrame();
+
+    // Vertex positions are already in clip space, so the view-projection, and the view, are the identity.
+    const float viewProjection[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+    const Frustum frustum = Frustum::fromViewProjection(viewProjection);
+    updateInstances(frustum);
+    updateLights(viewProjection, pView);
+    updateShadows(viewProjection, pView);
+
+    // Passes encode into their queue's command buffer, set before each one runs.
+    MTL::CommandBuffer *pCmd = nullptr;
+
+    using PassType = RenderGraph::PassType;
+    _graph.reset();
+    RenderGraph::ResourceId drawArguments = _graph.importResource("drawArguments");
+    const RenderGraph::ResourceId drawable = _graph.importResource("drawable");
+    RenderGraph::ResourceId shadowAtlas = _graph.createTexture(
+        "shadowAtlas",
+        _pTransientHeap->describe(MTL::PixelFormat::PixelFormatDepth32Float, _shadows.atlasWidth(),
+                                  _shadows.atlasHeight(), MTL::TextureUsageRenderTarget | MTL::TextureUsageShaderRead));
+
+    const RenderGraph::PassId culling = _graph.addPass("culling", PassType::Compute, [&]() {
+        _pIndirectDrawPass->encodeCulling(pCmd, frustum, _pGeometryPool->indexBuffer(), _frame);
+    });
+    drawArguments = _graph.write(culling, drawArguments);
+
+    const RenderGraph::PassId shadows = _graph.addPass("shadows", PassType::Render, [&]() {
+        encodeShadows(pCmd, _pTransientHeap->renderPassDescriptor(_graph, _graph.pass(shadows).renderPass));
+    });
+    shadowAtlas = _graph.writeAttachment(shadows, shadowAtlas, true);
+
+    const RenderGraph::PassId scene = _graph.addPass("scene", PassType::Render, [&]() {
+        encodeScene(pCmd, pView, _pTransientHeap->texture(_graph, shadowAtlas));
+    });
+    _graph.read(scene, drawArguments);
+    _graph.read(scene, shadowAtlas);
+    _graph.writeAttachment(scene, drawable, true);
+
+    _graph.compile();
+    _pTransientHeap->allocate(_graph);
+
+    size_t shadowDraws = 0;
+    for (uint32_t cascade = 0; cascade < _shadows.cascadeCount(); ++cascade)
+        shadowDraws += _shadowDrawCounts[cascade];
+    size_t sceneDraws = 0;
+    for (const MeshRun &run : _meshRuns)
+        sceneDraws += run.count;
+    _passCosts.assign(_graph.passCount(), PassCostBase);
+    _passCosts[culling] += CullingCostPerObject * float(_cullObjects.size());
+    _passCosts[shadows] += DrawCostPerInstance * float(shadowDraws);
+    _passCosts[scene] += DrawCostPerInstance * float(sceneDraws);
+    _scheduler.schedule(_graph, _passCosts.data());
+    _scheduler.plan(_graph, _syncPlanner);
+    _pSyncEncoder->beginFrame(_syncPlanner);
+
+    MTL::CommandBuffer *pCmds[2] = {_pCommandQueue->commandBuffer(), nullptr};
+    for (RenderGraph::PassId pass : _graph.order())
+    {
+        if (_scheduler.queue(pass) == AsyncComputeScheduler::ComputeQueue && !pCmds[1])
+            pCmds[1] = _pComputeQueue->commandBuffer();
+    }
+
+    // The frame is done once every command buffer it used has completed.
+    const uint64_t retirementFrame = _retirement.endFrame();
+    std::atomic<int> &pending = _pendingCommandBuffers[_frame];
+    pending = pCmds[1] ? 2 : 1;
+    for (MTL::CommandBuffer *pQueueCmd : pCmds)
+    {
+        if (!pQueueCmd)
+            continue;
+        pQueueCmd->addCompletedHandler([this, retirementFrame, &pending](MTL::CommandBuffer *) {
+            if (--pending == 0)
+            {
+                _retirement.complete(retirementFrame);
+                _frameSemaphore.release();
+            }
+        });
+    }
+
+    // Uploads land before any pass; the passes that read their destinations are on the graphics queue.
+    _pUploader->encode(pCmds[0]);
 
-    pEnc->setFragmentTexture(_pTexture, 0);
+    // Passes run in the graph's order, each on its scheduled queue, and cross-queue dependencies wait for events.
+    for (uint32_t position = 0; position < _graph.order().size(); ++position)
+    {
+        const RenderGraph::PassId pass = _graph.order()[position];
+        pCmd = pCmds[_scheduler.queue(pass)];
+        _pSyncEncoder->encodeWaits(position, pCmd);
+        _graph.pass(pass).execute();
+        _pSyncEncoder->encodeSignal(position, pCmd);
+    }
+    _pSyncEncoder->endFrame();
 
-    pEnc->drawIndexedPrimitives(MTL::PrimitiveType::PrimitiveTypeTriangle, NS::UInteger(6),
-                                MTL::IndexType::IndexTypeUInt16, _pVertexIndicesBuffer, NS::UInteger(0),
-                                NS::UInteger(6));
+    if (pCmds[1])
+        pCmds[1]->commit();
+    pCmds[0]->presentDrawable(pView->currentDrawable());
+    pCmds[0]->commit();
 
-    pEnc->endEncoding();
-    pCmd->presentDrawable(pView->currentDrawable());
-    pCmd->commit();
+    MemoryTracker &memory = GpuMemory::tracker();
+    if (memory.endFrame())
+        std::cerr << "GPU memory: " << (memory.bytes() >> 20) << " MB allocated of a " << (memory.budget() >> 20)
+                  << " MB working set budget\n";
 
     pPool->release();
 }
@@ -0,0 +1,95 @@
+#include "RetirementQueue.h"
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+RetirementQueue::RetirementQueue() : _batches(4)
+{
+    _batches[_current].frame = _frame;
+}
+
+uint64_t RetirementQueue::endFrame()
+{
+    const uint64_t frame = _frame++;
+
+    // Frames without objects need no batch of their own; the next frame's batch completes after them anyway.
+    if (!_batches[_current].objects.empty())
+    {
+        size_t next = (_current + 1) % _batches.size();
+        if (next == _oldest)
+        {
+            // Every batch is pending: grow the ring. When it wraps, the batches from the oldest on move to the end, so
+            // the new ones fall between the current and the oldest.
+            const size_t oldSize = _batches.size();
+            _batches.resize(oldSize * 2);
+            if (_oldest > 0)
+            {
+                for (size_t i = oldSize; i-- > _oldest;)
+                    std::swap(_batches[i], _batches[i + oldSize]);
+                _oldest += oldSize;
+            }
+            next = _current + 1;
+        }
+        _current = next;
+        assert(_batches[_current].objects.empty());
+    }
+    _batches[_current].frame = _frame;
+    return frame;
+}
+
+void RetirementQueue::complete(uint64_t frame)
+{
+    std::lock_guard<std::mutex> lock(_completionMutex);
+    uint64_t completed = _completedFrame.load(std::memory_order_relaxed);
+    assert(frame > completed);
+    if (frame != completed + 1)
+    {
+        _earlyCompletions.push_back(frame);
+        return;
+    }
+
+    // Frames that completed early follow once the gap before them closes.
+    completed = frame;
+    for (;;)
+    {
+        auto it = std::find(_earlyCompletions.begin(), _earlyCompletions.end(), completed + 1);
+        if (it == _earlyCompletions.end())
+            break;
+        ++completed;
+        *it = _earlyCompletions.back();
+        _earlyCompletions.pop_back();
+    }
+    _completedFrame.store(completed, std::memory_order_release);
+}
+
+void RetirementQueue::collect(std::vector<void *> &released)
+{
+    const uint64_t completed = _completedFrame.load(std::memory_order_acquire);
+    while (_batches[_oldest].frame <= completed)
+    {
+        std::vector<void *> &objects = _batches[_oldest].objects;
+        released.insert(released.end(), objects.begin(), objects.end());
+        _releasedObjects += objects.size();
+        objects.clear();
+        if (_oldest == _current)
+            break;
+        _oldest = (_oldest + 1) % _batches.size();
+    }
+}
+
+RetirementQueue::Stats RetirementQueue::stats() const
+{
+    Stats stats = {0, 0, _releasedObjects};
+    for (size_t i = _oldest;; i = (i + 1) % _batches.size())
+    {
+        if (!_batches[i].objects.empty())
+        {
+            ++stats.pendingFrames;
+            stats.pendingObjects += _batches[i].objects.size();
+        }
+        if (i == _current)
+            break;
+    }
+    return stats;
+}
@@ -0,0 +1,263 @@
+#include "SpatialHashGrid.h"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+
+#include "JobSystem.h"
+
+namespace
+{
+const size_t GrainSize = 16 * 1024;
+const size_t MaxPartitions = 256;
+const size_t QueryBlockSize = 256;
+
+size_t roundUpToPowerOfTwo(size_t value)
+{
+    size_t result = 1;
+    while (result < value)
+        result <<= 1;
+    return result;
+}
+} // namespace
+
+SpatialHashGrid::SpatialHashGrid(float cellSize, size_t bucketCount)
+    : _cellSize(cellSize), _inverseCellSize(1.0f / cellSize), _requestedBuckets(bucketCount)
+{
+    assert(cellSize > 0.0f);
+}
+
+// Truncate and step down for negative fractions; std::floor is a library call without SSE4.1.
+int32_t SpatialHashGrid::cellCoordinate(float v) const
+{
+    const float scaled = v * _inverseCellSize;
+    const int32_t truncated = int32_t(scaled);
+    return truncated - int32_t(scaled < float(truncated));
+}
+
+uint32_t SpatialHashGrid::bucketOf(int32_t cellX, int32_t cellY) const
+{
+    uint32_t h = uint32_t(cellX) * 0x8da6b343u ^ uint32_t(cellY) * 0xd8163841u;
+    h ^= h >> 15;
+    return h & _bucketMask;
+}
+
+void SpatialHashGrid::rebuild(const float *pX, const float *pY, size_t count, JobSystem *pJobs)
+{
+    assert(count < InvalidIndex);
+
+    const size_t bucketCount = roundUpToPowerOfTwo(_requestedBuckets ? _requestedBuckets : count);
+    const size_t partitionCount = std::min(MaxPartitions, bucketCount);
+    const size_t bucketsPerPartition = bucketCount / partitionCount;
+    const uint32_t partitionShift = uint32_t(std::countr_zero(bucketsPerPartition));
+    const size_t chunkCount = (count + GrainSize - 1) / GrainSize;
+
+    _bucketMask = uint32_t(bucketCount - 1);
+    _bucketStart.resize(bucketCount + 1);
+    _points.resize(count);
+    _partitioned.resize(count);
+    _chunkOffsets.assign(chunkCount * partitionCount, 0);
+    _partitionStart.resize(partitionCount + 1);
+
+    auto run = [pJobs](size_t jobCount, const JobSystem::RangeFunction &function) {
+        if (pJobs)
+            pJobs->parallelFor(jobCount, 1, function);
+        else
+            function(0, jobCount);
+    };
+    auto chunkEnd = [count](size_t chunk) { return std::min((chunk + 1) * GrainSize, count); };
+
+    auto bucketOfPoint = [&](size_t i) { return bucketOf(cellCoordinate(pX[i]), cellCoordinate(pY[i])); };
+
+    // Count the points of each chunk per partition. Hashing again in the next pass is cheaper than storing the
+    // buckets: the rebuild is bound by memory traffic, not arithmetic.
+    run(chunkCount, [&](size_t firstChunk, size_t lastChunk) {
+        for (size_t chunk = firstChunk; chunk < lastChunk; ++chunk)
+        {
+            uint32_t *pCounts = _chunkOffsets.data() + chunk * partitionCount;
+            for (size_t i = chunk * GrainSize; i < chunkEnd(chunk); ++i)
+                ++pCounts[bucketOfPoint(i) >> partitionShift];
+        }
+    });
+
+    // Partition-major prefix sum, so every chunk writes its share of each partition at its own offset.
+    uint32_t offset = 0;
+    for (size_t partition = 0; partition < partitionCount; ++partition)
+    {
+        _partitionStart[partition] = offset;
+        for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+        {
+            uint32_t &entry = _chunkOffsets[chunk * partitionCount + partition];
+            const uint32_t chunkPoints = entry;
+            entry = offset;
+            offset += chunkPoints;
+        }
+    }
+    _partitionStart[partitionCount] = offset;
+
+    run(chunkCount, [&](size_t firstChunk, size_t lastChunk) {
+        for (size_t chunk = firstChunk; chunk < lastChunk; ++chunk)
+        {
+            uint32_t *pCursor = _chunkOffsets.data() + chunk * partitionCount;
+            for (size_t i = chunk * GrainSize; i < chunkEnd(chunk); ++i)
+            {
+                const uint32_t bucket = bucketOfPoint(i);
+                const uint32_t slot = pCursor[bucket >> partitionShift]++;
+                _partitioned[slot] = {{pX[i], pY[i], uint32_t(i)}, bucket};
+            }
+        }
+    });
+
+    // Counting sort of each partition into its final range; the partition's buckets are consecutive.
+    run(partitionCount, [&](size_t firstPartition, size_t lastPartition) {
+        std::vector<uint32_t> cursor(bucketsPerPartition);
+        for (size_t partition = firstPartition; partition < lastPartition; ++partition)
+        {
+            const size_t firstBucket = partition * bucketsPerPartition;
+            const uint32_t begin = _partitionStart[partition], end = _partitionStart[partition + 1];
+
+            std::fill(cursor.begin(), cursor.end(), 0);
+            for (uint32_t j = begin; j < end; ++j)
+                ++cursor[_partitioned[j].bucket - firstBucket];
+
+            uint32_t start = begin;
+            for (size_t b = 0; b < bucketsPerPartition; ++b)
+            {
+                _bucketStart[firstBucket + b] = start;
+                const uint32_t bucketSize = cursor[b];
+                cursor[b] = start;
+                start += bucketSize;
+            }
+
+            for (uint32_t j = begin; j < end; ++j)
+            {
+                const PartitionedPoint &entry = _partitioned[j];
+                _points[cursor[entry.bucket - firstBucket]++] = entry.point;
+            }
+        }
+    });
+    _bucketStart[bucketCount] = uint32_t(count);
+}
+
+template <typename Visit> void SpatialHashGrid::visitRect(const Rect &rect, const Visit &visit) const
+{
+    if (_points.empty() || rect.minX > rect.maxX || rect.minY > rect.maxY)
+        return;
+
+    auto inside = [&rect](float x, float y) {
+        return x >= rect.minX && x <= rect.maxX && y >= rect.minY && y <= rect.maxY;
+    };
+
+    const int32_t cellX0 = cellCoordinate(rect.minX), cellX1 = cellCoordinate(rect.maxX);
+    const int32_t cellY0 = cellCoordinate(rect.minY), cellY1 = cellCoordinate(rect.maxY);
+    const uint64_t cellCount = uint64_t(int64_t(cellX1) - cellX0 + 1) * uint64_t(int64_t(cellY1) - cellY0 + 1);
+
+    // A rect spanning more cells than there are buckets is cheaper to answer with one pass over all points.
+    if (cellCount >= bucketCount())
+    {
+        for (const Point &point : _points)
+        {
+            if (inside(point.x, point.y))
+                visit(point);
+        }
+        return;
+    }
+
+    for (int32_t cellY = cellY0; cellY <= cellY1; ++cellY)
+    {
+        for (int32_t cellX = cellX0; cellX <= cellX1; ++cellX)
+        {
+            const uint32_t bucket = bucketOf(cellX, cellY);
+            for (uint32_t j = _bucketStart[bucket]; j < _bucketStart[bucket + 1]; ++j)
+            {
+                const Point &point = _points[j];
+                // Another cell of the rect may share the bucket; only report the point from its own cell.
+                if (inside(point.x, point.y) &&
+                    (cellCount == 1 || (cellCoordinate(point.x) == cellX && cellCoordinate(point.y) == cellY)))
+                    visit(point);
+            }
+        }
+    }
+}
+
+void SpatialHashGrid::queryRect(const Rect &rect, std::vector<uint32_t> &results) const
+{
+    visitRect(rect, [&](const Point &point) { results.push_back(point.index); });
+}
+
+void SpatialHashGrid::queryRadius(float x, float y, float radius, std::vector<uint32_t> &results) const
+{
+    const float radiusSquared = radius * radius;
+    visitRect({x - radius, y - radius, x + radius, y + radius}, [&](const Point &point) {
+        const float dx = point.x - x, dy = point.y - y;
+        if (dx * dx + dy * dy <= radiusSquared)
+            results.push_back(point.index);
+    });
+}
+
+uint32_t SpatialHashGrid::nearest(float x, float y, float maxDistance) const
+{
+    uint32_t best = InvalidIndex;
+    float bestDistanceSquared = maxDistance * maxDistance;
+    visitRect({x - maxDistance, y - maxDistance, x + maxDistance, y + maxDistance}, [&](const Point &point) {
+        const float dx = point.x - x, dy = point.y - y;
+        const float distanceSquared = dx * dx + dy * dy;
+        if (distanceSquared <= bestDistanceSquared)
+        {
+            best = point.index;
+            bestDistanceSquared = distanceSquared;
+        }
+    });
+    return best;
+}
+
+// Each block of queries collects into its own vector; the blocks are concatenated in order afterwards.
+template <typename Query>
+void SpatialHashGrid::batch(size_t count, std::vector<uint32_t> &results, std::vector<uint32_t> &offsets,
+                            JobSystem *pJobs, const Query &query) const
+{
+    const size_t blockCount = (count + QueryBlockSize - 1) / QueryBlockSize;
+    std::vector<std::vector<uint32_t>> blockResults(blockCount);
+    offsets.assign(count + 1, 0);
+
+    auto run = [&](size_t firstBlock, size_t lastBlock) {
+        for (size_t block = firstBlock; block < lastBlock; ++block)
+        {
+            const size_t end = std::min((block + 1) * QueryBlockSize, count);
+            for (size_t i = block * QueryBlockSize; i < end; ++i)
+            {
+                const size_t before = blockResults[block].size();
+                query(i, blockResults[block]);
+                offsets[i + 1] = uint32_t(blockResults[block].size() - before);
+            }
+        }
+    };
+    if (pJobs)
+        pJobs->parallelFor(blockCount, 1, run);
+    else
+        run(0, blockCount);
+
+    for (size_t i = 0; i < count; ++i)
+        offsets[i + 1] += offsets[i];
+
+    results.clear();
+    results.reserve(offsets[count]);
+    for (const std::vector<uint32_t> &block : blockResults)
+        results.insert(results.end(), block.begin(), block.end());
+}
+
+void SpatialHashGrid::queryRects(const Rect *pRects, size_t count, std::vector<uint32_t> &results,
+                                 std::vector<uint32_t> &offsets, JobSystem *pJobs) const
+{
+    batch(count, results, offsets, pJobs,
+          [&](size_t i, std::vector<uint32_t> &out) { queryRect(pRects[i], out); });
+}
+
+void SpatialHashGrid::queryRadii(const float *pX, const float *pY, size_t count, float radius,
+                                 std::vector<uint32_t> &results, std::vector<uint32_t> &offsets,
+                                 JobSystem *pJobs) const
+{
+    batch(count, results, offsets, pJobs,
+          [&](size_t i, std::vector<uint32_t> &out) { queryRadius(pX[i], pY[i], radius, out); });
+}
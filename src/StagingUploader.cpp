@@ -0,0 +1,80 @@
+#include "StagingUploader.h"
+
+#include <cassert>
+
+#include "GpuMemory.h"
+
+StagingUploader::StagingUploader(MTL::Device *pDevice, const UploadBatcher::Settings &settings, uint32_t frameLatency)
+    : _pDevice(pDevice->retain()), _batcher(settings), _frameLatency(frameLatency)
+{
+    // Staging is only reused once the copies reading it have run, so Metal need not track the ring.
+    const MTL::ResourceOptions options = MTL::ResourceStorageModeShared | MTL::ResourceCPUCacheModeWriteCombined |
+                                         MTL::ResourceHazardTrackingModeUntracked;
+    _pStaging = GpuMemory::track(_pDevice->newBuffer(settings.stagingSize, options), MemoryCategory::Staging,
+                                 "stagingRing");
+}
+
+StagingUploader::~StagingUploader()
+{
+    for (const Retired &retired : _retired)
+        GpuMemory::release(retired.pBuffer);
+    GpuMemory::release(_pStaging);
+    _pDevice->release();
+}
+
+void StagingUploader::beginFrame()
+{
+    // Frames complete in order, so those before the last frameLatency - 1 flushes have.
+    if (_serial + 1 <= _frameLatency)
+        return;
+    const uint64_t completed = _serial + 1 - _frameLatency;
+    _batcher.release(completed);
+
+    size_t released = 0;
+    while (released < _retired.size() && _retired[released].serial <= completed)
+        GpuMemory::release(_retired[released++].pBuffer);
+    _retired.erase(_retired.begin(), _retired.begin() + released);
+}
+
+void *StagingUploader::upload(MTL::Buffer *pDestination, size_t offset, size_t size)
+{
+    assert(offset + size <= pDestination->length());
+    const uint64_t stagingOffset = _batcher.upload(pDestination, offset, size);
+    if (stagingOffset != UploadBatcher::InvalidOffset)
+        return static_cast<uint8_t *>(_pStaging->contents()) + stagingOffset;
+
+    MTL::Buffer *pOverflow = GpuMemory::track(
+        _pDevice->newBuffer(size, MTL::ResourceStorageModeShared | MTL::ResourceCPUCacheModeWriteCombined),
+        MemoryCategory::Staging, "stagingOverflow");
+    _batcher.copy(pOverflow, 0, pDestination, offset, size);
+    retire(pOverflow);
+    return pOverflow->contents();
+}
+
+void StagingUploader::copy(MTL::Buffer *pSource, size_t sourceOffset, MTL::Buffer *pDestination,
+                           size_t destinationOffset, size_t size)
+{
+    _batcher.copy(pSource, sourceOffset, pDestination, destinationOffset, size);
+}
+
+void StagingUploader::retire(MTL::Buffer *pBuffer)
+{
+    _retired.push_back({pBuffer, _serial + 1});
+}
+
+void StagingUploader::encode(MTL::CommandBuffer *pCmd)
+{
+    _copies.clear();
+    _serial = _batcher.flush(_copies);
+    if (_copies.empty())
+        return;
+
+    MTL::BlitCommandEncoder *pBlit = pCmd->blitCommandEncoder();
+    for (const UploadBatcher::Copy &copy : _copies)
+    {
+        MTL::Buffer *pSource = copy.pSource ? static_cast<MTL::Buffer *>(copy.pSource) : _pStaging;
+        pBlit->copyFromBuffer(pSource, copy.sourceOffset, static_cast<MTL::Buffer *>(copy.pDestination),
+                              copy.destinationOffset, copy.size);
+    }
+    pBlit->endEncoding();
+}
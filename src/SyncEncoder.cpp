@@ -0,0 +1,104 @@
+#include "SyncEncoder.h"
+
+#include <cassert>
+
+namespace
+{
+MTL::RenderStages renderStages(SyncPlanner::Stage stage)
+{
+    return stage == SyncPlanner::Stage::Vertex ? MTL::RenderStageVertex : MTL::RenderStageFragment;
+}
+} // namespace
+
+SyncEncoder::SyncEncoder(MTL::Device *pDevice) : _pDevice(pDevice->retain())
+{
+}
+
+SyncEncoder::~SyncEncoder()
+{
+    for (MTL::SharedEvent *pEvent : _events)
+        pEvent->release();
+    for (const std::vector<MTL::Fence *> &fences : _fences)
+    {
+        for (MTL::Fence *pFence : fences)
+            pFence->release();
+    }
+    _pDevice->release();
+}
+
+void SyncEncoder::beginFrame(const SyncPlanner &planner)
+{
+    _pPlanner = &planner;
+    _timeline.beginFrame(planner);
+
+    while (_events.size() < planner.queueCount())
+    {
+        MTL::SharedEvent *pEvent = _pDevice->newSharedEvent();
+        assert(pEvent);
+        _events.push_back(pEvent);
+        _fences.emplace_back();
+    }
+
+    // A fence stays with its queue, so plan fences map onto the queue's own set in order.
+    std::vector<uint32_t> used(planner.queueCount(), 0);
+    _frameFences.resize(planner.fenceCount());
+    for (uint32_t fence = 0; fence < planner.fenceCount(); ++fence)
+    {
+        const uint32_t queue = planner.fenceQueue(fence);
+        std::vector<MTL::Fence *> &fences = _fences[queue];
+        if (used[queue] == fences.size())
+        {
+            MTL::Fence *pFence = _pDevice->newFence();
+            assert(pFence);
+            fences.push_back(pFence);
+        }
+        _frameFences[fence] = fences[used[queue]++];
+    }
+}
+
+void SyncEncoder::endFrame()
+{
+    _timeline.endFrame();
+    _pPlanner = nullptr;
+}
+
+void SyncEncoder::encodeWaits(SyncPlanner::PassId pass, MTL::CommandBuffer *pCmd) const
+{
+    for (const SyncPlanner::EventWait &wait : _pPlanner->passPlan(pass).eventWaits)
+        pCmd->encodeWait(_events[wait.queue], _timeline.value(wait.queue, wait.value));
+}
+
+void SyncEncoder::encodeFences(SyncPlanner::PassId pass, MTL::RenderCommandEncoder *pEncoder) const
+{
+    const SyncPlanner::PassPlan &plan = _pPlanner->passPlan(pass);
+    for (const SyncPlanner::FenceWait &wait : plan.fenceWaits)
+        pEncoder->waitForFence(_frameFences[wait.fence], renderStages(wait.beforeStage));
+    if (plan.updateFence != SyncPlanner::InvalidIndex)
+        pEncoder->updateFence(_frameFences[plan.updateFence], MTL::RenderStageFragment);
+}
+
+void SyncEncoder::encodeFences(SyncPlanner::PassId pass, MTL::ComputeCommandEncoder *pEncoder) const
+{
+    const SyncPlanner::PassPlan &plan = _pPlanner->passPlan(pass);
+    for (const SyncPlanner::FenceWait &wait : plan.fenceWaits)
+        pEncoder->waitForFence(_frameFences[wait.fence]);
+    if (plan.updateFence != SyncPlanner::InvalidIndex)
+        pEncoder->updateFence(_frameFences[plan.updateFence]);
+}
+
+void SyncEncoder::encodeFences(SyncPlanner::PassId pass, MTL::BlitCommandEncoder *pEncoder) const
+{
+    const SyncPlanner::PassPlan &plan = _pPlanner->passPlan(pass);
+    for (const SyncPlanner::FenceWait &wait : plan.fenceWaits)
+        pEncoder->waitForFence(_frameFences[wait.fence]);
+    if (plan.updateFence != SyncPlanner::InvalidIndex)
+        pEncoder->updateFence(_frameFences[plan.updateFence]);
+}
+
+void SyncEncoder::encodeSignal(SyncPlanner::PassId pass, MTL::CommandBuffer *pCmd) const
+{
+    const SyncPlanner::PassPlan &plan = _pPlanner->passPlan(pass);
+    const uint32_t queue = _pPlanner->passQueue(pass);
+    if (plan.signalValue)
+        pCmd->encodeSignalEvent(_events[queue], _timeline.value(queue, plan.signalValue));
+}
@@ -0,0 +1,238 @@
+#include "SyncPlanner.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+bool testBit(const uint64_t *pBits, uint32_t bit)
+{
+    return (pBits[bit / 64] >> (bit % 64)) & 1;
+}
+} // namespace
+
+void SyncPlanner::reset(uint32_t queueCount)
+{
+    assert(queueCount > 0);
+    _queueCount = queueCount;
+    _passes.clear();
+    _plans.clear();
+    _fenceQueues.clear();
+    _signalCounts.assign(queueCount, 0);
+    _fenceCount = 0;
+    _stats = {};
+}
+
+SyncPlanner::PassId SyncPlanner::addPass(uint32_t queue, PassType type)
+{
+    assert(queue < _queueCount);
+    _passes.push_back({queue, type, {}});
+    return PassId(_passes.size() - 1);
+}
+
+void SyncPlanner::read(PassId pass, uint32_t resource, Stage stage)
+{
+    if (_passes[pass].type != PassType::Render)
+        stage = Stage::Vertex;
+    _passes[pass].accesses.push_back({resource, stage, false});
+}
+
+void SyncPlanner::write(PassId pass, uint32_t resource, Stage stage)
+{
+    if (_passes[pass].type != PassType::Render)
+        stage = Stage::Vertex;
+    _passes[pass].accesses.push_back({resource, stage, true});
+}
+
+void SyncPlanner::plan(bool fences)
+{
+    const size_t passCount = _passes.size();
+    _bitsetWords = (passCount + 63) / 64;
+    _known.assign(passCount * 2 * _bitsetWords, 0);
+    _plans.assign(passCount, {});
+    _lastFenceWaiter.assign(passCount, InvalidIndex);
+    _stats = {};
+
+    uint32_t resourceCount = 0;
+    for (const Pass &pass : _passes)
+    {
+        for (const Access &access : pass.accesses)
+            resourceCount = std::max(resourceCount, access.resource + 1);
+    }
+    _resources.assign(resourceCount, {});
+
+    // Each producer with the earliest stage of the consumer that depends on it.
+    std::vector<std::pair<PassId, Stage>> producers;
+    for (PassId pass = 0; pass < passCount; ++pass)
+    {
+        producers.clear();
+        auto depend = [&](PassId producer, Stage stage) {
+            if (producer == InvalidIndex || producer == pass)
+                return;
+            for (auto &[existing, existingStage] : producers)
+            {
+                if (existing == producer)
+                {
+                    existingStage = std::min(existingStage, stage);
+                    return;
+                }
+            }
+            producers.push_back({producer, stage});
+        };
+
+        for (const Access &access : _passes[pass].accesses)
+        {
+            const ResourceState &state = _resources[access.resource];
+            depend(state.lastWriter, access.stage);
+            if (access.write)
+            {
+                for (PassId reader : state.readers)
+                    depend(reader, access.stage);
+            }
+        }
+        for (const Access &access : _passes[pass].accesses)
+        {
+            ResourceState &state = _resources[access.resource];
+            if (access.write)
+            {
+                state.lastWriter = pass;
+                state.readers.clear();
+            }
+        }
+        for (const Access &access : _passes[pass].accesses)
+        {
+            ResourceState &state = _resources[access.resource];
+            if (!access.write && state.lastWriter != pass &&
+                std::find(state.readers.begin(), state.readers.end(), pass) == state.readers.end())
+                state.readers.push_back(pass);
+        }
+        _stats.hazards += uint32_t(producers.size());
+
+        std::sort(producers.begin(), producers.end(), [](const auto &a, const auto &b) { return a.first > b.first; });
+        PassPlan &plan = _plans[pass];
+        for (auto [producer, stage] : producers)
+        {
+            if (testBit(known(pass, stage), producer))
+            {
+                ++_stats.redundantWaits;
+                continue;
+            }
+
+            // Event values are assigned in submission order once every signal is known, so waits hold the
+            // producer until then. Event waits are encoded on the command buffer, before any stage.
+            if (_passes[producer].queue != _passes[pass].queue)
+            {
+                plan.eventWaits.push_back({_passes[producer].queue, producer});
+                stage = Stage::Vertex;
+                ++_stats.eventWaits;
+            }
+            else if (fences)
+            {
+                plan.fenceWaits.push_back({producer, stage});
+                _lastFenceWaiter[producer] = pass;
+                ++_stats.fenceWaits;
+            }
+
+            // The producer has completed, along with everything it waited for, before this stage and the later one.
+            const uint64_t *pProducerKnown = known(producer, Stage::Fragment);
+            for (Stage after : {Stage::Vertex, Stage::Fragment})
+            {
+                if (after < stage)
+                    continue;
+                uint64_t *pKnown = known(pass, after);
+                for (size_t word = 0; word < _bitsetWords; ++word)
+                    pKnown[word] |= pProducerKnown[word];
+                pKnown[producer / 64] |= uint64_t(1) << (producer % 64);
+            }
+        }
+    }
+
+    assignSignals();
+    allocateFences();
+}
+
+void SyncPlanner::assignSignals()
+{
+    for (PassPlan &plan : _plans)
+    {
+        for (EventWait &wait : plan.eventWaits)
+            _plans[wait.value].signalValue = 1;
+    }
+
+    _signalCounts.assign(_queueCount, 0);
+    for (PassId pass = 0; pass < _passes.size(); ++pass)
+    {
+        if (_plans[pass].signalValue)
+            _plans[pass].signalValue = ++_signalCounts[_passes[pass].queue];
+    }
+
+    for (PassPlan &plan : _plans)
+    {
+        for (EventWait &wait : plan.eventWaits)
+            wait.value = _plans[wait.value].signalValue;
+    }
+}
+
+void SyncPlanner::allocateFences()
+{
+    // A fence can be updated again once every wait for its previous update has been submitted, as a wait sees the
+    // latest update submitted before it.
+    struct Slot {
+        uint32_t fence;
+        uint32_t queue;
+        PassId busyUntil;
+    };
+    std::vector<Slot> slots;
+    _fenceQueues.clear();
+    _fenceCount = 0;
+
+    for (PassId pass = 0; pass < _passes.size(); ++pass)
+    {
+        if (_lastFenceWaiter[pass] == InvalidIndex)
+            continue;
+
+        const uint32_t queue = _passes[pass].queue;
+        Slot *pSlot = nullptr;
+        for (Slot &slot : slots)
+        {
+            if (slot.queue == queue && slot.busyUntil < pass)
+            {
+                pSlot = &slot;
+                break;
+            }
+        }
+        if (!pSlot)
+        {
+            slots.push_back({_fenceCount++, queue, 0});
+            _fenceQueues.push_back(queue);
+            pSlot = &slots.back();
+        }
+        pSlot->busyUntil = _lastFenceWaiter[pass];
+        _plans[pass].updateFence = pSlot->fence;
+    }
+
+    for (PassPlan &plan : _plans)
+    {
+        for (FenceWait &wait : plan.fenceWaits)
+            wait.fence = _plans[wait.fence].updateFence;
+    }
+}
+
+void SyncTimeline::beginFrame(const SyncPlanner &planner)
+{
+    assert(!_inFrame);
+    _inFrame = true;
+    if (_bases.size() < planner.queueCount())
+        _bases.resize(planner.queueCount(), 0);
+    _frameSignals.assign(_bases.size(), 0);
+    for (uint32_t queue = 0; queue < planner.queueCount(); ++queue)
+        _frameSignals[queue] = planner.signalCount(queue);
+}
+
+void SyncTimeline::endFrame()
+{
+    assert(_inFrame);
+    _inFrame = false;
+    for (size_t queue = 0; queue < _bases.size(); ++queue)
+        _bases[queue] += _frameSignals[queue];
+}
@@ -0,0 +1,146 @@
+#include "TerrainQuadtree.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+bool intersectsSphere(const AABB &b, const float center[3], float radius)
+{
+    const float dx = std::max(std::max(b.minX - center[0], 0.0f), center[0] - b.maxX);
+    const float dy = std::max(std::max(b.minY - center[1], 0.0f), center[1] - b.maxY);
+    const float dz = std::max(std::max(b.minZ - center[2], 0.0f), center[2] - b.maxZ);
+    return dx * dx + dy * dy + dz * dz <= radius * radius;
+}
+} // namespace
+
+TerrainQuadtree::TerrainQuadtree(const uint16_t *pHeights, uint32_t width, uint32_t height,
+                                 const Settings &settings)
+    : _settings(settings), _width(width), _height(height), _levels(settings.lodCount)
+{
+    assert(settings.lodCount > 0 && settings.leafSize > 0);
+
+    // Leaf bounds include the shared edge samples so that neighbouring nodes' bounds overlap like their grids do.
+    Level &leaves = _levels[0];
+    leaves.width = (width + settings.leafSize - 1) / settings.leafSize;
+    leaves.height = (height + settings.leafSize - 1) / settings.leafSize;
+    leaves.minHeights.assign(size_t(leaves.width) * leaves.height, UINT16_MAX);
+    leaves.maxHeights.assign(size_t(leaves.width) * leaves.height, 0);
+    for (uint32_t z = 0; z < height; ++z)
+    {
+        const uint16_t *pRow = pHeights + size_t(z) * width;
+        const uint32_t nodeZ = std::min(z / settings.leafSize, leaves.height - 1);
+        const bool sharedZ = z % settings.leafSize == 0 && nodeZ > 0;
+        for (uint32_t nodeX = 0; nodeX < leaves.width; ++nodeX)
+        {
+            const uint32_t x0 = nodeX * settings.leafSize;
+            const uint32_t x1 = std::min(x0 + settings.leafSize + 1, width);
+            const auto range = std::minmax_element(pRow + x0, pRow + x1);
+            for (uint32_t nz = sharedZ ? nodeZ - 1 : nodeZ; nz <= nodeZ; ++nz)
+            {
+                const size_t i = size_t(nz) * leaves.width + nodeX;
+                leaves.minHeights[i] = std::min(leaves.minHeights[i], *range.first);
+                leaves.maxHeights[i] = std::max(leaves.maxHeights[i], *range.second);
+            }
+        }
+    }
+
+    for (uint32_t lod = 1; lod < settings.lodCount; ++lod)
+    {
+        const Level &children = _levels[lod - 1];
+        Level &level = _levels[lod];
+        level.width = (children.width + 1) / 2;
+        level.height = (children.height + 1) / 2;
+        level.minHeights.assign(size_t(level.width) * level.height, UINT16_MAX);
+        level.maxHeights.assign(size_t(level.width) * level.height, 0);
+        for (uint32_t z = 0; z < children.height; ++z)
+        {
+            for (uint32_t x = 0; x < children.width; ++x)
+            {
+                const size_t child = size_t(z) * children.width + x;
+                const size_t parent = size_t(z / 2) * level.width + x / 2;
+                level.minHeights[parent] = std::min(level.minHeights[parent], children.minHeights[child]);
+                level.maxHeights[parent] = std::max(level.maxHeights[parent], children.maxHeights[child]);
+            }
+        }
+    }
+
+    float range = settings.leafRange;
+    float previousRange = 0.0f;
+    for (uint32_t lod = 0; lod < settings.lodCount; ++lod)
+    {
+        _ranges.push_back(range);
+        _morphStarts.push_back(previousRange + (range - previousRange) * settings.morphStartRatio);
+        previousRange = range;
+        range *= 2.0f;
+    }
+}
+
+void TerrainQuadtree::select(const float cameraPosition[3], const Frustum &frustum, std::vector<Node> &nodes) const
+{
+    nodes.clear();
+
+    const uint32_t top = _settings.lodCount - 1;
+    const Level &roots = _levels[top];
+    for (uint32_t z = 0; z < roots.height; ++z)
+    {
+        for (uint32_t x = 0; x < roots.width; ++x)
+        {
+            if (!selectNode(top, x, z, cameraPosition, frustum, nodes))
+                addNode(top, nodeBounds(top, x, z), WholeNode, nodes);
+        }
+    }
+}
+
+// Returns false when the node is beyond the range of its LOD, in which case the parent must cover its area.
+bool TerrainQuadtree::selectNode(uint32_t lod, uint32_t nodeX, uint32_t nodeZ, const float cameraPosition[3],
+                                 const Frustum &frustum, std::vector<Node> &nodes) const
+{
+    const AABB bounds = nodeBounds(lod, nodeX, nodeZ);
+    if (!intersectsSphere(bounds, cameraPosition, _ranges[lod]))
+        return false;
+    if (!frustum.intersects(bounds))
+        return true;
+
+    if (lod == 0 || !intersectsSphere(bounds, cameraPosition, _ranges[lod - 1]))
+    {
+        addNode(lod, bounds, WholeNode, nodes);
+        return true;
+    }
+
+    const Level &children = _levels[lod - 1];
+    for (uint32_t child = 0; child < 4; ++child)
+    {
+        const uint32_t childX = nodeX * 2 + (child & 1);
+        const uint32_t childZ = nodeZ * 2 + (child >> 1);
+        if (childX >= children.width || childZ >= children.height)
+            continue;
+
+        // A child out of its own range is covered by this node's quadrant at this node's LOD.
+        if (!selectNode(lod - 1, childX, childZ, cameraPosition, frustum, nodes) &&
+            frustum.intersects(nodeBounds(lod - 1, childX, childZ)))
+            addNode(lod, bounds, child, nodes);
+    }
+    return true;
+}
+
+AABB TerrainQuadtree::nodeBounds(uint32_t lod, uint32_t nodeX, uint32_t nodeZ) const
+{
+    const Level &level = _levels[lod];
+    const size_t i = size_t(nodeZ) * level.width + nodeX;
+    const float size = float(_settings.leafSize << lod) * _settings.sampleSpacing;
+    const float heightScale = _settings.heightScale / float(UINT16_MAX);
+
+    return {nodeX * size,
+            level.minHeights[i] * heightScale,
+            nodeZ * size,
+            (nodeX + 1) * size,
+            level.maxHeights[i] * heightScale,
+            (nodeZ + 1) * size};
+}
+
+void TerrainQuadtree::addNode(uint32_t lod, const AABB &bounds, uint32_t quadrant, std::vector<Node> &nodes) const
+{
+    nodes.push_back(
+        {bounds.minX, bounds.minZ, bounds.maxX - bounds.minX, float(lod), _morphStarts[lod], _ranges[lod], quadrant, 0});
+}
@@ -0,0 +1,194 @@
+#include "TerrainRenderer.h"
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+
+#include "GpuMemory.h"
+
+TerrainRenderer::TerrainRenderer(MTL::Device *pDevice, MTL::Library *pLibrary, MTL::PixelFormat colorFormat,
+                                 MTL::PixelFormat depthFormat, const uint16_t *pHeights, uint32_t width,
+                                 uint32_t height, const TerrainQuadtree::Settings &settings, size_t framesInFlight)
+    : _pDevice(pDevice->retain()), _nodeBuffers(framesInFlight, nullptr), _quadtree(pHeights, width, height, settings)
+{
+    using NS::StringEncoding::UTF8StringEncoding;
+
+    assert(settings.leafSize % 2 == 0);
+
+    NS::Error *pError = nullptr;
+    MTL::Function *pVertexFunction = pLibrary->newFunction(NS::String::string("terrainVertex", UTF8StringEncoding));
+    MTL::Function *pFragmentFunction =
+        pLibrary->newFunction(NS::String::string("terrainFragment", UTF8StringEncoding));
+
+    MTL::RenderPipelineDescriptor *pDesc = MTL::RenderPipelineDescriptor::alloc()->init();
+    pDesc->setVertexFunction(pVertexFunction);
+    pDesc->setFragmentFunction(pFragmentFunction);
+    pDesc->colorAttachments()->object(0)->setPixelFormat(colorFormat);
+    pDesc->setDepthAttachmentPixelFormat(depthFormat);
+
+    _pPSO = _pDevice->newRenderPipelineState(pDesc, &pError);
+    if (!_pPSO)
+    {
+        std::cerr << pError->localizedDescription()->utf8String();
+        assert(false);
+    }
+
+    MTL::DepthStencilDescriptor *pDepthDesc = MTL::DepthStencilDescriptor::alloc()->init();
+    pDepthDesc->setDepthCompareFunction(MTL::CompareFunctionLess);
+    pDepthDesc->setDepthWriteEnabled(true);
+    _pDepthState = _pDevice->newDepthStencilState(pDepthDesc);
+
+    MTL::TextureDescriptor *pTextureDesc = MTL::TextureDescriptor::texture2DDescriptor(
+        MTL::PixelFormatR16Unorm, width, height, false);
+    pTextureDesc->setUsage(MTL::TextureUsageShaderRead);
+    pTextureDesc->setStorageMode(MTL::StorageModeManaged);
+    _pHeightmap =
+        GpuMemory::track(_pDevice->newTexture(pTextureDesc), MemoryCategory::Textures, "terrainHeightmap");
+    _pHeightmap->replaceRegion(MTL::Region::Make2D(0, 0, width, height), 0, pHeights, width * sizeof(uint16_t));
+
+    buildGrid();
+
+    pDepthDesc->release();
+    pDesc->release();
+    pVertexFunction->release();
+    pFragmentFunction->release();
+}
+
+TerrainRenderer::~TerrainRenderer()
+{
+    for (MTL::Buffer *pBuffer : _nodeBuffers)
+    {
+        if (pBuffer)
+            GpuMemory::release(pBuffer);
+    }
+    GpuMemory::release(_pGridIndices);
+    GpuMemory::release(_pGridVertices);
+    GpuMemory::release(_pHeightmap);
+    _pDepthState->release();
+    _pPSO->release();
+    _pDevice->release();
+}
+
+// The grid has leafSize cells per side so that LOD 0 nodes sample the heightmap once per vertex. Its indices are
+// laid out quadrant by quadrant, which lets partially covered nodes draw a quarter of the index range.
+void TerrainRenderer::buildGrid()
+{
+    const uint32_t gridDim = _quadtree.settings().leafSize;
+    const uint32_t rowLength = gridDim + 1;
+    const size_t vertexCount = size_t(rowLength) * rowLength;
+
+    std::vector<float> positions;
+    positions.reserve(vertexCount * 2);
+    for (uint32_t z = 0; z <= gridDim; ++z)
+    {
+        for (uint32_t x = 0; x <= gridDim; ++x)
+        {
+            positions.push_back(float(x) / float(gridDim));
+            positions.push_back(float(z) / float(gridDim));
+        }
+    }
+
+    std::vector<uint32_t> indices;
+    const uint32_t half = gridDim / 2;
+    for (uint32_t quadrant = 0; quadrant < 4; ++quadrant)
+    {
+        const uint32_t x0 = (quadrant & 1) * half;
+        const uint32_t z0 = (quadrant >> 1) * half;
+        for (uint32_t z = z0; z < z0 + half; ++z)
+        {
+            for (uint32_t x = x0; x < x0 + half; ++x)
+            {
+                const uint32_t i = z * rowLength + x;
+                indices.insert(indices.end(), {i, i + rowLength, i + 1, i + 1, i + rowLength, i + rowLength + 1});
+            }
+        }
+    }
+    _quadrantIndexCount = indices.size() / 4;
+
+    _pGridVertices = GpuMemory::track(
+        _pDevice->newBuffer(positions.data(), positions.size() * sizeof(float), MTL::ResourceStorageModeManaged),
+        MemoryCategory::Geometry, "terrainGridVertices");
+
+    if (vertexCount <= UINT16_MAX + 1)
+    {
+        std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+        _gridIndexType = MTL::IndexType::IndexTypeUInt16;
+        _pGridIndices = GpuMemory::track(
+            _pDevice->newBuffer(shortIndices.data(), shortIndices.size() * sizeof(uint16_t),
+                                MTL::ResourceStorageModeManaged),
+            MemoryCategory::Geometry, "terrainGridIndices");
+    }
+    else
+    {
+        _gridIndexType = MTL::IndexType::IndexTypeUInt32;
+        _pGridIndices = GpuMemory::track(
+            _pDevice->newBuffer(indices.data(), indices.size() * sizeof(uint32_t), MTL::ResourceStorageModeManaged),
+            MemoryCategory::Geometry, "terrainGridIndices");
+    }
+}
+
+void TerrainRenderer::draw(MTL::RenderCommandEncoder *pEnc, const float *viewProjection,
+                           const float cameraPosition[3], MTL::Texture *pColorTexture, size_t frame)
+{
+    _quadtree.select(cameraPosition, Frustum::fromViewProjection(viewProjection), _nodes);
+    if (_nodes.empty())
+        return;
+
+    // Group the nodes by the part of the grid they draw: whole nodes first, then each quadrant.
+    size_t groupStart[TerrainQuadtree::WholeNode + 2] = {};
+    for (const TerrainQuadtree::Node &node : _nodes)
+        ++groupStart[(node.quadrant + 1) % (TerrainQuadtree::WholeNode + 1) + 1];
+    for (size_t g = 1; g < TerrainQuadtree::WholeNode + 2; ++g)
+        groupStart[g] += groupStart[g - 1];
+
+    _sortedNodes.resize(_nodes.size());
+    size_t cursor[TerrainQuadtree::WholeNode + 1];
+    memcpy(cursor, groupStart, sizeof(cursor));
+    for (const TerrainQuadtree::Node &node : _nodes)
+        _sortedNodes[cursor[(node.quadrant + 1) % (TerrainQuadtree::WholeNode + 1)]++] = node;
+
+    const size_t size = _sortedNodes.size() * sizeof(TerrainQuadtree::Node);
+    MTL::Buffer *&pNodeBuffer = _nodeBuffers[frame];
+    if (!pNodeBuffer || pNodeBuffer->length() < size)
+    {
+        if (pNodeBuffer)
+            GpuMemory::release(pNodeBuffer);
+        pNodeBuffer = GpuMemory::track(_pDevice->newBuffer(size * 2, MTL::ResourceStorageModeManaged),
+                                       MemoryCategory::Instances, "terrainNodes");
+    }
+    memcpy(pNodeBuffer->contents(), _sortedNodes.data(), size);
+    pNodeBuffer->didModifyRange(NS::Range::Make(0, size));
+
+    const TerrainQuadtree::Settings &settings = _quadtree.settings();
+    TerrainUniforms uniforms;
+    memcpy(uniforms.viewProjection, viewProjection, sizeof(uniforms.viewProjection));
+    memcpy(uniforms.cameraPosition, cameraPosition, 3 * sizeof(float));
+    uniforms.cameraPosition[3] = 1.0f;
+    uniforms.inverseTerrainSize[0] = 1.0f / (float(_quadtree.width()) * settings.sampleSpacing);
+    uniforms.inverseTerrainSize[1] = 1.0f / (float(_quadtree.height()) * settings.sampleSpacing);
+    uniforms.heightScale = settings.heightScale;
+    uniforms.gridDim = float(settings.leafSize);
+
+    pEnc->setRenderPipelineState(_pPSO);
+    pEnc->setDepthStencilState(_pDepthState);
+    pEnc->setVertexBuffer(_pGridVertices, 0, 0);
+    pEnc->setVertexBuffer(pNodeBuffer, 0, 1);
+    pEnc->setVertexBytes(&uniforms, sizeof(uniforms), 2);
+    pEnc->setVertexTexture(_pHeightmap, 0);
+    pEnc->setFragmentTexture(pColorTexture, 0);
+
+    const size_t indexSize = _gridIndexType == MTL::IndexType::IndexTypeUInt16 ? sizeof(uint16_t) : sizeof(uint32_t);
+    for (size_t g = 0; g <= TerrainQuadtree::WholeNode; ++g)
+    {
+        const size_t instanceCount = groupStart[g + 1] - groupStart[g];
+        if (instanceCount == 0)
+            continue;
+
+        const bool whole = g == 0;
+        const size_t indexCount = whole ? _quadrantIndexCount * 4 : _quadrantIndexCount;
+        const size_t indexOffset = whole ? 0 : (g - 1) * _quadrantIndexCount * indexSize;
+        pEnc->drawIndexedPrimitives(MTL::PrimitiveType::PrimitiveTypeTriangle, NS::UInteger(indexCount),
+                                    _gridIndexType, _pGridIndices, NS::UInteger(indexOffset),
+                                    NS::UInteger(instanceCount), 0, NS::UInteger(groupStart[g]));
+    }
+}
@@ -0,0 +1,108 @@
+#include "TexturePool.h"
+
+#include <cassert>
+#include <iterator>
+
+TexturePool::TexturePool(const Settings &settings) : _settings(settings)
+{
+}
+
+uint64_t TexturePool::hash(const Descriptor &desc)
+{
+    // FNV-1a over the fields, then a final mix so nearby sizes spread over the buckets.
+    uint64_t h = 14695981039346656037ull;
+    for (uint32_t field : {desc.width, desc.height, desc.pixelFormat, desc.usage, desc.storageMode, desc.sampleCount})
+        h = (h ^ field) * 1099511628211ull;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    return h ^ (h >> 33);
+}
+
+void TexturePool::beginFrame(uint64_t frame, std::vector<void *> &trimmed)
+{
+    _frame = frame;
+
+    for (auto it = _idle.begin(); it != _idle.end();)
+    {
+        // Oldest first, so the expired textures are a prefix.
+        std::vector<void *> &textures = it->second;
+        size_t expired = 0;
+        while (expired < textures.size() &&
+               _textures[textures[expired]].releasedFrame + _settings.maxIdleFrames < frame)
+            ++expired;
+
+        for (size_t i = 0; i < expired; ++i)
+        {
+            auto record = _textures.find(textures[i]);
+            --_stats.texturesIdle;
+            _stats.bytesIdle -= record->second.size;
+            trimmed.push_back(textures[i]);
+            _textures.erase(record);
+        }
+        textures.erase(textures.begin(), textures.begin() + expired);
+        it = textures.empty() ? _idle.erase(it) : std::next(it);
+    }
+}
+
+void *TexturePool::acquire(const Descriptor &desc)
+{
+    ++_stats.requests;
+    auto bucket = _idle.find(hash(desc));
+    if (bucket == _idle.end())
+        return nullptr;
+
+    std::vector<void *> &textures = bucket->second;
+    for (size_t i = textures.size(); i-- > 0;)
+    {
+        Record &record = _textures[textures[i]];
+        if (record.releasedFrame + _settings.frameLatency > _frame || !(record.desc == desc))
+            continue;
+
+        void *pTexture = textures[i];
+        textures.erase(textures.begin() + i);
+        if (textures.empty())
+            _idle.erase(bucket);
+
+        record.inUse = true;
+        ++_stats.hits;
+        --_stats.texturesIdle;
+        _stats.bytesIdle -= record.size;
+        ++_stats.texturesInUse;
+        _stats.bytesInUse += record.size;
+        return pTexture;
+    }
+    return nullptr;
+}
+
+void TexturePool::add(const Descriptor &desc, void *pTexture, uint64_t size)
+{
+    assert(_textures.find(pTexture) == _textures.end());
+    _textures[pTexture] = {desc, hash(desc), size, 0, true};
+    ++_stats.texturesInUse;
+    _stats.bytesInUse += size;
+}
+
+void TexturePool::release(void *pTexture)
+{
+    auto it = _textures.find(pTexture);
+    assert(it != _textures.end() && it->second.inUse);
+    Record &record = it->second;
+    record.inUse = false;
+    record.releasedFrame = _frame;
+    _idle[record.hash].push_back(pTexture);
+
+    --_stats.texturesInUse;
+    _stats.bytesInUse -= record.size;
+    ++_stats.texturesIdle;
+    _stats.bytesIdle += record.size;
+}
+
+void TexturePool::clear(std::vector<void *> &removed)
+{
+    for (const auto &[pTexture, record] : _textures)
+        removed.push_back(pTexture);
+    _textures.clear();
+    _idle.clear();
+    _stats.texturesInUse = _stats.texturesIdle = 0;
+    _stats.bytesInUse = _stats.bytesIdle = 0;
+}
@@ -0,0 +1,226 @@
+#include "TlsfAllocator.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+uint32_t floorLog2(uint64_t value)
+{
+    return 63 - __builtin_clzll(value);
+}
+
+struct ListIndex {
+    uint32_t firstLevel, secondLevel;
+};
+
+// Sizes below SecondLevelCount units map one to one onto the lists of the first class; above, class f holds sizes
+// [2^(f + 3), 2^(f + 4)) split into 16 equal ranges.
+template <uint32_t SecondLevelShift> ListIndex listIndex(uint64_t units)
+{
+    if (units < (1u << SecondLevelShift))
+        return {0, uint32_t(units)};
+    const uint32_t log2 = floorLog2(units);
+    return {log2 - SecondLevelShift + 1, uint32_t(units >> (log2 - SecondLevelShift)) & ((1u << SecondLevelShift) - 1)};
+}
+} // namespace
+
+TlsfAllocator::TlsfAllocator(uint64_t capacity, uint64_t granularity)
+    : _capacity(capacity), _granularityShift(floorLog2(granularity))
+{
+    assert(granularity > 0 && (granularity & (granularity - 1)) == 0);
+
+    for (uint32_t(&lists)[SecondLevelCount] : _freeLists)
+        std::fill(std::begin(lists), std::end(lists), InvalidBlock);
+
+    const uint64_t units = capacity >> _granularityShift;
+    if (units > 0)
+        insertFree(newBlock(0, units));
+}
+
+uint32_t TlsfAllocator::newBlock(uint64_t offset, uint64_t size)
+{
+    uint32_t block;
+    if (!_unusedBlocks.empty())
+    {
+        block = _unusedBlocks.back();
+        _unusedBlocks.pop_back();
+    }
+    else
+    {
+        block = uint32_t(_blocks.size());
+        _blocks.emplace_back();
+    }
+    _blocks[block] = {offset, size, InvalidBlock, InvalidBlock, InvalidBlock, InvalidBlock, false};
+    return block;
+}
+
+void TlsfAllocator::insertFree(uint32_t block)
+{
+    Block &b = _blocks[block];
+    const ListIndex index = listIndex<SecondLevelShift>(b.size);
+    uint32_t &head = _freeLists[index.firstLevel][index.secondLevel];
+
+    b.free = true;
+    b.previousFree = InvalidBlock;
+    b.nextFree = head;
+    if (head != InvalidBlock)
+        _blocks[head].previousFree = block;
+    head = block;
+
+    _firstLevelBitmap |= uint64_t(1) << index.firstLevel;
+    _secondLevelBitmaps[index.firstLevel] |= 1u << index.secondLevel;
+    ++_freeBlockCount;
+}
+
+void TlsfAllocator::removeFree(uint32_t block)
+{
+    Block &b = _blocks[block];
+    if (b.previousFree != InvalidBlock)
+        _blocks[b.previousFree].nextFree = b.nextFree;
+    if (b.nextFree != InvalidBlock)
+        _blocks[b.nextFree].previousFree = b.previousFree;
+
+    const ListIndex index = listIndex<SecondLevelShift>(b.size);
+    uint32_t &head = _freeLists[index.firstLevel][index.secondLevel];
+    if (head == block)
+    {
+        head = b.nextFree;
+        if (head == InvalidBlock)
+        {
+            _secondLevelBitmaps[index.firstLevel] &= ~(1u << index.secondLevel);
+            if (_secondLevelBitmaps[index.firstLevel] == 0)
+                _firstLevelBitmap &= ~(uint64_t(1) << index.firstLevel);
+        }
+    }
+
+    b.free = false;
+    --_freeBlockCount;
+}
+
+uint32_t TlsfAllocator::split(uint32_t block, uint64_t units)
+{
+    const uint32_t rest = newBlock(_blocks[block].offset + units, _blocks[block].size - units);
+    Block &b = _blocks[block];
+    Block &r = _blocks[rest];
+    b.size = units;
+    r.previousPhysical = block;
+    r.nextPhysical = b.nextPhysical;
+    if (b.nextPhysical != InvalidBlock)
+        _blocks[b.nextPhysical].previousPhysical = rest;
+    b.nextPhysical = rest;
+    return rest;
+}
+
+uint32_t TlsfAllocator::findFree(uint64_t units) const
+{
+    // Rounding the size up to the next list boundary makes every block of the list found large enough.
+    if (units >= SecondLevelCount)
+        units += (uint64_t(1) << (floorLog2(units) - SecondLevelShift)) - 1;
+    ListIndex index = listIndex<SecondLevelShift>(units);
+    if (index.firstLevel >= FirstLevelCount)
+        return InvalidBlock;
+
+    uint32_t secondLevelMap = _secondLevelBitmaps[index.firstLevel] & (~0u << index.secondLevel);
+    if (secondLevelMap == 0)
+    {
+        const uint64_t firstLevelMap =
+            index.firstLevel + 1 < 64 ? _firstLevelBitmap & (~uint64_t(0) << (index.firstLevel + 1)) : 0;
+        if (firstLevelMap == 0)
+            return InvalidBlock;
+        index.firstLevel = __builtin_ctzll(firstLevelMap);
+        secondLevelMap = _secondLevelBitmaps[index.firstLevel];
+    }
+    return _freeLists[index.firstLevel][__builtin_ctz(secondLevelMap)];
+}
+
+TlsfAllocator::Allocation TlsfAllocator::allocate(uint64_t size, uint64_t alignment)
+{
+    assert(size > 0 && alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+    const uint64_t units = (size + (uint64_t(1) << _granularityShift) - 1) >> _granularityShift;
+    const uint64_t alignmentUnits = std::max<uint64_t>(alignment >> _granularityShift, 1);
+    // A block this much larger fits the allocation wherever the block starts.
+    uint32_t block = findFree(units + alignmentUnits - 1);
+    if (block == InvalidBlock)
+        return {};
+    removeFree(block);
+
+    const uint64_t padding = (alignmentUnits - _blocks[block].offset % alignmentUnits) % alignmentUnits;
+    if (padding > 0)
+    {
+        // The block before is in use, or the two would have been merged, so the padding stays a block of its own.
+        const uint32_t aligned = split(block, padding);
+        insertFree(block);
+        block = aligned;
+    }
+    if (_blocks[block].size > units)
+        insertFree(split(block, units));
+
+    _usedUnits += units;
+    ++_allocationCount;
+    return {_blocks[block].offset << _granularityShift, units << _granularityShift, block};
+}
+
+void TlsfAllocator::free(const Allocation &allocation)
+{
+    uint32_t block = allocation.block;
+    assert(allocation.valid() && !_blocks[block].free);
+    _usedUnits -= _blocks[block].size;
+    --_allocationCount;
+
+    // Merge with free neighbours, so no two free blocks are ever adjacent.
+    const uint32_t previous = _blocks[block].previousPhysical;
+    if (previous != InvalidBlock && _blocks[previous].free)
+    {
+        removeFree(previous);
+        Block &p = _blocks[previous];
+        const Block &b = _blocks[block];
+        p.size += b.size;
+        p.nextPhysical = b.nextPhysical;
+        if (b.nextPhysical != InvalidBlock)
+            _blocks[b.nextPhysical].previousPhysical = previous;
+        _unusedBlocks.push_back(block);
+        block = previous;
+    }
+
+    const uint32_t next = _blocks[block].nextPhysical;
+    if (next != InvalidBlock && _blocks[next].free)
+    {
+        removeFree(next);
+        Block &b = _blocks[block];
+        const Block &n = _blocks[next];
+        b.size += n.size;
+        b.nextPhysical = n.nextPhysical;
+        if (n.nextPhysical != InvalidBlock)
+            _blocks[n.nextPhysical].previousPhysical = block;
+        _unusedBlocks.push_back(next);
+    }
+
+    insertFree(block);
+}
+
+TlsfAllocator::Stats TlsfAllocator::stats() const
+{
+    Stats stats = {};
+    stats.capacity = _capacity;
+    stats.usedSize = usedSize();
+    stats.allocationCount = _allocationCount;
+    stats.freeBlockCount = _freeBlockCount;
+
+    // The largest free block is in the highest non-empty list, though not necessarily at its head.
+    if (_firstLevelBitmap)
+    {
+        const uint32_t firstLevel = floorLog2(_firstLevelBitmap);
+        const uint32_t secondLevel = floorLog2(_secondLevelBitmaps[firstLevel]);
+        uint64_t largest = 0;
+        for (uint32_t block = _freeLists[firstLevel][secondLevel]; block != InvalidBlock;
+             block = _blocks[block].nextFree)
+            largest = std::max(largest, _blocks[block].size);
+        stats.largestFreeBlock = largest << _granularityShift;
+    }
+
+    const uint64_t freeSize = ((_capacity >> _granularityShift) - _usedUnits) << _granularityShift;
+    stats.fragmentation = freeSize > 0 ? 1.0f - float(stats.largestFreeBlock) / float(freeSize) : 0.0f;
+    return stats;
+}
@@ -0,0 +1,346 @@
+#include "TransformHierarchy.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "JobSystem.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+const uint32_t NoParent = UINT32_MAX;
+const size_t GrainSize = 4096;
+
+// out = a * b, all column-major. out must not alias a or b.
+void multiply(const Matrix4 &a, const Matrix4 &b, Matrix4 &out)
+{
+#if defined(__AVX__)
+    const __m256 a01 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(a.m + 0));
+    const __m256 a11 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(a.m + 4));
+    const __m256 a21 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(a.m + 8));
+    const __m256 a31 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(a.m + 12));
+    for (int j = 0; j < 16; j += 8)
+    {
+        // Two result columns per iteration: lanes 0-3 are column j / 4, lanes 4-7 the next one.
+        const __m256 b0 = _mm256_setr_m128(_mm_set1_ps(b.m[j + 0]), _mm_set1_ps(b.m[j + 4]));
+        const __m256 b1 = _mm256_setr_m128(_mm_set1_ps(b.m[j + 1]), _mm_set1_ps(b.m[j + 5]));
+        const __m256 b2 = _mm256_setr_m128(_mm_set1_ps(b.m[j + 2]), _mm_set1_ps(b.m[j + 6]));
+        const __m256 b3 = _mm256_setr_m128(_mm_set1_ps(b.m[j + 3]), _mm_set1_ps(b.m[j + 7]));
+        __m256 r = _mm256_mul_ps(a01, b0);
+        r = _mm256_add_ps(r, _mm256_mul_ps(a11, b1));
+        r = _mm256_add_ps(r, _mm256_mul_ps(a21, b2));
+        r = _mm256_add_ps(r, _mm256_mul_ps(a31, b3));
+        _mm256_store_ps(out.m + j, r);
+    }
+#elif defined(__SSE__)
+    const __m128 a0 = _mm_load_ps(a.m + 0);
+    const __m128 a1 = _mm_load_ps(a.m + 4);
+    const __m128 a2 = _mm_load_ps(a.m + 8);
+    const __m128 a3 = _mm_load_ps(a.m + 12);
+    for (int j = 0; j < 16; j += 4)
+    {
+        __m128 r = _mm_mul_ps(a0, _mm_set1_ps(b.m[j + 0]));
+        r = _mm_add_ps(r, _mm_mul_ps(a1, _mm_set1_ps(b.m[j + 1])));
+        r = _mm_add_ps(r, _mm_mul_ps(a2, _mm_set1_ps(b.m[j + 2])));
+        r = _mm_add_ps(r, _mm_mul_ps(a3, _mm_set1_ps(b.m[j + 3])));
+        _mm_store_ps(out.m + j, r);
+    }
+#elif defined(__ARM_NEON)
+    const float32x4_t a0 = vld1q_f32(a.m + 0);
+    const float32x4_t a1 = vld1q_f32(a.m + 4);
+    const float32x4_t a2 = vld1q_f32(a.m + 8);
+    const float32x4_t a3 = vld1q_f32(a.m + 12);
+    for (int j = 0; j < 16; j += 4)
+    {
+        const float32x4_t bj = vld1q_f32(b.m + j);
+        float32x4_t r = vmulq_laneq_f32(a0, bj, 0);
+        r = vfmaq_laneq_f32(r, a1, bj, 1);
+        r = vfmaq_laneq_f32(r, a2, bj, 2);
+        r = vfmaq_laneq_f32(r, a3, bj, 3);
+        vst1q_f32(out.m + j, r);
+    }
+#else
+    for (int j = 0; j < 4; ++j)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            out.m[j * 4 + i] = a.m[i] * b.m[j * 4] + a.m[4 + i] * b.m[j * 4 + 1] + a.m[8 + i] * b.m[j * 4 + 2] +
+                               a.m[12 + i] * b.m[j * 4 + 3];
+        }
+    }
+#endif
+}
+
+// Keeps values[order[i]] as element i; slots missing from order are dropped.
+template <typename T> void permute(std::vector<T> &values, const std::vector<uint32_t> &order)
+{
+    std::vector<T> sorted(order.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        sorted[i] = values[order[i]];
+    values.swap(sorted);
+}
+} // namespace
+
+TransformHierarchy::NodeId TransformHierarchy::create(NodeId parent)
+{
+    assert(parent == InvalidNode || (_slotOfNode[parent] != InvalidNode && !_destroyed[_slotOfNode[parent]]));
+    const uint32_t slot = uint32_t(_nodeOfSlot.size());
+    const uint32_t parentSlot = parent == InvalidNode ? NoParent : _slotOfNode[parent];
+
+    NodeId node;
+    if (!_freeNodes.empty())
+    {
+        node = _freeNodes.back();
+        _freeNodes.pop_back();
+        _slotOfNode[node] = slot;
+    }
+    else
+    {
+        node = NodeId(_slotOfNode.size());
+        _slotOfNode.push_back(slot);
+    }
+    _nodeOfSlot.push_back(node);
+    _parentSlot.push_back(parentSlot);
+    _depth.push_back(parentSlot == NoParent ? 0 : _depth[parentSlot] + 1);
+
+    _translationX.push_back(0.0f);
+    _translationY.push_back(0.0f);
+    _translationZ.push_back(0.0f);
+    _rotationX.push_back(0.0f);
+    _rotationY.push_back(0.0f);
+    _rotationZ.push_back(0.0f);
+    _rotationW.push_back(1.0f);
+    _scaleX.push_back(1.0f);
+    _scaleY.push_back(1.0f);
+    _scaleZ.push_back(1.0f);
+    _localDirty.push_back(1);
+    _worldChanged.push_back(0);
+    _destroyed.push_back(0);
+    _world.push_back(Matrix4());
+
+    // Appending keeps the depth order only if nothing shallower follows a deeper node.
+    if (slot > 0 && _depth[slot] < _depth[slot - 1])
+        _orderDirty = true;
+    if (_levelStart.size() <= _depth[slot])
+        _levelStart.resize(_depth[slot] + 1, slot);
+    return node;
+}
+
+void TransformHierarchy::destroy(NodeId node)
+{
+    assert(_slotOfNode[node] != InvalidNode);
+    _destroyed[_slotOfNode[node]] = 1;
+    _orderDirty = true;
+}
+
+void TransformHierarchy::setParent(NodeId node, NodeId parent)
+{
+    const uint32_t slot = _slotOfNode[node];
+    const uint32_t parentSlot = parent == InvalidNode ? NoParent : _slotOfNode[parent];
+    assert(slot != InvalidNode && (parent == InvalidNode || parentSlot != InvalidNode));
+#ifndef NDEBUG
+    for (uint32_t ancestor = parentSlot; ancestor != NoParent; ancestor = _parentSlot[ancestor])
+        assert(ancestor != slot);
+#endif
+
+    _parentSlot[slot] = parentSlot;
+    _localDirty[slot] = 1;
+    _orderDirty = true;
+}
+
+void TransformHierarchy::setLocal(NodeId node, const float translation[3], const float rotation[4],
+                                  const float scale[3])
+{
+    setTranslation(node, translation);
+    setRotation(node, rotation);
+
+    const uint32_t slot = _slotOfNode[node];
+    _scaleX[slot] = scale[0];
+    _scaleY[slot] = scale[1];
+    _scaleZ[slot] = scale[2];
+}
+
+void TransformHierarchy::setTranslation(NodeId node, const float translation[3])
+{
+    const uint32_t slot = _slotOfNode[node];
+    _translationX[slot] = translation[0];
+    _translationY[slot] = translation[1];
+    _translationZ[slot] = translation[2];
+    _localDirty[slot] = 1;
+}
+
+void TransformHierarchy::setRotation(NodeId node, const float rotation[4])
+{
+    const uint32_t slot = _slotOfNode[node];
+    _rotationX[slot] = rotation[0];
+    _rotationY[slot] = rotation[1];
+    _rotationZ[slot] = rotation[2];
+    _rotationW[slot] = rotation[3];
+    _localDirty[slot] = 1;
+}
+
+TransformHierarchy::NodeId TransformHierarchy::parent(NodeId node) const
+{
+    const uint32_t parentSlot = _parentSlot[_slotOfNode[node]];
+    return parentSlot == NoParent ? InvalidNode : _nodeOfSlot[parentSlot];
+}
+
+void TransformHierarchy::update(JobSystem *pJobs)
+{
+    if (_orderDirty)
+        restructure();
+
+    _levelStart.push_back(_nodeOfSlot.size());
+    for (size_t level = 0; level + 1 < _levelStart.size(); ++level)
+    {
+        const size_t begin = _levelStart[level];
+        const size_t count = _levelStart[level + 1] - begin;
+        if (pJobs)
+        {
+            pJobs->parallelFor(count, GrainSize,
+                               [this, begin](size_t first, size_t last) { updateRange(begin + first, begin + last); });
+        }
+        else
+        {
+            updateRange(begin, begin + count);
+        }
+    }
+    _levelStart.pop_back();
+}
+
+void TransformHierarchy::updateRange(size_t begin, size_t end)
+{
+    for (size_t slot = begin; slot < end; ++slot)
+    {
+        const uint32_t parentSlot = _parentSlot[slot];
+        const bool parentChanged = parentSlot != NoParent && _worldChanged[parentSlot];
+        if (!_localDirty[slot] && !parentChanged)
+        {
+            _worldChanged[slot] = 0;
+            continue;
+        }
+
+        const float x = _rotationX[slot], y = _rotationY[slot], z = _rotationZ[slot], w = _rotationW[slot];
+        const float sx = _scaleX[slot], sy = _scaleY[slot], sz = _scaleZ[slot];
+        const float xx = x * x, yy = y * y, zz = z * z;
+        const float xy = x * y, xz = x * z, yz = y * z;
+        const float wx = w * x, wy = w * y, wz = w * z;
+
+        Matrix4 local = {{(1.0f - 2.0f * (yy + zz)) * sx, 2.0f * (xy + wz) * sx, 2.0f * (xz - wy) * sx, 0.0f,
+                          2.0f * (xy - wz) * sy, (1.0f - 2.0f * (xx + zz)) * sy, 2.0f * (yz + wx) * sy, 0.0f,
+                          2.0f * (xz + wy) * sz, 2.0f * (yz - wx) * sz, (1.0f - 2.0f * (xx + yy)) * sz, 0.0f,
+                          _translationX[slot], _translationY[slot], _translationZ[slot], 1.0f}};
+
+        if (parentSlot == NoParent)
+            _world[slot] = local;
+        else
+            multiply(_world[parentSlot], local, _world[slot]);
+
+        _localDirty[slot] = 0;
+        _worldChanged[slot] = 1;
+    }
+}
+
+// Drops destroyed subtrees and orders the remaining slots by depth and, within a level, by the already sorted slot
+// of the parent. Siblings end up adjacent and each level reads its parents' world matrices in increasing address
+// order.
+void TransformHierarchy::restructure()
+{
+    // Depths from the parent links, which setParent may have changed for whole subtrees, and whether a node or one
+    // of its ancestors was destroyed; each slot is resolved once by walking up to the nearest resolved ancestor.
+    const uint32_t Unresolved = UINT32_MAX;
+    const size_t slotCount = _nodeOfSlot.size();
+    std::vector<uint32_t> depth(slotCount, Unresolved);
+    std::vector<uint8_t> dead(slotCount, 0);
+    std::vector<uint32_t> path;
+    for (uint32_t slot = 0; slot < slotCount; ++slot)
+    {
+        for (uint32_t s = slot; s != NoParent && depth[s] == Unresolved; s = _parentSlot[s])
+            path.push_back(s);
+        while (!path.empty())
+        {
+            const uint32_t s = path.back();
+            path.pop_back();
+            const uint32_t parentSlot = _parentSlot[s];
+            depth[s] = parentSlot == NoParent ? 0 : depth[parentSlot] + 1;
+            dead[s] = _destroyed[s] || (parentSlot != NoParent && dead[parentSlot]);
+        }
+    }
+    _depth.swap(depth);
+
+    std::vector<uint32_t> order;
+    order.reserve(slotCount);
+    for (uint32_t slot = 0; slot < slotCount; ++slot)
+    {
+        if (!dead[slot])
+        {
+            order.push_back(slot);
+        }
+        else
+        {
+            _slotOfNode[_nodeOfSlot[slot]] = InvalidNode;
+            _freeNodes.push_back(_nodeOfSlot[slot]);
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) { return _depth[a] < _depth[b]; });
+
+    std::vector<uint32_t> sortedParent(slotCount);
+    size_t levelBegin = 0;
+    while (levelBegin < order.size())
+    {
+        size_t levelEnd = levelBegin;
+        while (levelEnd < order.size() && _depth[order[levelEnd]] == _depth[order[levelBegin]])
+            ++levelEnd;
+
+        std::stable_sort(order.begin() + levelBegin, order.begin() + levelEnd, [&](uint32_t a, uint32_t b) {
+            const uint32_t pa = _parentSlot[a] == NoParent ? 0 : sortedParent[_parentSlot[a]];
+            const uint32_t pb = _parentSlot[b] == NoParent ? 0 : sortedParent[_parentSlot[b]];
+            return pa < pb;
+        });
+        for (size_t i = levelBegin; i < levelEnd; ++i)
+            sortedParent[order[i]] = uint32_t(i);
+        levelBegin = levelEnd;
+    }
+
+    std::vector<uint32_t> newSlot(slotCount, NoParent);
+    for (size_t i = 0; i < order.size(); ++i)
+        newSlot[order[i]] = uint32_t(i);
+
+    permute(_translationX, order);
+    permute(_translationY, order);
+    permute(_translationZ, order);
+    permute(_rotationX, order);
+    permute(_rotationY, order);
+    permute(_rotationZ, order);
+    permute(_rotationW, order);
+    permute(_scaleX, order);
+    permute(_scaleY, order);
+    permute(_scaleZ, order);
+    permute(_parentSlot, order);
+    permute(_depth, order);
+    permute(_localDirty, order);
+    permute(_worldChanged, order);
+    permute(_world, order);
+    permute(_nodeOfSlot, order);
+    _destroyed.assign(order.size(), 0);
+
+    for (uint32_t &parentSlot : _parentSlot)
+        parentSlot = parentSlot == NoParent ? NoParent : newSlot[parentSlot];
+    for (NodeId node : _nodeOfSlot)
+        _slotOfNode[node] = newSlot[_slotOfNode[node]];
+
+    _levelStart.clear();
+    for (size_t slot = 0; slot < _depth.size(); ++slot)
+    {
+        if (_levelStart.size() <= _depth[slot])
+            _levelStart.resize(_depth[slot] + 1, slot);
+    }
+    _orderDirty = false;
+}
@@ -0,0 +1,217 @@
+#include "TransientHeap.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "GpuMemory.h"
+
+namespace
+{
+bool sameTexture(const RenderGraph::TextureDesc &a, const RenderGraph::TextureDesc &b)
+{
+    return a.width == b.width && a.height == b.height && a.pixelFormat == b.pixelFormat && a.usage == b.usage &&
+           a.sampleCount == b.sampleCount;
+}
+
+bool isDepth(MTL::PixelFormat pixelFormat)
+{
+    switch (pixelFormat)
+    {
+    case MTL::PixelFormatDepth16Unorm:
+    case MTL::PixelFormatDepth32Float:
+    case MTL::PixelFormatDepth24Unorm_Stencil8:
+    case MTL::PixelFormatDepth32Float_Stencil8:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool isStencil(MTL::PixelFormat pixelFormat)
+{
+    switch (pixelFormat)
+    {
+    case MTL::PixelFormatStencil8:
+    case MTL::PixelFormatDepth24Unorm_Stencil8:
+    case MTL::PixelFormatDepth32Float_Stencil8:
+    case MTL::PixelFormatX32_Stencil8:
+    case MTL::PixelFormatX24_Stencil8:
+        return true;
+    default:
+        return false;
+    }
+}
+} // namespace
+
+TransientHeap::TransientHeap(MTL::Device *pDevice, uint32_t frameLatency)
+    : _pDevice(pDevice->retain()), _memorylessTargets(pDevice, TexturePool::Settings{frameLatency})
+{
+}
+
+TransientHeap::~TransientHeap()
+{
+    releaseTextures();
+    if (_pHeap)
+        GpuMemory::release(_pHeap);
+    _pDevice->release();
+}
+
+MTL::TextureDescriptor *TransientHeap::newDescriptor(const RenderGraph::TextureDesc &desc) const
+{
+    MTL::TextureDescriptor *pDesc = MTL::TextureDescriptor::alloc()->init();
+    pDesc->setTextureType(desc.sampleCount > 1 ? MTL::TextureType2DMultisample : MTL::TextureType2D);
+    pDesc->setPixelFormat(MTL::PixelFormat(desc.pixelFormat));
+    pDesc->setWidth(desc.width);
+    pDesc->setHeight(desc.height);
+    pDesc->setSampleCount(desc.sampleCount);
+    pDesc->setUsage(MTL::TextureUsage(desc.usage));
+    pDesc->setStorageMode(MTL::StorageModePrivate);
+    return pDesc;
+}
+
+RenderGraph::TextureDesc TransientHeap::describe(MTL::PixelFormat pixelFormat, uint32_t width, uint32_t height,
+                                                 MTL::TextureUsage usage, uint32_t sampleCount) const
+{
+    RenderGraph::TextureDesc desc;
+    desc.width = width;
+    desc.height = height;
+    desc.pixelFormat = uint32_t(pixelFormat);
+    desc.usage = uint32_t(usage);
+    desc.sampleCount = sampleCount;
+
+    MTL::TextureDescriptor *pDesc = newDescriptor(desc);
+    const MTL::SizeAndAlign sizeAndAlign = _pDevice->heapTextureSizeAndAlign(pDesc);
+    pDesc->release();
+
+    desc.size = sizeAndAlign.size;
+    desc.alignment = sizeAndAlign.align;
+    return desc;
+}
+
+void TransientHeap::releaseTextures()
+{
+    for (CachedTexture &cached : _cache)
+        GpuMemory::release(cached.pTexture);
+    _cache.clear();
+}
+
+void TransientHeap::allocate(const RenderGraph &graph)
+{
+    using NS::StringEncoding::UTF8StringEncoding;
+
+    // Frames still in flight keep the old heap's textures alive through their command buffers.
+    if (!_pHeap || _pHeap->size() < graph.heapSize())
+    {
+        releaseTextures();
+        if (_pHeap)
+            GpuMemory::release(_pHeap);
+
+        MTL::HeapDescriptor *pDesc = MTL::HeapDescriptor::alloc()->init();
+        pDesc->setType(MTL::HeapTypePlacement);
+        pDesc->setStorageMode(MTL::StorageModePrivate);
+        pDesc->setHazardTrackingMode(MTL::HazardTrackingModeTracked);
+        pDesc->setSize(std::max<uint64_t>(graph.heapSize(), 1));
+        _pHeap = _pDevice->newHeap(pDesc);
+        pDesc->release();
+        assert(_pHeap);
+        GpuMemory::track(_pHeap, MemoryCategory::Heaps, "transientHeap");
+    }
+
+    for (CachedTexture &cached : _cache)
+        cached.used = false;
+    for (MTL::Texture *pTexture : _memorylessInUse)
+        _memorylessTargets.release(pTexture);
+    _memorylessInUse.clear();
+    _memorylessTargets.beginFrame();
+
+    const std::vector<RenderGraph::Resource> &resources = graph.resources();
+    _textures.assign(resources.size(), nullptr);
+    for (size_t index = 0; index < resources.size(); ++index)
+    {
+        const RenderGraph::Resource &resource = resources[index];
+        if (resource.imported || resource.firstUse == RenderGraph::InvalidIndex)
+            continue;
+
+        if (resource.memoryless)
+        {
+            // Memoryless textures can only be rendered to.
+            MTL::Texture *pTexture = _memorylessTargets.acquire(
+                MTL::PixelFormat(resource.desc.pixelFormat), resource.desc.width, resource.desc.height,
+                MTL::TextureUsageRenderTarget, MTL::StorageModeMemoryless, resource.desc.sampleCount);
+            pTexture->setLabel(NS::String::string(resource.name.c_str(), UTF8StringEncoding));
+            _memorylessInUse.push_back(pTexture);
+            _textures[index] = pTexture;
+            continue;
+        }
+
+        CachedTexture *pCached = nullptr;
+        for (CachedTexture &cached : _cache)
+        {
+            if (!cached.used && cached.heapOffset == resource.heapOffset && sameTexture(cached.desc, resource.desc))
+            {
+                pCached = &cached;
+                break;
+            }
+        }
+        if (!pCached)
+        {
+            MTL::TextureDescriptor *pDesc = newDescriptor(resource.desc);
+            MTL::Texture *pTexture = _pHeap->newTexture(pDesc, resource.heapOffset);
+            pDesc->release();
+            assert(pTexture);
+            pTexture->setLabel(NS::String::string(resource.name.c_str(), UTF8StringEncoding));
+            _cache.push_back({resource.desc, resource.heapOffset, pTexture, false});
+            pCached = &_cache.back();
+        }
+        pCached->used = true;
+        _textures[index] = pCached->pTexture;
+    }
+
+    // Layouts that changed leave textures behind that no pass will use again.
+    for (size_t i = 0; i < _cache.size();)
+    {
+        if (_cache[i].used)
+        {
+            ++i;
+            continue;
+        }
+        GpuMemory::release(_cache[i].pTexture);
+        _cache[i] = _cache.back();
+        _cache.pop_back();
+    }
+}
+
+MTL::Texture *TransientHeap::texture(const RenderGraph &graph, RenderGraph::ResourceId resource) const
+{
+    return _textures[graph.resourceIndex(resource)];
+}
+
+MTL::RenderPassDescriptor *TransientHeap::renderPassDescriptor(const RenderGraph &graph, uint32_t renderPass) const
+{
+    MTL::RenderPassDescriptor *pRpd = MTL::RenderPassDescriptor::renderPassDescriptor();
+    uint32_t colorCount = 0;
+    for (const RenderGraph::Attachment &attachment : graph.renderPasses()[renderPass].attachments)
+    {
+        const MTL::PixelFormat pixelFormat = MTL::PixelFormat(graph.resources()[attachment.resource].desc.pixelFormat);
+        const bool hasDepth = isDepth(pixelFormat);
+        const bool hasStencil = isStencil(pixelFormat);
+
+        MTL::RenderPassAttachmentDescriptor *pAttachments[2] = {};
+        if (hasDepth)
+            pAttachments[0] = pRpd->depthAttachment();
+        if (hasStencil)
+            pAttachments[1] = pRpd->stencilAttachment();
+        if (!hasDepth && !hasStencil)
+            pAttachments[0] = pRpd->colorAttachments()->object(colorCount++);
+
+        for (MTL::RenderPassAttachmentDescriptor *pAttachment : pAttachments)
+        {
+            if (!pAttachment)
+                continue;
+            pAttachment->setTexture(_textures[attachment.resource]);
+            pAttachment->setLoadAction(MTL::LoadAction(attachment.load));
+            pAttachment->setStoreAction(MTL::StoreAction(attachment.store));
+        }
+    }
+    return pRpd;
+}
@@ -0,0 +1,226 @@
+#include "UploadBatcher.h"
+
+#include <algorithm>
+#include <cassert>
+
+UploadBatcher::UploadBatcher(const Settings &settings) : _settings(settings)
+{
+    assert(settings.alignment > 0 && (settings.alignment & (settings.alignment - 1)) == 0);
+}
+
+void UploadBatcher::release(uint64_t serial)
+{
+    size_t released = 0;
+    while (released < _batches.size() && _batches[released].serial <= serial)
+    {
+        _tail = _batches[released].head;
+        _used -= _batches[released].bytes;
+        ++released;
+    }
+    _batches.erase(_batches.begin(), _batches.begin() + released);
+    _stats.stagingBytes = _used;
+}
+
+uint64_t UploadBatcher::allocate(uint64_t size)
+{
+    if (_used == 0)
+        _head = _tail = 0;
+
+    uint64_t offset = align(_head);
+    uint64_t end = offset + size;
+    if (_head < _tail || (_head == _tail && _used > 0))
+    {
+        if (end > _tail)
+            return InvalidOffset;
+    }
+    else if (end > _settings.stagingSize)
+    {
+        // Wrap around, leaving the end of the ring unused until this batch is released.
+        if (size > _tail)
+            return InvalidOffset;
+        offset = 0;
+        end = size;
+        _used += _settings.stagingSize - _head;
+        _batchBytes += _settings.stagingSize - _head;
+        _head = 0;
+    }
+
+    _used += end - _head;
+    _batchBytes += end - _head;
+    _head = end;
+    _stats.stagingBytes = _used;
+    return offset;
+}
+
+// Gives back the unused end of a run's chunk when nothing was allocated after it.
+void UploadBatcher::trim(Run &run)
+{
+    if (run.end != _head || run.cursor == run.end)
+        return;
+    const uint64_t unused = run.end - run.cursor;
+    _head = run.cursor;
+    _used -= unused;
+    _batchBytes -= unused;
+    run.end = run.cursor;
+    _stats.stagingBytes = _used;
+}
+
+uint64_t UploadBatcher::upload(void *pDestination, uint64_t destinationOffset, uint64_t size)
+{
+    assert(pDestination);
+
+    auto it = std::find_if(_runs.begin(), _runs.end(),
+                           [pDestination](const Run &run) { return run.pDestination == pDestination; });
+    uint64_t offset = InvalidOffset;
+    if (it != _runs.end())
+    {
+        // Uploads continuing the destination range stay contiguous in the chunk, so their copies coalesce.
+        const uint64_t cursor = it->nextOffset == destinationOffset ? it->cursor : align(it->cursor);
+        if (cursor + size <= it->end)
+            offset = cursor;
+        else
+            trim(*it);
+    }
+
+    if (offset == InvalidOffset)
+    {
+        // Chunks double for destinations that keep filling theirs, so a stream breaks into few copies.
+        uint64_t chunkSize = _settings.chunkSize;
+        if (it != _runs.end())
+            chunkSize = std::max(chunkSize, std::min(2 * it->chunkSize, _settings.stagingSize / MaxRuns));
+        chunkSize = std::max(chunkSize, size);
+        uint64_t chunkEnd;
+        if ((offset = allocate(chunkSize)) != InvalidOffset)
+            chunkEnd = offset + chunkSize;
+        else if (chunkSize > size && (offset = allocate(size)) != InvalidOffset)
+            chunkEnd = offset + size;
+        else
+        {
+            ++_stats.overflows;
+            return InvalidOffset;
+        }
+
+        if (it == _runs.end())
+        {
+            if (_runs.size() == MaxRuns)
+            {
+                trim(_runs.front());
+                _runs.erase(_runs.begin());
+            }
+            _runs.push_back({pDestination, 0, 0, 0, 0});
+            it = _runs.end() - 1;
+        }
+        it->end = chunkEnd;
+        it->chunkSize = chunkEnd - offset;
+    }
+
+    it->cursor = offset + size;
+    it->nextOffset = destinationOffset + size;
+    _pending.push_back({{nullptr, offset, pDestination, destinationOffset, size}, 0});
+    return offset;
+}
+
+void UploadBatcher::copy(void *pSource, uint64_t sourceOffset, void *pDestination, uint64_t destinationOffset,
+                         uint64_t size)
+{
+    assert(pSource && pDestination);
+    _pending.push_back({{pSource, sourceOffset, pDestination, destinationOffset, size}, 0});
+}
+
+// Staging is never written by a copy, so only copies between resources can depend on others.
+void UploadBatcher::assignPhases()
+{
+    if (std::none_of(_pending.begin(), _pending.end(), [](const Pending &p) { return p.copy.pSource; }))
+        return;
+
+    _accesses.clear();
+    for (Pending &pending : _pending)
+    {
+        uint32_t phase = 0;
+        Access *pSource = pending.copy.pSource ? &_accesses[pending.copy.pSource] : nullptr;
+        if (pSource && pSource->written)
+            phase = pSource->written;
+        Access &destination = _accesses[pending.copy.pDestination];
+        phase = std::max(phase, destination.read);
+        // Writes in the same phase stay in recording order where they overlap.
+        if (destination.written)
+            phase = std::max(phase, destination.written - 1);
+
+        pending.phase = phase;
+        destination.written = std::max(destination.written, phase + 1);
+        if (pSource)
+            pSource->read = std::max(pSource->read, phase + 1);
+    }
+}
+
+uint64_t UploadBatcher::flush(std::vector<Copy> &copies)
+{
+    for (Run &run : _runs)
+        trim(run);
+    _runs.clear();
+    if (_batchBytes)
+        _batches.push_back({_serial + 1, _head, _batchBytes});
+    _batchBytes = 0;
+
+    assignPhases();
+
+    _sorted.resize(_pending.size());
+    for (uint32_t i = 0; i < _sorted.size(); ++i)
+    {
+        const Pending &pending = _pending[i];
+        _sorted[i] = {pending.phase, uintptr_t(pending.copy.pDestination), pending.copy.destinationOffset, i};
+    }
+    // Uploads mostly arrive in destination order already.
+    if (!std::is_sorted(_sorted.begin(), _sorted.end()))
+        std::sort(_sorted.begin(), _sorted.end());
+
+    const size_t first = copies.size();
+    uint64_t bytes = 0;
+    for (size_t groupStart = 0; groupStart < _sorted.size();)
+    {
+        // The copies of one phase into one destination.
+        const Copy &head = _pending[_sorted[groupStart].index].copy;
+        const uint32_t phase = _pending[_sorted[groupStart].index].phase;
+        size_t groupEnd = groupStart + 1;
+        bool overlapping = false;
+        uint64_t end = head.destinationOffset + head.size;
+        for (; groupEnd < _sorted.size(); ++groupEnd)
+        {
+            const Pending &pending = _pending[_sorted[groupEnd].index];
+            if (pending.phase != phase || pending.copy.pDestination != head.pDestination)
+                break;
+            overlapping |= pending.copy.destinationOffset < end;
+            end = std::max(end, pending.copy.destinationOffset + pending.copy.size);
+        }
+        if (overlapping)
+        {
+            std::sort(_sorted.begin() + groupStart, _sorted.begin() + groupEnd,
+                      [](const SortKey &a, const SortKey &b) { return a.index < b.index; });
+        }
+
+        for (size_t i = groupStart; i < groupEnd; ++i)
+        {
+            const Copy &copy = _pending[_sorted[i].index].copy;
+            bytes += copy.size;
+            if (copies.size() > first)
+            {
+                Copy &last = copies.back();
+                if (last.pSource == copy.pSource && last.pDestination == copy.pDestination &&
+                    last.sourceOffset + last.size == copy.sourceOffset &&
+                    last.destinationOffset + last.size == copy.destinationOffset)
+                {
+                    last.size += copy.size;
+                    continue;
+                }
+            }
+            copies.push_back(copy);
+        }
+        groupStart = groupEnd;
+    }
+
+    _stats.uploads = _pending.size();
+    _stats.copies = copies.size() - first;
+    _stats.bytes = bytes;
+    _pending.clear();
+    return ++_serial;
+}
@@ -0,0 +1,281 @@
+// CascadedShadows: every cascade's projection contains its slice of the view frustum, and moving or turning the
+// camera only ever shifts a cascade by whole shadow texels at an unchanged scale. cullCasters must give each cascade
+// exactly the casters a brute-force test in that cascade's clip space keeps: inside the sides and not beyond the far
+// plane, with nothing culled toward the light.
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "CascadedShadows.h"
+#include "JobSystem.h"
+#include "Test.h"
+
+using namespace SimdMath;
+
+namespace
+{
+constexpr float FovY = 1.0f, Aspect = 16.0f / 9.0f, Near = 0.1f;
+
+// Clip coordinates of a world point, in double precision from the float matrix.
+void toClip(const ShadowCascade &cascade, const float p[3], double clip[3])
+{
+    const float *m = cascade.lightViewProjection.data();
+    for (int row = 0; row < 3; ++row)
+        clip[row] = double(m[row]) * p[0] + double(m[4 + row]) * p[1] + double(m[8 + row]) * p[2] + m[12 + row];
+}
+
+// Clip units per world unit along a clip axis; the projection is a rotation and an axis-aligned scale.
+double clipScale(const ShadowCascade &cascade, int row)
+{
+    const float *m = cascade.lightViewProjection.data();
+    return std::sqrt(double(m[row]) * m[row] + double(m[4 + row]) * m[4 + row] + double(m[8 + row]) * m[8 + row]);
+}
+
+// World-space corners of the view frustum between two view depths.
+std::vector<float3> sliceCorners(const float4x4 &view, float nearDepth, float farDepth)
+{
+    const float *v = view.data();
+    const float3 right = {v[0], v[4], v[8]}, up = {v[1], v[5], v[9]}, back = {v[2], v[6], v[10]};
+    const float3 eye = -(right * v[12] + up * v[13] + back * v[14]);
+    const float tanHalfY = std::tan(0.5f * FovY), tanHalfX = tanHalfY * Aspect;
+    std::vector<float3> corners;
+    for (float depth : {nearDepth, farDepth})
+    {
+        for (int corner = 0; corner < 4; ++corner)
+        {
+            const float sx = corner & 1 ? 1.0f : -1.0f, sy = corner & 2 ? 1.0f : -1.0f;
+            corners.push_back(eye + right * (sx * tanHalfX * depth) + up * (sy * tanHalfY * depth) - back * depth);
+        }
+    }
+    return corners;
+}
+
+void checkCoverage(const CascadedShadows &shadows, const float4x4 &view)
+{
+    bool covered = true;
+    float previousSplit = Near;
+    for (uint32_t c = 0; c < shadows.cascadeCount(); ++c)
+    {
+        const ShadowCascade &cascade = shadows.cascade(c);
+        for (const float3 &corner : sliceCorners(view, previousSplit, cascade.splitDepth))
+        {
+            const float p[3] = {corner.x, corner.y, corner.z};
+            double clip[3];
+            toClip(cascade, p, clip);
+            covered = covered && std::fabs(clip[0]) <= 1.0 && std::fabs(clip[1]) <= 1.0 && clip[2] >= 0.0 &&
+                      clip[2] <= 1.0;
+        }
+        previousSplit = cascade.splitDepth;
+    }
+    CHECK(covered);
+}
+
+void testSplits()
+{
+    float splits[5];
+    CascadedShadows::computeSplits(0.1f, 100.0f, 4, 0.75f, splits);
+    CHECK(splits[0] == 0.1f && splits[4] == 100.0f);
+    CHECK(splits[0] < splits[1] && splits[1] < splits[2] && splits[2] < splits[3] && splits[3] < splits[4]);
+    // Between the logarithmic and the uniform split.
+    CHECK(splits[2] > 0.1f * std::sqrt(1000.0f) && splits[2] < 50.05f);
+
+    CascadedShadows shadows(CascadedShadows::Settings{});
+    const float4x4 view = float4x4::lookAt({0.0f, 5.0f, 0.0f}, {10.0f, 4.0f, -10.0f}, {0.0f, 1.0f, 0.0f});
+    const float light[3] = {0.3f, -1.0f, 0.2f};
+    shadows.update({view.data(), FovY, Aspect, Near}, light);
+    CHECK(shadows.cascade(3).splitDepth == 100.0f);
+
+    // Viewports tile the atlas without overlapping.
+    CHECK(shadows.atlasWidth() == 2048 && shadows.atlasHeight() == 2048);
+    bool tiled = true;
+    for (uint32_t a = 0; a < shadows.cascadeCount(); ++a)
+    {
+        const CascadedShadows::Viewport va = shadows.viewport(a);
+        tiled = tiled && va.x + va.size <= shadows.atlasWidth() && va.y + va.size <= shadows.atlasHeight();
+        for (uint32_t b = 0; b < a; ++b)
+        {
+            const CascadedShadows::Viewport vb = shadows.viewport(b);
+            tiled = tiled && (va.x >= vb.x + vb.size || vb.x >= va.x + va.size || va.y >= vb.y + vb.size ||
+                              vb.y >= va.y + va.size);
+        }
+    }
+    CHECK(tiled);
+}
+
+void testCoverage()
+{
+    // The bounding spheres are tight, so with enough light directions some side of a cascade lines up with a slice
+    // corner.
+    CascadedShadows shadows(CascadedShadows::Settings{});
+    std::mt19937 random(2);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    for (int i = 0; i < 500; ++i)
+    {
+        const float3 eye = {unit(random) * 50.0f, unit(random) * 10.0f, unit(random) * 50.0f};
+        const float3 target = eye + float3{unit(random), unit(random) * 0.5f, unit(random)};
+        const float4x4 view = float4x4::lookAt(eye, target, {0.0f, 1.0f, 0.0f});
+        const float light[3] = {unit(random), unit(random), unit(random)};
+        shadows.update({view.data(), FovY, Aspect, Near}, light);
+        checkCoverage(shadows, view);
+    }
+}
+
+// A fixed world point's texel position in every cascade, and the cascades' texel sizes.
+struct Snapshot {
+    std::vector<double> texelX, texelY;
+    std::vector<float> texelSize;
+};
+
+Snapshot snapshot(const CascadedShadows &shadows, const std::vector<float3> &points, uint32_t resolution)
+{
+    Snapshot result;
+    for (uint32_t c = 0; c < shadows.cascadeCount(); ++c)
+    {
+        result.texelSize.push_back(shadows.cascade(c).texelSize);
+        for (const float3 &point : points)
+        {
+            const float p[3] = {point.x, point.y, point.z};
+            double clip[3];
+            toClip(shadows.cascade(c), p, clip);
+            result.texelX.push_back((clip[0] * 0.5 + 0.5) * resolution);
+            result.texelY.push_back((clip[1] * 0.5 + 0.5) * resolution);
+        }
+    }
+    return result;
+}
+
+// Returns whether every point moved by whole texels, with the texel sizes unchanged.
+bool wholeTexelShift(const Snapshot &a, const Snapshot &b)
+{
+    bool whole = a.texelSize == b.texelSize;
+    for (size_t i = 0; i < a.texelX.size(); ++i)
+    {
+        const double dx = b.texelX[i] - a.texelX[i], dy = b.texelY[i] - a.texelY[i];
+        whole = whole && std::fabs(dx - std::round(dx)) < 0.02 && std::fabs(dy - std::round(dy)) < 0.02;
+    }
+    return whole;
+}
+
+void testTexelSnapping()
+{
+    CascadedShadows::Settings settings;
+    settings.resolution = 512;
+    CascadedShadows shadows(settings);
+    const float light[3] = {-0.4f, -1.0f, 0.25f};
+    const std::vector<float3> points = {{0.0f, 0.0f, 0.0f}, {3.5f, 1.25f, -7.0f}, {-12.0f, 0.5f, -20.0f}};
+
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> step(-0.3f, 0.3f), angle(-0.2f, 0.2f);
+    float3 eye = {1.0f, 4.0f, 2.0f};
+    float yaw = 0.3f;
+    auto update = [&]() {
+        const float3 target = eye + float3{std::sin(yaw), -0.2f, -std::cos(yaw)};
+        const float4x4 view = float4x4::lookAt(eye, target, {0.0f, 1.0f, 0.0f});
+        shadows.update({view.data(), FovY, Aspect, Near}, light);
+        checkCoverage(shadows, view);
+        return snapshot(shadows, points, settings.resolution);
+    };
+
+    // Sub-texel moves and turns in place both shift every cascade by whole texels.
+    Snapshot previous = update();
+    bool moves = true, turns = true;
+    for (int frame = 0; frame < 30; ++frame)
+    {
+        eye = eye + float3{step(random), step(random) * 0.2f, step(random)};
+        Snapshot moved = update();
+        moves = moves && wholeTexelShift(previous, moved);
+        yaw += angle(random);
+        Snapshot turned = update();
+        turns = turns && wholeTexelShift(moved, turned);
+        previous = turned;
+    }
+    CHECK(moves);
+    CHECK(turns);
+}
+
+void checkCulling(uint32_t cascadeCount, size_t count, JobSystem *pJobs, uint32_t seed)
+{
+    CascadedShadows::Settings settings;
+    settings.cascadeCount = cascadeCount;
+    CascadedShadows shadows(settings);
+    const float4x4 view = float4x4::lookAt({5.0f, 6.0f, 3.0f}, {-20.0f, 2.0f, -40.0f}, {0.0f, 1.0f, 0.0f});
+    const float light[3] = {0.5f, -0.8f, -0.3f};
+    shadows.update({view.data(), FovY, Aspect, Near}, light);
+
+    // Casters all around, including far up toward the light, where they must not be culled.
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> across(-250.0f, 250.0f), height(-20.0f, 200.0f), size(0.1f, 10.0f);
+    std::vector<float> x(count), y(count), z(count), radius(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        x[i] = across(random);
+        y[i] = height(random);
+        z[i] = across(random);
+        radius[i] = size(random);
+    }
+
+    std::vector<std::vector<uint32_t>> visible(cascadeCount, std::vector<uint32_t>(count));
+    uint32_t *ppVisible[CascadedShadows::MaxCascades] = {};
+    for (uint32_t c = 0; c < cascadeCount; ++c)
+        ppVisible[c] = visible[c].data();
+    size_t counts[CascadedShadows::MaxCascades] = {};
+    shadows.cullCasters({x.data(), y.data(), z.data(), radius.data()}, count, ppVisible, counts, pJobs);
+
+    bool match = true, ordered = true, someCulled = false, someKept = false;
+    for (uint32_t c = 0; c < cascadeCount; ++c)
+    {
+        const ShadowCascade &cascade = shadows.cascade(c);
+        const double scaleX = clipScale(cascade, 0), scaleY = clipScale(cascade, 1), scaleZ = clipScale(cascade, 2);
+        const std::vector<uint32_t> found(visible[c].begin(), visible[c].begin() + counts[c]);
+        ordered = ordered && std::is_sorted(found.begin(), found.end()) &&
+                  std::adjacent_find(found.begin(), found.end()) == found.end();
+        someCulled = someCulled || counts[c] < count;
+        someKept = someKept || counts[c] > 0;
+
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            const float p[3] = {x[i], y[i], z[i]};
+            double clip[3];
+            toClip(cascade, p, clip);
+            // Margins to the sides and to the far plane; negative means outside.
+            const double margins[3] = {1.0 + radius[i] * scaleX - std::fabs(clip[0]),
+                                       1.0 + radius[i] * scaleY - std::fabs(clip[1]),
+                                       1.0 - (clip[2] - radius[i] * scaleZ)};
+            const double closest = std::min({margins[0], margins[1], margins[2]});
+            if (std::fabs(closest) < 1e-4)
+                continue;
+            const bool expected = closest >= 0.0;
+            const bool listed = std::binary_search(found.begin(), found.end(), i);
+            match = match && expected == listed;
+        }
+    }
+    CHECK(match);
+    CHECK(ordered);
+    CHECK(someCulled && someKept);
+}
+
+void testCullCasters()
+{
+    for (uint32_t cascades = 1; cascades <= CascadedShadows::MaxCascades; ++cascades)
+        checkCulling(cascades, 1003, nullptr, cascades);
+}
+
+void testCullCastersJobSystem()
+{
+    // Several 16K chunks, whose slices of each list are moved together after the parallel pass.
+    JobSystem jobs(4);
+    checkCulling(4, 70001, &jobs, 10);
+    checkCulling(3, 40000, nullptr, 11);
+}
+} // namespace
+
+int main()
+{
+    return Test::run({{"splits and atlas", testSplits},
+                      {"cascades contain their slices", testCoverage},
+                      {"texel snapping", testTexelSnapping},
+                      {"cullCasters matches brute force", testCullCasters},
+                      {"cullCasters on the JobSystem", testCullCastersJobSystem}});
+}
@@ -0,0 +1,179 @@
+// DescriptorTable against a model of its slots: random allocate and free sequences across frames must never hand out
+// a slot that is allocated or was freed less than frameLatency frames ago, must fail only when no slot is free, and
+// must leave every handle ever freed invalid, even once its slot has been reused. Generations wrapping around never
+// produce InvalidHandle.
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "DescriptorTable.h"
+#include "Test.h"
+
+namespace
+{
+struct Slot {
+    bool allocated = false;
+    bool used = false;       // handed out at least once
+    uint64_t freedFrame = 0; // valid once used and not allocated
+};
+
+void checkRandomFrames(const DescriptorTable::Settings &settings, uint32_t seed)
+{
+    std::mt19937 random(seed);
+    DescriptorTable table(settings);
+    std::vector<Slot> slots(settings.capacity);
+    std::vector<DescriptorTable::Handle> live, stale;
+    bool latencyKept = true, failsOnlyWhenFull = true, liveValid = true, staleInvalid = true, statsMatch = true;
+    size_t failures = 0, reuses = 0;
+    for (uint64_t frame = 1; frame <= 2000; ++frame)
+    {
+        table.beginFrame(frame);
+        // Phases of growth and shrinkage, so the table fills up and drains.
+        const bool growing = frame % 400 < 200;
+        const uint32_t operations = random() % 40;
+        for (uint32_t i = 0; i < operations; ++i)
+        {
+            if (live.empty() || random() % 100 < (growing ? 70u : 30u))
+            {
+                const DescriptorTable::Handle handle = table.allocate();
+                if (handle == DescriptorTable::InvalidHandle)
+                {
+                    bool available = false;
+                    for (const Slot &slot : slots)
+                        available = available || !slot.used ||
+                                    (!slot.allocated && slot.freedFrame + settings.frameLatency <= frame);
+                    failsOnlyWhenFull = failsOnlyWhenFull && !available;
+                    ++failures;
+                    continue;
+                }
+                const uint32_t index = DescriptorTable::index(handle);
+                if (index >= slots.size())
+                {
+                    latencyKept = false;
+                    continue;
+                }
+                Slot &slot = slots[index];
+                latencyKept = latencyKept && !slot.allocated &&
+                              (!slot.used || slot.freedFrame + settings.frameLatency <= frame);
+                reuses += slot.used;
+                slot.allocated = slot.used = true;
+                live.push_back(handle);
+            }
+            else
+            {
+                const size_t i = random() % live.size();
+                const DescriptorTable::Handle handle = live[i];
+                table.free(handle);
+                slots[DescriptorTable::index(handle)].allocated = false;
+                slots[DescriptorTable::index(handle)].freedFrame = frame;
+                live[i] = live.back();
+                live.pop_back();
+                stale.push_back(handle);
+            }
+        }
+
+        if (frame % 50 == 0)
+        {
+            for (DescriptorTable::Handle handle : live)
+                liveValid = liveValid && table.valid(handle);
+            for (DescriptorTable::Handle handle : stale)
+                staleInvalid = staleInvalid && !table.valid(handle);
+
+            uint32_t retired = 0, highWater = 0;
+            for (uint32_t index = 0; index < slots.size(); ++index)
+            {
+                retired += slots[index].used && !slots[index].allocated &&
+                           slots[index].freedFrame + settings.frameLatency > frame;
+                highWater = slots[index].used ? index + 1 : highWater;
+            }
+            const DescriptorTable::Stats stats = table.stats();
+            statsMatch = statsMatch && stats.capacity == settings.capacity && stats.allocated == live.size() &&
+                         stats.retired == retired && stats.highWater == highWater;
+        }
+    }
+    CHECK(latencyKept);
+    CHECK(failsOnlyWhenFull);
+    CHECK(liveValid);
+    CHECK(staleInvalid);
+    CHECK(statsMatch);
+    // The loop must fill the table and reuse slots.
+    CHECK(failures > 0 && reuses > 1000);
+}
+
+void testRandomFrames()
+{
+    checkRandomFrames(DescriptorTable::Settings{256, 3}, 1);
+}
+
+void testSingleFrameLatency()
+{
+    checkRandomFrames(DescriptorTable::Settings{100, 1}, 2);
+}
+
+void testLongLatency()
+{
+    checkRandomFrames(DescriptorTable::Settings{512, 8}, 3);
+}
+
+void testStaleHandle()
+{
+    // A freed handle stays invalid through its slot's retirement and after the slot is handed out again.
+    DescriptorTable table(DescriptorTable::Settings{1, 3});
+    table.beginFrame(1);
+    const DescriptorTable::Handle first = table.allocate();
+    CHECK(first != DescriptorTable::InvalidHandle && table.valid(first));
+    CHECK(table.allocate() == DescriptorTable::InvalidHandle);
+    table.free(first);
+    CHECK(!table.valid(first));
+
+    table.beginFrame(3);
+    CHECK(table.allocate() == DescriptorTable::InvalidHandle);
+    CHECK(table.stats().retired == 1);
+    table.beginFrame(4);
+    const DescriptorTable::Handle second = table.allocate();
+    CHECK(second != DescriptorTable::InvalidHandle && second != first);
+    CHECK(DescriptorTable::index(second) == DescriptorTable::index(first));
+    CHECK(table.valid(second) && !table.valid(first));
+    CHECK(!table.valid(DescriptorTable::InvalidHandle));
+    // Handles naming slots past the capacity, or slots never handed out, are invalid too.
+    CHECK(!table.valid((1u << DescriptorTable::IndexBits) | 5));
+    DescriptorTable larger(DescriptorTable::Settings{8, 3});
+    larger.beginFrame(1);
+    CHECK(larger.valid(larger.allocate()));
+    CHECK(!larger.valid((1u << DescriptorTable::IndexBits) | 3));
+}
+
+void testGenerationWrap()
+{
+    // Cycling one slot through every generation twice never produces InvalidHandle and never repeats a handle before
+    // all the others of the slot have been used.
+    DescriptorTable table(DescriptorTable::Settings{1, 0});
+    constexpr uint32_t Generations = (1u << (32 - DescriptorTable::IndexBits)) - 1;
+    std::vector<DescriptorTable::Handle> handles;
+    for (uint64_t frame = 1; frame <= 2 * Generations; ++frame)
+    {
+        table.beginFrame(frame);
+        const DescriptorTable::Handle handle = table.allocate();
+        handles.push_back(handle);
+        table.free(handle);
+    }
+    CHECK(std::find(handles.begin(), handles.end(), DescriptorTable::InvalidHandle) == handles.end());
+    bool cycled = true;
+    for (size_t i = 0; i < handles.size(); ++i)
+        cycled = cycled && handles[i] == handles[i % Generations];
+    std::vector<DescriptorTable::Handle> firstCycle(handles.begin(), handles.begin() + Generations);
+    std::sort(firstCycle.begin(), firstCycle.end());
+    CHECK(cycled);
+    CHECK(std::adjacent_find(firstCycle.begin(), firstCycle.end()) == firstCycle.end());
+}
+} // namespace
+
+int main()
+{
+    return Test::run({{"random frames match the model", testRandomFrames},
+                      {"random frames, one frame of latency", testSingleFrameLatency},
+                      {"random frames, eight frames of latency", testLongLatency},
+                      {"stale handles are invalid", testStaleHandle},
+                      {"generations wrap without InvalidHandle", testGenerationWrap}});
+}
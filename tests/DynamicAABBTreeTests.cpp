@@ -0,0 +1,257 @@
+// DynamicAABBTree under random inserts, moves and removes: the structure stays balanced with fat bounds containing
+// the exact ones, and overlap, frustum and ray queries agree with a brute-force scan of the live proxies.
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "DynamicAABBTree.h"
+#include "SimdMath.h"
+#include "Test.h"
+
+namespace
+{
+struct Object {
+    DynamicAABBTree::ProxyId proxy = DynamicAABBTree::InvalidProxy;
+    AABB bounds;
+    float velocity[3];
+};
+
+AABB box(float x, float y, float z, float halfSize)
+{
+    return {x - halfSize, y - halfSize, z - halfSize, x + halfSize, y + halfSize, z + halfSize};
+}
+
+bool contains(const AABB &outer, const AABB &inner)
+{
+    return outer.minX <= inner.minX && outer.minY <= inner.minY && outer.minZ <= inner.minZ &&
+           inner.maxX <= outer.maxX && inner.maxY <= outer.maxY && inner.maxZ <= outer.maxZ;
+}
+
+bool overlaps(const AABB &a, const AABB &b)
+{
+    return a.minX <= b.maxX && b.minX <= a.maxX && a.minY <= b.maxY && b.minY <= a.maxY && a.minZ <= b.maxZ &&
+           b.minZ <= a.maxZ;
+}
+
+// Entry distance of the ray into the box within maxDistance, or a negative value on a miss.
+float rayDistance(const AABB &b, const float origin[3], const float direction[3], float maxDistance)
+{
+    const float *pMin = &b.minX, *pMax = &b.maxX;
+    float tMin = 0.0f, tMax = maxDistance;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float t0 = (pMin[axis] - origin[axis]) / direction[axis];
+        float t1 = (pMax[axis] - origin[axis]) / direction[axis];
+        if (t0 > t1)
+            std::swap(t0, t1);
+        tMin = std::max(tMin, t0);
+        tMax = std::min(tMax, t1);
+        if (tMin > tMax)
+            return -1.0f;
+    }
+    return tMin;
+}
+
+class Scene {
+  public:
+    explicit Scene(uint32_t seed) : random(seed) {}
+
+    std::mt19937 random;
+    DynamicAABBTree tree;
+    std::vector<Object> objects; // indexed by userData
+
+    void insert()
+    {
+        std::uniform_real_distribution<float> position(-100.0f, 100.0f), speed(-2.0f, 2.0f), size(0.2f, 3.0f);
+        Object object;
+        object.bounds = box(position(random), position(random), position(random), size(random));
+        for (float &v : object.velocity)
+            v = speed(random);
+        object.proxy = tree.insert(object.bounds, uint32_t(objects.size()));
+        objects.push_back(object);
+    }
+
+    void step(bool refit)
+    {
+        std::uniform_int_distribution<int> percent(0, 99);
+        for (Object &object : objects)
+        {
+            if (object.proxy == DynamicAABBTree::InvalidProxy)
+                continue;
+            float *pMin = &object.bounds.minX, *pMax = &object.bounds.maxX;
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                // Bounce off the walls of the world so the density stays put.
+                if (pMin[axis] + object.velocity[axis] < -110.0f || pMax[axis] + object.velocity[axis] > 110.0f)
+                    object.velocity[axis] = -object.velocity[axis];
+                pMin[axis] += object.velocity[axis];
+                pMax[axis] += object.velocity[axis];
+            }
+            if (refit)
+                tree.setBounds(object.proxy, object.bounds);
+            else
+                tree.move(object.proxy, object.bounds, object.velocity);
+        }
+        if (refit)
+            tree.refit();
+
+        // Some objects leave and others arrive.
+        for (Object &object : objects)
+        {
+            if (object.proxy != DynamicAABBTree::InvalidProxy && percent(random) < 2)
+            {
+                tree.remove(object.proxy);
+                object.proxy = DynamicAABBTree::InvalidProxy;
+            }
+        }
+        for (int i = 0; i < 20; ++i)
+            insert();
+    }
+
+    std::vector<uint32_t> bruteOverlap(const AABB &query) const
+    {
+        std::vector<uint32_t> results;
+        for (uint32_t i = 0; i < objects.size(); ++i)
+        {
+            if (objects[i].proxy != DynamicAABBTree::InvalidProxy && overlaps(objects[i].bounds, query))
+                results.push_back(i);
+        }
+        return results;
+    }
+};
+
+void checkStructure(const Scene &scene)
+{
+    CHECK(scene.tree.validate());
+    size_t live = 0;
+    for (const Object &object : scene.objects)
+    {
+        if (object.proxy == DynamicAABBTree::InvalidProxy)
+            continue;
+        ++live;
+        CHECK(contains(scene.tree.fatBounds(object.proxy), object.bounds));
+    }
+    CHECK(scene.tree.size() == live);
+    // AVL balance bounds the height by 1.44 log2(n + 2).
+    CHECK(scene.tree.height() <= int(1.45f * std::log2(float(live) + 2.0f)) + 1);
+}
+
+void checkQueries(Scene &scene)
+{
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f), size(1.0f, 20.0f), unit(-1.0f, 1.0f);
+    for (int q = 0; q < 20; ++q)
+    {
+        const float x = position(scene.random), y = position(scene.random), z = position(scene.random);
+        const AABB query = box(x, y, z, size(scene.random));
+        std::vector<uint32_t> results;
+        scene.tree.queryOverlap(query, results);
+        std::sort(results.begin(), results.end());
+        CHECK(results == scene.bruteOverlap(query));
+    }
+
+    const SimdMath::float4x4 viewProjection =
+        SimdMath::float4x4::perspective(1.0f, 1.5f, 0.5f, 150.0f) *
+        SimdMath::float4x4::lookAt({0.0f, 20.0f, -120.0f}, {10.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f});
+    const Frustum frustum = Frustum::fromViewProjection(viewProjection.data());
+    std::vector<uint32_t> visible, expected;
+    scene.tree.queryFrustum(frustum, visible);
+    std::sort(visible.begin(), visible.end());
+    for (uint32_t i = 0; i < scene.objects.size(); ++i)
+    {
+        if (scene.objects[i].proxy != DynamicAABBTree::InvalidProxy && frustum.intersects(scene.objects[i].bounds))
+            expected.push_back(i);
+    }
+    CHECK(visible == expected);
+
+    for (int r = 0; r < 20; ++r)
+    {
+        const float origin[3] = {position(scene.random), position(scene.random), -150.0f};
+        const float direction[3] = {unit(scene.random) * 0.3f, unit(scene.random) * 0.3f, 1.0f};
+        float distance = 0.0f;
+        const DynamicAABBTree::ProxyId hit = scene.tree.pick(origin, direction, 400.0f, &distance);
+
+        float nearest = 400.0f;
+        bool any = false;
+        for (const Object &object : scene.objects)
+        {
+            if (object.proxy == DynamicAABBTree::InvalidProxy)
+                continue;
+            const float d = rayDistance(object.bounds, origin, direction, nearest);
+            if (d >= 0.0f)
+            {
+                nearest = d;
+                any = true;
+            }
+        }
+        CHECK(any == (hit != DynamicAABBTree::InvalidProxy));
+        if (any && hit != DynamicAABBTree::InvalidProxy)
+            CHECK(std::fabs(distance - nearest) <= 1e-3f * (1.0f + nearest));
+    }
+}
+
+void testRandomMoves()
+{
+    Scene scene(11);
+    for (int i = 0; i < 2000; ++i)
+        scene.insert();
+    checkStructure(scene);
+    for (int frame = 0; frame < 60; ++frame)
+    {
+        scene.step(false);
+        checkStructure(scene);
+        if (frame % 10 == 0)
+            checkQueries(scene);
+    }
+}
+
+void testRefit()
+{
+    Scene scene(12);
+    for (int i = 0; i < 2000; ++i)
+        scene.insert();
+    for (int frame = 0; frame < 30; ++frame)
+    {
+        scene.step(frame % 3 != 0);
+        checkStructure(scene);
+        if (frame % 5 == 0)
+            checkQueries(scene);
+    }
+}
+
+void testRemoveAll()
+{
+    Scene scene(13);
+    for (int i = 0; i < 500; ++i)
+        scene.insert();
+    std::vector<size_t> order(scene.objects.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), scene.random);
+    for (size_t i : order)
+    {
+        scene.tree.remove(scene.objects[i].proxy);
+        scene.objects[i].proxy = DynamicAABBTree::InvalidProxy;
+        if (i % 50 == 0)
+            checkStructure(scene);
+    }
+    CHECK(scene.tree.size() == 0);
+    CHECK(scene.tree.validate());
+
+    // Freed proxies and nodes are reused.
+    for (int i = 0; i < 100; ++i)
+        scene.insert();
+    checkStructure(scene);
+    checkQueries(scene);
+}
+} // namespace
+
+int main()
+{
+    return Test::run({
+        {"random moves keep the tree balanced and queries exact", testRandomMoves},
+        {"setBounds and refit", testRefit},
+        {"remove everything and reinsert", testRemoveAll},
+    });
+}
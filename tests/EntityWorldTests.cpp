@@ -0,0 +1,251 @@
+// EntityWorld against a plain map from entity to expected component values: destroys and component changes that
+// swap the last entity of an archetype into the hole keep every handle pointing at its own data, destroyed indices
+// come back with a new generation, and EntityCommandBuffer placeholders resolve to the entities apply creates.
+
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "EntityWorld.h"
+#include "JobSystem.h"
+#include "Test.h"
+
+namespace
+{
+struct Id {
+    uint32_t value;
+};
+
+struct Payload {
+    float data[12]; // large enough that an archetype needs several chunks for a few thousand entities
+};
+
+struct Tag {
+    uint32_t value;
+};
+
+struct EntityOrder {
+    bool operator()(const Entity &a, const Entity &b) const
+    {
+        return a.index != b.index ? a.index < b.index : a.generation < b.generation;
+    }
+};
+
+template <typename T> using EntityMap = std::map<Entity, T, EntityOrder>;
+
+// Every expected entity is alive with its own Id and Tag, and forEach visits each of them exactly once.
+void checkWorld(EntityWorld &world, const EntityMap<Id> &ids, const EntityMap<Tag> &tags)
+{
+    CHECK(world.size() == ids.size());
+    for (const auto &[entity, id] : ids)
+    {
+        CHECK(world.isAlive(entity));
+        const Id *pId = world.get<Id>(entity);
+        CHECK(pId && pId->value == id.value);
+        const Tag *pTag = world.get<Tag>(entity);
+        const auto tag = tags.find(entity);
+        CHECK((pTag != nullptr) == (tag != tags.end()));
+        if (pTag && tag != tags.end())
+            CHECK(pTag->value == tag->second.value);
+    }
+
+    size_t visited = 0;
+    bool matches = true;
+    world.forEach<const Id>([&](Entity entity, const Id &id) {
+        const auto expected = ids.find(entity);
+        matches = matches && expected != ids.end() && expected->second.value == id.value;
+        ++visited;
+    });
+    CHECK(matches && visited == ids.size());
+}
+
+void testSwapRemoveFixesLocations()
+{
+    EntityWorld world;
+    EntityMap<Id> ids;
+    EntityMap<Tag> tags;
+    std::vector<Entity> alive;
+    std::mt19937 random(1);
+    uint32_t nextId = 0;
+
+    for (int round = 0; round < 20; ++round)
+    {
+        for (int i = 0; i < 500; ++i)
+        {
+            const Entity entity = world.create(Id{nextId}, Payload{});
+            ids[entity] = Id{nextId++};
+            alive.push_back(entity);
+        }
+
+        // Destroy the first, last and random entities, so holes open in every chunk, including the last one.
+        std::shuffle(alive.begin(), alive.end(), random);
+        for (int i = 0; i < 200 && !alive.empty(); ++i)
+        {
+            const Entity entity = alive.back();
+            alive.pop_back();
+            world.destroy(entity);
+            ids.erase(entity);
+            tags.erase(entity);
+        }
+
+        // Moving between archetypes swap-removes from the source as well.
+        for (int i = 0; i < 150; ++i)
+        {
+            const Entity entity = alive[random() % alive.size()];
+            if (tags.count(entity))
+            {
+                world.remove<Tag>(entity);
+                tags.erase(entity);
+            }
+            else
+            {
+                const Tag tag = {uint32_t(random())};
+                world.add(entity, tag);
+                tags[entity] = tag;
+            }
+        }
+        checkWorld(world, ids, tags);
+    }
+
+    for (const Entity entity : alive)
+        world.destroy(entity);
+    ids.clear();
+    tags.clear();
+    checkWorld(world, ids, tags);
+}
+
+void testGenerationReuse()
+{
+    EntityWorld world;
+    const Entity first = world.create(Id{1});
+    const Entity second = world.create(Id{2});
+    world.destroy(first);
+    CHECK(!world.isAlive(first));
+    CHECK(world.isAlive(second));
+
+    // The freed index comes back with a new generation; the stale handle stays dead.
+    const Entity reused = world.create(Id{3});
+    CHECK(reused.index == first.index);
+    CHECK(reused.generation != first.generation);
+    CHECK(!world.isAlive(first));
+    CHECK(world.isAlive(reused) && world.get<Id>(reused)->value == 3);
+
+    // Many cycles on the same index never revive an old handle.
+    std::vector<Entity> handles = {first, reused};
+    Entity current = reused;
+    for (int i = 0; i < 100; ++i)
+    {
+        world.destroy(current);
+        current = world.create(Id{uint32_t(i)});
+        CHECK(current.index == first.index);
+        handles.push_back(current);
+    }
+    for (size_t i = 0; i + 1 < handles.size(); ++i)
+        CHECK(!world.isAlive(handles[i]) && handles[i] != current);
+    CHECK(world.isAlive(current) && world.get<Id>(current)->value == 99);
+    CHECK(world.get<Id>(second)->value == 2);
+
+    // A stale handle in a command buffer is skipped rather than hitting the entity that reused its index.
+    EntityCommandBuffer commands;
+    commands.destroy(first);
+    commands.add(first, Tag{7});
+    world.apply(commands);
+    CHECK(world.isAlive(current) && world.get<Tag>(current) == nullptr);
+}
+
+void testCommandBufferPlaceholders()
+{
+    EntityWorld world;
+    // Real entities with indices 0 and 1, the same indices the first placeholders get.
+    const Entity existing0 = world.create(Id{100});
+    const Entity existing1 = world.create(Id{101});
+
+    EntityCommandBuffer commands;
+    const Entity a = commands.create();
+    const Entity b = commands.create();
+    const Entity c = commands.create();
+    CHECK(a.index == existing0.index && b.index == existing1.index);
+    commands.add(a, Id{1});
+    commands.add(b, Id{2});
+    commands.add(b, Tag{22});
+    commands.add(c, Id{3});
+    commands.destroy(c);
+    commands.add(existing1, Tag{11});
+    commands.destroy(existing0);
+    commands.destroy(existing0);
+    CHECK(world.isAlive(existing0) && world.size() == 2);
+
+    world.apply(commands);
+    CHECK(commands.empty());
+    CHECK(!world.isAlive(existing0));
+    CHECK(world.get<Id>(existing1)->value == 101 && world.get<Tag>(existing1)->value == 11);
+
+    std::map<uint32_t, Entity> byId;
+    world.forEach<const Id>([&](Entity entity, const Id &id) { byId[id.value] = entity; });
+    CHECK(byId.size() == 3 && byId.count(1) && byId.count(2) && !byId.count(3));
+    if (byId.count(1) && byId.count(2))
+    {
+        CHECK(world.get<Tag>(byId[1]) == nullptr);
+        CHECK(world.get<Tag>(byId[2]) && world.get<Tag>(byId[2])->value == 22);
+    }
+
+    // After clear, placeholders start from zero again and resolve against the next apply only.
+    const Entity d = commands.create();
+    CHECK(d.index == 0);
+    commands.add(d, Id{4});
+    world.apply(commands);
+    size_t withId4 = 0;
+    world.forEach<const Id>([&](Entity, const Id &id) { withId4 += id.value == 4; });
+    CHECK(withId4 == 1 && world.size() == 4);
+}
+
+void testParallelRecording()
+{
+    EntityWorld world;
+    for (uint32_t i = 0; i < 20000; ++i)
+        world.create(Id{i});
+
+    // Every entity with an odd id spawns a child carrying the parent's id plus a tag, and even ones are destroyed.
+    JobSystem jobs(4);
+    EntityCommandBuffer commands;
+    world.parallelForEach<const Id>(jobs, [&](Entity entity, const Id &id) {
+        if (id.value % 2)
+        {
+            const Entity child = commands.create();
+            commands.add(child, Id{id.value + 1000000});
+            commands.add(child, Tag{id.value});
+        }
+        else
+        {
+            commands.destroy(entity);
+        }
+    });
+    world.apply(commands);
+
+    size_t parents = 0, children = 0;
+    bool consistent = true;
+    world.forEach<const Id>([&](Entity entity, const Id &id) {
+        if (id.value >= 1000000)
+        {
+            const Tag *pTag = world.get<Tag>(entity);
+            consistent = consistent && pTag && pTag->value + 1000000 == id.value && pTag->value % 2;
+            ++children;
+        }
+        else
+        {
+            consistent = consistent && id.value % 2;
+            ++parents;
+        }
+    });
+    CHECK(consistent && parents == 10000 && children == 10000 && world.size() == 20000);
+}
+} // namespace
+
+int main()
+{
+    return Test::run({{"swapRemove fixes locations", testSwapRemoveFixesLocations},
+                      {"generation reuse", testGenerationReuse},
+                      {"command buffer placeholders", testCommandBufferPlaceholders},
+                      {"parallel recording", testParallelRecording}});
+}
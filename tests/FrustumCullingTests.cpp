@@ -0,0 +1,180 @@
+// FrustumCulling against a brute-force reference: a sphere is visible when its center is within radius of the inside
+// of every plane, a box when one of its eight corners is inside every plane. Boxes and spheres straddling a plane,
+// object counts that leave a partial batch of eight, and the chunked JobSystem path must all produce exactly the
+// reference's visible list. CMake builds this file once per Float8 back end the host can run.
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "FrustumCulling.h"
+#include "JobSystem.h"
+#include "SimdMath.h"
+#include "Test.h"
+
+using namespace SimdMath;
+
+namespace
+{
+// Objects closer to a plane than this are regenerated: float rounding may put them on either side of it.
+constexpr double Ambiguous = 1e-3;
+
+struct Scene {
+    std::vector<float> x, y, z, radius;
+    std::vector<float> minX, minY, minZ, maxX, maxY, maxZ;
+    std::vector<uint32_t> visibleSpheres, visibleBoxes;
+    size_t straddlingSpheres = 0, straddlingBoxes = 0;
+};
+
+// Smallest and largest signed distance of the sphere or box to the plane, in double precision.
+void sphereRange(const Plane &p, double x, double y, double z, double r, double &low, double &high)
+{
+    const double d = double(p.nx) * x + double(p.ny) * y + double(p.nz) * z + double(p.distance);
+    low = d - r;
+    high = d + r;
+}
+
+void boxRange(const Plane &p, const double corner0[3], const double corner1[3], double &low, double &high)
+{
+    low = 1e30;
+    high = -1e30;
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        const double cx = corner & 1 ? corner1[0] : corner0[0];
+        const double cy = corner & 2 ? corner1[1] : corner0[1];
+        const double cz = corner & 4 ? corner1[2] : corner0[2];
+        const double d = double(p.nx) * cx + double(p.ny) * cy + double(p.nz) * cz + double(p.distance);
+        low = d < low ? d : low;
+        high = d > high ? d : high;
+    }
+}
+
+// Visible when no plane has the object entirely outside; straddling when visible and some plane cuts it.
+// Returns false when a plane lies within Ambiguous of the object's nearest or farthest point.
+template <typename Range> bool classify(const Frustum &frustum, Range range, bool &visible, bool &straddling)
+{
+    visible = true;
+    straddling = false;
+    for (const Plane &p : frustum.planes)
+    {
+        double low, high;
+        range(p, low, high);
+        if (std::fabs(high) < Ambiguous || std::fabs(low) < Ambiguous)
+            return false;
+        visible = visible && high >= 0.0;
+        straddling = straddling || (low < 0.0 && high > 0.0);
+    }
+    straddling = straddling && visible;
+    return true;
+}
+
+// Objects scattered through and around the frustum, with sizes up to a few units so many cross its planes.
+Scene makeScene(const Frustum &frustum, size_t count, uint32_t seed)
+{
+    Scene scene;
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> position(-45.0f, 45.0f), depth(-70.0f, 5.0f), size(0.05f, 4.0f);
+    for (uint32_t i = 0; i < count;)
+    {
+        const float cx = position(random), cy = position(random) * 0.6f, cz = depth(random), r = size(random);
+        const float hx = size(random), hy = size(random), hz = size(random);
+        bool sphereVisible, sphereStraddling, boxVisible, boxStraddling;
+        const float min[3] = {cx - hx, cy - hy, cz - hz}, max[3] = {cx + hx, cy + hy, cz + hz};
+        const double corner0[3] = {min[0], min[1], min[2]}, corner1[3] = {max[0], max[1], max[2]};
+        const bool sphereClear = classify(
+            frustum, [&](const Plane &p, double &lo, double &hi) { sphereRange(p, cx, cy, cz, r, lo, hi); },
+            sphereVisible, sphereStraddling);
+        const bool boxClear = classify(
+            frustum, [&](const Plane &p, double &lo, double &hi) { boxRange(p, corner0, corner1, lo, hi); },
+            boxVisible, boxStraddling);
+        if (!sphereClear || !boxClear)
+            continue;
+
+        scene.x.push_back(cx);
+        scene.y.push_back(cy);
+        scene.z.push_back(cz);
+        scene.radius.push_back(r);
+        scene.minX.push_back(min[0]);
+        scene.minY.push_back(min[1]);
+        scene.minZ.push_back(min[2]);
+        scene.maxX.push_back(max[0]);
+        scene.maxY.push_back(max[1]);
+        scene.maxZ.push_back(max[2]);
+        if (sphereVisible)
+            scene.visibleSpheres.push_back(i);
+        if (boxVisible)
+            scene.visibleBoxes.push_back(i);
+        scene.straddlingSpheres += sphereStraddling;
+        scene.straddlingBoxes += boxStraddling;
+        ++i;
+    }
+    return scene;
+}
+
+Frustum makeFrustum()
+{
+    const float4x4 viewProjection = float4x4::perspective(1.1f, 16.0f / 9.0f, 0.5f, 60.0f) *
+                                    float4x4::lookAt({0.0f, 0.0f, 0.0f}, {0.2f, -0.1f, -1.0f}, {0.0f, 1.0f, 0.0f});
+    return Frustum::fromViewProjection(viewProjection.data());
+}
+
+void checkCulling(size_t count, JobSystem *pJobs)
+{
+    const Frustum frustum = makeFrustum();
+    const Scene scene = makeScene(frustum, count, uint32_t(count));
+    if (count >= 1000)
+    {
+        CHECK(scene.straddlingSpheres > count / 50);
+        CHECK(scene.straddlingBoxes > count / 50);
+    }
+
+    // One spare entry past the end catches writes beyond count.
+    std::vector<uint32_t> visible(count + 1, 0xdeadbeef);
+    const FrustumCulling::SphereSoA spheres = {scene.x.data(), scene.y.data(), scene.z.data(), scene.radius.data()};
+    const size_t sphereCount = FrustumCulling::cullSpheres(frustum, spheres, count, visible.data(), pJobs);
+    CHECK(std::vector<uint32_t>(visible.begin(), visible.begin() + sphereCount) == scene.visibleSpheres);
+    CHECK(visible[count] == 0xdeadbeef);
+
+    const FrustumCulling::AABBSoA boxes = {scene.minX.data(), scene.minY.data(), scene.minZ.data(),
+                                           scene.maxX.data(), scene.maxY.data(), scene.maxZ.data()};
+    const size_t boxCount = FrustumCulling::cullAABBs(frustum, boxes, count, visible.data(), pJobs);
+    CHECK(std::vector<uint32_t>(visible.begin(), visible.begin() + boxCount) == scene.visibleBoxes);
+    CHECK(visible[count] == 0xdeadbeef);
+}
+
+void testPartialBatches()
+{
+    for (size_t count : {1, 7, 8, 9, 15, 16, 17, 1003})
+        checkCulling(count, nullptr);
+}
+
+void testSerial()
+{
+    checkCulling(50000, nullptr);
+}
+
+void testJobSystem()
+{
+    // Several 16K-object chunks, the last one partial.
+    JobSystem jobs(4);
+    checkCulling(100005, &jobs);
+    checkCulling(5, &jobs);
+}
+} // namespace
+
+int main()
+{
+#if defined(__AVX__)
+    std::printf("Float8 back end: AVX\n");
+#elif defined(__SSE__)
+    std::printf("Float8 back end: SSE\n");
+#elif defined(__ARM_NEON)
+    std::printf("Float8 back end: NEON\n");
+#else
+    std::printf("Float8 back end: scalar\n");
+#endif
+    return Test::run({{"partial batches match brute force", testPartialBatches},
+                      {"one thread matches brute force", testSerial},
+                      {"JobSystem matches brute force", testJobSystem}});
+}
@@ -0,0 +1,137 @@
+// IndirectCulling::cullAndCompact against a brute-force reference in double precision: an object is drawn when it has
+// instances and its sphere is within radius of the inside of every frustum plane, and its draw arguments are its own
+// with the byte offset turned into an index of its index type. Objects closer to a plane than float rounding can
+// decide are regenerated. The compacted draws must be exactly the reference's, in object order, with nothing written
+// past objectCount entries.
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "IndirectCulling.h"
+#include "SimdMath.h"
+#include "Test.h"
+
+using namespace SimdMath;
+
+namespace
+{
+constexpr double Ambiguous = 1e-3;
+constexpr uint32_t IndexTypeUInt16 = 0, IndexTypeUInt32 = 1;
+
+struct Scene {
+    std::vector<CullObject> objects;
+    std::vector<DrawIndexedArguments> expected;
+};
+
+bool sameDraw(const DrawIndexedArguments &a, const DrawIndexedArguments &b)
+{
+    return a.indexCount == b.indexCount && a.instanceCount == b.instanceCount && a.indexStart == b.indexStart &&
+           a.baseVertex == b.baseVertex && a.baseInstance == b.baseInstance;
+}
+
+Frustum makeFrustum()
+{
+    const float4x4 viewProjection = float4x4::perspective(1.1f, 16.0f / 9.0f, 0.5f, 60.0f) *
+                                    float4x4::lookAt({0.0f, 0.0f, 0.0f}, {0.2f, -0.1f, -1.0f}, {0.0f, 1.0f, 0.0f});
+    return Frustum::fromViewProjection(viewProjection.data());
+}
+
+// Objects scattered through and around the frustum, many crossing its planes, with both index types and a tenth of
+// them left without instances by CPU culling.
+Scene makeScene(const Frustum &frustum, size_t count, uint32_t seed)
+{
+    Scene scene;
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> position(-45.0f, 45.0f), depth(-70.0f, 5.0f), size(0.05f, 4.0f);
+    while (scene.objects.size() < count)
+    {
+        CullObject object = {};
+        object.bounds = {position(random), position(random) * 0.6f, depth(random), size(random)};
+        object.indexType = random() % 2 ? IndexTypeUInt32 : IndexTypeUInt16;
+        object.indexCount = 3 * (1 + random() % 5000);
+        object.indexOffset = (random() % 100000) * (object.indexType == IndexTypeUInt16 ? 2 : 4);
+        object.baseVertex = int32_t(random() % 200000) - 1000;
+        object.baseInstance = random() % 100000;
+        object.instanceCount = random() % 10 == 0 ? 0 : 1 + random() % 64;
+
+        bool visible = true, clear = true;
+        for (const Plane &p : frustum.planes)
+        {
+            const Sphere &s = object.bounds;
+            const double d = double(p.nx) * s.x + double(p.ny) * s.y + double(p.nz) * s.z + double(p.distance);
+            clear = clear && std::fabs(d + s.radius) >= Ambiguous;
+            visible = visible && d >= -double(s.radius);
+        }
+        if (!clear)
+            continue;
+
+        scene.objects.push_back(object);
+        if (visible && object.instanceCount > 0)
+        {
+            const uint32_t indexSize = object.indexType == IndexTypeUInt16 ? 2 : 4;
+            scene.expected.push_back({object.indexCount, object.instanceCount, object.indexOffset / indexSize,
+                                      object.baseVertex, object.baseInstance});
+        }
+    }
+    return scene;
+}
+
+void checkScene(const Frustum &frustum, const Scene &scene)
+{
+    const size_t count = scene.objects.size();
+    // One spare entry past objectCount catches writes beyond the room the caller must provide.
+    std::vector<DrawIndexedArguments> draws(count + 1, DrawIndexedArguments{0xdeadbeef, 0, 0, 0, 0});
+    const size_t drawCount = IndirectCulling::cullAndCompact(frustum, scene.objects.data(), count, draws.data());
+    CHECK(drawCount == scene.expected.size());
+    bool same = drawCount == scene.expected.size();
+    for (size_t i = 0; same && i < drawCount; ++i)
+        same = sameDraw(draws[i], scene.expected[i]);
+    CHECK(same);
+    CHECK(draws[count].indexCount == 0xdeadbeef);
+}
+
+void testAgainstBruteForce()
+{
+    const Frustum frustum = makeFrustum();
+    for (size_t count : {size_t(0), size_t(1), size_t(7), size_t(1000), size_t(20011)})
+    {
+        const Scene scene = makeScene(frustum, count, uint32_t(count) + 1);
+        if (count >= 1000)
+            CHECK(scene.expected.size() > count / 20 && scene.expected.size() < count / 2);
+        checkScene(frustum, scene);
+    }
+}
+
+void testEveryObjectVisible()
+{
+    // A frustum enclosing the whole field keeps every object with instances.
+    const float4x4 viewProjection = float4x4::perspective(2.5f, 1.0f, 0.01f, 1000.0f) *
+                                    float4x4::lookAt({0.0f, 0.0f, 200.0f}, {0.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f});
+    const Frustum frustum = Frustum::fromViewProjection(viewProjection.data());
+    const Scene scene = makeScene(frustum, 5000, 11);
+    size_t withInstances = 0;
+    for (const CullObject &object : scene.objects)
+        withInstances += object.instanceCount > 0;
+    CHECK(scene.expected.size() == withInstances);
+    checkScene(frustum, scene);
+}
+
+void testNothingVisible()
+{
+    // Looking away from the field culls everything.
+    const float4x4 viewProjection = float4x4::perspective(1.1f, 1.0f, 0.5f, 60.0f) *
+                                    float4x4::lookAt({0.0f, 0.0f, 80.0f}, {0.0f, 0.0f, 200.0f}, {0.0f, 1.0f, 0.0f});
+    const Frustum frustum = Frustum::fromViewProjection(viewProjection.data());
+    const Scene scene = makeScene(frustum, 5000, 12);
+    CHECK(scene.expected.empty());
+    checkScene(frustum, scene);
+}
+} // namespace
+
+int main()
+{
+    return Test::run({{"matches brute force", testAgainstBruteForce},
+                      {"every object visible", testEveryObjectVisible},
+                      {"nothing visible", testNothingVisible}});
+}
@@ -0,0 +1,257 @@
+// LightClusters against brute force over every light and cluster. From below: points sampled inside each light's
+// sphere are looked up in the written buffer the way fragmentMain does, and the light must be in that cluster's list.
+// From above: every cluster a light is listed in has view-space bounds, recomputed in double precision, that the
+// sphere touches. The written ranges must tile the index list with each cluster's lights in input order, and the
+// buffer must not depend on the thread count.
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "ClusteredLighting.h"
+#include "JobSystem.h"
+#include "SimdMath.h"
+#include "Test.h"
+
+using namespace SimdMath;
+
+namespace
+{
+constexpr float Width = 320.0f, Height = 180.0f, FovY = 1.0f, Near = 0.1f, Far = 100.0f;
+
+struct Written {
+    ClusterGrid grid;
+    std::vector<ClusterRange> ranges;
+    std::vector<uint16_t> indices;
+    std::vector<uint8_t> bytes;
+};
+
+Written writeClusters(const LightClusters &clusters, JobSystem *pJobs)
+{
+    const LightClusters::Layout layout = clusters.layout();
+    Written written;
+    written.bytes.assign(layout.size, 0xcd);
+    clusters.write(written.bytes.data(), pJobs);
+    memcpy(&written.grid, written.bytes.data() + layout.gridOffset, sizeof(ClusterGrid));
+    written.ranges.resize(clusters.clusterCount());
+    memcpy(written.ranges.data(), written.bytes.data() + layout.rangesOffset,
+           written.ranges.size() * sizeof(ClusterRange));
+    written.indices.resize(clusters.indexCount());
+    memcpy(written.indices.data(), written.bytes.data() + layout.indicesOffset,
+           written.indices.size() * sizeof(uint16_t));
+    return written;
+}
+
+// Lights around and ahead of the camera: some containing it, some crossing the near or far plane, some off screen
+// or behind, a few huge.
+std::vector<LightComponent> makeLights(size_t count, const float3 &eye, uint32_t seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> across(-60.0f, 60.0f), along(-10.0f, 115.0f), radius(0.05f, 6.0f);
+    std::vector<LightComponent> lights(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        LightComponent &light = lights[i];
+        // The camera looks down -z from eye.
+        const float3 p = {eye.x + across(random), eye.y + across(random) * 0.5f, eye.z - along(random)};
+        light = {{p.x, p.y, p.z}, radius(random), {1.0f, 1.0f, 1.0f}, 1.0f};
+        if (i % 97 == 0)
+            light.radius = 25.0f;
+        if (i % 101 == 0)
+            light = {{eye.x + 0.1f, eye.y, eye.z - 0.05f}, 1.0f, {1.0f, 1.0f, 1.0f}, 1.0f};
+    }
+    return lights;
+}
+
+struct Camera {
+    float4x4 view;
+    double tanHalfX, tanHalfY;
+
+    // View space with depth along -z.
+    void toView(const float p[3], double out[3]) const
+    {
+        const float *m = view.data();
+        for (int row = 0; row < 3; ++row)
+            out[row] = double(m[row]) * p[0] + double(m[4 + row]) * p[1] + double(m[8 + row]) * p[2] + m[12 + row];
+        out[2] = -out[2];
+    }
+};
+
+// A light is only listed in clusters whose view-space box its sphere touches, and each cluster lists its lights in
+// input order.
+void checkUpperBound(const Written &written, const std::vector<LightComponent> &lights, const Camera &camera)
+{
+    const ClusterGrid &grid = written.grid;
+    bool touches = true, ordered = true, tiled = true;
+    uint32_t expectedOffset = 0;
+    for (uint32_t z = 0; z < grid.countZ; ++z)
+    {
+        const double depth0 = Near * std::pow(double(Far) / Near, double(z) / grid.countZ);
+        const double depth1 = Near * std::pow(double(Far) / Near, double(z + 1) / grid.countZ);
+        for (uint32_t y = 0; y < grid.countY; ++y)
+        {
+            const double top = (1.0 - 2.0 * y / grid.countY) * camera.tanHalfY;
+            const double bottom = (1.0 - 2.0 * (y + 1) / grid.countY) * camera.tanHalfY;
+            for (uint32_t x = 0; x < grid.countX; ++x)
+            {
+                const double left = (-1.0 + 2.0 * x / grid.countX) * camera.tanHalfX;
+                const double right = (-1.0 + 2.0 * (x + 1) / grid.countX) * camera.tanHalfX;
+                const double lo[3] = {std::min(left * depth0, left * depth1),
+                                      std::min(bottom * depth0, bottom * depth1), depth0};
+                const double hi[3] = {std::max(right * depth0, right * depth1),
+                                      std::max(top * depth0, top * depth1), depth1};
+
+                const ClusterRange &range = written.ranges[(z * grid.countY + y) * grid.countX + x];
+                tiled = tiled && range.offset == expectedOffset;
+                expectedOffset += range.count;
+                for (uint32_t i = range.offset; i < range.offset + range.count; ++i)
+                {
+                    const LightComponent &light = lights[written.indices[i]];
+                    ordered = ordered && (i == range.offset || written.indices[i - 1] < written.indices[i]);
+                    double center[3], distanceSquared = 0.0;
+                    camera.toView(light.position, center);
+                    for (int axis = 0; axis < 3; ++axis)
+                    {
+                        const double d = std::max({lo[axis] - center[axis], center[axis] - hi[axis], 0.0});
+                        distanceSquared += d * d;
+                    }
+                    touches = touches && distanceSquared <= double(light.radius) * light.radius * 1.0001 + 1e-6;
+                }
+            }
+        }
+    }
+    CHECK(touches);
+    CHECK(ordered);
+    CHECK(tiled && expectedOffset == written.indices.size());
+}
+
+// Points inside each sphere find the light in the cluster fragmentMain would read. Points within a hair of a cluster
+// boundary are skipped, as rounding may put them on either side.
+size_t checkLowerBound(const Written &written, const std::vector<LightComponent> &lights, const Camera &camera,
+                       uint32_t seed)
+{
+    const ClusterGrid &grid = written.grid;
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<double> unit(-1.0, 1.0);
+    auto awayFromEdge = [](double cell) { return std::fabs(cell - std::round(cell)) > 1e-3; };
+    size_t samples = 0;
+    bool found = true;
+    for (size_t light = 0; light < lights.size(); ++light)
+    {
+        double center[3];
+        camera.toView(lights[light].position, center);
+        for (int sample = 0; sample < 48; ++sample)
+        {
+            double offset[3];
+            do
+            {
+                offset[0] = unit(random), offset[1] = unit(random), offset[2] = unit(random);
+            } while (offset[0] * offset[0] + offset[1] * offset[1] + offset[2] * offset[2] > 1.0);
+            const double r = lights[light].radius;
+            const double x = center[0] + offset[0] * r, y = center[1] + offset[1] * r;
+            const double depth = center[2] + offset[2] * r;
+            if (depth <= Near || depth >= Far)
+                continue;
+            const double ndcX = x / (depth * camera.tanHalfX), ndcY = y / (depth * camera.tanHalfY);
+            if (std::fabs(ndcX) >= 1.0 || std::fabs(ndcY) >= 1.0)
+                continue;
+
+            const double pixelX = (ndcX + 1.0) * 0.5 * Width, pixelY = (1.0 - ndcY) * 0.5 * Height;
+            const double cellX = pixelX * grid.pixelToClusterX, cellY = pixelY * grid.pixelToClusterY;
+            const double cellZ = std::log2(depth) * grid.depthScale + grid.depthBias;
+            if (!awayFromEdge(cellX) || !awayFromEdge(cellY) || !awayFromEdge(cellZ))
+                continue;
+            const uint32_t clusterX = std::min(uint32_t(cellX), grid.countX - 1);
+            const uint32_t clusterY = std::min(uint32_t(cellY), grid.countY - 1);
+            const uint32_t clusterZ = uint32_t(std::clamp(cellZ, 0.0, double(grid.countZ - 1)));
+            const ClusterRange &range = written.ranges[(clusterZ * grid.countY + clusterY) * grid.countX + clusterX];
+            const uint16_t *pBegin = written.indices.data() + range.offset;
+            found = found && std::find(pBegin, pBegin + range.count, uint16_t(light)) != pBegin + range.count;
+            ++samples;
+        }
+    }
+    CHECK(found);
+    return samples;
+}
+
+void checkView(const float3 &eye, const float3 &target, uint32_t seed)
+{
+    Camera camera = {float4x4::lookAt(eye, target, {0.0f, 1.0f, 0.0f}), 0.0, 0.0};
+    camera.tanHalfY = std::tan(0.5 * FovY);
+    camera.tanHalfX = camera.tanHalfY * Width / Height;
+
+    // Lights are placed relative to a camera looking down -z; move them into the looked-at direction.
+    const float4x4 worldFromView = float4x4::lookAt({0.0f, 0.0f, 0.0f}, target - eye, {0.0f, 1.0f, 0.0f});
+    std::vector<LightComponent> lights = makeLights(3000, {0.0f, 0.0f, 0.0f}, seed);
+    for (LightComponent &light : lights)
+    {
+        // lookAt is orthonormal, so its transpose maps view directions back to the world.
+        const float *m = worldFromView.data();
+        const float p[3] = {light.position[0], light.position[1], light.position[2]};
+        const float origin[3] = {eye.x, eye.y, eye.z};
+        for (int row = 0; row < 3; ++row)
+            light.position[row] = m[4 * row] * p[0] + m[4 * row + 1] * p[1] + m[4 * row + 2] * p[2] + origin[row];
+    }
+
+    LightClusters clusters(LightClusters::Settings{});
+    clusters.setProjection(FovY, Width, Height, Near, Far);
+    CHECK(clusters.build(camera.view.data(), lights.data(), lights.size()) == lights.size());
+    const Written serial = writeClusters(clusters, nullptr);
+    CHECK(serial.grid.lightCount == lights.size());
+    CHECK(memcmp(serial.bytes.data() + clusters.layout().lightsOffset, lights.data(),
+                 lights.size() * sizeof(LightComponent)) == 0);
+    checkUpperBound(serial, lights, camera);
+    CHECK(checkLowerBound(serial, lights, camera, seed) > 20000);
+
+    // Three chunks of lights binned and written on the JobSystem give the same bytes.
+    JobSystem jobs(4);
+    CHECK(clusters.build(camera.view.data(), lights.data(), lights.size(), &jobs) == lights.size());
+    const Written parallel = writeClusters(clusters, &jobs);
+    CHECK(parallel.bytes == serial.bytes);
+}
+
+void testForwardView()
+{
+    checkView({0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, -1.0f}, 1);
+}
+
+void testRotatedView()
+{
+    checkView({12.0f, 3.0f, -7.0f}, {-20.0f, -1.0f, 15.0f}, 2);
+}
+
+void testNoLights()
+{
+    LightClusters clusters(LightClusters::Settings{4, 3, 5});
+    clusters.setProjection(FovY, Width, Height, Near, Far);
+    CHECK(clusters.build(float4x4::identity().data(), nullptr, 0) == 0);
+    const Written written = writeClusters(clusters, nullptr);
+    bool empty = written.ranges.size() == 60;
+    for (const ClusterRange &range : written.ranges)
+        empty = empty && range.offset == 0 && range.count == 0;
+    CHECK(empty && clusters.indexCount() == 0);
+}
+
+void testTooManyLights()
+{
+    // Only the first MaxLights lights can be named by the 16-bit indices.
+    std::vector<LightComponent> lights(LightClusters::MaxLights + 100,
+                                       LightComponent{{0.0f, 0.0f, -5.0f}, 0.5f, {1.0f, 1.0f, 1.0f}, 1.0f});
+    LightClusters clusters(LightClusters::Settings{});
+    clusters.setProjection(FovY, Width, Height, Near, Far);
+    CHECK(clusters.build(float4x4::identity().data(), lights.data(), lights.size()) == LightClusters::MaxLights);
+    const Written written = writeClusters(clusters, nullptr);
+    CHECK(written.grid.lightCount == LightClusters::MaxLights);
+    CHECK(clusters.indexCount() % LightClusters::MaxLights == 0 && clusters.indexCount() > 0);
+}
+} // namespace
+
+int main()
+{
+    return Test::run({{"forward view matches brute force", testForwardView},
+                      {"rotated view matches brute force", testRotatedView},
+                      {"no lights", testNoLights},
+                      {"too many lights", testTooManyLights}});
+}
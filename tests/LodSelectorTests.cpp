@@ -0,0 +1,286 @@
+// LodSelector against a scalar reference of the projected error: every selected LOD lies between the coarsest LOD
+// within threshold * (1 - hysteresis) and the coarsest within the threshold, and an object whose previous LOD is in
+// that dead band keeps it, so a camera jittering by less than the band never flips a LOD back. With a triangle budget
+// the selection never exceeds it, whatever the previous LODs, and the raised threshold is no coarser than one
+// histogram bin requires.
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "JobSystem.h"
+#include "LodSelector.h"
+#include "Test.h"
+
+namespace
+{
+struct Scene {
+    std::vector<LodSelector::Lod> lods[16];
+    std::vector<float> x, y, z, radius;
+    std::vector<uint32_t> meshes;
+
+    FrustumCulling::SphereSoA bounds() const { return {x.data(), y.data(), z.data(), radius.data()}; }
+    size_t size() const { return meshes.size(); }
+};
+
+// Meshes of one to eight LODs with errors roughly doubling and triangles roughly halving per LOD, some repeated, and
+// objects scattered around the origin, a few of them around the camera.
+Scene makeScene(size_t count, uint32_t seed)
+{
+    Scene scene;
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (std::vector<LodSelector::Lod> &lods : scene.lods)
+    {
+        const uint32_t lodCount = 1 + random() % LodSelector::MaxLods;
+        float error = 0.001f + unit(random) * 0.01f;
+        uint32_t triangles = 20000 + random() % 20000;
+        for (uint32_t lod = 0; lod < lodCount; ++lod)
+        {
+            lods.push_back({error, triangles});
+            if (random() % 5)
+            {
+                error *= 1.5f + unit(random) * 1.5f;
+                triangles = std::max(triangles / uint32_t(2 + random() % 2), 12u);
+            }
+        }
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float distance = i % 100 == 0 ? unit(random) * 2.0f : 1.0f + unit(random) * 400.0f;
+        const float theta = unit(random) * 6.2831853f, z = unit(random) * 2.0f - 1.0f;
+        const float ring = std::sqrt(1.0f - z * z);
+        scene.x.push_back(distance * ring * std::cos(theta));
+        scene.y.push_back(distance * ring * std::sin(theta));
+        scene.z.push_back(distance * z);
+        scene.radius.push_back(0.2f + unit(random) * 3.0f);
+        scene.meshes.push_back(uint32_t(random() % 16));
+    }
+    return scene;
+}
+
+void addMeshes(LodSelector &selector, const Scene &scene)
+{
+    for (const std::vector<LodSelector::Lod> &lods : scene.lods)
+        selector.addMesh(lods.data(), uint32_t(lods.size()));
+}
+
+// Pixels per world unit of error, computed the way select does, lane for lane.
+float scaleOf(const Scene &scene, size_t i, const LodSelector::View &view, float nearDistance)
+{
+    const float dx = scene.x[i] - view.position[0], dy = scene.y[i] - view.position[1];
+    const float dz = scene.z[i] - view.position[2];
+    const float distance = std::sqrt(dx * dx + dy * dy + dz * dz) - scene.radius[i];
+    return view.projectionScale / std::max(distance, nearDistance);
+}
+
+// Coarsest LOD whose projected error is within threshold. ambiguous is set when a LOD's error lies so close to the
+// threshold that rounding could decide either way.
+uint32_t referenceLod(const std::vector<LodSelector::Lod> &lods, float scale, float threshold, bool &ambiguous)
+{
+    uint32_t lod = uint32_t(lods.size() - 1);
+    for (const LodSelector::Lod &l : lods)
+        ambiguous = ambiguous || std::fabs(l.error * scale - threshold) <= threshold * 1e-5f;
+    while (lod > 0 && lods[lod].error * scale > threshold)
+        --lod;
+    return lod;
+}
+
+uint64_t referenceTriangles(const Scene &scene, const LodSelector::View &view, float nearDistance, float threshold)
+{
+    uint64_t triangles = 0;
+    for (size_t i = 0; i < scene.size(); ++i)
+    {
+        bool ambiguous = false;
+        const std::vector<LodSelector::Lod> &lods = scene.lods[scene.meshes[i]];
+        triangles += lods[referenceLod(lods, scaleOf(scene, i, view, nearDistance), threshold, ambiguous)]
+                         .triangleCount;
+    }
+    return triangles;
+}
+
+uint64_t selectedTriangles(const Scene &scene, const std::vector<uint8_t> &selected)
+{
+    uint64_t triangles = 0;
+    for (size_t i = 0; i < scene.size(); ++i)
+        triangles += scene.lods[scene.meshes[i]][selected[i]].triangleCount;
+    return triangles;
+}
+
+// Every LOD is in the dead band, [coarsest within the tighter threshold, coarsest within the threshold], and an
+// object whose previous LOD was already in it keeps it. Returns the number of objects that changed LOD.
+size_t checkDeadBand(const Scene &scene, const LodSelector &selector, const LodSelector::View &view,
+                     const std::vector<uint8_t> &previous, const std::vector<uint8_t> &selected)
+{
+    const float keep = 1.0f - selector.settings().hysteresis;
+    bool inBand = true, kept = true;
+    size_t changed = 0;
+    for (size_t i = 0; i < scene.size(); ++i)
+    {
+        const std::vector<LodSelector::Lod> &lods = scene.lods[scene.meshes[i]];
+        const float scale = scaleOf(scene, i, view, selector.settings().nearDistance);
+        bool ambiguous = false;
+        const uint32_t fine = referenceLod(lods, scale, selector.threshold(), ambiguous);
+        const uint32_t strict = std::min(referenceLod(lods, scale, selector.threshold() * keep, ambiguous), fine);
+        changed += previous[i] != selected[i];
+        if (ambiguous)
+            continue;
+        inBand = inBand && selected[i] >= strict && selected[i] <= fine;
+        const uint32_t old = std::min(uint32_t(previous[i]), uint32_t(lods.size() - 1));
+        kept = kept && (old < strict || old > fine || selected[i] == old);
+    }
+    CHECK(inBand);
+    CHECK(kept);
+    return changed;
+}
+
+// Jitters the projection by +-8% every frame, a range of 1.17x, inside the 1 / 0.75 = 1.33x dead band. Counts the
+// objects whose LOD went back to a value it had left, after the first frame settled them.
+size_t countFlips(float hysteresis, JobSystem *pJobs)
+{
+    const Scene scene = makeScene(20000, 7);
+    LodSelector::Settings settings;
+    settings.errorThreshold = 1.0f;
+    settings.hysteresis = hysteresis;
+    LodSelector selector(settings);
+    addMeshes(selector, scene);
+
+    std::vector<uint8_t> lods(scene.size(), 0), previous;
+    LodSelector::View view = {{0.0f, 0.0f, 0.0f}, LodSelector::projectionScale(1080.0f, 1.0f)};
+    const float baseScale = view.projectionScale;
+    selector.select(view, scene.bounds(), scene.meshes.data(), scene.size(), lods.data(), pJobs);
+
+    std::mt19937 random(8);
+    std::uniform_real_distribution<float> jitter(0.92f, 1.08f);
+    std::vector<int> direction(scene.size(), 0);
+    size_t flips = 0;
+    for (int frame = 0; frame < 40; ++frame)
+    {
+        previous = lods;
+        view.projectionScale = baseScale * jitter(random);
+        const uint64_t triangles =
+            selector.select(view, scene.bounds(), scene.meshes.data(), scene.size(), lods.data(), pJobs);
+        CHECK(triangles == selectedTriangles(scene, lods));
+        CHECK(selector.threshold() == settings.errorThreshold);
+        checkDeadBand(scene, selector, view, previous, lods);
+        for (size_t i = 0; i < scene.size(); ++i)
+        {
+            const int step = lods[i] > previous[i] ? 1 : lods[i] < previous[i] ? -1 : 0;
+            flips += step != 0 && direction[i] == -step;
+            direction[i] = step != 0 ? step : direction[i];
+        }
+    }
+    return flips;
+}
+
+void testNoFlipsInsideDeadBand()
+{
+    CHECK(countFlips(0.25f, nullptr) == 0);
+    JobSystem jobs(4);
+    CHECK(countFlips(0.25f, &jobs) == 0);
+    // Without the band the same jitter does flip, so the scene exercises it.
+    CHECK(countFlips(0.0f, nullptr) > 100);
+}
+
+void testRandomPreviousLods()
+{
+    // Whatever the previous LODs, including values past the last LOD, each object lands in its dead band.
+    const Scene scene = makeScene(30000, 9);
+    LodSelector selector(LodSelector::Settings{});
+    addMeshes(selector, scene);
+    std::mt19937 random(10);
+    std::vector<uint8_t> previous(scene.size()), lods;
+    for (uint8_t &lod : previous)
+        lod = uint8_t(random());
+    lods = previous;
+    const LodSelector::View view = {{3.0f, -2.0f, 1.0f}, LodSelector::projectionScale(720.0f, 1.2f)};
+    selector.select(view, scene.bounds(), scene.meshes.data(), scene.size(), lods.data());
+    CHECK(checkDeadBand(scene, selector, view, previous, lods) > 0);
+}
+
+void checkBudget(float hysteresis, uint64_t budgetPercent, JobSystem *pJobs)
+{
+    // 100k objects: several 16K chunks, so the per-chunk histograms are merged.
+    const Scene scene = makeScene(100000, 11 + uint32_t(budgetPercent));
+    LodSelector::Settings settings;
+    settings.errorThreshold = 0.5f;
+    settings.hysteresis = hysteresis;
+    LodSelector selector(settings);
+    addMeshes(selector, scene);
+    LodSelector::View view = {{0.0f, 0.0f, 0.0f}, LodSelector::projectionScale(1080.0f, 1.0f)};
+
+    // The budget is a share of the way from all-coarsest to the unbudgeted selection.
+    const float keep = 1.0f - hysteresis;
+    const uint64_t coarsest = referenceTriangles(scene, view, settings.nearDistance, INFINITY);
+    const uint64_t unbudgeted = referenceTriangles(scene, view, settings.nearDistance, settings.errorThreshold * keep);
+    selector.settings().triangleBudget = coarsest + (unbudgeted - coarsest) * budgetPercent / 100;
+    const uint64_t budget = selector.settings().triangleBudget;
+
+    std::mt19937 random(12);
+    std::uniform_real_distribution<float> move(-5.0f, 5.0f);
+    std::vector<uint8_t> lods(scene.size()), previous;
+    for (uint8_t &lod : lods)
+        lod = uint8_t(random() % LodSelector::MaxLods);
+    bool withinBudget = true, tight = true;
+    for (int frame = 0; frame < 6; ++frame)
+    {
+        previous = lods;
+        const uint64_t triangles =
+            selector.select(view, scene.bounds(), scene.meshes.data(), scene.size(), lods.data(), pJobs);
+        CHECK(triangles == selectedTriangles(scene, lods));
+        withinBudget = withinBudget && triangles <= budget;
+        checkDeadBand(scene, selector, view, previous, lods);
+
+        // The threshold is at most one histogram bin above the smallest that fits: a bin spans at most a ratio of
+        // 9 / 8, so a threshold below 8 / 9 of it refines the whole bin and exceeds the budget. Transitions past the
+        // last bin leave no finite threshold to check.
+        if (selector.threshold() < 1e30f)
+        {
+            const float lower = selector.threshold() * keep * (8.0f / 9.0f) * 0.999f;
+            tight = tight && referenceTriangles(scene, view, settings.nearDistance, lower) > budget;
+        }
+        for (float &position : view.position)
+            position += move(random);
+    }
+    CHECK(withinBudget);
+    CHECK(tight);
+    CHECK(selector.threshold() > settings.errorThreshold);
+}
+
+void testBudget()
+{
+    JobSystem jobs(4);
+    for (uint64_t percent : {0, 10, 50, 90})
+    {
+        checkBudget(0.0f, percent, nullptr);
+        checkBudget(0.25f, percent, &jobs);
+    }
+}
+
+void testBudgetBelowCoarsest()
+{
+    // A budget even the coarsest LODs exceed selects the coarsest LOD of every object.
+    const Scene scene = makeScene(20000, 13);
+    LodSelector::Settings settings;
+    settings.triangleBudget = 1000;
+    LodSelector selector(settings);
+    addMeshes(selector, scene);
+    std::vector<uint8_t> lods(scene.size(), 0);
+    const LodSelector::View view = {{0.0f, 0.0f, 0.0f}, LodSelector::projectionScale(1080.0f, 1.0f)};
+    const uint64_t triangles = selector.select(view, scene.bounds(), scene.meshes.data(), scene.size(), lods.data());
+    bool coarsest = true;
+    for (size_t i = 0; i < scene.size(); ++i)
+        coarsest = coarsest && lods[i] == scene.lods[scene.meshes[i]].size() - 1;
+    CHECK(coarsest);
+    CHECK(triangles == referenceTriangles(scene, view, settings.nearDistance, INFINITY));
+}
+} // namespace
+
+int main()
+{
+    return Test::run({{"no flips inside the dead band", testNoFlipsInsideDeadBand},
+                      {"random previous LODs land in the dead band", testRandomPreviousLods},
+                      {"triangle budget is never exceeded", testBudget},
+                      {"budget below the coarsest LODs", testBudgetBelowCoarsest}});
+}
@@ -0,0 +1,240 @@
+// OcclusionCuller must be conservative: a box that a ray-cast depth test sees past every occluder is never reported
+// occluded. The reference shoots a ray through the center of every pixel the box may cover, the culler's own sample
+// positions, and compares the ray's entry into the box with its hits on the occluder triangles. The culler must also
+// still reject most of the boxes the reference finds hidden, so the test cannot pass by accepting everything.
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "OcclusionCulling.h"
+#include "SimdMath.h"
+#include "Test.h"
+
+using namespace SimdMath;
+
+namespace
+{
+constexpr uint32_t Width = 160, Height = 90;
+constexpr float FovY = 1.0f, Aspect = float(Width) / float(Height), Near = 0.5f, Far = 200.0f;
+
+struct Triangle {
+    float3 v0, v1, v2;
+};
+
+// Distance along the ray to the triangle, or infinity on a miss (Moller-Trumbore, both windings).
+float rayTriangle(const float3 &direction, const Triangle &t)
+{
+    const float3 e1 = t.v1 - t.v0, e2 = t.v2 - t.v0;
+    const float3 p = cross(direction, e2);
+    const float determinant = dot(e1, p);
+    if (std::fabs(determinant) < 1e-12f)
+        return INFINITY;
+    const float inverse = 1.0f / determinant;
+    const float3 s = float3{0.0f, 0.0f, 0.0f} - t.v0;
+    const float u = dot(s, p) * inverse;
+    const float3 q = cross(s, e1);
+    const float v = dot(direction, q) * inverse;
+    if (u < 0.0f || v < 0.0f || u + v > 1.0f)
+        return INFINITY;
+    const float distance = dot(e2, q) * inverse;
+    return distance > 0.0f ? distance : INFINITY;
+}
+
+// Entry distance of a ray from the origin into the box, or infinity on a miss.
+float rayBox(const float3 &direction, const AABB &b)
+{
+    const float lo[3] = {b.minX, b.minY, b.minZ}, hi[3] = {b.maxX, b.maxY, b.maxZ};
+    const float d[3] = {direction.x, direction.y, direction.z};
+    float enter = 0.0f, exit = INFINITY;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const float t0 = lo[axis] / d[axis], t1 = hi[axis] / d[axis];
+        enter = std::max(enter, std::min(t0, t1));
+        exit = std::min(exit, std::max(t0, t1));
+    }
+    return enter <= exit ? enter : INFINITY;
+}
+
+// The camera sits at the origin looking down -z, so view space is world space.
+float3 rayThroughPixel(float px, float py)
+{
+    const float tanHalf = std::tan(0.5f * FovY);
+    const float ndcX = px / float(Width) * 2.0f - 1.0f, ndcY = 1.0f - py / float(Height) * 2.0f;
+    return {ndcX * tanHalf * Aspect, ndcY * tanHalf, -1.0f};
+}
+
+bool referenceVisible(const AABB &b, const std::vector<Triangle> &occluders, const float4x4 &clipFromWorld)
+{
+    // The box's pixel rectangle, from its corners; boxes here never cross the near plane.
+    float minX = INFINITY, maxX = -INFINITY, minY = INFINITY, maxY = -INFINITY;
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        const float4 c = clipFromWorld * float4{corner & 1 ? b.maxX : b.minX, corner & 2 ? b.maxY : b.minY,
+                                                corner & 4 ? b.maxZ : b.minZ, 1.0f};
+        const float x = (c.x / c.w * 0.5f + 0.5f) * float(Width), y = (0.5f - c.y / c.w * 0.5f) * float(Height);
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+    }
+    const int x0 = std::max(int(std::floor(minX)), 0), x1 = std::min(int(std::floor(maxX)), int(Width) - 1);
+    const int y0 = std::max(int(std::floor(minY)), 0), y1 = std::min(int(std::floor(maxY)), int(Height) - 1);
+    for (int py = y0; py <= y1; ++py)
+    {
+        for (int px = x0; px <= x1; ++px)
+        {
+            const float3 direction = rayThroughPixel(float(px) + 0.5f, float(py) + 0.5f);
+            const float boxDistance = rayBox(direction, b);
+            if (boxDistance == INFINITY || boxDistance * -direction.z > Far)
+                continue;
+            // A small margin keeps boxes touching an occluder's surface out of the comparison.
+            bool occluded = false;
+            for (size_t t = 0; t < occluders.size() && !occluded; ++t)
+                occluded = rayTriangle(direction, occluders[t]) * 0.999f <= boxDistance;
+            if (!occluded)
+                return true;
+        }
+    }
+    return false;
+}
+
+// Random quads, as two triangles each, facing the camera at various tilts.
+std::vector<Triangle> makeOccluders(std::mt19937 &random, int quadCount)
+{
+    std::uniform_real_distribution<float> across(-25.0f, 25.0f), depth(-60.0f, -8.0f), size(3.0f, 12.0f),
+        tilt(-0.6f, 0.6f);
+    std::vector<Triangle> triangles;
+    for (int i = 0; i < quadCount; ++i)
+    {
+        const float3 center = {across(random), across(random) * 0.5f, depth(random)};
+        const float3 u = normalize(float3{1.0f, 0.0f, tilt(random)}) * size(random);
+        const float3 v = normalize(float3{tilt(random), 1.0f, tilt(random)}) * size(random);
+        const float3 a = center - u - v, b = center + u - v, c = center + u + v, d = center - u + v;
+        triangles.push_back({a, b, c});
+        triangles.push_back({a, c, d});
+    }
+    return triangles;
+}
+
+void testConservative(uint32_t seed, int quadCount)
+{
+    std::mt19937 random(seed);
+    const std::vector<Triangle> occluders = makeOccluders(random, quadCount);
+    const float4x4 clipFromWorld = float4x4::perspective(FovY, Aspect, Near, Far);
+
+    OcclusionCuller culler(Width, Height);
+    std::vector<float> positions;
+    std::vector<uint32_t> indices;
+    for (const Triangle &t : occluders)
+    {
+        for (const float3 &v : {t.v0, t.v1, t.v2})
+        {
+            indices.push_back(uint32_t(positions.size() / 3));
+            positions.insert(positions.end(), {v.x, v.y, v.z});
+        }
+    }
+    culler.renderOccluder(positions.data(), 3 * sizeof(float), indices.data(), indices.size(), clipFromWorld.data());
+
+    std::uniform_real_distribution<float> across(-30.0f, 30.0f), depth(-90.0f, -4.0f), size(0.1f, 2.5f);
+    size_t hidden = 0, rejected = 0, wronglyRejected = 0;
+    for (int i = 0; i < 3000; ++i)
+    {
+        const float3 c = {across(random), across(random) * 0.5f, depth(random)};
+        const float3 e = {size(random), size(random), size(random)};
+        const AABB box = {c.x - e.x, c.y - e.y, c.z - e.z, c.x + e.x, c.y + e.y, c.z + e.z};
+        if (box.maxZ > -Near)
+            continue;
+
+        const bool visible = referenceVisible(box, occluders, clipFromWorld);
+        const bool culled = !culler.isVisible(box, clipFromWorld.data());
+        hidden += !visible;
+        rejected += culled;
+        wronglyRejected += visible && culled;
+    }
+    CHECK(wronglyRejected == 0);
+    // Off-screen boxes count as hidden for the reference too, so most hidden boxes should be rejected.
+    CHECK(hidden > 300);
+    CHECK(rejected * 2 > hidden);
+}
+
+void testSparseOccluders()
+{
+    testConservative(1, 12);
+}
+
+void testDenseOccluders()
+{
+    testConservative(2, 60);
+}
+
+void testCullAABBsMatchesIsVisible()
+{
+    std::mt19937 random(3);
+    const std::vector<Triangle> occluders = makeOccluders(random, 30);
+    const float4x4 clipFromWorld = float4x4::perspective(FovY, Aspect, Near, Far);
+    OcclusionCuller culler(Width, Height);
+    for (const Triangle &t : occluders)
+    {
+        const uint32_t indices[3] = {0, 1, 2};
+        culler.renderOccluder(&t.v0.x, sizeof(float3), indices, 3, clipFromWorld.data());
+    }
+
+    std::uniform_real_distribution<float> across(-30.0f, 30.0f), depth(-90.0f, -4.0f), size(0.1f, 2.5f);
+    std::vector<float> minX, minY, minZ, maxX, maxY, maxZ;
+    std::vector<uint32_t> candidates, expected;
+    for (uint32_t i = 0; i < 2000; ++i)
+    {
+        const float3 c = {across(random), across(random) * 0.5f, depth(random)};
+        const float e = size(random);
+        minX.push_back(c.x - e);
+        minY.push_back(c.y - e);
+        minZ.push_back(c.z - e);
+        maxX.push_back(c.x + e);
+        maxY.push_back(c.y + e);
+        maxZ.push_back(c.z + e);
+        if (i % 3 == 0)
+            continue;
+        candidates.push_back(i);
+        if (culler.isVisible({c.x - e, c.y - e, c.z - e, c.x + e, c.y + e, c.z + e}, clipFromWorld.data()))
+            expected.push_back(i);
+    }
+    const FrustumCulling::AABBSoA boxes = {minX.data(), minY.data(), minZ.data(),
+                                           maxX.data(), maxY.data(), maxZ.data()};
+    // In place, as the header allows.
+    const size_t count =
+        culler.cullAABBs(boxes, candidates.data(), candidates.size(), clipFromWorld.data(), candidates.data());
+    candidates.resize(count);
+    CHECK(candidates == expected);
+    CHECK(expected.size() > 100 && expected.size() < 1300);
+}
+
+void testClearForgetsOccluders()
+{
+    std::mt19937 random(4);
+    const std::vector<Triangle> occluders = makeOccluders(random, 60);
+    const float4x4 clipFromWorld = float4x4::perspective(FovY, Aspect, Near, Far);
+    OcclusionCuller culler(Width, Height);
+    const uint32_t indices[3] = {0, 1, 2};
+    for (const Triangle &t : occluders)
+        culler.renderOccluder(&t.v0.x, sizeof(float3), indices, 3, clipFromWorld.data());
+    culler.clear();
+
+    std::uniform_real_distribution<float> across(-3.0f, 3.0f), depth(-90.0f, -10.0f);
+    for (int i = 0; i < 500; ++i)
+    {
+        const float3 c = {across(random), across(random) * 0.5f, depth(random)};
+        CHECK(culler.isVisible({c.x - 0.5f, c.y - 0.5f, c.z - 0.5f, c.x + 0.5f, c.y + 0.5f, c.z + 0.5f},
+                               clipFromWorld.data()));
+    }
+}
+} // namespace
+
+int main()
+{
+    return Test::run({{"conservative with sparse occluders", testSparseOccluders},
+                      {"conservative with dense occluders", testDenseOccluders},
+                      {"cullAABBs matches isVisible", testCullAABBsMatchesIsVisible},
+                      {"clear forgets occluders", testClearForgetsOccluders}});
+}
@@ -0,0 +1,377 @@
+// RenderGraph compilation: culling, ordering and transient aliasing on a representative deferred frame, and render
+// pass merging with the attachment actions and memoryless storage it infers.
+
+#include <algorithm>
+#include <cstdio>
+
+#include "RenderGraph.h"
+#include "Test.h"
+
+namespace
+{
+using PassType = RenderGraph::PassType;
+using ResourceId = RenderGraph::ResourceId;
+
+constexpr uint64_t HeapAlignment = 64 << 10;
+
+RenderGraph::TextureDesc target(uint32_t width, uint32_t height, uint32_t bytesPerPixel)
+{
+    RenderGraph::TextureDesc desc;
+    desc.width = width;
+    desc.height = height;
+    desc.size = (uint64_t(width) * height * bytesPerPixel + HeapAlignment - 1) / HeapAlignment * HeapAlignment;
+    desc.alignment = HeapAlignment;
+    return desc;
+}
+
+// A G-buffer, SSAO with a blur, lighting, a five-level bloom chain and a tonemap into the drawable, plus a debug view
+// nothing reads. Between the render passes everything is read by sampling, so no transient is memoryless.
+void buildDeferredFrame(RenderGraph &graph, uint32_t width, uint32_t height)
+{
+    graph.reset();
+    const auto noop = []() {};
+
+    ResourceId albedo = graph.createTexture("albedo", target(width, height, 4));
+    ResourceId normal = graph.createTexture("normal", target(width, height, 8));
+    ResourceId depth = graph.createTexture("depth", target(width, height, 4));
+    ResourceId ao = graph.createTexture("ao", target(width / 2, height / 2, 1));
+    ResourceId aoBlurred = graph.createTexture("aoBlurred", target(width / 2, height / 2, 1));
+    ResourceId hdr = graph.createTexture("hdr", target(width, height, 8));
+    ResourceId debugView = graph.createTexture("debugView", target(width, height, 16));
+    ResourceId drawable = graph.importResource("drawable", target(width, height, 4));
+
+    const RenderGraph::PassId gbuffer = graph.addPass("gbuffer", PassType::Render, noop);
+    albedo = graph.writeAttachment(gbuffer, albedo, true);
+    normal = graph.writeAttachment(gbuffer, normal, true);
+    depth = graph.writeAttachment(gbuffer, depth, true);
+
+    const RenderGraph::PassId ssao = graph.addPass("ssao", PassType::Compute, noop);
+    graph.read(ssao, normal);
+    graph.read(ssao, depth);
+    ao = graph.write(ssao, ao);
+
+    const RenderGraph::PassId blur = graph.addPass("aoBlur", PassType::Compute, noop);
+    graph.read(blur, ao);
+    aoBlurred = graph.write(blur, aoBlurred);
+
+    const RenderGraph::PassId lighting = graph.addPass("lighting", PassType::Compute, noop);
+    for (ResourceId input : {albedo, normal, depth, aoBlurred})
+        graph.read(lighting, input);
+    hdr = graph.write(lighting, hdr);
+
+    ResourceId bloom[5];
+    ResourceId source = hdr;
+    for (uint32_t level = 0; level < 5; ++level)
+    {
+        static const char *const Names[] = {"bloom0", "bloom1", "bloom2", "bloom3", "bloom4"};
+        bloom[level] = graph.createTexture(Names[level], target(width >> (level + 1), height >> (level + 1), 8));
+        const RenderGraph::PassId down = graph.addPass(Names[level], PassType::Compute, noop);
+        graph.read(down, source);
+        bloom[level] = graph.write(down, bloom[level]);
+        source = bloom[level];
+    }
+
+    const RenderGraph::PassId debug = graph.addPass("debug", PassType::Compute, noop);
+    graph.read(debug, normal);
+    graph.write(debug, debugView);
+
+    const RenderGraph::PassId tonemap = graph.addPass("tonemap", PassType::Render, noop);
+    graph.read(tonemap, hdr);
+    for (ResourceId level : bloom)
+        graph.read(tonemap, level);
+    graph.writeAttachment(tonemap, drawable, true);
+
+    graph.compile();
+}
+
+constexpr uint32_t RGBA8 = 70;    // MTL::PixelFormatRGBA8Unorm
+constexpr uint32_t RGBA16F = 115; // MTL::PixelFormatRGBA16Float
+constexpr uint32_t Depth32F = 252; // MTL::PixelFormatDepth32Float
+
+RenderGraph::TextureDesc attachment(uint32_t width, uint32_t height, uint32_t pixelFormat, uint32_t bytesPerPixel)
+{
+    RenderGraph::TextureDesc desc = target(width, height, bytesPerPixel);
+    desc.pixelFormat = pixelFormat;
+    return desc;
+}
+
+// A shadow atlas, then a G-buffer, lighting that reads it in tile memory and transparents blended over the lighting,
+// then a tonemap sampling the result into the drawable. With ssao set, a compute pass samples the G-buffer between
+// it and the lighting, which then has to read it back from memory.
+struct TiledFrame {
+    ResourceId shadowAtlas, albedo, normal, depth, hdr;
+    RenderGraph::PassId shadows, gbuffer, lighting, transparent, tonemap;
+};
+
+TiledFrame buildTiledFrame(RenderGraph &graph, bool ssao)
+{
+    graph.reset();
+    const auto noop = []() {};
+    constexpr uint32_t Width = 1920, Height = 1080;
+
+    TiledFrame f;
+    f.shadowAtlas = graph.createTexture("shadowAtlas", attachment(4096, 4096, Depth32F, 4));
+    f.albedo = graph.createTexture("albedo", attachment(Width, Height, RGBA8, 4));
+    f.normal = graph.createTexture("normal", attachment(Width, Height, RGBA16F, 8));
+    f.depth = graph.createTexture("depth", attachment(Width, Height, Depth32F, 4));
+    f.hdr = graph.createTexture("hdr", attachment(Width, Height, RGBA16F, 8));
+    const ResourceId drawable = graph.importResource("drawable", attachment(Width, Height, RGBA8, 4));
+
+    f.shadows = graph.addPass("shadows", PassType::Render, noop);
+    f.shadowAtlas = graph.writeAttachment(f.shadows, f.shadowAtlas, true);
+
+    f.gbuffer = graph.addPass("gbuffer", PassType::Render, noop);
+    f.albedo = graph.writeAttachment(f.gbuffer, f.albedo, true);
+    f.normal = graph.writeAttachment(f.gbuffer, f.normal, true);
+    f.depth = graph.writeAttachment(f.gbuffer, f.depth, true);
+
+    ResourceId ao = RenderGraph::InvalidIndex;
+    if (ssao)
+    {
+        ao = graph.createTexture("ao", target(Width / 2, Height / 2, 1));
+        const RenderGraph::PassId pass = graph.addPass("ssao", PassType::Compute, noop);
+        graph.read(pass, f.normal);
+        graph.read(pass, f.depth);
+        ao = graph.write(pass, ao);
+    }
+
+    f.lighting = graph.addPass("lighting", PassType::Render, noop);
+    for (ResourceId input : {f.albedo, f.normal, f.depth})
+        graph.readAttachment(f.lighting, input);
+    graph.read(f.lighting, f.shadowAtlas);
+    if (ssao)
+        graph.read(f.lighting, ao);
+    f.hdr = graph.writeAttachment(f.lighting, f.hdr, true);
+
+    f.transparent = graph.addPass("transparent", PassType::Render, noop);
+    graph.readAttachment(f.transparent, f.depth);
+    graph.read(f.transparent, f.hdr);
+    f.hdr = graph.writeAttachment(f.transparent, f.hdr);
+
+    // Samples the G-buffer but nothing uses its output, so it is culled and must not force a store.
+    const RenderGraph::PassId debug = graph.addPass("debug", PassType::Compute, noop);
+    graph.read(debug, f.albedo);
+    graph.write(debug, graph.createTexture("debugView", target(Width, Height, 4)));
+
+    f.tonemap = graph.addPass("tonemap", PassType::Render, noop);
+    graph.read(f.tonemap, f.hdr);
+    graph.writeAttachment(f.tonemap, drawable, true);
+
+    graph.compile();
+    return f;
+}
+
+const RenderGraph::Attachment *findAttachment(const RenderGraph &graph, RenderGraph::PassId pass, ResourceId resource)
+{
+    const uint32_t renderPass = graph.pass(pass).renderPass;
+    if (renderPass == RenderGraph::InvalidIndex)
+        return nullptr;
+    for (const RenderGraph::Attachment &a : graph.renderPasses()[renderPass].attachments)
+    {
+        if (a.resource == graph.resourceIndex(resource))
+            return &a;
+    }
+    return nullptr;
+}
+
+bool hasActions(const RenderGraph &graph, RenderGraph::PassId pass, ResourceId resource, RenderGraph::LoadAction load,
+                RenderGraph::StoreAction store)
+{
+    const RenderGraph::Attachment *pAttachment = findAttachment(graph, pass, resource);
+    return pAttachment && pAttachment->load == load && pAttachment->store == store;
+}
+
+bool placed(const RenderGraph::Resource &resource)
+{
+    return !resource.imported && !resource.memoryless && resource.firstUse != RenderGraph::InvalidIndex;
+}
+
+void testAliasedHeapIsSmallerThanItsTransients()
+{
+    for (uint32_t scale : {1u, 2u})
+    {
+        RenderGraph graph;
+        buildDeferredFrame(graph, 1920 * scale, 1080 * scale);
+
+        uint64_t sum = 0;
+        for (const RenderGraph::Resource &resource : graph.resources())
+        {
+            if (placed(resource))
+                sum += resource.desc.size;
+        }
+
+        // Nothing can do better than the most bytes live during one pass.
+        uint64_t peak = 0;
+        for (uint32_t position = 0; position < graph.order().size(); ++position)
+        {
+            uint64_t live = 0;
+            for (const RenderGraph::Resource &resource : graph.resources())
+            {
+                if (placed(resource) && resource.firstUse <= position && position <= resource.lastUse)
+                    live += resource.desc.size;
+            }
+            peak = std::max(peak, live);
+        }
+
+        CHECK(graph.transientSize() == sum);
+        CHECK(graph.heapSize() < sum);
+        CHECK(graph.heapSize() >= peak);
+        std::printf("  %ux1080p: transients %.1f MB, heap %.1f MB, peak live %.1f MB\n", scale, double(sum) / 1e6,
+                    double(graph.heapSize()) / 1e6, double(peak) / 1e6);
+    }
+}
+
+void testPlacementsDoNotOverlapWhileLive()
+{
+    RenderGraph graph;
+    buildDeferredFrame(graph, 1920, 1080);
+
+    const std::vector<RenderGraph::Resource> &resources = graph.resources();
+    for (size_t a = 0; a < resources.size(); ++a)
+    {
+        const RenderGraph::Resource &ra = resources[a];
+        if (!placed(ra))
+            continue;
+        CHECK(ra.heapOffset % ra.desc.alignment == 0);
+        CHECK(ra.heapOffset + ra.desc.size <= graph.heapSize());
+        for (size_t b = a + 1; b < resources.size(); ++b)
+        {
+            const RenderGraph::Resource &rb = resources[b];
+            if (!placed(rb) || ra.lastUse < rb.firstUse || rb.lastUse < ra.firstUse)
+                continue;
+            CHECK(ra.heapOffset + ra.desc.size <= rb.heapOffset || rb.heapOffset + rb.desc.size <= ra.heapOffset);
+        }
+    }
+}
+
+void testUnusedPassIsCulledAndItsTargetUnplaced()
+{
+    RenderGraph graph;
+    buildDeferredFrame(graph, 1920, 1080);
+
+    for (RenderGraph::PassId pass = 0; pass < graph.passCount(); ++pass)
+        CHECK(graph.pass(pass).culled == (graph.pass(pass).name == "debug"));
+    CHECK(graph.order().size() == graph.passCount() - 1);
+    for (const RenderGraph::Resource &resource : graph.resources())
+    {
+        if (resource.name == "debugView")
+            CHECK(resource.firstUse == RenderGraph::InvalidIndex);
+    }
+}
+
+void testPassesRunAfterWhatTheyRead()
+{
+    RenderGraph graph;
+    buildDeferredFrame(graph, 1920, 1080);
+
+    std::vector<uint32_t> position(graph.passCount(), RenderGraph::InvalidIndex);
+    for (uint32_t i = 0; i < graph.order().size(); ++i)
+        position[graph.order()[i]] = i;
+    for (RenderGraph::PassId pass : graph.order())
+    {
+        for (RenderGraph::PassId dependency : graph.dependencies(pass))
+            CHECK(graph.pass(dependency).culled || position[dependency] < position[pass]);
+    }
+}
+void testConsecutiveRenderPassesMergeAndKeepTheGBufferInTiles()
+{
+    using Load = RenderGraph::LoadAction;
+    using Store = RenderGraph::StoreAction;
+    RenderGraph graph;
+    const TiledFrame f = buildTiledFrame(graph, false);
+
+    // The shadow atlas has another size and the tonemap samples hdr, so only the middle three passes merge.
+    CHECK(graph.renderPasses().size() == 3);
+    CHECK(graph.pass(f.gbuffer).renderPass == graph.pass(f.lighting).renderPass);
+    CHECK(graph.pass(f.lighting).renderPass == graph.pass(f.transparent).renderPass);
+    CHECK(graph.pass(f.shadows).renderPass != graph.pass(f.gbuffer).renderPass);
+    CHECK(graph.pass(f.tonemap).renderPass != graph.pass(f.transparent).renderPass);
+
+    CHECK(hasActions(graph, f.gbuffer, f.albedo, Load::Clear, Store::DontCare));
+    CHECK(hasActions(graph, f.gbuffer, f.normal, Load::Clear, Store::DontCare));
+    CHECK(hasActions(graph, f.gbuffer, f.depth, Load::Clear, Store::DontCare));
+    CHECK(hasActions(graph, f.lighting, f.hdr, Load::Clear, Store::Store));
+    CHECK(hasActions(graph, f.shadows, f.shadowAtlas, Load::Clear, Store::Store));
+
+    uint64_t gbufferBytes = 0;
+    for (ResourceId resource : {f.albedo, f.normal, f.depth})
+    {
+        CHECK(graph.resource(resource).memoryless);
+        gbufferBytes += graph.resource(resource).desc.size;
+    }
+    CHECK(!graph.resource(f.hdr).memoryless && !graph.resource(f.shadowAtlas).memoryless);
+
+    const RenderGraph::AttachmentTraffic &traffic = graph.attachmentTraffic();
+    CHECK(traffic.memorylessBytes == gbufferBytes);
+    CHECK(traffic.plannedBytes < traffic.unmergedBytes);
+    // Stores of the atlas, hdr and drawable are all that is left.
+    CHECK(traffic.plannedBytes == graph.resource(f.shadowAtlas).desc.size + graph.resource(f.hdr).desc.size +
+                                      target(1920, 1080, 4).size);
+    // Memoryless transients take no heap space.
+    CHECK(graph.transientSize() == graph.resource(f.shadowAtlas).desc.size + graph.resource(f.hdr).desc.size);
+    std::printf("  attachment traffic %.1f MB -> %.1f MB, %.1f MB memoryless\n", double(traffic.unmergedBytes) / 1e6,
+                double(traffic.plannedBytes) / 1e6, double(traffic.memorylessBytes) / 1e6);
+}
+
+void testSampledAttachmentsAreStoredAndLoaded()
+{
+    using Load = RenderGraph::LoadAction;
+    using Store = RenderGraph::StoreAction;
+    RenderGraph graph;
+    const TiledFrame f = buildTiledFrame(graph, true);
+
+    // The compute pass between them splits the G-buffer from the lighting, which loads what the G-buffer stores.
+    CHECK(graph.renderPasses().size() == 4);
+    CHECK(graph.pass(f.gbuffer).renderPass != graph.pass(f.lighting).renderPass);
+    CHECK(graph.pass(f.lighting).renderPass == graph.pass(f.transparent).renderPass);
+    CHECK(hasActions(graph, f.gbuffer, f.normal, Load::Clear, Store::Store));
+    CHECK(hasActions(graph, f.gbuffer, f.depth, Load::Clear, Store::Store));
+    CHECK(hasActions(graph, f.lighting, f.normal, Load::Load, Store::DontCare));
+    CHECK(hasActions(graph, f.lighting, f.depth, Load::Load, Store::DontCare));
+    // The lighting reads the albedo in another render pass, so it is stored; the culled debug pass plays no part.
+    CHECK(hasActions(graph, f.gbuffer, f.albedo, Load::Clear, Store::Store));
+    for (ResourceId resource : {f.albedo, f.normal, f.depth, f.hdr})
+        CHECK(!graph.resource(resource).memoryless);
+    CHECK(graph.attachmentTraffic().plannedBytes < graph.attachmentTraffic().unmergedBytes);
+}
+
+void testMergingStopsAtTheAttachmentLimit()
+{
+    RenderGraph graph;
+    const auto noop = []() {};
+    std::vector<ResourceId> targets;
+    std::vector<RenderGraph::PassId> passes;
+    for (uint32_t i = 0; i < RenderGraph::MaxColorAttachments + 1; ++i)
+    {
+        static const char *const Names[] = {"t0", "t1", "t2", "t3", "t4", "t5", "t6", "t7", "t8"};
+        const RenderGraph::PassId pass = graph.addPass(Names[i], PassType::Render, noop);
+        const ResourceId color = graph.createTexture(Names[i], attachment(256, 256, RGBA8, 4));
+        targets.push_back(graph.writeAttachment(pass, color, true));
+        passes.push_back(pass);
+    }
+    const ResourceId output = graph.importResource("output");
+    const RenderGraph::PassId resolve = graph.addPass("resolve", PassType::Compute, noop);
+    for (ResourceId t : targets)
+        graph.read(resolve, t);
+    graph.write(resolve, output);
+    graph.compile();
+
+    CHECK(graph.renderPasses().size() == 2);
+    CHECK(graph.renderPasses()[0].attachments.size() == RenderGraph::MaxColorAttachments);
+    CHECK(graph.pass(passes.back()).renderPass == 1);
+}
+} // namespace
+
+int main()
+{
+    return Test::run({
+        {"aliased heap is smaller than its transients", testAliasedHeapIsSmallerThanItsTransients},
+        {"placements do not overlap while live", testPlacementsDoNotOverlapWhileLive},
+        {"unused pass is culled and its target unplaced", testUnusedPassIsCulledAndItsTargetUnplaced},
+        {"passes run after what they read", testPassesRunAfterWhatTheyRead},
+        {"consecutive render passes merge and keep the G-buffer in tiles",
+         testConsecutiveRenderPassesMergeAndKeepTheGBufferInTiles},
+        {"sampled attachments are stored and loaded", testSampledAttachmentsAreStoredAndLoaded},
+        {"merging stops at the attachment limit", testMergingStopsAtTheAttachmentLimit},
+    });
+}
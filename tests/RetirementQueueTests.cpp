@@ -0,0 +1,166 @@
+// RetirementQueue against a simulated GPU timeline, with frames completing out of order and handlers running late.
+
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "RetirementQueue.h"
+#include "Test.h"
+
+namespace
+{
+struct Completion {
+    double time; // when the frame's last completion handler runs
+    uint64_t frame;
+};
+
+struct Object {
+    uint64_t frame; // retired in
+    int released = 0;
+};
+
+// Records frames on up to two queues, each running its command buffers in order for a random time. A frame's
+// completion reaches the queue when its last command buffer's handler runs, some of them long after the GPU is done
+// and after later frames have been reported.
+void simulate(uint32_t seed, uint32_t queueCount, double lateHandlerChance)
+{
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    constexpr uint64_t FrameCount = 2000;
+    std::vector<Object> objects;
+    objects.reserve(FrameCount * 6);
+    std::vector<bool> reported(FrameCount + 1, false);
+    std::vector<Completion> inFlight;
+    std::vector<double> queueBusyUntil(queueCount, 0.0);
+
+    RetirementQueue queue;
+    std::vector<void *> released;
+    uint64_t firstUnreported = 1;
+    auto report = [&](uint64_t frame) {
+        reported[frame] = true;
+        queue.complete(frame);
+        while (firstUnreported <= FrameCount && reported[firstUnreported])
+            ++firstUnreported;
+    };
+    auto collect = [&]() {
+        released.clear();
+        queue.collect(released);
+        for (void *pObject : released)
+        {
+            Object &object = *static_cast<Object *>(pObject);
+            ++object.released;
+            // Released only once its frame and every earlier one were reported.
+            CHECK(object.frame < firstUnreported);
+        }
+    };
+
+    double now = 0.0;
+    for (uint64_t frame = 1; frame <= FrameCount; ++frame)
+    {
+        CHECK(queue.frame() == frame);
+        const uint32_t retired = random() % 6; // some frames retire nothing
+        for (uint32_t i = 0; i < retired; ++i)
+        {
+            objects.push_back({frame});
+            queue.retire(&objects.back());
+        }
+        CHECK(queue.endFrame() == frame);
+
+        double done = 0.0;
+        for (uint32_t q = 0; q < queueCount; ++q)
+        {
+            queueBusyUntil[q] = std::max(queueBusyUntil[q], now) + 0.5 + 2.0 * unit(random);
+            done = std::max(done, queueBusyUntil[q]);
+        }
+        const double handlerDelay = unit(random) < lateHandlerChance ? 50.0 * unit(random) : 0.1 * unit(random);
+        inFlight.push_back({done + handlerDelay, frame});
+
+        // The CPU records a frame per unit of time and reports whatever completed meanwhile, in completion order.
+        now += 1.0;
+        std::sort(inFlight.begin(), inFlight.end(),
+                  [](const Completion &a, const Completion &b) { return a.time < b.time; });
+        size_t delivered = 0;
+        for (; delivered < inFlight.size() && inFlight[delivered].time <= now; ++delivered)
+            report(inFlight[delivered].frame);
+        inFlight.erase(inFlight.begin(), inFlight.begin() + delivered);
+        collect();
+
+        // Nothing is held back longer than needed: every pending object waits for an unreported frame.
+        const auto firstPending = std::lower_bound(
+            objects.begin(), objects.end(), firstUnreported,
+            [](const Object &object, uint64_t frame) { return object.frame < frame; });
+        CHECK(queue.stats().pendingObjects == uint64_t(objects.end() - firstPending));
+    }
+
+    for (const Completion &completion : inFlight)
+        report(completion.frame);
+    collect();
+
+    const RetirementQueue::Stats stats = queue.stats();
+    CHECK(stats.pendingFrames == 0 && stats.pendingObjects == 0);
+    CHECK(stats.releasedObjects == objects.size());
+    for (const Object &object : objects)
+        CHECK(object.released == 1);
+}
+
+void testInOrderCompletions()
+{
+    simulate(1, 1, 0.0);
+}
+
+void testOutOfOrderCompletionsAcrossQueues()
+{
+    simulate(2, 2, 0.0);
+    simulate(3, 2, 0.05);
+}
+
+void testLateCompletionsHoldBackLaterFrames()
+{
+    // A handler running many frames late keeps every later frame's objects, growing the ring of batches.
+    simulate(4, 1, 0.2);
+    simulate(5, 2, 0.5);
+}
+
+void testCompletionsFromSeveralThreads()
+{
+    constexpr uint64_t FrameCount = 4096;
+    std::vector<Object> objects(FrameCount);
+    RetirementQueue queue;
+    std::vector<uint64_t> frames;
+    for (uint64_t frame = 1; frame <= FrameCount; ++frame)
+    {
+        objects[frame - 1].frame = frame;
+        queue.retire(&objects[frame - 1]);
+        frames.push_back(queue.endFrame());
+    }
+    std::shuffle(frames.begin(), frames.end(), std::mt19937(6));
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&, t]() {
+            for (size_t i = t; i < frames.size(); i += 4)
+                queue.complete(frames[i]);
+        });
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+
+    std::vector<void *> released;
+    queue.collect(released);
+    CHECK(released.size() == FrameCount);
+    CHECK(queue.stats().pendingObjects == 0);
+}
+} // namespace
+
+int main()
+{
+    return Test::run({
+        {"in-order completions", testInOrderCompletions},
+        {"out-of-order completions across queues", testOutOfOrderCompletionsAcrossQueues},
+        {"late completions hold back later frames", testLateCompletionsHoldBackLaterFrames},
+        {"completions from several threads", testCompletionsFromSeveralThreads},
+    });
+}
@@ -0,0 +1,227 @@
+// SpatialHashGrid against a brute-force scan of the points: queryRect, queryRadius and nearest, singly and batched,
+// with few buckets so that cells share them, with one bucket per point, with points on cell edges and query
+// boundaries, and with rebuilds of the same grid at different sizes, serially and on the JobSystem.
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "JobSystem.h"
+#include "SpatialHashGrid.h"
+#include "Test.h"
+
+namespace
+{
+struct Points {
+    std::vector<float> x, y;
+};
+
+// Random points in [-extent, extent]^2; a quarter snapped to the cell grid, and some exact duplicates.
+Points makePoints(size_t count, float extent, float cellSize, uint32_t seed)
+{
+    Points points;
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> coordinate(-extent, extent);
+    for (size_t i = 0; i < count; ++i)
+    {
+        float x = coordinate(random), y = coordinate(random);
+        if (i % 4 == 0)
+        {
+            x = std::round(x / cellSize) * cellSize;
+            y = std::round(y / cellSize) * cellSize;
+        }
+        if (i % 50 == 1)
+        {
+            x = points.x[i - 1];
+            y = points.y[i - 1];
+        }
+        points.x.push_back(x);
+        points.y.push_back(y);
+    }
+    return points;
+}
+
+std::vector<uint32_t> sorted(std::vector<uint32_t> values)
+{
+    std::sort(values.begin(), values.end());
+    return values;
+}
+
+std::vector<uint32_t> bruteRect(const Points &p, const SpatialHashGrid::Rect &r)
+{
+    std::vector<uint32_t> result;
+    for (uint32_t i = 0; i < p.x.size(); ++i)
+    {
+        if (p.x[i] >= r.minX && p.x[i] <= r.maxX && p.y[i] >= r.minY && p.y[i] <= r.maxY)
+            result.push_back(i);
+    }
+    return result;
+}
+
+std::vector<uint32_t> bruteRadius(const Points &p, float x, float y, float radius)
+{
+    std::vector<uint32_t> result;
+    for (uint32_t i = 0; i < p.x.size(); ++i)
+    {
+        const float dx = p.x[i] - x, dy = p.y[i] - y;
+        if (dx * dx + dy * dy <= radius * radius)
+            result.push_back(i);
+    }
+    return result;
+}
+
+float distanceSquared(const Points &p, uint32_t i, float x, float y)
+{
+    const float dx = p.x[i] - x, dy = p.y[i] - y;
+    return dx * dx + dy * dy;
+}
+
+void checkQueries(const SpatialHashGrid &grid, const Points &points, float extent, uint32_t seed, JobSystem *pJobs)
+{
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> coordinate(-extent * 1.1f, extent * 1.1f);
+    std::uniform_real_distribution<float> size(0.0f, grid.cellSize() * 4.0f);
+
+    std::vector<SpatialHashGrid::Rect> rects;
+    std::vector<float> centerX, centerY;
+    const float radius = grid.cellSize() * 1.5f;
+    bool rectsMatch = true, radiiMatch = true, nearestMatch = true;
+    for (int q = 0; q < 300; ++q)
+    {
+        // Some queries are centered on a point, so boundaries pass exactly through points.
+        float x = coordinate(random), y = coordinate(random);
+        if (q % 3 == 0)
+        {
+            const uint32_t i = uint32_t(random() % points.x.size());
+            x = points.x[i];
+            y = points.y[i];
+        }
+        SpatialHashGrid::Rect rect = {x, y, x + size(random), y + size(random)};
+        if (q % 10 == 0)
+            rect = {-extent * 2.0f, -extent * 0.5f, extent * 2.0f, extent * 0.5f}; // more cells than buckets
+        rects.push_back(rect);
+        centerX.push_back(x);
+        centerY.push_back(y);
+
+        std::vector<uint32_t> results;
+        grid.queryRect(rect, results);
+        rectsMatch = rectsMatch && sorted(results) == bruteRect(points, rect);
+
+        results.clear();
+        grid.queryRadius(x, y, radius, results);
+        radiiMatch = radiiMatch && sorted(results) == bruteRadius(points, x, y, radius);
+
+        // Ties between duplicates may pick either point, so compare distances.
+        const uint32_t found = grid.nearest(x, y, radius);
+        const std::vector<uint32_t> candidates = bruteRadius(points, x, y, radius);
+        if (candidates.empty())
+        {
+            nearestMatch = nearestMatch && found == SpatialHashGrid::InvalidIndex;
+        }
+        else
+        {
+            float best = INFINITY;
+            for (uint32_t i : candidates)
+                best = std::min(best, distanceSquared(points, i, x, y));
+            nearestMatch = nearestMatch && found != SpatialHashGrid::InvalidIndex &&
+                           distanceSquared(points, found, x, y) == best;
+        }
+    }
+    CHECK(rectsMatch);
+    CHECK(radiiMatch);
+    CHECK(nearestMatch);
+
+    // Every point, including the last of each bucket, is found by an empty rect at its own position.
+    bool everyPointFound = true;
+    for (uint32_t i = 0; i < points.x.size(); ++i)
+    {
+        std::vector<uint32_t> results;
+        grid.queryRect({points.x[i], points.y[i], points.x[i], points.y[i]}, results);
+        everyPointFound = everyPointFound && std::find(results.begin(), results.end(), i) != results.end();
+    }
+    CHECK(everyPointFound);
+
+    // Batched queries give each query's results, in order, at its offsets.
+    std::vector<uint32_t> results, offsets;
+    grid.queryRects(rects.data(), rects.size(), results, offsets, pJobs);
+    bool batchMatch = offsets.size() == rects.size() + 1 && offsets.back() == results.size();
+    for (size_t q = 0; batchMatch && q < rects.size(); ++q)
+    {
+        std::vector<uint32_t> single;
+        grid.queryRect(rects[q], single);
+        const std::vector<uint32_t> batched(results.begin() + offsets[q], results.begin() + offsets[q + 1]);
+        batchMatch = batched == single;
+    }
+    CHECK(batchMatch);
+
+    grid.queryRadii(centerX.data(), centerY.data(), centerX.size(), radius, results, offsets, pJobs);
+    batchMatch = offsets.size() == centerX.size() + 1 && offsets.back() == results.size();
+    for (size_t q = 0; batchMatch && q < centerX.size(); ++q)
+    {
+        const std::vector<uint32_t> batched(results.begin() + offsets[q], results.begin() + offsets[q + 1]);
+        batchMatch = sorted(batched) == bruteRadius(points, centerX[q], centerY[q], radius);
+    }
+    CHECK(batchMatch);
+}
+
+void testFewBuckets()
+{
+    // 64 buckets for thousands of occupied cells: every bucket is shared by many cells.
+    const Points points = makePoints(5000, 100.0f, 2.0f, 1);
+    SpatialHashGrid grid(2.0f, 64);
+    grid.rebuild(points.x.data(), points.y.data(), points.x.size());
+    CHECK(grid.bucketCount() == 64 && grid.size() == 5000);
+    checkQueries(grid, points, 100.0f, 2, nullptr);
+}
+
+void testBucketPerPoint()
+{
+    const Points points = makePoints(20000, 300.0f, 1.0f, 3);
+    SpatialHashGrid grid(1.0f);
+    grid.rebuild(points.x.data(), points.y.data(), points.x.size());
+    CHECK(grid.bucketCount() == 32768);
+    checkQueries(grid, points, 300.0f, 4, nullptr);
+}
+
+void testJobSystemRebuild()
+{
+    // Several 16K-point chunks, so both sort passes split into jobs; the result must not depend on that.
+    JobSystem jobs(4);
+    const Points points = makePoints(100000, 500.0f, 1.5f, 5);
+    SpatialHashGrid serial(1.5f), parallel(1.5f);
+    serial.rebuild(points.x.data(), points.y.data(), points.x.size());
+    parallel.rebuild(points.x.data(), points.y.data(), points.x.size(), &jobs);
+    std::vector<uint32_t> a, b;
+    serial.queryRect({-600.0f, -600.0f, 600.0f, 600.0f}, a);
+    parallel.queryRect({-600.0f, -600.0f, 600.0f, 600.0f}, b);
+    CHECK(a == b && a.size() == points.x.size());
+    checkQueries(parallel, points, 500.0f, 6, &jobs);
+}
+
+void testRebuildShrinksAndGrows()
+{
+    SpatialHashGrid grid(4.0f);
+    for (size_t count : {3000, 10, 0, 7000})
+    {
+        const Points points = makePoints(count, 200.0f, 4.0f, uint32_t(count) + 7);
+        grid.rebuild(points.x.data(), points.y.data(), count);
+        CHECK(grid.size() == count);
+        std::vector<uint32_t> results;
+        grid.queryRect({-250.0f, -250.0f, 250.0f, 250.0f}, results);
+        CHECK(results.size() == count);
+        if (count)
+            checkQueries(grid, points, 200.0f, uint32_t(count), nullptr);
+        else
+            CHECK(grid.nearest(0.0f, 0.0f, 100.0f) == SpatialHashGrid::InvalidIndex);
+    }
+}
+} // namespace
+
+int main()
+{
+    return Test::run({{"few shared buckets match brute force", testFewBuckets},
+                      {"one bucket per point matches brute force", testBucketPerPoint},
+                      {"JobSystem rebuild matches brute force", testJobSystemRebuild},
+                      {"rebuild shrinks and grows", testRebuildShrinksAndGrows}});
+}
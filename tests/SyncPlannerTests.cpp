@@ -0,0 +1,403 @@
+// SyncPlanner and SyncTimeline, checked by encoding their plans into a mock command stream and proving every hazard
+// between passes is ordered by the waits it holds.
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "SyncPlanner.h"
+#include "Test.h"
+
+namespace
+{
+using PassId = SyncPlanner::PassId;
+using PassType = SyncPlanner::PassType;
+using Stage = SyncPlanner::Stage;
+
+struct Access {
+    uint32_t resource;
+    Stage stage;
+    bool write;
+};
+
+// The passes of a frame with the accesses given to the planner, to check its plan against.
+struct Frame {
+    uint32_t queueCount = 1;
+    std::vector<uint32_t> queues;
+    std::vector<PassType> types;
+    std::vector<std::vector<Access>> accesses;
+
+    PassId addPass(uint32_t queue, PassType type)
+    {
+        queues.push_back(queue);
+        types.push_back(type);
+        accesses.emplace_back();
+        return PassId(queues.size() - 1);
+    }
+    void access(PassId pass, uint32_t resource, bool write, Stage stage = Stage::Vertex)
+    {
+        // As SyncPlanner does, compute and blit accesses happen at the first stage.
+        accesses[pass].push_back({resource, types[pass] == PassType::Render ? stage : Stage::Vertex, write});
+    }
+    void plan(SyncPlanner &planner, bool fences) const
+    {
+        planner.reset(queueCount);
+        for (PassId pass = 0; pass < queues.size(); ++pass)
+        {
+            planner.addPass(queues[pass], types[pass]);
+            for (const Access &a : accesses[pass])
+                a.write ? planner.write(pass, a.resource, a.stage) : planner.read(pass, a.resource, a.stage);
+        }
+        planner.plan(fences);
+    }
+};
+
+// What SyncEncoder encodes for a frame, per queue in submission order, with event values made absolute by the
+// SyncTimeline the way SyncEncoder does.
+struct Command {
+    enum class Type : uint8_t { WaitEvent, WaitFence, UpdateFence, SignalEvent } type;
+    PassId pass;
+    uint32_t queue; // whose event is waited for
+    uint64_t value;
+    uint32_t fence = 0; // WaitFence and UpdateFence only
+    Stage stage = {};   // WaitFence only
+};
+
+class MockCommandStream {
+  public:
+    void encodeFrame(const SyncPlanner &planner, const SyncTimeline &timeline)
+    {
+        queues.assign(planner.queueCount(), {});
+        for (PassId pass = 0; pass < planner.passCount(); ++pass)
+        {
+            const SyncPlanner::PassPlan &plan = planner.passPlan(pass);
+            std::vector<Command> &stream = queues[planner.passQueue(pass)];
+            for (const SyncPlanner::EventWait &wait : plan.eventWaits)
+                stream.push_back({Command::Type::WaitEvent, pass, wait.queue, timeline.value(wait.queue, wait.value)});
+            for (const SyncPlanner::FenceWait &wait : plan.fenceWaits)
+                stream.push_back({Command::Type::WaitFence, pass, 0, 0, wait.fence, wait.beforeStage});
+            if (plan.updateFence != SyncPlanner::InvalidIndex)
+                stream.push_back({Command::Type::UpdateFence, pass, 0, 0, plan.updateFence});
+            if (plan.signalValue)
+            {
+                const uint32_t queue = planner.passQueue(pass);
+                stream.push_back({Command::Type::SignalEvent, pass, queue, timeline.value(queue, plan.signalValue)});
+            }
+        }
+    }
+
+    std::vector<std::vector<Command>> queues;
+};
+
+// Every event value signaled so far, per queue, with the frame that signaled it.
+struct Signal {
+    uint64_t value;
+    uint32_t frame;
+    PassId pass;
+};
+
+// Builds the happens-before graph of a frame from its command streams, where each pass has a vertex stage start, a
+// fragment stage start and an end, and checks that every hazard between two passes is ordered by it.
+class HazardChecker {
+  public:
+    explicit HazardChecker(uint32_t queueCount) : _signals(queueCount) {}
+
+    void checkFrame(const Frame &frame, const SyncPlanner &planner, const MockCommandStream &stream, bool fences)
+    {
+        const size_t passCount = frame.queues.size();
+        _edges.assign(passCount * 3, {});
+        for (PassId pass = 0; pass < passCount; ++pass)
+        {
+            _edges[node(pass, 0)].push_back(node(pass, 1));
+            _edges[node(pass, 1)].push_back(node(pass, 2));
+        }
+
+        // Signals first, so waits can find the ones of later passes on other queues. Values only grow.
+        for (uint32_t queue = 0; queue < stream.queues.size(); ++queue)
+        {
+            for (const Command &command : stream.queues[queue])
+            {
+                if (command.type != Command::Type::SignalEvent)
+                    continue;
+                CHECK(command.queue == queue);
+                CHECK(_signals[queue].empty() || command.value > _signals[queue].back().value);
+                _signals[queue].push_back({command.value, _frame, command.pass});
+            }
+        }
+
+        for (uint32_t queue = 0; queue < stream.queues.size(); ++queue)
+        {
+            std::vector<PassId> lastUpdate(planner.fenceCount(), SyncPlanner::InvalidIndex);
+            for (const Command &command : stream.queues[queue])
+            {
+                CHECK(frame.queues[command.pass] == queue);
+                switch (command.type)
+                {
+                case Command::Type::WaitEvent:
+                {
+                    // The first signal reaching the value releases the wait; it must be this frame's.
+                    const Signal *pSignal = nullptr;
+                    for (const Signal &signal : _signals[command.queue])
+                    {
+                        if (signal.value >= command.value)
+                        {
+                            pSignal = &signal;
+                            break;
+                        }
+                    }
+                    CHECK(pSignal && pSignal->frame == _frame);
+                    if (pSignal && pSignal->frame == _frame)
+                        _edges[node(pSignal->pass, 2)].push_back(node(command.pass, 0));
+                    break;
+                }
+                case Command::Type::WaitFence:
+                {
+                    // Waits for the latest update of the fence encoded earlier on this queue.
+                    CHECK(planner.fenceQueue(command.fence) == queue);
+                    const PassId updater = lastUpdate[command.fence];
+                    CHECK(updater != SyncPlanner::InvalidIndex);
+                    if (updater != SyncPlanner::InvalidIndex)
+                        _edges[node(updater, 2)].push_back(node(command.pass, uint32_t(command.stage)));
+                    break;
+                }
+                case Command::Type::UpdateFence:
+                    CHECK(planner.fenceQueue(command.fence) == queue);
+                    lastUpdate[command.fence] = command.pass;
+                    break;
+                case Command::Type::SignalEvent:
+                    break;
+                }
+            }
+        }
+
+        // Without fences, Metal's hazard tracking orders the passes of one queue.
+        if (!fences)
+        {
+            forEachHazard(frame, [&](PassId producer, PassId consumer, Stage stage) {
+                if (frame.queues[producer] == frame.queues[consumer])
+                    _edges[node(producer, 2)].push_back(node(consumer, uint32_t(stage)));
+            });
+        }
+
+        forEachHazard(frame, [&](PassId producer, PassId consumer, Stage stage) {
+            const bool ordered = reaches(node(producer, 2), node(consumer, uint32_t(stage)));
+            CHECK(ordered);
+            if (!ordered)
+                std::printf("  frame %u: pass %u does not wait for pass %u\n", _frame, consumer, producer);
+        });
+        ++_frame;
+    }
+
+  private:
+    static uint32_t node(PassId pass, uint32_t point) { return pass * 3 + point; }
+
+    // Every pair of passes touching a resource, at least one writing it, with the consumer's stage doing so.
+    template <typename F> static void forEachHazard(const Frame &frame, F &&f)
+    {
+        for (PassId consumer = 0; consumer < frame.queues.size(); ++consumer)
+        {
+            for (PassId producer = 0; producer < consumer; ++producer)
+            {
+                bool found = false;
+                Stage earliest = Stage::Fragment;
+                for (const Access &c : frame.accesses[consumer])
+                {
+                    for (const Access &p : frame.accesses[producer])
+                    {
+                        if (c.resource == p.resource && (c.write || p.write))
+                        {
+                            found = true;
+                            earliest = std::min(earliest, c.stage);
+                        }
+                    }
+                }
+                if (found)
+                    f(producer, consumer, earliest);
+            }
+        }
+    }
+
+    bool reaches(uint32_t from, uint32_t to)
+    {
+        std::vector<bool> visited(_edges.size(), false);
+        std::vector<uint32_t> stack = {from};
+        visited[from] = true;
+        while (!stack.empty())
+        {
+            const uint32_t n = stack.back();
+            stack.pop_back();
+            if (n == to)
+                return true;
+            for (uint32_t next : _edges[n])
+            {
+                if (!visited[next])
+                {
+                    visited[next] = true;
+                    stack.push_back(next);
+                }
+            }
+        }
+        return false;
+    }
+
+    uint32_t _frame = 0;
+    std::vector<std::vector<Signal>> _signals;
+    std::vector<std::vector<uint32_t>> _edges;
+};
+
+Frame randomFrame(std::mt19937 &random, uint32_t queueCount)
+{
+    Frame frame;
+    frame.queueCount = queueCount;
+    const uint32_t passCount = 2 + random() % 40;
+    const uint32_t resourceCount = 1 + random() % 10;
+    for (uint32_t i = 0; i < passCount; ++i)
+    {
+        const PassType type = PassType(random() % 3);
+        const PassId pass = frame.addPass(random() % queueCount, type);
+        const uint32_t accessCount = 1 + random() % 4;
+        for (uint32_t a = 0; a < accessCount; ++a)
+            frame.access(pass, random() % resourceCount, random() % 3 == 0, Stage(random() % 2));
+    }
+    return frame;
+}
+
+// Plans, encodes and checks frames the way Renderer does: the next frame is planned only once this one has ended.
+void runFrames(const std::vector<Frame> &frames, bool fences)
+{
+    SyncPlanner planner;
+    SyncTimeline timeline;
+    MockCommandStream stream;
+    HazardChecker checker(frames.front().queueCount);
+    for (const Frame &frame : frames)
+    {
+        frame.plan(planner, fences);
+        timeline.beginFrame(planner);
+        stream.encodeFrame(planner, timeline);
+        timeline.endFrame();
+        checker.checkFrame(frame, planner, stream, fences);
+    }
+}
+
+void testRandomFramesOrderEveryHazard()
+{
+    std::mt19937 random(7);
+    for (uint32_t queueCount = 1; queueCount <= 3; ++queueCount)
+    {
+        for (bool fences : {true, false})
+        {
+            std::vector<Frame> frames;
+            for (int i = 0; i < 300; ++i)
+                frames.push_back(randomFrame(random, queueCount));
+            runFrames(frames, fences);
+        }
+    }
+}
+
+void testFragmentReadWaitsBeforeFragmentStage()
+{
+    Frame frame;
+    const PassId shadows = frame.addPass(0, PassType::Render);
+    frame.access(shadows, 0, true, Stage::Fragment);
+    const PassId scene = frame.addPass(0, PassType::Render);
+    frame.access(scene, 0, false, Stage::Fragment);
+
+    SyncPlanner planner;
+    frame.plan(planner, true);
+    const SyncPlanner::PassPlan &plan = planner.passPlan(scene);
+    CHECK(plan.fenceWaits.size() == 1);
+    CHECK(plan.fenceWaits.size() == 1 && plan.fenceWaits[0].beforeStage == Stage::Fragment);
+    CHECK(plan.eventWaits.empty());
+    CHECK(planner.passPlan(shadows).updateFence != SyncPlanner::InvalidIndex);
+    CHECK(planner.signalCount(0) == 0);
+}
+
+void testTransitiveWaitsAreNotRepeated()
+{
+    // C reads what A and B wrote, and B already waited for A.
+    Frame frame;
+    const PassId a = frame.addPass(0, PassType::Compute);
+    frame.access(a, 0, true);
+    const PassId b = frame.addPass(0, PassType::Compute);
+    frame.access(b, 0, false);
+    frame.access(b, 1, true);
+    const PassId c = frame.addPass(0, PassType::Compute);
+    frame.access(c, 0, false);
+    frame.access(c, 1, false);
+
+    SyncPlanner planner;
+    frame.plan(planner, true);
+    CHECK(planner.passPlan(c).fenceWaits.size() == 1);
+    CHECK(planner.stats().redundantWaits == 1);
+}
+
+void testCrossQueueHazardSignalsOnce()
+{
+    Frame frame;
+    frame.queueCount = 2;
+    const PassId culling = frame.addPass(1, PassType::Compute);
+    frame.access(culling, 0, true);
+    const PassId shadows = frame.addPass(0, PassType::Render);
+    frame.access(shadows, 0, false);
+    const PassId scene = frame.addPass(0, PassType::Render);
+    frame.access(scene, 0, false);
+
+    SyncPlanner planner;
+    frame.plan(planner, true);
+    CHECK(planner.passPlan(culling).signalValue == 1);
+    CHECK(planner.passPlan(shadows).eventWaits.size() == 1);
+    // Nothing orders the shadow pass before the scene on their queue, so the scene waits for the event too.
+    CHECK(planner.passPlan(scene).eventWaits.size() == 1);
+    CHECK(planner.signalCount(1) == 1 && planner.signalCount(0) == 0);
+}
+
+// Frames signaling fewer values than the one before them must still continue after everything it signaled. Had the
+// timeline read the counts back after the next frame was planned, the second frame's values would start after 1
+// rather than 3, and its waits would be released by the first frame's signals.
+void testEventValuesContinueWhenSignalCountsDrop()
+{
+    auto fanIn = [](uint32_t producers) {
+        Frame frame;
+        frame.queueCount = 2;
+        for (uint32_t i = 0; i < producers; ++i)
+            frame.access(frame.addPass(0, PassType::Compute), i, true);
+        const PassId consumer = frame.addPass(1, PassType::Compute);
+        for (uint32_t i = 0; i < producers; ++i)
+            frame.access(consumer, i, false);
+        return frame;
+    };
+
+    SyncPlanner planner;
+    fanIn(3).plan(planner, true);
+    CHECK(planner.signalCount(0) == 3);
+
+    runFrames({fanIn(3), fanIn(1), fanIn(2), fanIn(1), fanIn(3)}, true);
+
+    SyncTimeline timeline;
+    uint64_t last = 0;
+    for (uint32_t producers : {3u, 1u, 2u})
+    {
+        fanIn(producers).plan(planner, true);
+        timeline.beginFrame(planner);
+        CHECK(timeline.value(0, 1) == last + 1);
+        last = timeline.value(0, planner.signalCount(0));
+        // Planning the next frame before this one ends must not move its values.
+        fanIn(1).plan(planner, true);
+        CHECK(timeline.value(0, 1) == last - producers + 1);
+        timeline.endFrame();
+    }
+    CHECK(last == 6);
+}
+} // namespace
+
+int main()
+{
+    return Test::run({
+        {"random frames order every hazard", testRandomFramesOrderEveryHazard},
+        {"fragment read waits before the fragment stage", testFragmentReadWaitsBeforeFragmentStage},
+        {"transitive waits are not repeated", testTransitiveWaitsAreNotRepeated},
+        {"cross-queue hazard signals once", testCrossQueueHazardSignalsOnce},
+        {"event values continue when signal counts drop", testEventValuesContinueWhenSignalCountsDrop},
+    });
+}
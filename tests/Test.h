@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdio>
+#include <initializer_list>
+
+// A minimal harness for the GraphicsCore tests: each test file is an executable whose main() runs its test
+// functions with Test::run(), and CHECK records a failure without stopping the test, so one run reports every
+// broken expectation. The executable's exit status is what ctest sees.
+namespace Test
+{
+inline int &failures()
+{
+    static int count = 0;
+    return count;
+}
+
+inline void check(bool condition, const char *expression, const char *file, int line)
+{
+    if (condition)
+        return;
+    ++failures();
+    std::printf("  %s:%d: CHECK(%s) failed\n", file, line, expression);
+}
+
+struct Case {
+    const char *name;
+    void (*function)();
+};
+
+inline int run(std::initializer_list<Case> cases)
+{
+    for (const Case &test : cases)
+    {
+        const int before = failures();
+        test.function();
+        std::printf("%s %s\n", failures() == before ? "[pass]" : "[FAIL]", test.name);
+    }
+    return failures() ? 1 : 0;
+}
+} // namespace Test
+
+#define CHECK(condition) Test::check(bool(condition), #condition, __FILE__, __LINE__)
@@ -0,0 +1,271 @@
+// TexturePool against a reference model of every texture it knows: a random frame loop acquires and releases
+// textures of a few descriptors, and each acquire must hit exactly when the model has a matching texture released at
+// least frameLatency frames ago, returning the most recently released of them. beginFrame must trim exactly the
+// textures idle for more than maxIdleFrames, and the stats must match the model throughout.
+
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "Test.h"
+#include "TexturePool.h"
+
+namespace
+{
+struct Model {
+    TexturePool::Descriptor desc;
+    uint64_t size;
+    uint64_t releasedFrame;
+    bool inUse;
+};
+
+TexturePool::Descriptor descriptor(uint32_t width, uint32_t height, uint32_t pixelFormat)
+{
+    TexturePool::Descriptor desc;
+    desc.width = width;
+    desc.height = height;
+    desc.pixelFormat = pixelFormat;
+    desc.usage = 5;       // render target | shader read
+    desc.storageMode = 2; // private
+    return desc;
+}
+
+void *fakeTexture(uint64_t id)
+{
+    return reinterpret_cast<void *>(uintptr_t(id) * 16);
+}
+
+void checkRandomFrames(const TexturePool::Settings &settings, uint32_t seed)
+{
+    std::mt19937 random(seed);
+    const TexturePool::Descriptor descs[] = {descriptor(1920, 1080, 115), descriptor(960, 540, 115),
+                                             descriptor(480, 270, 115),   descriptor(1920, 1080, 252),
+                                             descriptor(1920, 1080, 80),  descriptor(960, 540, 80)};
+    constexpr uint32_t DescCount = sizeof(descs) / sizeof(descs[0]);
+
+    TexturePool pool(settings);
+    std::unordered_map<void *, Model> model;
+    std::vector<void *> held, trimmed;
+    uint64_t nextId = 1, requests = 0, hits = 0;
+    bool hitsMatch = true, latencyKept = true, mostRecent = true, trimsMatch = true, statsMatch = true;
+    for (uint64_t frame = 1; frame <= 3000; ++frame)
+    {
+        // The frame's textures are released at the end of the frame, a few are held into the next ones.
+        trimmed.clear();
+        pool.beginFrame(frame, trimmed);
+        std::vector<void *> expected;
+        for (const auto &[pTexture, m] : model)
+        {
+            if (!m.inUse && m.releasedFrame + settings.maxIdleFrames < frame)
+                expected.push_back(pTexture);
+        }
+        std::sort(trimmed.begin(), trimmed.end());
+        std::sort(expected.begin(), expected.end());
+        trimsMatch = trimsMatch && trimmed == expected;
+        for (void *pTexture : expected)
+            model.erase(pTexture);
+
+        // Bursts of demand for one descriptor, then long quiet spells, so some textures idle out.
+        const uint32_t acquireCount = frame % 200 < 150 ? 2 + random() % 5 : random() % 2;
+        std::vector<void *> acquired;
+        for (uint32_t i = 0; i < acquireCount; ++i)
+        {
+            const uint32_t d = frame % 500 < 250 ? random() % 3 : random() % DescCount;
+            uint64_t newest = 0;
+            bool ready = false;
+            for (const auto &[pTexture, m] : model)
+            {
+                if (!m.inUse && m.desc == descs[d] && m.releasedFrame + settings.frameLatency <= frame)
+                {
+                    ready = true;
+                    newest = std::max(newest, m.releasedFrame);
+                }
+            }
+
+            void *pTexture = pool.acquire(descs[d]);
+            ++requests;
+            hitsMatch = hitsMatch && (pTexture != nullptr) == ready;
+            if (pTexture)
+            {
+                ++hits;
+                auto it = model.find(pTexture);
+                const bool known = it != model.end();
+                latencyKept = latencyKept && known && !it->second.inUse && it->second.desc == descs[d] &&
+                              it->second.releasedFrame + settings.frameLatency <= frame;
+                mostRecent = mostRecent && known && it->second.releasedFrame == newest;
+                if (known)
+                    it->second.inUse = true;
+            }
+            else
+            {
+                pTexture = fakeTexture(nextId++);
+                const uint64_t size = uint64_t(descs[d].width) * descs[d].height * 8;
+                pool.add(descs[d], pTexture, size);
+                model[pTexture] = {descs[d], size, 0, true};
+            }
+            (random() % 8 == 0 ? held : acquired).push_back(pTexture);
+        }
+
+        for (void *pTexture : acquired)
+        {
+            pool.release(pTexture);
+            model[pTexture].inUse = false;
+            model[pTexture].releasedFrame = frame;
+        }
+        if (frame % 7 == 0)
+        {
+            for (void *pTexture : held)
+            {
+                pool.release(pTexture);
+                model[pTexture].inUse = false;
+                model[pTexture].releasedFrame = frame;
+            }
+            held.clear();
+        }
+
+        TexturePool::Stats expectedStats;
+        for (const auto &[pTexture, m] : model)
+        {
+            (m.inUse ? expectedStats.texturesInUse : expectedStats.texturesIdle) += 1;
+            (m.inUse ? expectedStats.bytesInUse : expectedStats.bytesIdle) += m.size;
+        }
+        const TexturePool::Stats &stats = pool.stats();
+        statsMatch = statsMatch && stats.requests == requests && stats.hits == hits &&
+                     stats.texturesInUse == expectedStats.texturesInUse &&
+                     stats.texturesIdle == expectedStats.texturesIdle &&
+                     stats.bytesInUse == expectedStats.bytesInUse && stats.bytesIdle == expectedStats.bytesIdle;
+    }
+    CHECK(hitsMatch);
+    CHECK(latencyKept);
+    CHECK(mostRecent);
+    CHECK(trimsMatch);
+    CHECK(statsMatch);
+    // The loop must exercise both outcomes and trimming.
+    CHECK(hits > requests / 2 && hits < requests);
+    CHECK(nextId > 100);
+}
+
+void testRandomFrames()
+{
+    checkRandomFrames(TexturePool::Settings{3, 20}, 1);
+}
+
+void testSingleFrameLatency()
+{
+    checkRandomFrames(TexturePool::Settings{1, 5}, 2);
+}
+
+void testLongLatency()
+{
+    checkRandomFrames(TexturePool::Settings{6, 60}, 3);
+}
+
+void testReleaseLatency()
+{
+    // Released in frame 10, the texture is not handed out in frames 10 to 12 and is in frame 13.
+    TexturePool pool(TexturePool::Settings{3, 100});
+    const TexturePool::Descriptor desc = descriptor(256, 256, 70);
+    std::vector<void *> trimmed;
+    pool.beginFrame(10, trimmed);
+    CHECK(pool.acquire(desc) == nullptr);
+    pool.add(desc, fakeTexture(1), 1024);
+    pool.release(fakeTexture(1));
+    for (uint64_t frame = 10; frame < 13; ++frame)
+    {
+        pool.beginFrame(frame, trimmed);
+        CHECK(pool.acquire(desc) == nullptr);
+    }
+    pool.beginFrame(13, trimmed);
+    CHECK(pool.acquire(desc) == fakeTexture(1));
+    CHECK(pool.acquire(desc) == nullptr);
+    CHECK(trimmed.empty());
+}
+
+void testTrimming()
+{
+    // Idle since frame 1, textures survive through frame 1 + maxIdleFrames and are trimmed in the frame after; one
+    // acquired and released again in between is kept.
+    TexturePool pool(TexturePool::Settings{2, 10});
+    const TexturePool::Descriptor desc = descriptor(128, 128, 70);
+    std::vector<void *> trimmed;
+    pool.beginFrame(1, trimmed);
+    for (uint64_t id = 1; id <= 3; ++id)
+        pool.add(desc, fakeTexture(id), 100);
+    for (uint64_t id = 1; id <= 3; ++id)
+        pool.release(fakeTexture(id));
+    CHECK(pool.stats().texturesIdle == 3 && pool.stats().bytesIdle == 300);
+
+    pool.beginFrame(5, trimmed);
+    void *pKept = pool.acquire(desc);
+    CHECK(pKept == fakeTexture(3)); // the most recently released
+    pool.release(pKept);
+
+    pool.beginFrame(11, trimmed);
+    CHECK(trimmed.empty());
+    pool.beginFrame(12, trimmed);
+    std::sort(trimmed.begin(), trimmed.end());
+    CHECK(trimmed == std::vector<void *>({fakeTexture(1), fakeTexture(2)}));
+    CHECK(pool.stats().texturesIdle == 1 && pool.stats().bytesIdle == 100);
+    CHECK(pool.acquire(desc) == pKept);
+
+    // Textures in use are never trimmed, however long they are held.
+    trimmed.clear();
+    pool.beginFrame(100, trimmed);
+    CHECK(trimmed.empty() && pool.stats().texturesInUse == 1);
+}
+
+void testDescriptorFields()
+{
+    // Textures differing in any one field are never interchanged.
+    TexturePool pool(TexturePool::Settings{1, 100});
+    std::vector<TexturePool::Descriptor> descs(7, descriptor(64, 64, 70));
+    descs[1].width = 65;
+    descs[2].height = 65;
+    descs[3].pixelFormat = 71;
+    descs[4].usage = 1;
+    descs[5].storageMode = 0;
+    descs[6].sampleCount = 4;
+    std::vector<void *> trimmed;
+    pool.beginFrame(1, trimmed);
+    for (size_t i = 0; i < descs.size(); ++i)
+        pool.add(descs[i], fakeTexture(i + 1), 10);
+    for (size_t i = 0; i < descs.size(); ++i)
+        pool.release(fakeTexture(i + 1));
+    pool.beginFrame(2, trimmed);
+    // The base descriptor first: a field left out of the match would hand it a newer texture of another.
+    bool matched = true;
+    for (size_t i = 0; i < descs.size(); ++i)
+        matched = matched && pool.acquire(descs[i]) == fakeTexture(i + 1);
+    CHECK(matched);
+    CHECK(pool.stats().hitRate() == 1.0f);
+}
+
+void testClear()
+{
+    TexturePool pool(TexturePool::Settings{});
+    const TexturePool::Descriptor desc = descriptor(64, 64, 70);
+    std::vector<void *> removed;
+    pool.beginFrame(1, removed);
+    pool.add(desc, fakeTexture(1), 10);
+    pool.add(desc, fakeTexture(2), 10);
+    pool.release(fakeTexture(2));
+    pool.clear(removed);
+    std::sort(removed.begin(), removed.end());
+    CHECK(removed == std::vector<void *>({fakeTexture(1), fakeTexture(2)}));
+    CHECK(pool.stats().texturesInUse == 0 && pool.stats().texturesIdle == 0 && pool.stats().bytesIdle == 0);
+    pool.beginFrame(10, removed);
+    CHECK(pool.acquire(desc) == nullptr);
+}
+} // namespace
+
+int main()
+{
+    return Test::run({{"random frames match the model", testRandomFrames},
+                      {"random frames, one frame of latency", testSingleFrameLatency},
+                      {"random frames, six frames of latency", testLongLatency},
+                      {"no reuse within frameLatency frames", testReleaseLatency},
+                      {"idle textures are trimmed", testTrimming},
+                      {"every descriptor field is matched", testDescriptorFields},
+                      {"clear", testClear}});
+}
@@ -0,0 +1,177 @@
+// TlsfAllocator under random allocate and free sequences: live allocations never overlap, stay inside the capacity,
+// start at multiples of their alignment and the granularity, and cover their size; the stats agree with the live
+// set; an allocation only fails when no free block is close to large enough; and freeing everything, in any order,
+// coalesces the free space back into one block the size of the whole range.
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "Test.h"
+#include "TlsfAllocator.h"
+
+namespace
+{
+struct Live {
+    TlsfAllocator::Allocation allocation;
+    uint64_t size, alignment;
+};
+
+// Sorted by offset, each allocation must end before the next begins.
+bool consistent(const TlsfAllocator &allocator, std::vector<Live> live, uint64_t granularity)
+{
+    std::sort(live.begin(), live.end(),
+              [](const Live &a, const Live &b) { return a.allocation.offset < b.allocation.offset; });
+    bool ok = true;
+    uint64_t used = 0, end = 0;
+    for (const Live &l : live)
+    {
+        const TlsfAllocator::Allocation &a = l.allocation;
+        ok = ok && a.valid() && a.offset >= end && a.offset % l.alignment == 0 && a.offset % granularity == 0;
+        ok = ok && a.size >= l.size && a.size < l.size + granularity && a.offset + a.size <= allocator.capacity();
+        end = a.offset + a.size;
+        used += a.size;
+    }
+    const TlsfAllocator::Stats stats = allocator.stats();
+    return ok && allocator.usedSize() == used && stats.usedSize == used && stats.allocationCount == live.size() &&
+           stats.largestFreeBlock <= allocator.capacity() - used;
+}
+
+size_t churn(uint64_t capacity, uint64_t granularity, uint64_t maxSize, uint32_t seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<uint64_t> size(1, maxSize);
+    std::uniform_int_distribution<uint32_t> alignmentShift(0, 16), action(0, 99);
+
+    TlsfAllocator allocator(capacity, granularity);
+    std::vector<Live> live;
+    bool ok = true, failuresJustified = true;
+    size_t failures = 0;
+    for (int step = 0; step < 20000; ++step)
+    {
+        // Mostly allocating until the range is well filled, then as many frees as allocations.
+        const bool allocate = live.empty() || action(random) < (allocator.usedSize() < capacity / 2 ? 80u : 50u);
+        if (allocate)
+        {
+            const uint64_t s = size(random), alignment = uint64_t(1) << alignmentShift(random);
+            const TlsfAllocator::Allocation a = allocator.allocate(s, alignment);
+            if (a.valid())
+            {
+                live.push_back({a, s, alignment});
+            }
+            else
+            {
+                // Lists are searched from the next size class boundary above size plus alignment slack, at most
+                // a sixteenth more, so a failure means no free block reaches that.
+                const uint64_t units =
+                    (s + granularity - 1) / granularity + std::max<uint64_t>(alignment / granularity, 1);
+                failuresJustified =
+                    failuresJustified && allocator.stats().largestFreeBlock < (units + units / 16 + 1) * granularity;
+                ++failures;
+            }
+        }
+        else
+        {
+            const size_t index = random() % live.size();
+            allocator.free(live[index].allocation);
+            live[index] = live.back();
+            live.pop_back();
+        }
+        if (step % 97 == 0)
+            ok = ok && consistent(allocator, live, granularity);
+    }
+    CHECK(ok && consistent(allocator, live, granularity));
+    CHECK(failuresJustified);
+    CHECK(live.size() > 20);
+
+    // Freeing everything in random order leaves one free block spanning the range.
+    std::shuffle(live.begin(), live.end(), random);
+    for (const Live &l : live)
+        allocator.free(l.allocation);
+    const TlsfAllocator::Stats stats = allocator.stats();
+    CHECK(stats.usedSize == 0 && stats.allocationCount == 0);
+    CHECK(stats.freeBlockCount == 1);
+    CHECK(stats.largestFreeBlock == capacity);
+    CHECK(stats.fragmentation == 0.0f);
+    const TlsfAllocator::Allocation whole = allocator.allocate(capacity);
+    CHECK(whole.valid() && whole.offset == 0 && whole.size == capacity);
+    return failures;
+}
+
+void testSmallAllocations()
+{
+    churn(uint64_t(1) << 24, 256, 64 * 1024, 1);
+}
+
+void testLargeAllocations()
+{
+    // Many allocations fail once the range is full.
+    CHECK(churn(uint64_t(1) << 26, 256, uint64_t(4) << 20, 2) > 100);
+}
+
+void testFineGranularity()
+{
+    churn(uint64_t(1) << 20, 16, 4096, 3);
+}
+
+void testExactFill()
+{
+    // A range filled with granularity-sized allocations has no room left, and freeing every other one fragments it.
+    TlsfAllocator allocator(64 * 256, 256);
+    std::vector<TlsfAllocator::Allocation> allocations;
+    for (int i = 0; i < 64; ++i)
+        allocations.push_back(allocator.allocate(1));
+    std::vector<Live> live;
+    for (const TlsfAllocator::Allocation &a : allocations)
+        live.push_back({a, 1, 1});
+    CHECK(consistent(allocator, live, 256));
+    CHECK(!allocator.allocate(1).valid());
+
+    for (size_t i = 0; i < allocations.size(); i += 2)
+        allocator.free(allocations[i]);
+    TlsfAllocator::Stats stats = allocator.stats();
+    CHECK(stats.freeBlockCount == 32 && stats.largestFreeBlock == 256);
+    CHECK(stats.fragmentation > 0.9f);
+    CHECK(!allocator.allocate(512).valid());
+
+    // Freeing the rest merges each with both neighbours.
+    for (size_t i = 1; i < allocations.size(); i += 2)
+        allocator.free(allocations[i]);
+    stats = allocator.stats();
+    CHECK(stats.freeBlockCount == 1 && stats.largestFreeBlock == 64 * 256);
+}
+
+void testAlignmentPadding()
+{
+    // The padding in front of an aligned allocation stays free and is handed out again. It is 255 granules, so a
+    // request of 248, the bottom of its list, finds it.
+    TlsfAllocator allocator(1 << 20, 256);
+    const TlsfAllocator::Allocation first = allocator.allocate(256);
+    const TlsfAllocator::Allocation aligned = allocator.allocate(1000, 64 * 1024);
+    CHECK(first.offset == 0 && aligned.offset == 64 * 1024 && aligned.size == 1024);
+    CHECK(allocator.stats().freeBlockCount == 2);
+    const TlsfAllocator::Allocation padding = allocator.allocate(62 * 1024);
+    CHECK(padding.valid() && padding.offset == 256 && padding.offset + padding.size <= aligned.offset);
+}
+
+void testCapacityRounding()
+{
+    // Capacity beyond the last whole granule is never handed out.
+    TlsfAllocator allocator(1000, 256);
+    const TlsfAllocator::Allocation a = allocator.allocate(768);
+    CHECK(a.valid() && a.offset + a.size <= 768);
+    CHECK(!allocator.allocate(1).valid());
+    TlsfAllocator empty(100, 256);
+    CHECK(!empty.allocate(1).valid() && empty.stats().freeBlockCount == 0);
+}
+} // namespace
+
+int main()
+{
+    return Test::run({{"small allocations never overlap and coalesce", testSmallAllocations},
+                      {"large allocations never overlap and coalesce", testLargeAllocations},
+                      {"fine granularity", testFineGranularity},
+                      {"exact fill and checkerboard", testExactFill},
+                      {"alignment padding is reused", testAlignmentPadding},
+                      {"capacity rounding", testCapacityRounding}});
+}
@@ -0,0 +1,251 @@
+// TransformHierarchy against a naive recursive reference: after random local changes, reparents, destroys and
+// creates, every live node's world matrix matches parent world * local computed by walking up the parent chain,
+// whether update() runs serially or across the job system, and parents always sit in earlier slots.
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "JobSystem.h"
+#include "SimdMath.h"
+#include "Test.h"
+#include "TransformHierarchy.h"
+
+namespace
+{
+using SimdMath::float3;
+using SimdMath::float4x4;
+using SimdMath::quatf;
+using NodeId = TransformHierarchy::NodeId;
+
+struct ReferenceNode {
+    bool alive = false;
+    bool destroyed = false;
+    NodeId parent = TransformHierarchy::InvalidNode;
+    float3 translation = {0.0f, 0.0f, 0.0f};
+    quatf rotation = quatf::identity();
+    float3 scale = {1.0f, 1.0f, 1.0f};
+};
+
+// Mirrors every call on a TransformHierarchy and recomputes world matrices from scratch.
+class Scene {
+  public:
+    explicit Scene(uint32_t seed) : _random(seed) {}
+
+    NodeId create(NodeId parent)
+    {
+        const NodeId node = _hierarchy.create(parent);
+        if (node >= _nodes.size())
+            _nodes.resize(node + 1);
+        CHECK(!_nodes[node].alive);
+        _nodes[node] = ReferenceNode();
+        _nodes[node].alive = true;
+        _nodes[node].parent = parent;
+        setRandomLocal(node);
+        return node;
+    }
+
+    void setRandomLocal(NodeId node)
+    {
+        ReferenceNode &n = _nodes[node];
+        n.translation = {uniform(-2.0f, 2.0f), uniform(-2.0f, 2.0f), uniform(-2.0f, 2.0f)};
+        n.rotation = SimdMath::quatf::fromAxisAngle(SimdMath::normalize(float3{uniform(-1.0f, 1.0f),
+                                                                               uniform(-1.0f, 1.0f), 1.0f}),
+                                                    uniform(-3.0f, 3.0f));
+        n.scale = {uniform(0.8f, 1.2f), uniform(0.8f, 1.2f), uniform(0.8f, 1.2f)};
+        const float t[3] = {n.translation.x, n.translation.y, n.translation.z};
+        const float r[4] = {n.rotation.x, n.rotation.y, n.rotation.z, n.rotation.w};
+        const float s[3] = {n.scale.x, n.scale.y, n.scale.z};
+        _hierarchy.setLocal(node, t, r, s);
+    }
+
+    void destroy(NodeId node)
+    {
+        _hierarchy.destroy(node);
+        _nodes[node].destroyed = true;
+    }
+
+    // False, without changing anything, if parent is the node or one of its descendants.
+    bool setParent(NodeId node, NodeId parent)
+    {
+        for (NodeId a = parent; a != TransformHierarchy::InvalidNode; a = _nodes[a].parent)
+        {
+            if (a == node)
+                return false;
+        }
+        _hierarchy.setParent(node, parent);
+        _nodes[node].parent = parent;
+        return true;
+    }
+
+    void update(JobSystem *pJobs)
+    {
+        _hierarchy.update(pJobs);
+        for (NodeId node = 0; node < _nodes.size(); ++node)
+        {
+            if (_nodes[node].alive && isDestroyed(node))
+                _nodes[node].alive = false;
+        }
+        for (ReferenceNode &n : _nodes)
+            n.destroyed = false;
+    }
+
+    void check() const
+    {
+        size_t liveCount = 0;
+        for (NodeId node = 0; node < _nodes.size(); ++node)
+        {
+            if (!_nodes[node].alive)
+            {
+                CHECK(_hierarchy.slotOf(node) == TransformHierarchy::InvalidNode);
+                continue;
+            }
+            ++liveCount;
+            const NodeId parent = _nodes[node].parent;
+            CHECK(_hierarchy.parent(node) == parent);
+            if (parent != TransformHierarchy::InvalidNode)
+                CHECK(_hierarchy.slotOf(parent) < _hierarchy.slotOf(node));
+
+            const float4x4 expected = world(node);
+            const float *actual = _hierarchy.worldMatrix(node).m;
+            CHECK(&_hierarchy.worldMatrices()[_hierarchy.slotOf(node)] == &_hierarchy.worldMatrix(node));
+            bool close = true;
+            for (int i = 0; i < 16; ++i)
+                close = close && std::fabs(actual[i] - expected.data()[i]) <= 1e-3f * (1.0f + std::fabs(actual[i]));
+            CHECK(close);
+        }
+        CHECK(_hierarchy.size() == liveCount);
+    }
+
+    // A random live node that is not waiting to be destroyed, or InvalidNode if there is none.
+    NodeId randomLiveNode()
+    {
+        for (int attempt = 0; attempt < 64 && !_nodes.empty(); ++attempt)
+        {
+            const NodeId node = NodeId(std::uniform_int_distribution<size_t>(0, _nodes.size() - 1)(_random));
+            if (_nodes[node].alive && !isDestroyed(node))
+                return node;
+        }
+        return TransformHierarchy::InvalidNode;
+    }
+
+    float uniform(float low, float high) { return std::uniform_real_distribution<float>(low, high)(_random); }
+
+  private:
+    bool isDestroyed(NodeId node) const
+    {
+        for (NodeId a = node; a != TransformHierarchy::InvalidNode; a = _nodes[a].parent)
+        {
+            if (_nodes[a].destroyed)
+                return true;
+        }
+        return false;
+    }
+
+    float4x4 world(NodeId node) const
+    {
+        const ReferenceNode &n = _nodes[node];
+        const float4x4 local = float4x4::transform(n.translation, n.rotation, n.scale);
+        return n.parent == TransformHierarchy::InvalidNode ? local : world(n.parent) * local;
+    }
+
+    TransformHierarchy _hierarchy;
+    std::vector<ReferenceNode> _nodes;
+    std::mt19937 _random;
+};
+
+// A forest of roughly depth-first chains and wide fans, created in an order that is not depth-sorted.
+void buildForest(Scene &scene, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const bool root = i % 500 == 0 || scene.uniform(0.0f, 1.0f) < 0.02f;
+        scene.create(root ? TransformHierarchy::InvalidNode : scene.randomLiveNode());
+    }
+}
+
+void testPropagationMatchesReference(JobSystem *pJobs)
+{
+    Scene scene(7);
+    buildForest(scene, 20000);
+    scene.update(pJobs);
+    scene.check();
+
+    for (int frame = 0; frame < 4; ++frame)
+    {
+        for (int i = 0; i < 2000; ++i)
+            scene.setRandomLocal(scene.randomLiveNode());
+        scene.update(pJobs);
+        scene.check();
+    }
+}
+
+void testSerialPropagation()
+{
+    testPropagationMatchesReference(nullptr);
+}
+
+void testParallelPropagation()
+{
+    JobSystem jobs(4);
+    testPropagationMatchesReference(&jobs);
+}
+
+void testReparentDestroyAndCreate()
+{
+    JobSystem jobs(4);
+    Scene scene(11);
+    buildForest(scene, 10000);
+    scene.update(&jobs);
+
+    for (int frame = 0; frame < 20; ++frame)
+    {
+        int reparented = 0;
+        while (reparented < 200)
+        {
+            const NodeId node = scene.randomLiveNode();
+            const NodeId parent = scene.uniform(0.0f, 1.0f) < 0.1f ? TransformHierarchy::InvalidNode
+                                                                    : scene.randomLiveNode();
+            reparented += scene.setParent(node, parent);
+        }
+        for (int i = 0; i < 20; ++i)
+            scene.destroy(scene.randomLiveNode());
+        for (int i = 0; i < 200; ++i)
+            scene.setRandomLocal(scene.randomLiveNode());
+        // Created under nodes that survive this frame's destroys; on later frames create() reuses freed ids.
+        for (int i = 0; i < 300; ++i)
+            scene.create(scene.uniform(0.0f, 1.0f) < 0.1f ? TransformHierarchy::InvalidNode : scene.randomLiveNode());
+
+        scene.update(frame % 2 ? &jobs : nullptr);
+        scene.check();
+    }
+}
+
+void testDestroyEverything()
+{
+    Scene scene(13);
+    std::vector<NodeId> roots;
+    for (int i = 0; i < 10; ++i)
+        roots.push_back(scene.create(TransformHierarchy::InvalidNode));
+    for (int i = 0; i < 1000; ++i)
+        scene.create(scene.randomLiveNode());
+    scene.update(nullptr);
+
+    for (NodeId root : roots)
+        scene.destroy(root);
+    scene.update(nullptr);
+    scene.check();
+
+    buildForest(scene, 100);
+    scene.update(nullptr);
+    scene.check();
+}
+} // namespace
+
+int main()
+{
+    return Test::run({{"serial propagation matches reference", testSerialPropagation},
+                      {"parallel propagation matches reference", testParallelPropagation},
+                      {"reparent, destroy and create", testReparentDestroyAndCreate},
+                      {"destroy everything", testDestroyEverything}});
+}